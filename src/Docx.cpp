@@ -0,0 +1,151 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+// Local Project
+#include "Interface.hpp"
+#include "core/docxImpl.hpp"
+#include "core/renderScheduler.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+/* A Pixmap that owns a reference to the pooled pixels it points into */
+class PixmapHolder {
+public:
+  Pixmap pixmap;
+  std::shared_ptr<const RasterImage> image;
+};
+
+std::shared_ptr<Pixmap> toPixmap(std::shared_ptr<const RasterImage> image) {
+  auto holder = std::make_shared<PixmapHolder>();
+  holder->pixmap.data = image->pixels.get();
+  holder->pixmap.width = image->width;
+  holder->pixmap.height = image->height;
+  holder->pixmap.pixelBytes = 4;
+  holder->image = std::move(image);
+  return std::shared_ptr<Pixmap>(holder, &holder->pixmap);
+}
+
+} // namespace
+
+Docx::Docx() : impl(std::make_shared<DocxImpl>()) {
+  scheduler = std::make_shared<RenderScheduler>(
+      impl, [this](const RenderUpdate &update) {
+        if (!updateCallback)
+          return;
+        updateCallback(toPixmap(update.image),
+                       {this, (int)update.pageIndex, (int)update.dpi,
+                        update.x, update.y, update.preview});
+      });
+}
+
+Docx::~Docx() { scheduler = nullptr; }
+
+void Docx::openFile(std::string fileName) {
+  // nothing may render from the archive being replaced
+  scheduler->cancelAll();
+  scheduler->wait();
+  impl->openFile(fileName);
+}
+
+int Docx::getError() { return impl->getError(); }
+
+int Docx::getInfoPagesTotal(PagesTotalMode mode) {
+  uint32_t pageTotal = 0;
+  int32_t err = mode == PagesTotalMode::Stored
+                    ? impl->getPagesTotalStored(pageTotal)
+                    : impl->getPagesTotalLayout(pageTotal);
+  return err == MZ_OK ? (int)pageTotal : -1;
+}
+
+std::shared_ptr<Pixmap> Docx::getPixmap(int pageNum, int dpi) {
+  std::shared_ptr<const RasterImage> image;
+  if (pageNum < 0 || dpi <= 0 ||
+      impl->getPageImage((uint32_t)pageNum, (uint32_t)dpi, image) != MZ_OK)
+    return nullptr;
+  return toPixmap(std::move(image));
+}
+
+std::shared_ptr<Pixmap> Docx::getPixmapTile(int pageNum, int tileX, int tileY,
+                                            int dpi) {
+  std::shared_ptr<const RasterImage> image;
+  if (pageNum < 0 || tileX < 0 || tileY < 0 || dpi <= 0 ||
+      impl->getTile((uint32_t)pageNum, (uint32_t)dpi, (uint32_t)tileX,
+                    (uint32_t)tileY, image) != MZ_OK)
+    return nullptr;
+  return toPixmap(std::move(image));
+}
+
+void Docx::renderPage(int pageNum, RenderPriority priority, int dpi) {
+  if (pageNum < 0 || dpi <= 0)
+    return;
+  scheduler->requestPage((uint32_t)pageNum, (uint32_t)dpi,
+                         priority == RenderPriority::Visible ? renderVisible
+                                                             : renderPrefetch);
+}
+
+void Docx::setViewport(int firstPage, int lastPage, int dpi) {
+  if (firstPage < 0 || lastPage < firstPage || dpi <= 0)
+    return;
+  scheduler->setViewport((uint32_t)firstPage, (uint32_t)lastPage,
+                         (uint32_t)dpi);
+}
+
+void Docx::cancelRender(int pageNum) {
+  if (pageNum >= 0)
+    scheduler->cancelPage((uint32_t)pageNum);
+}
+
+void Docx::setPart(std::string partName, std::string data) {
+  impl->setPart(std::move(partName), std::move(data));
+}
+
+void Docx::removePart(std::string partName) {
+  impl->removePart(std::move(partName));
+}
+
+int Docx::saveFile(std::string fileName) { return impl->saveFile(fileName); }
+
+int Docx::saveToMemory(std::vector<char> &buffer) {
+  ZipMemorySink sink;
+  int32_t err = impl->save(sink);
+  if (err == MZ_OK)
+    buffer = std::move(sink.buffer);
+  return err;
+}
+
+int Docx::extractText(docx_text_cb_t callback) {
+  return impl->extractText([&callback](const TextParagraph &paragraph) {
+    callback({(int)paragraph.paragraphIndex, (int)paragraph.pageIndex,
+              paragraph.text});
+  });
+}
+
+DocxMetrics Docx::getMetrics() {
+  DocumentMetrics::Snapshot snapshot = impl->getMetrics();
+  MemoryAccountant::Usage usage = impl->getMemoryUsage();
+  return {snapshot.documentId,      snapshot.bytesInflated,
+          snapshot.partsTouched,
+          snapshot.allocationTotal, snapshot.allocationBytes,
+          snapshot.arenaPeakBytes,  snapshot.cacheHits,
+          snapshot.cacheMisses,     snapshot.errorTotal,
+          usage.modelBytes,         usage.partBytes,
+          usage.pixmapBytes};
+}
+
+std::string Docx::getFileName() { return impl->getFileName(); }
+
+void Docx::setUpdateCallback(pixmap_update_cb_t callback) {
+  updateCallback = std::move(callback);
+}
+
+} // namespace bookfiler
@@ -12,6 +12,9 @@
 // c++17
 #include <functional>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 /* boost 1.72.0
@@ -46,26 +49,181 @@ public:
 };
 #endif // end BOOKFILER_PIXMAP_H
 
+/* Pixel edge of the tiles getPixmapTile returns */
+const long pixmapTileSize = 256;
+
+/* Counters of the module wide cache of rendered tiles */
+class PixmapCacheStats {
+public:
+  unsigned long long hits, misses, evictions;
+  unsigned long long bytes, budget;
+  // glyph atlas and shaped run cache lookups
+  unsigned long long glyphHits, glyphMisses, shapedRunHits, shapedRunMisses;
+};
+
+/* Counters of one open document, see getMetricsSnapshot */
+class DocxMetrics {
+public:
+  // unique in the process, tags the document's trace events
+  unsigned long long documentId;
+  unsigned long long bytesInflated, partsTouched;
+  unsigned long long allocations, allocationBytes, arenaPeakBytes;
+  unsigned long long cacheHits, cacheMisses, errors;
+  // bytes held now: model and layout, cached inflated parts, tiles
+  unsigned long long modelBytes, partBytes, pixmapBytes;
+};
+
+/* Memory held for every open document against the "memoryBudgetBytes"
+ * setting. total is the budget, 0 when there is none, and available what is
+ * left of it. Over budget, cold pixmaps are evicted first, then inflated
+ * parts, then the models of idle documents, which are read again from
+ * their archive on next use.
+ */
 class DocxMonitor {
 public:
   unsigned long available, total;
+  unsigned long used, modelBytes, partBytes, pixmapBytes;
+  unsigned long documents;
+  unsigned long long pixmapEvictions, partEvictions, modelEvictions;
+};
+
+class DocxImpl;
+class RenderScheduler;
+class Docx;
+
+/* One paragraph of body text, see Docx::extractText */
+class DocxTextParagraph {
+public:
+  // in document order, paragraphs without text counted
+  int paragraph;
+  // from the page breaks saved in the file, nothing is laid out
+  int page;
+  // UTF-8 with '\t', '\n' and '\f' for tabs, line and page breaks. Valid
+  // during the callback only.
+  std::string_view text;
 };
 
+using docx_text_cb_t = std::function<void(const DocxTextParagraph &)>;
+
+/* A match of DocxInterface::searchText */
+class DocxSearchHit {
+public:
+  std::shared_ptr<Docx> docx;
+  int paragraph, page;
+  // bytes into the paragraph's text as extractText delivers it
+  long offset, length;
+};
+
+/* Queue order of background renders */
+enum class RenderPriority { Visible, Prefetch };
+
+/* Where a pixmap delivered by imageUpdateSignal belongs */
+class PixmapUpdate {
+public:
+  Docx *docx;
+  int pageNum, dpi;
+  /* page pixel at dpi of the pixmap's top left corner */
+  long x, y;
+  /* low resolution whole page, replaced by the tiles that follow */
+  bool preview;
+};
+
+using pixmap_update_cb_t =
+    std::function<void(std::shared_ptr<Pixmap>, const PixmapUpdate &)>;
+
+/* How getInfoPagesTotal counts.
+ * Stored: the count the application that last saved the file wrote into
+ *   docProps/app.xml. Instant, but missing or stale for some producers.
+ * Layout: lays the document out (line and page breaks only, nothing is
+ *   drawn). Slower on first use, then cached by file contents; with the
+ *   "diskCacheDirectory" setting the count and the parsed document are
+ *   kept across runs, and openFile on a cached file reads no XML.
+ */
+enum class PagesTotalMode { Stored, Layout };
+
 /* The docx format is dynamic
  * this class should also be dynamic
  * Use PDF for absolute page positioning
  * Can't get number of pages until document is rendered
+ *
+ * Thread safe: any number of threads may render, read, edit and save one
+ * Docx at once, e.g. a server drawing different pages of the same popular
+ * document for different requests. What is parsed and laid out is built
+ * once and shared read only. A call running while openFile replaces the
+ * document finishes on the document it started on. Only
+ * setUpdateCallback must come before the first render.
  */
 class Docx {
 public:
+  Docx();
+  ~Docx();
+  // background renders call back into this object, it must stay put
+  Docx(const Docx &) = delete;
+  Docx &operator=(const Docx &) = delete;
+  Docx(Docx &&) = delete;
+  Docx &operator=(Docx &&) = delete;
   /* UTF8 encoded file path
    */
   void openFile(std::string);
-  /* Get page count from the meta data the previous renderer stored
+  /* Error code of the last openFile, 0 on success
    */
-  int getInfoPagesTotal();
+  int getError();
+  /* Get the page count, -1 when it can't be worked out
+   */
+  int getInfoPagesTotal(PagesTotalMode mode = PagesTotalMode::Stored);
 
-  std::shared_ptr<Pixmap> getPixmap(int pageNum);
+  /* Render page pageNum (0 based) at dpi. RGBA, pixelBytes is 4. The pixel
+   * memory is pooled and stays valid while the returned pointer lives.
+   * nullptr when the page does not exist
+   */
+  std::shared_ptr<Pixmap> getPixmap(int pageNum, int dpi = 96);
+  /* One pixmapTileSize square of the page, cut short at the right and bottom
+   * edges. Tiles are cached, the pixels are shared and must not be written.
+   */
+  std::shared_ptr<Pixmap> getPixmapTile(int pageNum, int tileX, int tileY,
+                                        int dpi = 96);
+  /* Render in the background, the result arrives tile by tile through
+   * DocxInterface::imageUpdateSignal on a worker thread, preceded by a low
+   * resolution preview of the page.
+   */
+  void renderPage(int pageNum,
+                  RenderPriority priority = RenderPriority::Visible,
+                  int dpi = 96);
+  /* Pages [firstPage, lastPage] are on screen: they render first, their
+   * neighbours are prefetched and work for every other page is cancelled.
+   */
+  void setViewport(int firstPage, int lastPage, int dpi = 96);
+  void cancelRender(int pageNum);
+  /* Replace the contents of a part, e.g. "word/document.xml", in what the
+   * save functions write. The pages shown still come from the opened file.
+   */
+  void setPart(std::string partName, std::string data);
+  void removePart(std::string partName);
+  /* Write the document with the parts set since openFile. The other parts
+   * are copied as they are, without being decompressed. The opened file
+   * may be the target.
+   * @return 0 on success, otherwise the error code
+   */
+  int saveFile(std::string fileName);
+  int saveToMemory(std::vector<char> &buffer);
+  /* Body text paragraph by paragraph in document order, streamed from the
+   * file without parsing the whole document or laying it out. Paragraphs
+   * without text are not delivered.
+   * @return 0 on success, otherwise the error code
+   */
+  int extractText(docx_text_cb_t callback);
+  /* Counters since the last openFile */
+  DocxMetrics getMetrics();
+  /* The file last opened, as given to openFile */
+  std::string getFileName();
+  /* Set by the module to feed imageUpdateSignal, before any rendering */
+  void setUpdateCallback(pixmap_update_cb_t callback);
+
+private:
+  std::shared_ptr<DocxImpl> impl;
+  pixmap_update_cb_t updateCallback;
+  // declared last so it is destroyed, and its jobs finished, first
+  std::shared_ptr<RenderScheduler> scheduler;
 };
 
 using settings_cb_t = std::function<void(std::shared_ptr<rapidjson::Document>)>;
@@ -77,7 +235,29 @@ public:
       std::shared_ptr<std::unordered_map<std::string, settings_cb_t>>) = 0;
   virtual void setSettings(std::shared_ptr<rapidjson::Value> data) = 0;
   virtual std::shared_ptr<Docx> newDocx() = 0;
-  boost::signals2::signal<void(std::shared_ptr<Pixmap>)> imageUpdateSignal;
+  virtual PixmapCacheStats getPixmapCacheStats() = 0;
+  virtual DocxMonitor getDocxMonitor() = 0;
+  /* Trace span totals, the counters of every live Docx from newDocx, the
+   * cache statistics and the memory use as one JSON object. Also delivered
+   * by the "DocxMetricsCB" settings callback into the document it is given.
+   */
+  virtual std::shared_ptr<rapidjson::Document> getMetricsSnapshot() = 0;
+  /* Brings the full text index up to date with every live Docx from
+   * newDocx, nothing is indexed before the first call. Documents indexed
+   * since their last openFile are skipped, the others are read in parallel
+   * on workers of this call and ones no longer alive are dropped. Once
+   * dropped documents outnumber the rest the index starts over.
+   * @return the documents indexed by this call
+   */
+  virtual int indexText() = 0;
+  /* Hits for a word or a phrase, ASCII letters in any case, the words of a
+   * phrase adjacent in one paragraph. In the order the documents were
+   * indexed, then in document order.
+   */
+  virtual std::vector<DocxSearchHit> searchText(std::string query,
+                                                int hitMax = 100) = 0;
+  boost::signals2::signal<void(std::shared_ptr<Pixmap>, const PixmapUpdate &)>
+      imageUpdateSignal;
 };
 
 } // namespace bookfiler
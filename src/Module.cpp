@@ -6,6 +6,10 @@
  * @brief filesystem database and utilities
  */
 
+// C++
+#include <algorithm>
+#include <thread>
+
 /* rapidjson v1.1 (2016-8-25)
  * Developed by Tencent
  * License: MITs
@@ -14,6 +18,15 @@
 
 // Local Project
 #include "Module.hpp"
+#include "core/bufferPool.hpp"
+#include "core/diskCache.hpp"
+#include "core/glyphCache.hpp"
+#include "core/mediaCache.hpp"
+#include "core/memoryAccountant.hpp"
+#include "core/pixelKernel.hpp"
+#include "core/threadPool.hpp"
+#include "core/tileCache.hpp"
+#include "core/trace.hpp"
 
 /*
  * bookfiler = BookFiler™
@@ -34,6 +47,12 @@ void ModuleExport::registerSettings(
   moduleCallbackMap->insert(
       {"FilesystemDatabaseCB",
        std::bind(&ModuleExport::setSettings, this, std::placeholders::_1)});
+  // the caller passes a document and reads the snapshot out of it
+  moduleRequest->AddMember("DocxMetrics", "DocxMetricsCB",
+                           moduleRequest->GetAllocator());
+  moduleCallbackMap->insert(
+      {"DocxMetricsCB",
+       std::bind(&ModuleExport::writeMetrics, this, std::placeholders::_1)});
 }
 
 void ModuleExport::setSettings(std::shared_ptr<rapidjson::Value> data) {
@@ -44,12 +63,330 @@ void ModuleExport::setSettings(std::shared_ptr<rapidjson::Value> data) {
   std::cout << "bookfiler::ModuleExport::setSettings:\n"
             << buffer.GetString() << std::endl;
 #endif
+  if (!data->IsObject())
+    return;
+  // bytes of rendered tiles kept for scrolling back
+  auto member = data->FindMember("pixmapCacheBytes");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    tileCache().setByteBudget((size_t)member->value.GetUint64());
+  // bytes of embedded images decoded at the size they are drawn
+  member = data->FindMember("mediaCacheBytes");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    mediaCache().setByteBudget((size_t)member->value.GetUint64());
+  // bytes of released pixel buffers kept for reuse
+  member = data->FindMember("pixmapPoolBytes");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    pixmapBufferPool().setRetainMax((size_t)member->value.GetUint64());
+  // bytes of released inflated part buffers kept for reuse
+  member = data->FindMember("partPoolBytes");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    partBufferPool().setRetainMax((size_t)member->value.GetUint64());
+  // bytes of rasterized glyph masks, 0 rasterizes every glyph as drawn
+  member = data->FindMember("glyphAtlasBytes");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    glyphAtlas().setByteBudget((size_t)member->value.GetUint64());
+  // bytes of runs mapped to glyphs and advances
+  member = data->FindMember("shapedRunBytes");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    shapedRunCache().setByteBudget((size_t)member->value.GetUint64());
+  // bytes held for all open documents together, 0 for no limit
+  member = data->FindMember("memoryBudgetBytes");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    memoryAccountant().setByteBudget((size_t)member->value.GetUint64());
+  // parsed models and page counts kept here across runs, "" turns it off
+  member = data->FindMember("diskCacheDirectory");
+  if (member != data->MemberEnd() && member->value.IsString())
+    diskCache().setDirectory(member->value.GetString());
+  // "off", "stats" or "events", events are what traceDump writes
+  member = data->FindMember("traceMode");
+  if (member != data->MemberEnd() && member->value.IsString()) {
+    std::string mode = member->value.GetString();
+    if (mode == "off")
+      tracer().setMode(TraceMode::Off);
+    else if (mode == "stats")
+      tracer().setMode(TraceMode::Stats);
+    else if (mode == "events")
+      tracer().setMode(TraceMode::Events);
+  }
+  // trace events kept, later ones are dropped and counted
+  member = data->FindMember("traceEventCapacity");
+  if (member != data->MemberEnd() && member->value.IsUint64())
+    tracer().setEventCapacity((size_t)member->value.GetUint64());
+  // writes the events so far as Chrome trace JSON to this file
+  member = data->FindMember("traceDump");
+  if (member != data->MemberEnd() && member->value.IsString())
+    tracer().writeChromeTrace(member->value.GetString());
 }
 
 std::shared_ptr<Docx> ModuleExport::newDocx(){
     std::shared_ptr<Docx> modelPtr = std::make_shared<Docx>();
+    modelPtr->setUpdateCallback(
+        [this](std::shared_ptr<Pixmap> pixmap, const PixmapUpdate &update) {
+          imageUpdateSignal(pixmap, update);
+        });
+    std::lock_guard<std::mutex> lock(DocxListMutex);
+    DocxList.erase(std::remove_if(DocxList.begin(), DocxList.end(),
+                                  [](const std::weak_ptr<Docx> &docx) {
+                                    return docx.expired();
+                                  }),
+                   DocxList.end());
     DocxList.push_back(modelPtr);
     return modelPtr;
 }
 
+PixmapCacheStats ModuleExport::getPixmapCacheStats() {
+  TileCache::Stats stats = tileCache().getStats();
+  GlyphAtlas::Stats glyphStats = glyphAtlas().getStats();
+  ShapedRunCache::Stats runStats = shapedRunCache().getStats();
+  return {stats.hitTotal,       stats.missTotal,      stats.evictionTotal,
+          stats.byteTotal,      stats.byteBudget,     glyphStats.hitTotal,
+          glyphStats.missTotal, runStats.hitTotal,    runStats.missTotal};
+}
+
+DocxMonitor ModuleExport::getDocxMonitor() {
+  MemoryAccountant::Stats stats = memoryAccountant().getStats();
+  DocxMonitor monitor;
+  monitor.total = (unsigned long)stats.byteBudget;
+  monitor.used = (unsigned long)stats.usage.total();
+  monitor.available =
+      stats.byteBudget > stats.usage.total()
+          ? (unsigned long)(stats.byteBudget - stats.usage.total())
+          : 0;
+  monitor.modelBytes = (unsigned long)stats.usage.modelBytes;
+  monitor.partBytes = (unsigned long)stats.usage.partBytes;
+  monitor.pixmapBytes = (unsigned long)stats.usage.pixmapBytes;
+  monitor.documents = (unsigned long)stats.documentTotal;
+  monitor.pixmapEvictions = stats.pixmapEvictionTotal;
+  monitor.partEvictions = stats.partEvictionTotal;
+  monitor.modelEvictions = stats.modelEvictionTotal;
+  return monitor;
+}
+
+int ModuleExport::indexText() {
+  std::vector<std::shared_ptr<Docx>> liveList;
+  {
+    std::lock_guard<std::mutex> lock(DocxListMutex);
+    for (const std::weak_ptr<Docx> &docxWeak : DocxList)
+      if (std::shared_ptr<Docx> docx = docxWeak.lock())
+        liveList.push_back(docx);
+  }
+  std::lock_guard<std::mutex> lock(textIndexMutex);
+  // documents indexed as they are now, the rest leave the index
+  std::unordered_map<Docx *, unsigned long long> currentMap;
+  for (uint32_t indexId = 0; indexId < indexedList.size(); indexId++) {
+    std::shared_ptr<Docx> docx = indexedList[indexId].docx.lock();
+    if (docx &&
+        docx->getMetrics().documentId == indexedList[indexId].documentId) {
+      currentMap[docx.get()] = indexedList[indexId].documentId;
+    } else {
+      // closed or opened again, removing twice does nothing
+      textIndex.remove(indexId);
+      indexedList[indexId].docx.reset();
+    }
+  }
+  // ids are not reused, once removed ones outnumber the rest start over
+  if (indexedList.size() - currentMap.size() > currentMap.size()) {
+    textIndex.clear();
+    indexedList.clear();
+    currentMap.clear();
+  }
+
+  class Extraction {
+  public:
+    std::shared_ptr<Docx> docx;
+    unsigned long long documentId;
+    std::future<int> future;
+    TextIndexDocument document;
+  };
+  std::vector<std::unique_ptr<Extraction>> extractionList;
+  for (const std::shared_ptr<Docx> &docx : liveList) {
+    if (currentMap.count(docx.get()))
+      continue;
+    auto extraction = std::make_unique<Extraction>();
+    extraction->docx = docx;
+    extraction->documentId = docx->getMetrics().documentId;
+    extractionList.push_back(std::move(extraction));
+  }
+  if (extractionList.empty())
+    return 0;
+  /* Its own workers, not defaultThreadPool(): this waits on them with
+   * textIndexMutex held and may itself run on a defaultThreadPool() worker
+   */
+  ThreadPool pool(std::min<size_t>(
+      extractionList.size(),
+      std::max(1u, std::thread::hardware_concurrency())));
+  for (std::unique_ptr<Extraction> &extraction : extractionList) {
+    Extraction *extractionPtr = extraction.get();
+    extraction->future = pool.submit([extractionPtr]() {
+      return extractionPtr->docx->extractText(
+          [extractionPtr](const DocxTextParagraph &paragraph) {
+            extractionPtr->document.addParagraph(
+                {(uint32_t)paragraph.paragraph, (uint32_t)paragraph.page,
+                 paragraph.text});
+          });
+    });
+  }
+  int indexedTotal = 0;
+  for (std::unique_ptr<Extraction> &extraction : extractionList) {
+    // a document that cannot be read is tried again on the next call
+    if (extraction->future.get() != 0)
+      continue;
+    uint32_t indexId = textIndex.add(std::move(extraction->document));
+    indexedList.resize(indexId + 1);
+    indexedList[indexId] = {extraction->docx, extraction->documentId};
+    indexedTotal++;
+  }
+  return indexedTotal;
+}
+
+std::vector<DocxSearchHit> ModuleExport::searchText(std::string query,
+                                                    int hitMax) {
+  std::vector<DocxSearchHit> hitList;
+  std::lock_guard<std::mutex> lock(textIndexMutex);
+  for (const TextIndex::Hit &hit :
+       textIndex.search(query, (size_t)std::max(hitMax, 0))) {
+    std::shared_ptr<Docx> docx = indexedList[hit.documentId].docx.lock();
+    // closed since the last indexText
+    if (!docx)
+      continue;
+    hitList.push_back({docx, (int)hit.paragraphIndex, (int)hit.pageIndex,
+                       (long)hit.offset, (long)hit.length});
+  }
+  return hitList;
+}
+
+std::shared_ptr<rapidjson::Document> ModuleExport::getMetricsSnapshot() {
+  auto document = std::make_shared<rapidjson::Document>();
+  writeMetrics(document);
+  return document;
+}
+
+void ModuleExport::writeMetrics(std::shared_ptr<rapidjson::Document> document) {
+  rapidjson::Document::AllocatorType &allocator = document->GetAllocator();
+  document->SetObject();
+  static const char *modeNameList[] = {"off", "stats", "events"};
+  document->AddMember("traceCompiled", BOOKFILER_MODULE_DOCX_TRACE != 0,
+                      allocator);
+  document->AddMember(
+      "traceMode",
+      rapidjson::StringRef(modeNameList[(int)tracer().getMode()]), allocator);
+
+  rapidjson::Value spans(rapidjson::kObjectType);
+  std::array<Tracer::SpanStats, traceSpanKindTotal> spanStats =
+      tracer().getSpanStats();
+  for (uint32_t kind = 0; kind < traceSpanKindTotal; kind++) {
+    rapidjson::Value span(rapidjson::kObjectType);
+    span.AddMember("count", spanStats[kind].count, allocator);
+    span.AddMember("totalNanoseconds", spanStats[kind].totalNanoseconds,
+                   allocator);
+    span.AddMember("maxNanoseconds", spanStats[kind].maxNanoseconds,
+                   allocator);
+    spans.AddMember(rapidjson::StringRef(traceSpanName((TraceSpanKind)kind)),
+                    span, allocator);
+  }
+  document->AddMember("spans", spans, allocator);
+  document->AddMember("droppedEvents", tracer().getDroppedTotal(), allocator);
+
+  std::vector<std::shared_ptr<Docx>> liveList;
+  {
+    std::lock_guard<std::mutex> lock(DocxListMutex);
+    for (const std::weak_ptr<Docx> &docxWeak : DocxList)
+      if (std::shared_ptr<Docx> docx = docxWeak.lock())
+        liveList.push_back(docx);
+  }
+  rapidjson::Value documents(rapidjson::kArrayType);
+  for (const std::shared_ptr<Docx> &docx : liveList) {
+    DocxMetrics metrics = docx->getMetrics();
+    rapidjson::Value entry(rapidjson::kObjectType);
+    entry.AddMember("id", (uint64_t)metrics.documentId, allocator);
+    std::string fileName = docx->getFileName();
+    entry.AddMember("file",
+                    rapidjson::Value(fileName.c_str(),
+                                     (rapidjson::SizeType)fileName.size(),
+                                     allocator),
+                    allocator);
+    entry.AddMember("bytesInflated", (uint64_t)metrics.bytesInflated,
+                    allocator);
+    entry.AddMember("partsTouched", (uint64_t)metrics.partsTouched, allocator);
+    entry.AddMember("allocations", (uint64_t)metrics.allocations, allocator);
+    entry.AddMember("allocationBytes", (uint64_t)metrics.allocationBytes,
+                    allocator);
+    entry.AddMember("arenaPeakBytes", (uint64_t)metrics.arenaPeakBytes,
+                    allocator);
+    entry.AddMember("cacheHits", (uint64_t)metrics.cacheHits, allocator);
+    entry.AddMember("cacheMisses", (uint64_t)metrics.cacheMisses, allocator);
+    entry.AddMember("errors", (uint64_t)metrics.errors, allocator);
+    entry.AddMember("modelBytes", (uint64_t)metrics.modelBytes, allocator);
+    entry.AddMember("partBytes", (uint64_t)metrics.partBytes, allocator);
+    entry.AddMember("pixmapBytes", (uint64_t)metrics.pixmapBytes, allocator);
+    documents.PushBack(entry, allocator);
+  }
+  document->AddMember("documents", documents, allocator);
+
+  PixmapCacheStats cacheStats = getPixmapCacheStats();
+  rapidjson::Value cache(rapidjson::kObjectType);
+  cache.AddMember("hits", (uint64_t)cacheStats.hits, allocator);
+  cache.AddMember("misses", (uint64_t)cacheStats.misses, allocator);
+  cache.AddMember("evictions", (uint64_t)cacheStats.evictions, allocator);
+  cache.AddMember("bytes", (uint64_t)cacheStats.bytes, allocator);
+  cache.AddMember("budget", (uint64_t)cacheStats.budget, allocator);
+  cache.AddMember("glyphHits", (uint64_t)cacheStats.glyphHits, allocator);
+  cache.AddMember("glyphMisses", (uint64_t)cacheStats.glyphMisses, allocator);
+  cache.AddMember("shapedRunHits", (uint64_t)cacheStats.shapedRunHits,
+                  allocator);
+  cache.AddMember("shapedRunMisses", (uint64_t)cacheStats.shapedRunMisses,
+                  allocator);
+  document->AddMember("pixmapCache", cache, allocator);
+
+  DocxMonitor monitor = getDocxMonitor();
+  rapidjson::Value memory(rapidjson::kObjectType);
+  memory.AddMember("budget", (uint64_t)monitor.total, allocator);
+  memory.AddMember("available", (uint64_t)monitor.available, allocator);
+  memory.AddMember("used", (uint64_t)monitor.used, allocator);
+  memory.AddMember("modelBytes", (uint64_t)monitor.modelBytes, allocator);
+  memory.AddMember("partBytes", (uint64_t)monitor.partBytes, allocator);
+  memory.AddMember("pixmapBytes", (uint64_t)monitor.pixmapBytes, allocator);
+  memory.AddMember("documents", (uint64_t)monitor.documents, allocator);
+  memory.AddMember("pixmapEvictions", (uint64_t)monitor.pixmapEvictions,
+                   allocator);
+  memory.AddMember("partEvictions", (uint64_t)monitor.partEvictions,
+                   allocator);
+  memory.AddMember("modelEvictions", (uint64_t)monitor.modelEvictions,
+                   allocator);
+  document->AddMember("memory", memory, allocator);
+
+  TextIndex::Stats indexStats = textIndex.getStats();
+  rapidjson::Value index(rapidjson::kObjectType);
+  index.AddMember("documents", (uint64_t)indexStats.documentTotal, allocator);
+  index.AddMember("terms", (uint64_t)indexStats.termTotal, allocator);
+  index.AddMember("occurrences", (uint64_t)indexStats.occurrenceTotal,
+                  allocator);
+  index.AddMember("postingBytes", (uint64_t)indexStats.postingBytes,
+                  allocator);
+  index.AddMember("rawBytes", (uint64_t)indexStats.rawBytes, allocator);
+  document->AddMember("textIndex", index, allocator);
+
+  DiskCache::Stats diskStats = diskCache().getStats();
+  rapidjson::Value disk(rapidjson::kObjectType);
+  disk.AddMember("enabled", diskCache().isEnabled(), allocator);
+  disk.AddMember("hits", diskStats.hitTotal, allocator);
+  disk.AddMember("misses", diskStats.missTotal, allocator);
+  disk.AddMember("stale", diskStats.staleTotal, allocator);
+  disk.AddMember("stores", diskStats.storeTotal, allocator);
+  disk.AddMember("storeBytes", diskStats.storeBytes, allocator);
+  document->AddMember("diskCache", disk, allocator);
+
+  MediaCache::Stats mediaStats = mediaCache().getStats();
+  rapidjson::Value media(rapidjson::kObjectType);
+  media.AddMember("kernel", rapidjson::StringRef(pixelKernel().name),
+                  allocator);
+  media.AddMember("hits", mediaStats.hitTotal, allocator);
+  media.AddMember("misses", mediaStats.missTotal, allocator);
+  media.AddMember("evictions", mediaStats.evictionTotal, allocator);
+  media.AddMember("images", (uint64_t)mediaStats.imageTotal, allocator);
+  media.AddMember("bytes", (uint64_t)mediaStats.byteTotal, allocator);
+  media.AddMember("budget", (uint64_t)mediaStats.byteBudget, allocator);
+  document->AddMember("mediaCache", media, allocator);
+}
+
 } // namespace bookfiler
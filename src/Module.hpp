@@ -17,6 +17,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -39,6 +40,7 @@
 
 // Local Project
 #include "Interface.hpp"
+#include "core/textIndex.hpp"
 
 /*
  * bookfiler = BookFiler™
@@ -52,7 +54,18 @@ namespace bookfiler {
  */
 class ModuleExport : public DocxInterface {
 private:
-  std::vector<std::shared_ptr<Docx>> DocxList;
+  // the caller owns them, the list only reports on the live ones
+  std::vector<std::weak_ptr<Docx>> DocxList;
+  std::mutex DocxListMutex;
+  // by TextIndex document id, what indexText added and from which openFile
+  class IndexedDocx {
+  public:
+    std::weak_ptr<Docx> docx;
+    unsigned long long documentId;
+  };
+  TextIndex textIndex;
+  std::vector<IndexedDocx> indexedList;
+  std::mutex textIndexMutex;
 
 public:
   ModuleExport();
@@ -67,6 +80,15 @@ public:
           moduleCallbackMap);
   void setSettings(std::shared_ptr<rapidjson::Value> data);
   std::shared_ptr<Docx> newDocx();
+  PixmapCacheStats getPixmapCacheStats();
+  DocxMonitor getDocxMonitor();
+  std::shared_ptr<rapidjson::Document> getMetricsSnapshot();
+  int indexText();
+  std::vector<DocxSearchHit> searchText(std::string query, int hitMax = 100);
+
+private:
+  /* Replaces document with the metrics snapshot */
+  void writeMetrics(std::shared_ptr<rapidjson::Document> document);
 };
 
 // Exporting `my_namespace::module` variable with alias name `module`
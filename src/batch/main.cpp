@@ -0,0 +1,218 @@
+// C++
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Local Project
+#include "pipeline.hpp"
+
+namespace {
+
+using bookfiler::batch::BatchMode;
+using bookfiler::batch::BatchOptions;
+using bookfiler::batch::BatchPipeline;
+using bookfiler::batch::StageStats;
+using bookfiler::batch::stageName;
+using bookfiler::batch::stageTotal;
+
+const char *usage =
+    " [options] <file.docx | directory | @list.txt> ...\n"
+    "  --out=DIR            where output goes, default .\n"
+    "  --mode=text|png      extract text or render pages, default text\n"
+    "  --dpi=N              png resolution, default 96\n"
+    "  --pages=N            pages rendered per document, default all\n"
+    "  --queue=N            documents waiting per stage, default 4\n"
+    "  --workers-STAGE=N    workers of open, inflate, parse, layout,\n"
+    "                       render or write\n"
+    "  --progress           report every second on stderr\n";
+
+bool isDocx(const std::filesystem::path &path) {
+  std::string extension = path.extension().u8string();
+  for (char &c : extension)
+    c = (char)std::tolower((unsigned char)c);
+  return extension == ".docx";
+}
+
+/* Files named on the command line, the .docx files under directories in
+ * name order and the lines of @lists. Unreadable entries are passed on, the
+ * pipeline reports them.
+ */
+void collectInputs(const std::string &arg, std::vector<std::string> &list) {
+  if (arg.size() > 1 && arg[0] == '@') {
+    std::ifstream listFile(arg.substr(1));
+    std::string line;
+    while (std::getline(listFile, line)) {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (!line.empty())
+        list.push_back(line);
+    }
+    return;
+  }
+  std::filesystem::path path = std::filesystem::u8path(arg);
+  std::error_code err;
+  if (!std::filesystem::is_directory(path, err)) {
+    list.push_back(arg);
+    return;
+  }
+  std::set<std::string> found;
+  for (std::filesystem::recursive_directory_iterator
+           it(path, std::filesystem::directory_options::skip_permission_denied,
+              err),
+       end;
+       it != end; it.increment(err)) {
+    if (err)
+      break;
+    if (it->is_regular_file(err) && isDocx(it->path()))
+      found.insert(it->path().u8string());
+  }
+  list.insert(list.end(), found.begin(), found.end());
+}
+
+/* The input's stem, with a number added when an earlier input had it */
+std::string outputNameFor(const std::string &fileName,
+                          std::set<std::string> &usedSet) {
+  std::string stem = std::filesystem::u8path(fileName).stem().u8string();
+  if (stem.empty())
+    stem = "document";
+  std::string name = stem;
+  for (int i = 2; !usedSet.insert(name).second; i++)
+    name = stem + "-" + std::to_string(i);
+  return name;
+}
+
+void printStats(std::ostream &out, const BatchPipeline &pipeline) {
+  std::array<StageStats, stageTotal> stats = pipeline.getStats();
+  out << std::left << std::setw(9) << "stage" << std::right << std::setw(8)
+      << "workers" << std::setw(8) << "done" << std::setw(8) << "failed"
+      << std::setw(10) << "mean ms" << std::setw(10) << "max ms"
+      << std::setw(7) << "queue" << std::setw(11) << "queue max" << "\n";
+  for (uint32_t stage = 0; stage < stageTotal; stage++) {
+    const StageStats &stageStats = stats[stage];
+    uint64_t runTotal = stageStats.doneTotal + stageStats.failedTotal;
+    double meanMs =
+        runTotal ? stageStats.busySeconds * 1000 / (double)runTotal : 0;
+    out << std::left << std::setw(9) << stageName(stage) << std::right
+        << std::setw(8) << pipeline.getOptions().workerTotal[stage]
+        << std::setw(8) << stageStats.doneTotal << std::setw(8)
+        << stageStats.failedTotal << std::fixed << std::setprecision(2)
+        << std::setw(10) << meanMs << std::setw(10)
+        << stageStats.latencyMax * 1000 << std::setw(7)
+        << stageStats.queueDepth << std::setw(11) << stageStats.queueDepthMax
+        << "\n";
+  }
+}
+
+} // namespace
+
+/* Usage: docx-batch [options] <file.docx | directory | @list.txt> ...
+ */
+int main(int argc, char *argv[]) {
+  BatchOptions options;
+  bool progress = false;
+  std::vector<std::string> inputList;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool valid = true;
+    try {
+      if (arg.rfind("--out=", 0) == 0) {
+        options.outputDirectory = arg.substr(6);
+      } else if (arg == "--mode=text") {
+        options.mode = BatchMode::Text;
+      } else if (arg == "--mode=png") {
+        options.mode = BatchMode::Png;
+      } else if (arg.rfind("--dpi=", 0) == 0) {
+        options.dpi = std::stoi(arg.substr(6));
+        valid = options.dpi > 0;
+      } else if (arg.rfind("--pages=", 0) == 0) {
+        options.pageLimit = (uint32_t)std::stoul(arg.substr(8));
+      } else if (arg.rfind("--queue=", 0) == 0) {
+        options.queueCapacity = std::stoul(arg.substr(8));
+      } else if (arg.rfind("--workers-", 0) == 0) {
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(10, equals - 10);
+        uint32_t stage = 0;
+        while (stage < stageTotal && name != stageName(stage))
+          stage++;
+        valid = stage < stageTotal && equals != std::string::npos;
+        if (valid)
+          options.workerTotal[stage] = std::stoul(arg.substr(equals + 1));
+      } else if (arg == "--progress") {
+        progress = true;
+      } else if (arg.rfind("--", 0) == 0) {
+        valid = false;
+      } else {
+        collectInputs(arg, inputList);
+      }
+    } catch (const std::exception &) {
+      valid = false;
+    }
+    if (!valid) {
+      std::cout << "Usage: " << argv[0] << usage << std::flush;
+      return 1;
+    }
+  }
+  if (inputList.empty()) {
+    std::cout << "Usage: " << argv[0] << usage << std::flush;
+    return 1;
+  }
+  std::error_code err;
+  std::filesystem::create_directories(
+      std::filesystem::u8path(options.outputDirectory), err);
+
+  auto begin = std::chrono::steady_clock::now();
+  auto elapsed = [&begin]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         begin)
+        .count();
+  };
+  BatchPipeline pipeline(options);
+  std::atomic<bool> submitting{true};
+  std::thread reporter;
+  if (progress) {
+    reporter = std::thread([&]() {
+      while (submitting || pipeline.getFinishedTotal() <
+                               pipeline.getSubmittedTotal()) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::cerr << std::fixed << std::setprecision(1) << elapsed() << " s, "
+                  << pipeline.getFinishedTotal() << "/" << inputList.size()
+                  << " documents\n";
+        printStats(std::cerr, pipeline);
+      }
+    });
+  }
+  std::set<std::string> usedSet;
+  for (const std::string &fileName : inputList)
+    pipeline.submit(fileName, outputNameFor(fileName, usedSet));
+  pipeline.wait();
+  double seconds = elapsed();
+  submitting = false;
+  if (reporter.joinable())
+    reporter.join();
+
+  std::vector<bookfiler::batch::BatchFailure> failureList =
+      pipeline.getFailureList();
+  double latencyMean, latencyMax;
+  pipeline.getDocumentLatency(latencyMean, latencyMax);
+  std::cout << inputList.size() << " documents, "
+            << inputList.size() - failureList.size() << " written, "
+            << failureList.size() << " failed in " << std::fixed
+            << std::setprecision(2) << seconds << " s: "
+            << (seconds > 0 ? (double)inputList.size() / seconds : 0)
+            << " documents/s, latency mean " << latencyMean * 1000
+            << " ms, max " << latencyMax * 1000 << " ms\n";
+  printStats(std::cout, pipeline);
+  for (const bookfiler::batch::BatchFailure &failure : failureList)
+    std::cout << "failed " << failure.fileName << ": "
+              << stageName(failure.stage) << " error " << failure.err << "\n";
+  return failureList.empty() ? 0 : 2;
+}
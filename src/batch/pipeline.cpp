@@ -0,0 +1,313 @@
+// C++
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/documentParser.hpp"
+#include "../core/layout.hpp"
+#include "../core/rasterizer.hpp"
+#include "../core/xmlReader.hpp"
+#include "pipeline.hpp"
+#include "pngWriter.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace batch {
+
+namespace {
+
+using steady_clock_t = std::chrono::steady_clock;
+
+// rendered pages are mostly background, a fast level loses little
+const int pngLevel = 3;
+
+double secondsSince(steady_clock_t::time_point begin) {
+  return std::chrono::duration<double>(steady_clock_t::now() - begin).count();
+}
+
+} // namespace
+
+/* Everything one document carries between stages. Each stage drops what
+ * the later ones no longer need.
+ */
+class BatchJob {
+public:
+  class Output {
+  public:
+    std::string fileName;
+    std::vector<char> data;
+  };
+
+  std::string fileName, outputName;
+  steady_clock_t::time_point submitTime;
+  DocxImpl docx;
+  std::shared_ptr<ZipPart> documentPart;
+  std::shared_ptr<const ZipPart> stylesPart;
+  std::shared_ptr<DocumentModel> model;
+  std::unique_ptr<DocumentLayout> layout;
+  std::vector<Output> outputList;
+};
+
+const char *stageName(uint32_t stage) {
+  static const char *nameList[stageTotal] = {"open",   "inflate", "parse",
+                                             "layout", "render",  "write"};
+  return stage < stageTotal ? nameList[stage] : "";
+}
+
+BatchPipeline::BatchPipeline(BatchOptions options_) : options(options_) {
+  for (uint32_t stage = 0; stage < stageTotal; stage++)
+    poolList[stage] = std::make_unique<ThreadPool>(
+        std::max<size_t>(options.workerTotal[stage], 1),
+        std::max<size_t>(options.queueCapacity, 1));
+}
+
+BatchPipeline::~BatchPipeline() { wait(); }
+
+void BatchPipeline::submit(std::string fileName, std::string outputName) {
+  auto job = std::make_shared<BatchJob>();
+  job->fileName = std::move(fileName);
+  job->outputName = std::move(outputName);
+  job->submitTime = steady_clock_t::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    submittedTotal++;
+  }
+  enqueue(stageOpen, std::move(job));
+}
+
+void BatchPipeline::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [this]() { return finishedTotal == submittedTotal; });
+}
+
+std::array<StageStats, stageTotal> BatchPipeline::getStats() const {
+  std::array<StageStats, stageTotal> statsCopy;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    statsCopy = stats;
+  }
+  for (uint32_t stage = 0; stage < stageTotal; stage++)
+    statsCopy[stage].queueDepth = poolList[stage]->getQueueDepth();
+  return statsCopy;
+}
+
+uint64_t BatchPipeline::getSubmittedTotal() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return submittedTotal;
+}
+
+uint64_t BatchPipeline::getFinishedTotal() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return finishedTotal;
+}
+
+std::vector<BatchFailure> BatchPipeline::getFailureList() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return failureList;
+}
+
+void BatchPipeline::getDocumentLatency(double &meanSeconds,
+                                       double &maxSeconds) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  meanSeconds = writtenTotal ? latencyTotal / (double)writtenTotal : 0;
+  maxSeconds = latencyMax;
+}
+
+void BatchPipeline::enqueue(uint32_t stage, std::shared_ptr<BatchJob> job) {
+  ThreadPool &pool = *poolList[stage];
+  // blocks while the stage is full, which is what bounds the pipeline
+  pool.submit([this, stage, job]() { runStage(stage, job); });
+  size_t queueDepth = pool.getQueueDepth();
+  std::lock_guard<std::mutex> lock(mutex);
+  stats[stage].queueDepthMax = std::max(stats[stage].queueDepthMax, queueDepth);
+}
+
+void BatchPipeline::runStage(uint32_t stage, std::shared_ptr<BatchJob> job) {
+  steady_clock_t::time_point begin = steady_clock_t::now();
+  int32_t err = MZ_OK;
+  // a document that throws is as failed as one that returns an error
+  try {
+    switch (stage) {
+    case stageOpen:
+      err = runOpen(*job);
+      break;
+    case stageInflate:
+      err = runInflate(*job);
+      break;
+    case stageParse:
+      err = runParse(*job);
+      break;
+    case stageLayout:
+      err = runLayout(*job);
+      break;
+    case stageRender:
+      err = runRender(*job);
+      break;
+    default:
+      err = runWrite(*job);
+      break;
+    }
+  } catch (const std::bad_alloc &) {
+    err = MZ_MEM_ERROR;
+  } catch (const std::exception &) {
+    err = MZ_INTERNAL_ERROR;
+  }
+  double seconds = secondsSince(begin);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    StageStats &stageStats = stats[stage];
+    if (err == MZ_OK)
+      stageStats.doneTotal++;
+    else
+      stageStats.failedTotal++;
+    stageStats.busySeconds += seconds;
+    stageStats.latencyMax = std::max(stageStats.latencyMax, seconds);
+  }
+  if (err != MZ_OK || stage == stageWrite) {
+    finish(*job, stage, err);
+    return;
+  }
+  uint32_t next = stage + 1;
+  if (next == stageLayout && options.mode == BatchMode::Text)
+    next++;
+  enqueue(next, std::move(job));
+}
+
+void BatchPipeline::finish(const BatchJob &job, uint32_t stage,
+                           int32_t err) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    finishedTotal++;
+    if (err != MZ_OK) {
+      failureList.push_back({job.fileName, stage, err});
+    } else {
+      double seconds = secondsSince(job.submitTime);
+      writtenTotal++;
+      latencyTotal += seconds;
+      latencyMax = std::max(latencyMax, seconds);
+    }
+  }
+  finished.notify_all();
+}
+
+int32_t BatchPipeline::runOpen(BatchJob &job) {
+  return job.docx.openFile(job.fileName);
+}
+
+int32_t BatchPipeline::runInflate(BatchJob &job) {
+  std::shared_ptr<ZipReader> zipReader = job.docx.getZipReader();
+  const std::string &mainPartName = job.docx.getPackage().getMainPartName();
+  const ZipIndexEntry *entry = zipReader->getIndex().find(mainPartName);
+  if (!entry)
+    return MZ_END_OF_LIST;
+  if (entry->uncompressedSize > options.partBytesMax)
+    return MZ_MEM_ERROR;
+  job.documentPart = zipReader->extractPart(mainPartName);
+  if (job.documentPart->err != MZ_OK)
+    return job.documentPart->err;
+  // a document without styles is still a document
+  if (job.docx.getDocumentPart("styles", job.stylesPart) != MZ_OK ||
+      job.stylesPart->data.size() > options.partBytesMax)
+    job.stylesPart = nullptr;
+  return MZ_OK;
+}
+
+int32_t BatchPipeline::runParse(BatchJob &job) {
+  job.model = std::make_shared<DocumentModel>();
+  DocumentParser parser;
+  if (job.stylesPart) {
+    XmlReader stylesReader;
+    stylesReader.open(job.stylesPart->data);
+    if (parser.parseStyles(stylesReader, *job.model) != MZ_OK)
+      job.model->styleSheet.clear();
+  }
+  XmlReader reader;
+  reader.open(job.documentPart->data);
+  int32_t err = parser.parse(reader, *job.model);
+  job.documentPart = nullptr;
+  job.stylesPart = nullptr;
+  return err;
+}
+
+int32_t BatchPipeline::runLayout(BatchJob &job) {
+  LayoutOptions layoutOptions;
+  layoutOptions.recordBoxes = true;
+  layoutOptions.pageLimit = options.pageLimit;
+  job.layout = std::make_unique<DocumentLayout>(*job.model, layoutOptions);
+  job.layout->paginate(serialPool);
+  return MZ_OK;
+}
+
+int32_t BatchPipeline::runRender(BatchJob &job) {
+  if (options.mode == BatchMode::Text) {
+    BatchJob::Output output{job.outputName + ".txt", {}};
+    for (const DocumentParagraph &paragraph : job.model->paragraphList) {
+      for (uint32_t runIndex = paragraph.runBegin;
+           runIndex < paragraph.runEnd; runIndex++) {
+        const DocumentRun &run = job.model->runList[runIndex];
+        if (run.objectIndex != documentNone)
+          continue;
+        std::string_view text = job.model->getText(run);
+        output.data.insert(output.data.end(), text.begin(), text.end());
+      }
+      output.data.push_back('\n');
+    }
+    job.outputList.push_back(std::move(output));
+    job.model = nullptr;
+    return MZ_OK;
+  }
+
+  // pictures come through the document's media cache like the viewer's
+  PageRasterizer rasterizer(
+      *job.layout, options.dpi,
+      [&job](std::string_view relId, int32_t width, int32_t height) {
+        std::shared_ptr<const RasterImage> media;
+        job.docx.getMedia(relId, width, height, media);
+        return media;
+      });
+  std::vector<unsigned char> pixels;
+  uint32_t pageTotal = (uint32_t)job.layout->getPageList().size();
+  for (uint32_t pageIndex = 0; pageIndex < pageTotal; pageIndex++) {
+    int32_t width, height;
+    rasterizer.getPageSize(pageIndex, width, height);
+    size_t stride = (size_t)width * 4;
+    pixels.resize(stride * height);
+    rasterizer.render(pageIndex, {pixels.data(), stride, width, height, 0, 0});
+    BatchJob::Output output{
+        job.outputName + "-" + std::to_string(pageIndex + 1) + ".png", {}};
+    int32_t err = encodePng(pixels.data(), stride, width, height, pngLevel,
+                            output.data);
+    if (err != MZ_OK)
+      return err;
+    job.outputList.push_back(std::move(output));
+  }
+  job.layout = nullptr;
+  job.model = nullptr;
+  return MZ_OK;
+}
+
+int32_t BatchPipeline::runWrite(BatchJob &job) {
+  for (const BatchJob::Output &output : job.outputList) {
+    std::filesystem::path path =
+        std::filesystem::u8path(options.outputDirectory) /
+        std::filesystem::u8path(output.fileName);
+    std::ofstream outFile(path, std::ios::binary);
+    if (!outFile)
+      return MZ_OPEN_ERROR;
+    outFile.write(output.data.data(), (std::streamsize)output.data.size());
+    outFile.close();
+    if (!outFile)
+      return MZ_WRITE_ERROR;
+  }
+  job.outputList.clear();
+  return MZ_OK;
+}
+
+} // namespace batch
+} // namespace bookfiler
@@ -0,0 +1,131 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_BATCH_PIPELINE_H
+#define BOOKFILER_MODULE_DOCX_BATCH_PIPELINE_H
+
+// C++
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/threadPool.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace batch {
+
+/* Pipeline stages in the order a document goes through them */
+const uint32_t stageOpen = 0;
+const uint32_t stageInflate = 1;
+const uint32_t stageParse = 2;
+const uint32_t stageLayout = 3;
+const uint32_t stageRender = 4;
+const uint32_t stageWrite = 5;
+const uint32_t stageTotal = 6;
+
+const char *stageName(uint32_t stage);
+
+enum class BatchMode { Text, Png };
+
+class BatchOptions {
+public:
+  std::string outputDirectory = ".";
+  BatchMode mode = BatchMode::Text;
+  int32_t dpi = 96;
+  // pages rendered per document, 0 for all
+  uint32_t pageLimit = 0;
+  // documents waiting in front of each stage before the one before blocks
+  size_t queueCapacity = 4;
+  // a main document or styles part inflating to more fails the document
+  uint64_t partBytesMax = (uint64_t)256 << 20;
+  // by stage
+  std::array<size_t, stageTotal> workerTotal = {1, 2, 2, 2, 2, 1};
+};
+
+class StageStats {
+public:
+  uint64_t doneTotal = 0, failedTotal = 0;
+  // time spent in the stage, not waiting for it
+  double busySeconds = 0, latencyMax = 0;
+  size_t queueDepth = 0, queueDepthMax = 0;
+};
+
+class BatchFailure {
+public:
+  std::string fileName;
+  uint32_t stage;
+  int32_t err;
+};
+
+class BatchJob;
+
+/* BatchPipeline
+ * Converts documents through open, inflate, parse, layout, render and
+ * write stages. Each stage is a ThreadPool of its own with a bounded
+ * queue, so I/O and CPU bound stages overlap and a slow stage holds back
+ * the ones before it instead of letting documents pile up in memory. A
+ * document that fails any stage is recorded and dropped there; nothing
+ * waits on it. Text mode skips layout.
+ */
+class BatchPipeline {
+public:
+  explicit BatchPipeline(BatchOptions options);
+  /* Waits for every submitted document */
+  ~BatchPipeline();
+  /* Queues a file, blocking while the open stage's queue is full.
+   * outputName is the base name of what it produces.
+   */
+  void submit(std::string fileName, std::string outputName);
+  /* Blocks until every submitted document is written or failed */
+  void wait();
+  /* Counters so far, queue depths as of now */
+  std::array<StageStats, stageTotal> getStats() const;
+  uint64_t getSubmittedTotal() const;
+  uint64_t getFinishedTotal() const;
+  std::vector<BatchFailure> getFailureList() const;
+  /* Mean and worst time from submit to written, successful documents */
+  void getDocumentLatency(double &meanSeconds, double &maxSeconds) const;
+  const BatchOptions &getOptions() const { return options; }
+
+private:
+  void runStage(uint32_t stage, std::shared_ptr<BatchJob> job);
+  void enqueue(uint32_t stage, std::shared_ptr<BatchJob> job);
+  int32_t runOpen(BatchJob &job);
+  int32_t runInflate(BatchJob &job);
+  int32_t runParse(BatchJob &job);
+  int32_t runLayout(BatchJob &job);
+  int32_t runRender(BatchJob &job);
+  int32_t runWrite(BatchJob &job);
+  void finish(const BatchJob &job, uint32_t stage, int32_t err);
+
+  BatchOptions options;
+  mutable std::mutex mutex;
+  std::condition_variable finished;
+  std::array<StageStats, stageTotal> stats;
+  uint64_t submittedTotal = 0, finishedTotal = 0, writtenTotal = 0;
+  double latencyTotal = 0, latencyMax = 0;
+  std::vector<BatchFailure> failureList;
+  // pagination runs on the layout stage's own workers
+  ThreadPool serialPool{1};
+  // declared last, so their workers stop before anything they touch goes
+  std::array<std::unique_ptr<ThreadPool>, stageTotal> poolList;
+};
+
+} // namespace batch
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_BATCH_PIPELINE_H
@@ -0,0 +1,99 @@
+// C++
+#include <cstring>
+
+/* zlib
+ * License: zlib
+ */
+#include <zlib.h>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "pngWriter.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace batch {
+
+namespace {
+
+const unsigned char pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                       '\n'};
+const unsigned char filterSub = 1;
+
+void putBE32(std::vector<char> &out, uint32_t value) {
+  out.push_back((char)(value >> 24));
+  out.push_back((char)(value >> 16));
+  out.push_back((char)(value >> 8));
+  out.push_back((char)value);
+}
+
+/* Length, type and data are in place from chunkBegin, appends the CRC */
+void endChunk(std::vector<char> &png, size_t chunkBegin) {
+  size_t dataSize = png.size() - chunkBegin - 8;
+  for (int i = 0; i < 4; i++)
+    png[chunkBegin + i] = (char)(dataSize >> (24 - 8 * i));
+  uint32_t crc = (uint32_t)crc32(
+      crc32(0L, Z_NULL, 0), (const Bytef *)png.data() + chunkBegin + 4,
+      (uInt)(dataSize + 4));
+  putBE32(png, crc);
+}
+
+size_t beginChunk(std::vector<char> &png, const char *type) {
+  size_t chunkBegin = png.size();
+  putBE32(png, 0);
+  png.insert(png.end(), type, type + 4);
+  return chunkBegin;
+}
+
+} // namespace
+
+int32_t encodePng(const unsigned char *pixels, size_t stride, int32_t width,
+                  int32_t height, int level, std::vector<char> &png) {
+  if (!pixels || width <= 0 || height <= 0 || stride < (size_t)width * 4)
+    return MZ_PARAM_ERROR;
+  size_t rowSize = (size_t)width * 4 + 1;
+  std::vector<unsigned char> filtered(rowSize * (size_t)height);
+  for (int32_t y = 0; y < height; y++) {
+    const unsigned char *source = pixels + (size_t)y * stride;
+    unsigned char *row = filtered.data() + (size_t)y * rowSize;
+    row[0] = filterSub;
+    std::memcpy(row + 1, source, 4);
+    for (size_t x = 4; x < (size_t)width * 4; x++)
+      row[1 + x] = (unsigned char)(source[x] - source[x - 4]);
+  }
+
+  png.assign((const char *)pngSignature,
+             (const char *)pngSignature + sizeof(pngSignature));
+  size_t chunkBegin = beginChunk(png, "IHDR");
+  putBE32(png, (uint32_t)width);
+  putBE32(png, (uint32_t)height);
+  png.push_back(8); // bit depth
+  png.push_back(6); // RGBA
+  png.push_back(0); // deflate
+  png.push_back(0); // adaptive filtering
+  png.push_back(0); // not interlaced
+  endChunk(png, chunkBegin);
+
+  chunkBegin = beginChunk(png, "IDAT");
+  uLongf compressedSize = compressBound((uLong)filtered.size());
+  size_t dataBegin = png.size();
+  png.resize(dataBegin + compressedSize);
+  if (compress2((Bytef *)png.data() + dataBegin, &compressedSize,
+                filtered.data(), (uLong)filtered.size(), level) != Z_OK)
+    return MZ_MEM_ERROR;
+  png.resize(dataBegin + compressedSize);
+  endChunk(png, chunkBegin);
+
+  endChunk(png, beginChunk(png, "IEND"));
+  return MZ_OK;
+}
+
+} // namespace batch
+} // namespace bookfiler
@@ -0,0 +1,32 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_BATCH_PNG_WRITER_H
+#define BOOKFILER_MODULE_DOCX_BATCH_PNG_WRITER_H
+
+// C++
+#include <cstdint>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace batch {
+
+/* Encodes 8 bit RGBA rows as a PNG, every row Sub filtered, which suits
+ * rendered pages: long runs of one colour.
+ * @return MZ_OK, MZ_PARAM_ERROR or MZ_MEM_ERROR
+ */
+int32_t encodePng(const unsigned char *pixels, size_t stride, int32_t width,
+                  int32_t height, int level, std::vector<char> &png);
+
+} // namespace batch
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_BATCH_PNG_WRITER_H
@@ -0,0 +1,133 @@
+// C++
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/tileCache.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+namespace {
+
+/* Every operator new of the benchmark process, the module's included */
+std::atomic<unsigned long long> newTotal{0}, newBytes{0};
+
+void *countedNew(std::size_t size) {
+  newTotal.fetch_add(1, std::memory_order_relaxed);
+  newBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *pointer = std::malloc(size ? size : 1))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return countedNew(size); }
+void *operator new[](std::size_t size) { return countedNew(size); }
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const uint32_t dpi = 96;
+
+class Corpus {
+public:
+  const char *name;
+  CorpusOptions options;
+};
+
+std::vector<Corpus> corpusList() {
+  std::vector<Corpus> list(3);
+  list[0].name = "text";
+  list[0].options.pageTotal = 50;
+  list[1].name = "tables";
+  list[1].options.pageTotal = 50;
+  list[1].options.tableEvery = 2;
+  list[2].name = "images";
+  list[2].options.pageTotal = 20;
+  list[2].options.imageTotal = 24;
+  list[2].options.imageSize = 512;
+  return list;
+}
+
+/* What one document costs up to and including a stage */
+using stage_cb_t = std::function<int32_t(DocxImpl &)>;
+
+int32_t stageOpen(DocxImpl &) { return MZ_OK; }
+
+int32_t stageParse(DocxImpl &docx) {
+  std::shared_ptr<const DocumentModel> model;
+  return docx.getModel(model);
+}
+
+int32_t stageLayout(DocxImpl &docx) {
+  std::shared_ptr<const DocumentLayout> layout;
+  return docx.getLayout(layout);
+}
+
+int32_t stageTile(DocxImpl &docx) {
+  std::shared_ptr<const RasterImage> tile;
+  return docx.getTile(0, dpi, 0, 0, tile);
+}
+
+} // namespace
+
+void registerAllocationBenchmarks(Registry &registry) {
+  const std::pair<const char *, stage_cb_t> stageList[] = {
+      {"open", stageOpen},
+      {"parse", stageParse},
+      {"layout", stageLayout},
+      {"tile", stageTile}};
+  for (const Corpus &corpus : corpusList()) {
+    for (const auto &stagePair : stageList) {
+      std::string name = std::string("allocation/") + stagePair.first + "/" +
+                         corpus.name;
+      CorpusOptions options = corpus.options;
+      stage_cb_t stage = stagePair.second;
+
+      // operator new calls for one opened document taken that far, every
+      // cache the module keeps across documents emptied first
+      registry.add(name, [options, stage](State &state) {
+        std::string fileName = corpusArchiveName(options);
+        unsigned long long countTotal = 0, byteTotal = 0;
+        while (state.keepRunning()) {
+          tileCache().clear();
+          pageCountCache().clear();
+          unsigned long long countBase = newTotal, byteBase = newBytes;
+          {
+            DocxImpl docx;
+            if (docx.openFile(fileName) != MZ_OK || stage(docx) != MZ_OK)
+              state.skipWithError("stage error");
+          }
+          countTotal += newTotal - countBase;
+          byteTotal += newBytes - byteBase;
+        }
+        double iterations = (double)state.getIterations();
+        state.setItemsProcessed(state.getIterations());
+        state.setCounter("allocations", (double)countTotal / iterations);
+        state.setCounter("allocatedKiB", (double)byteTotal / iterations / 1024);
+      });
+    }
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
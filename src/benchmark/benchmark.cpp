@@ -0,0 +1,187 @@
+// C++
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+// Local Project
+#include "benchmark.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+State::State(long long iterationsTotal_) : iterationsTotal(iterationsTotal_) {}
+
+bool State::keepRunning() {
+  if (iterationsDone == 0) {
+    cpuStart = std::clock();
+    startTime = std::chrono::steady_clock::now();
+  }
+  if (iterationsDone < iterationsTotal && errorMessage.empty()) {
+    iterationsDone++;
+    return true;
+  }
+  stopTime = std::chrono::steady_clock::now();
+  cpuStop = std::clock();
+  return false;
+}
+
+void State::pauseTiming() {
+  pauseTime = std::chrono::steady_clock::now();
+  cpuPause = std::clock();
+}
+
+void State::resumeTiming() {
+  pausedTotal += std::chrono::steady_clock::now() - pauseTime;
+  cpuPausedTotal += std::clock() - cpuPause;
+}
+
+double State::getSeconds() const {
+  return std::chrono::duration<double>(stopTime - startTime - pausedTotal)
+      .count();
+}
+
+double State::getCpuSeconds() const {
+  return (double)(cpuStop - cpuStart - cpuPausedTotal) / CLOCKS_PER_SEC;
+}
+
+void Registry::add(std::string name, benchmark_cb_t benchmarkCallback) {
+  benchmarkList.push_back({name, benchmarkCallback});
+}
+
+int Registry::run(std::string filter, double minSeconds) {
+  int failTotal = 0;
+  std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+            << std::setw(12) << "Iterations" << std::setw(16) << "ns/op"
+            << std::setw(12) << "MB/s" << std::setw(14) << "items/s"
+            << std::endl;
+  for (auto &benchmarkPair : benchmarkList) {
+    if (benchmarkPair.first.find(filter) == std::string::npos)
+      continue;
+    long long iterations = 1;
+    while (true) {
+      State state(iterations);
+      benchmarkPair.second(state);
+      if (!state.errorMessage.empty()) {
+        std::cout << std::left << std::setw(48) << benchmarkPair.first
+                  << " ERROR: " << state.errorMessage << std::endl;
+        Result result;
+        result.name = benchmarkPair.first;
+        result.errorMessage = state.errorMessage;
+        resultList.push_back(result);
+        failTotal++;
+        break;
+      }
+      double seconds = state.getSeconds();
+      if (seconds < minSeconds && iterations < 1000000000LL) {
+        // aim a little past minSeconds, growing at most 10x per attempt
+        double scale = seconds > 0 ? 1.4 * minSeconds / seconds : 10.0;
+        if (scale > 10.0)
+          scale = 10.0;
+        iterations = (long long)(iterations * scale) + 1;
+        continue;
+      }
+      std::cout << std::left << std::setw(48) << benchmarkPair.first
+                << std::right << std::setw(12) << iterations << std::fixed
+                << std::setprecision(1) << std::setw(16)
+                << seconds * 1e9 / iterations << std::setw(12)
+                << state.bytesProcessed / seconds / 1e6 << std::setw(14)
+                << std::setprecision(0) << state.itemsProcessed / seconds;
+      for (auto &counterPair : state.counters)
+        std::cout << "  " << counterPair.first << "=" << std::setprecision(2)
+                  << counterPair.second;
+      std::cout << std::endl;
+      resultList.push_back({benchmarkPair.first, "", iterations, seconds,
+                            state.getCpuSeconds(), state.bytesProcessed,
+                            state.itemsProcessed, state.counters});
+      break;
+    }
+  }
+  return failTotal;
+}
+
+bool Registry::writeJson(std::string fileName, double minSeconds) const {
+  rapidjson::StringBuffer buffer;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("context");
+  writer.StartObject();
+  char date[32];
+  std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  writer.Key("date");
+  writer.String(date);
+  writer.Key("num_cpus");
+  writer.Uint(std::thread::hardware_concurrency());
+#ifdef NDEBUG
+  writer.Key("library_build_type");
+  writer.String("release");
+#else
+  writer.Key("library_build_type");
+  writer.String("debug");
+#endif
+  writer.Key("min_time");
+  writer.Double(minSeconds);
+  writer.EndObject();
+
+  writer.Key("benchmarks");
+  writer.StartArray();
+  for (const Result &result : resultList) {
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(result.name.c_str());
+    writer.Key("run_name");
+    writer.String(result.name.c_str());
+    writer.Key("run_type");
+    writer.String("iteration");
+    if (!result.errorMessage.empty()) {
+      writer.Key("error_occurred");
+      writer.Bool(true);
+      writer.Key("error_message");
+      writer.String(result.errorMessage.c_str());
+      writer.EndObject();
+      continue;
+    }
+    writer.Key("iterations");
+    writer.Int64(result.iterations);
+    writer.Key("real_time");
+    writer.Double(result.seconds * 1e9 / result.iterations);
+    writer.Key("cpu_time");
+    writer.Double(result.cpuSeconds * 1e9 / result.iterations);
+    writer.Key("time_unit");
+    writer.String("ns");
+    if (result.bytesProcessed) {
+      writer.Key("bytes_per_second");
+      writer.Double(result.bytesProcessed / result.seconds);
+    }
+    if (result.itemsProcessed) {
+      writer.Key("items_per_second");
+      writer.Double(result.itemsProcessed / result.seconds);
+    }
+    // user counters sit beside the timings, as Google Benchmark puts them
+    for (auto &counterPair : result.counters) {
+      writer.Key(counterPair.first.c_str());
+      writer.Double(counterPair.second);
+    }
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  std::ofstream outFile(fileName, std::ios::binary);
+  outFile << buffer.GetString() << "\n";
+  return (bool)outFile;
+}
+
+} // namespace benchmark
+} // namespace bookfiler
@@ -0,0 +1,128 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_BENCHMARK_H
+#define BOOKFILER_MODULE_DOCX_BENCHMARK_H
+
+// C++
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+/* State
+ * Passed to every benchmark. Setup goes before the loop and is not timed:
+ *   while (state.keepRunning()) { ... }
+ * Per iteration setup inside the loop goes between pauseTiming() and
+ * resumeTiming().
+ */
+class State {
+public:
+  State(long long iterationsTotal);
+  bool keepRunning();
+  void pauseTiming();
+  void resumeTiming();
+  long long getIterations() const { return iterationsTotal; }
+  double getSeconds() const;
+  /* Processor time of the whole process over the loop, every thread */
+  double getCpuSeconds() const;
+  /* Totals over all iterations, reported per second */
+  void setBytesProcessed(long long bytes) { bytesProcessed = bytes; }
+  void setItemsProcessed(long long items) { itemsProcessed = items; }
+  /* Free form values printed next to the timing */
+  void setCounter(std::string name, double value) { counters[name] = value; }
+  void skipWithError(std::string message) { errorMessage = message; }
+
+  long long bytesProcessed = 0, itemsProcessed = 0;
+  std::map<std::string, double> counters;
+  std::string errorMessage;
+
+private:
+  long long iterationsTotal, iterationsDone = 0;
+  std::chrono::steady_clock::time_point startTime, stopTime, pauseTime;
+  std::chrono::steady_clock::duration pausedTotal{0};
+  std::clock_t cpuStart = 0, cpuStop = 0, cpuPause = 0, cpuPausedTotal = 0;
+};
+
+/* What one benchmark measured, kept for the JSON report */
+class Result {
+public:
+  std::string name, errorMessage;
+  long long iterations = 0;
+  double seconds = 0, cpuSeconds = 0;
+  long long bytesProcessed = 0, itemsProcessed = 0;
+  std::map<std::string, double> counters;
+};
+
+using benchmark_cb_t = std::function<void(State &)>;
+
+class Registry {
+public:
+  void add(std::string name, benchmark_cb_t benchmarkCallback);
+  /* Runs every benchmark whose name contains filter. The iteration count is
+   * grown until a run lasts at least minSeconds.
+   * @return number of benchmarks that failed
+   */
+  int run(std::string filter, double minSeconds);
+  /* Everything run() measured, in run order */
+  const std::vector<Result> &getResultList() const { return resultList; }
+  /* The results in Google Benchmark's JSON layout, so its compare.py and
+   * similar tools can diff two runs. minSeconds goes in the context.
+   * @return false if the file could not be written
+   */
+  bool writeJson(std::string fileName, double minSeconds) const;
+
+private:
+  std::vector<std::pair<std::string, benchmark_cb_t>> benchmarkList;
+  std::vector<Result> resultList;
+};
+
+/* Keeps the optimizer from discarding a computed value */
+template <class T> inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const T *sink;
+  sink = &value;
+#endif
+}
+
+// benchmark groups
+void registerAllocationBenchmarks(Registry &registry);
+void registerConcurrencyBenchmarks(Registry &registry);
+void registerCorpusBenchmarks(Registry &registry);
+void registerDiskCacheBenchmarks(Registry &registry);
+void registerDocumentParseBenchmarks(Registry &registry);
+void registerDocxOpenBenchmarks(Registry &registry);
+void registerGlyphBenchmarks(Registry &registry);
+void registerImageBenchmarks(Registry &registry);
+void registerLayoutBenchmarks(Registry &registry);
+void registerMemoryBenchmarks(Registry &registry);
+void registerPageCountBenchmarks(Registry &registry);
+void registerRasterBenchmarks(Registry &registry);
+void registerStyleBenchmarks(Registry &registry);
+void registerTextIndexBenchmarks(Registry &registry);
+void registerTraceBenchmarks(Registry &registry);
+void registerZipBatchBenchmarks(Registry &registry);
+void registerZipIndexBenchmarks(Registry &registry);
+void registerXmlScanBenchmarks(Registry &registry);
+void registerZipStreamBenchmarks(Registry &registry);
+void registerZipWriterBenchmarks(Registry &registry);
+
+} // namespace benchmark
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_BENCHMARK_H
@@ -0,0 +1,285 @@
+// C++
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/zipWriter.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const uint32_t dpi = 96;
+// tile reads per thread and pass, enough to hide starting the threads
+const int tileReadTotal = 4000;
+
+/* The popular document every thread reads */
+std::string sharedArchiveName() {
+  CorpusOptions options;
+  options.pageTotal = 24;
+  options.tableEvery = 12;
+  return corpusArchiveName(options);
+}
+
+/* The other document the stress writer opens, with pictures */
+std::string mediaArchiveName() {
+  CorpusOptions options;
+  options.pageTotal = 12;
+  options.imageTotal = 12;
+  options.imageSize = 128;
+  options.jpeg = true;
+  return corpusArchiveName(options);
+}
+
+/* Runs body(threadIndex) on threadTotal threads and waits for them */
+template <class Body> void runThreads(size_t threadTotal, Body body) {
+  std::vector<std::thread> threadList;
+  for (size_t threadIndex = 0; threadIndex < threadTotal; threadIndex++)
+    threadList.emplace_back(body, threadIndex);
+  for (std::thread &thread : threadList)
+    thread.join();
+}
+
+int32_t openShared(DocxImpl &docx, uint32_t &pageTotal) {
+  std::shared_ptr<const DocumentLayout> layout;
+  int32_t err = docx.openFile(sharedArchiveName());
+  if (err == MZ_OK)
+    err = docx.getLayout(layout);
+  if (err == MZ_OK)
+    pageTotal = (uint32_t)layout->getPageList().size();
+  return err;
+}
+
+/* Readers on one document while a writer opens the two fixtures in turn,
+ * edits the model and drops it the way the memory accountant does. Every
+ * reader call must succeed on whichever document it started on.
+ */
+void stressPass(DocxImpl &docx, size_t readerTotal, uint32_t pageMax,
+                uint32_t seed, std::atomic<uint64_t> &operationTotal,
+                std::atomic<uint64_t> &failTotal) {
+  const std::string fileNameList[] = {sharedArchiveName(),
+                                      mediaArchiveName()};
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    std::mt19937 rng(seed);
+    for (int step = 0; step < 24; step++) {
+      int32_t err = MZ_OK;
+      switch (rng() % 4) {
+      case 0:
+        err = docx.openFile(fileNameList[rng() % 2]);
+        break;
+      case 1: {
+        std::shared_ptr<const DocumentModel> model;
+        err = docx.getModel(model);
+        if (err != MZ_OK)
+          break;
+        auto edited = std::make_shared<DocumentModel>(*model);
+        err = docx.updateModel(edited, {0});
+        // openFile won the race, the edit had nothing left to apply to
+        if (err == MZ_PARAM_ERROR)
+          err = MZ_OK;
+        break;
+      }
+      case 2:
+        docx.releaseModel();
+        docx.releaseParts();
+        break;
+      default:
+        tileCache().clear();
+      }
+      if (err != MZ_OK)
+        failTotal++;
+      // the readers get through a few calls on every state
+      uint64_t operationMin = operationTotal + 4 * readerTotal;
+      while (operationTotal < operationMin)
+        std::this_thread::yield();
+    }
+    done = true;
+  });
+
+  runThreads(readerTotal, [&](size_t threadIndex) {
+    std::mt19937 rng(seed * 31 + (uint32_t)threadIndex);
+    while (!done) {
+      uint32_t pageIndex = rng() % pageMax;
+      int32_t err = MZ_OK;
+      switch (rng() % 8) {
+      case 0:
+      case 1:
+      case 2: {
+        std::shared_ptr<const RasterImage> tile;
+        err = docx.getTile(pageIndex, dpi, rng() % 3, rng() % 4, tile);
+        if (err == MZ_OK && (tile->width <= 0 || tile->height <= 0))
+          err = MZ_DATA_ERROR;
+        break;
+      }
+      case 3: {
+        uint32_t pageTotal = 0;
+        err = docx.getPagesTotalLayout(pageTotal);
+        if (err == MZ_OK && pageTotal < pageMax)
+          err = MZ_DATA_ERROR;
+        break;
+      }
+      case 4: {
+        size_t paragraphTotal = 0;
+        err = docx.extractText(
+            [&](const TextParagraph &) { paragraphTotal++; });
+        if (err == MZ_OK && paragraphTotal == 0)
+          err = MZ_DATA_ERROR;
+        break;
+      }
+      case 5: {
+        std::shared_ptr<const ZipPart> part;
+        err = docx.getDocumentPart("styles", part);
+        break;
+      }
+      case 6: {
+        ZipMemorySink sink;
+        err = docx.save(sink);
+        break;
+      }
+      default: {
+        std::shared_ptr<const DocumentLayout> layout;
+        err = docx.getLayout(layout);
+        if (err == MZ_OK && layout->getPageList().size() < pageMax)
+          err = MZ_DATA_ERROR;
+      }
+      }
+      operationTotal++;
+      if (err != MZ_OK)
+        failTotal++;
+    }
+  });
+  writer.join();
+}
+
+} // namespace
+
+void registerConcurrencyBenchmarks(Registry &registry) {
+  std::vector<size_t> threadTotalList = {1, 2, 4, 8};
+  size_t hardwareTotal = std::thread::hardware_concurrency();
+  if (hardwareTotal > 8)
+    threadTotalList.push_back(hardwareTotal);
+
+  for (size_t threadTotal : threadTotalList) {
+    std::string suffix = "/threads:" + std::to_string(threadTotal);
+
+    // cached tiles of the first pages of one document, the web service
+    // serving a popular document
+    registry.add("concurrency/tileWarm" + suffix, [threadTotal](State &state) {
+      DocxImpl docx;
+      uint32_t pageTotal = 0;
+      if (openShared(docx, pageTotal) != MZ_OK)
+        return state.skipWithError("open error");
+      tileCache().clear();
+      std::shared_ptr<const RasterImage> image;
+      for (uint32_t pageIndex = 0; pageIndex < 4; pageIndex++)
+        docx.getPageImage(pageIndex, dpi, image);
+      std::atomic<uint64_t> failTotal{0};
+      while (state.keepRunning()) {
+        runThreads(threadTotal, [&](size_t threadIndex) {
+          for (int i = 0; i < tileReadTotal; i++) {
+            uint32_t tileIndex = (uint32_t)(i + threadIndex * 7);
+            std::shared_ptr<const RasterImage> tile;
+            if (docx.getTile(tileIndex % 4, dpi, tileIndex / 4 % 3,
+                             tileIndex / 12 % 4, tile) != MZ_OK)
+              failTotal++;
+          }
+        });
+      }
+      if (failTotal > 0)
+        state.skipWithError("tile error");
+      state.setItemsProcessed(state.getIterations() * tileReadTotal *
+                              (long long)threadTotal);
+      state.setCounter("threads", (double)threadTotal);
+    });
+
+    // every page drawn again, each thread its own pages
+    registry.add("concurrency/tileCold" + suffix, [threadTotal](State &state) {
+      DocxImpl docx;
+      uint32_t pageTotal = 0;
+      if (openShared(docx, pageTotal) != MZ_OK)
+        return state.skipWithError("open error");
+      std::atomic<uint64_t> failTotal{0};
+      while (state.keepRunning()) {
+        tileCache().clear();
+        runThreads(threadTotal, [&](size_t threadIndex) {
+          for (uint32_t pageIndex = (uint32_t)threadIndex;
+               pageIndex < pageTotal; pageIndex += (uint32_t)threadTotal) {
+            std::shared_ptr<const RasterImage> image;
+            if (docx.getPageImage(pageIndex, dpi, image) != MZ_OK)
+              failTotal++;
+          }
+        });
+      }
+      if (failTotal > 0)
+        state.skipWithError("render error");
+      state.setItemsProcessed(state.getIterations() * pageTotal);
+      state.setCounter("threads", (double)threadTotal);
+    });
+
+    // the main document part inflated by every thread from one archive
+    registry.add("concurrency/part" + suffix, [threadTotal](State &state) {
+      DocxImpl docx;
+      if (docx.openFile(sharedArchiveName()) != MZ_OK)
+        return state.skipWithError("open error");
+      std::shared_ptr<ZipReader> zipReader = docx.getZipReader();
+      const std::string &partName = docx.getPackage().getMainPartName();
+      std::atomic<uint64_t> failTotal{0}, byteTotal{0};
+      while (state.keepRunning()) {
+        runThreads(threadTotal, [&](size_t) {
+          std::shared_ptr<ZipPart> part = zipReader->extractPart(partName);
+          if (part->err != MZ_OK)
+            failTotal++;
+          byteTotal += part->data.size();
+        });
+      }
+      if (failTotal > 0)
+        state.skipWithError("extract error");
+      state.setBytesProcessed((long long)byteTotal.load());
+      state.setItemsProcessed(state.getIterations() * (long long)threadTotal);
+      state.setCounter("threads", (double)threadTotal);
+    });
+  }
+
+  /* Not a timing: readers against openFile, updateModel and releaseModel
+   * on one document. The tsan-stress target of a BOOKFILER_DOCX_TSAN
+   * build runs it under ThreadSanitizer.
+   */
+  registry.add("concurrency/stress", [](State &state) {
+    DocxImpl docx;
+    uint32_t pageMax = 0;
+    {
+      DocxImpl mediaDocx;
+      uint32_t mediaPageTotal = 0;
+      if (openShared(docx, pageMax) != MZ_OK ||
+          mediaDocx.openFile(mediaArchiveName()) != MZ_OK ||
+          mediaDocx.getPagesTotalLayout(mediaPageTotal) != MZ_OK)
+        return state.skipWithError("open error");
+      pageMax = std::min(pageMax, mediaPageTotal);
+    }
+    std::atomic<uint64_t> operationTotal{0}, failTotal{0};
+    uint32_t seed = 1;
+    while (state.keepRunning())
+      stressPass(docx, 4, pageMax, seed++, operationTotal, failTotal);
+    if (failTotal > 0)
+      state.skipWithError(std::to_string(failTotal.load()) + " of " +
+                          std::to_string(operationTotal.load()) +
+                          " calls failed");
+    state.setItemsProcessed((long long)operationTotal.load());
+  });
+}
+
+} // namespace benchmark
+} // namespace bookfiler
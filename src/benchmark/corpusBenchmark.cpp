@@ -0,0 +1,189 @@
+// C++
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/documentParser.hpp"
+#include "../core/layout.hpp"
+#include "../core/rasterizer.hpp"
+#include "../core/xmlReader.hpp"
+#include "../core/zipIndex.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int32_t dpi = 96;
+
+class Corpus {
+public:
+  const char *name;
+  CorpusOptions options;
+};
+
+/* One document per shape worth watching. Every stage runs on each, so a
+ * regression shows up next to the document kind that exposes it.
+ */
+std::vector<Corpus> corpusList() {
+  std::vector<Corpus> list(5);
+  list[0].name = "text";
+  list[0].options.pageTotal = 50;
+  list[1].name = "tables";
+  list[1].options.pageTotal = 50;
+  list[1].options.tableEvery = 2;
+  list[2].name = "images";
+  list[2].options.pageTotal = 20;
+  list[2].options.imageTotal = 24;
+  list[2].options.imageSize = 512;
+  list[3].name = "styles";
+  list[3].options.pageTotal = 50;
+  list[3].options.styleTotal = 64;
+  list[4].name = "stored";
+  list[4].options.pageTotal = 50;
+  list[4].options.deflate = false;
+  return list;
+}
+
+int32_t loadCorpusModel(const CorpusOptions &options,
+                        std::shared_ptr<const DocumentModel> &model) {
+  DocxImpl docx;
+  int32_t err = docx.openFile(corpusArchiveName(options));
+  if (err != MZ_OK)
+    return err;
+  return docx.getModel(model);
+}
+
+} // namespace
+
+void registerCorpusBenchmarks(Registry &registry) {
+  for (const Corpus &corpus : corpusList()) {
+    std::string suffix = std::string("/") + corpus.name;
+    CorpusOptions options = corpus.options;
+
+    // the central directory read into a ZipIndex
+    registry.add("corpus/index" + suffix, [options](State &state) {
+      std::string fileName = corpusArchiveName(options);
+      size_t entryTotal = 0;
+      while (state.keepRunning()) {
+        ZipIndex index;
+        if (index.open(fileName) != MZ_OK)
+          state.skipWithError("index error");
+        entryTotal = index.getEntries().size();
+      }
+      state.setItemsProcessed(state.getIterations() * (long long)entryTotal);
+    });
+
+    // every part inflated, or viewed in place when STOREd
+    registry.add("corpus/extract" + suffix, [options](State &state) {
+      ZipReader zipReader;
+      if (zipReader.open(corpusArchiveName(options)) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      long long bytes = 0;
+      while (state.keepRunning()) {
+        for (const ZipIndexEntry &entry : zipReader.getIndex().getEntries()) {
+          std::shared_ptr<ZipPart> part =
+              zipReader.extractPart(std::string(entry.filePath));
+          if (part->err != MZ_OK)
+            state.skipWithError("extract error");
+          bytes += (long long)part->data.size();
+        }
+      }
+      state.setBytesProcessed(bytes);
+    });
+
+    // word/document.xml into a DocumentModel, the part already in memory
+    registry.add("corpus/parse" + suffix, [options](State &state) {
+      ZipReader zipReader;
+      if (zipReader.open(corpusArchiveName(options)) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      std::shared_ptr<ZipPart> part =
+          zipReader.extractPart("word/document.xml");
+      DocumentModel model;
+      while (state.keepRunning()) {
+        model.clear();
+        XmlReader reader;
+        reader.open(part->data);
+        DocumentParser parser;
+        if (parser.parse(reader, model) != MZ_OK)
+          state.skipWithError("parse error");
+      }
+      state.setBytesProcessed(state.getIterations() *
+                              (long long)part->data.size());
+      state.setCounter("runs", (double)model.runList.size());
+    });
+
+    // styles.xml flattened into the effective formatting of every run
+    registry.add("corpus/styles" + suffix, [options](State &state) {
+      std::shared_ptr<const DocumentModel> loaded;
+      if (loadCorpusModel(options, loaded) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      DocumentModel model = *loaded;
+      while (state.keepRunning())
+        model.styleSheet.resolve(model);
+      state.setItemsProcessed(state.getIterations() *
+                              (long long)model.runList.size());
+      state.setCounter("runSets", (double)model.resolvedRunTable.size());
+    });
+
+    registry.add("corpus/layout" + suffix, [options](State &state) {
+      std::shared_ptr<const DocumentModel> model;
+      if (loadCorpusModel(options, model) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      LayoutOptions layoutOptions;
+      layoutOptions.recordBoxes = true;
+      DocumentLayout layout(*model, layoutOptions);
+      while (state.keepRunning())
+        doNotOptimize(layout.paginate());
+      state.setItemsProcessed(state.getIterations() *
+                              (long long)model->paragraphList.size());
+      state.setCounter("pages", (double)layout.getPageList().size());
+    });
+
+    // every page drawn whole at screen resolution
+    registry.add("corpus/raster" + suffix, [options](State &state) {
+      std::shared_ptr<const DocumentModel> model;
+      if (loadCorpusModel(options, model) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      LayoutOptions layoutOptions;
+      layoutOptions.recordBoxes = true;
+      DocumentLayout layout(*model, layoutOptions);
+      layout.paginate();
+      PageRasterizer rasterizer(layout, dpi);
+      uint32_t pageTotal = (uint32_t)layout.getPageList().size();
+      std::vector<unsigned char> pixels;
+      while (state.keepRunning()) {
+        for (uint32_t pageIndex = 0; pageIndex < pageTotal; pageIndex++) {
+          int32_t width, height;
+          rasterizer.getPageSize(pageIndex, width, height);
+          size_t stride = (size_t)width * 4;
+          pixels.resize(stride * height);
+          rasterizer.render(pageIndex,
+                            {pixels.data(), stride, width, height, 0, 0});
+        }
+      }
+      doNotOptimize(pixels);
+      state.setItemsProcessed(state.getIterations() * (long long)pageTotal);
+      state.setCounter("pages", (double)pageTotal);
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
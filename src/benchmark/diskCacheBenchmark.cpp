@@ -0,0 +1,137 @@
+// C++
+#include <memory>
+#include <string>
+
+// Local Project
+#include "../core/diskCache.hpp"
+#include "../core/docxImpl.hpp"
+#include "../core/tileCache.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+std::string diskCacheArchiveName() {
+  CorpusOptions options;
+  options.pageTotal = 100;
+  options.tableEvery = 8;
+  options.styleTotal = 24;
+  return corpusArchiveName(options);
+}
+
+/* Turns diskCache() on for one benchmark, then off again */
+class DiskCacheScope {
+public:
+  DiskCacheScope() { diskCache().setDirectory(fixtureDirectory() + "/cache"); }
+  ~DiskCacheScope() { diskCache().setDirectory(std::string()); }
+};
+
+/* Fills the disk cache for fileName, as a first run would */
+bool warmDiskCache(const std::string &fileName) {
+  pageCountCache().clear();
+  DocxImpl docx;
+  uint32_t pageTotal;
+  return docx.openFile(fileName) == MZ_OK &&
+         docx.getPagesTotalLayout(pageTotal) == MZ_OK;
+}
+
+} // namespace
+
+void registerDiskCacheBenchmarks(Registry &registry) {
+  // a fresh process: open, parse and paginate
+  registry.add("diskCache/open/cold", [](State &state) {
+    std::string fileName = diskCacheArchiveName();
+    uint32_t pageTotal = 0;
+    while (state.keepRunning()) {
+      pageCountCache().clear();
+      DocxImpl docx;
+      if (docx.openFile(fileName) != MZ_OK ||
+          docx.getPagesTotalLayout(pageTotal) != MZ_OK)
+        state.skipWithError("page count error");
+    }
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("pages", (double)pageTotal);
+  });
+
+  // a fresh process after an earlier one filled the disk cache
+  registry.add("diskCache/open/warm", [](State &state) {
+    std::string fileName = diskCacheArchiveName();
+    DiskCacheScope scope;
+    if (!warmDiskCache(fileName))
+      return state.skipWithError("store error");
+    uint32_t pageTotal = 0;
+    uint64_t partsTouched = 0;
+    while (state.keepRunning()) {
+      pageCountCache().clear();
+      DocxImpl docx;
+      if (docx.openFile(fileName) != MZ_OK ||
+          docx.getPagesTotalLayout(pageTotal) != MZ_OK)
+        state.skipWithError("page count error");
+      partsTouched = docx.getMetrics().partsTouched;
+    }
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("pages", (double)pageTotal);
+    state.setCounter("partsTouched", (double)partsTouched);
+  });
+
+  // the model alone, from the archive's XML
+  registry.add("diskCache/model/parse", [](State &state) {
+    std::string fileName = diskCacheArchiveName();
+    size_t textBytes = 0;
+    while (state.keepRunning()) {
+      DocxImpl docx;
+      std::shared_ptr<const DocumentModel> model;
+      if (docx.openFile(fileName) != MZ_OK || docx.getModel(model) != MZ_OK)
+        state.skipWithError("parse error");
+      else
+        textBytes = model->text.size();
+    }
+    state.setBytesProcessed(state.getIterations() * textBytes);
+  });
+
+  // the model alone, from the cache file
+  registry.add("diskCache/model/load", [](State &state) {
+    std::string fileName = diskCacheArchiveName();
+    DiskCacheScope scope;
+    if (!warmDiskCache(fileName))
+      return state.skipWithError("store error");
+    size_t textBytes = 0;
+    while (state.keepRunning()) {
+      DocxImpl docx;
+      std::shared_ptr<const DocumentModel> model;
+      if (docx.openFile(fileName) != MZ_OK || docx.getModel(model) != MZ_OK)
+        state.skipWithError("load error");
+      else
+        textBytes = model->text.size();
+    }
+    state.setBytesProcessed(state.getIterations() * textBytes);
+  });
+
+  // serializing and writing one entry
+  registry.add("diskCache/store", [](State &state) {
+    std::string fileName = diskCacheArchiveName();
+    DocxImpl docx;
+    std::shared_ptr<const DocumentModel> model;
+    if (docx.openFile(fileName) != MZ_OK || docx.getModel(model) != MZ_OK)
+      return state.skipWithError("parse error");
+    DiskCacheScope scope;
+    while (state.keepRunning()) {
+      // forgets the entry, so store writes it again
+      diskCache().setDirectory(fixtureDirectory() + "/cache");
+      if (diskCache().store(1, *model, 0) != MZ_OK)
+        state.skipWithError("store error");
+    }
+    DiskCache::Stats stats = diskCache().getStats();
+    state.setItemsProcessed(state.getIterations());
+    state.setBytesProcessed((long long)stats.storeBytes);
+  });
+}
+
+} // namespace benchmark
+} // namespace bookfiler
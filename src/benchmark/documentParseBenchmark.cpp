@@ -0,0 +1,77 @@
+// Local Project
+#include "../core/documentParser.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+// roughly a 500 page contract
+const int paragraphTotal = 5000;
+
+const std::string &contractXml() {
+  static std::string xml = fixtureDocumentXml(paragraphTotal, 20);
+  return xml;
+}
+
+std::string contractArchiveName() {
+  static std::string fileName;
+  if (fileName.empty()) {
+    fileName = fixtureDirectory() + "/contract.docx";
+    writeFixtureZip(fileName, {{"word/document.xml", contractXml(), true}});
+  }
+  return fileName;
+}
+
+void setModelCounters(State &state, const DocumentModel &model) {
+  state.setCounter("textMiB", model.text.size() / 1048576.0);
+  state.setCounter("modelMiB", model.memoryUsage() / 1048576.0);
+  state.setCounter("modelPerText",
+                   (double)model.memoryUsage() / model.text.size());
+}
+
+} // namespace
+
+void registerDocumentParseBenchmarks(Registry &registry) {
+  registry.add("documentParse/memory", [](State &state) {
+    const std::string &xml = contractXml();
+    DocumentModel model;
+    while (state.keepRunning()) {
+      model.clear();
+      XmlReader reader;
+      reader.open(std::string_view(xml));
+      DocumentParser parser;
+      if (parser.parse(reader, model) != MZ_OK)
+        state.skipWithError("parse error");
+    }
+    state.setBytesProcessed(state.getIterations() * xml.size());
+    setModelCounters(state, model);
+  });
+
+  registry.add("documentParse/stream", [](State &state) {
+    ZipIndex index;
+    if (index.open(contractArchiveName()) != MZ_OK)
+      return state.skipWithError("fixture open error");
+    const ZipIndexEntry *entryPtr = index.find("word/document.xml");
+    DocumentModel model;
+    ZipInflateStream stream;
+    while (state.keepRunning()) {
+      model.clear();
+      stream.open(index, *entryPtr);
+      DocumentParser parser;
+      if (parser.parse(stream, model) != MZ_OK)
+        state.skipWithError("parse error");
+    }
+    state.setBytesProcessed(state.getIterations() *
+                            entryPtr->uncompressedSize);
+    setModelCounters(state, model);
+  });
+}
+
+} // namespace benchmark
+} // namespace bookfiler
@@ -0,0 +1,93 @@
+// C++
+#include <random>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int paragraphTotal = 2000;
+const int mediaTotal = 8;
+
+/* The same document with mediaMiB of deflated images */
+std::string openArchiveName(int mediaMiB) {
+  static std::map<int, std::string> fileNameMap;
+  std::string &fileName = fileNameMap[mediaMiB];
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/open" + std::to_string(mediaMiB) + ".docx";
+  std::mt19937 rng(6);
+  std::vector<FixturePart> mediaList;
+  size_t mediaSize = ((size_t)mediaMiB << 20) / mediaTotal;
+  for (int i = 0; i < mediaTotal; i++) {
+    std::string media(mediaSize, '\0');
+    for (size_t j = 0; j < mediaSize; j++)
+      media[j] = (char)((rng() & 0x3F) + (j & 0x40));
+    mediaList.push_back(
+        {"word/media/image" + std::to_string(i + 1) + ".png", media, true});
+  }
+  writeFixtureZip(fileName,
+                  fixtureDocxParts(fixtureDocumentXml(paragraphTotal, 20),
+                                   mediaList));
+  return fileName;
+}
+
+} // namespace
+
+void registerDocxOpenBenchmarks(Registry &registry) {
+  for (int mediaMiB : {1, 16, 64}) {
+    std::string suffix = "/" + std::to_string(mediaMiB) + "MiB";
+
+    // what a file listing or page count pays
+    registry.add("docxOpen/lazy" + suffix, [mediaMiB](State &state) {
+      std::string fileName = openArchiveName(mediaMiB);
+      size_t partLoadTotal = 0;
+      while (state.keepRunning()) {
+        DocxImpl docx;
+        if (docx.openFile(fileName) != MZ_OK)
+          state.skipWithError("open error");
+        partLoadTotal = docx.getPackage().getPartLoadTotal();
+      }
+      state.setItemsProcessed(state.getIterations());
+      state.setCounter("partsLoaded", (double)partLoadTotal);
+    });
+
+    registry.add("docxOpen/lazyModel" + suffix, [mediaMiB](State &state) {
+      std::string fileName = openArchiveName(mediaMiB);
+      while (state.keepRunning()) {
+        DocxImpl docx;
+        std::shared_ptr<const DocumentModel> model;
+        if (docx.openFile(fileName) != MZ_OK || docx.getModel(model) != MZ_OK)
+          state.skipWithError("open error");
+      }
+      state.setItemsProcessed(state.getIterations());
+    });
+
+    // every part inflated up front, as enumerating with extractEntryAll did
+    registry.add("docxOpen/eager" + suffix, [mediaMiB](State &state) {
+      std::string fileName = openArchiveName(mediaMiB);
+      while (state.keepRunning()) {
+        ZipReader zipReader;
+        if (zipReader.open(fileName) != MZ_OK)
+          state.skipWithError("open error");
+        std::vector<std::string> pathList;
+        for (const ZipIndexEntry &entry : zipReader.getIndex().getEntries())
+          pathList.push_back(std::string(entry.filePath));
+        for (auto &partFuture : zipReader.extractBatch(pathList))
+          doNotOptimize(partFuture.get());
+      }
+      state.setItemsProcessed(state.getIterations());
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
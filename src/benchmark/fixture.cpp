@@ -0,0 +1,631 @@
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+
+/* zlib
+ * License: zlib
+ */
+#include <zlib.h>
+
+// Local Project
+#include "../batch/pngWriter.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+void putLE16(std::string &out, uint16_t value) {
+  out.push_back((char)(value & 0xFF));
+  out.push_back((char)(value >> 8));
+}
+void putLE32(std::string &out, uint32_t value) {
+  putLE16(out, (uint16_t)(value & 0xFFFF));
+  putLE16(out, (uint16_t)(value >> 16));
+}
+
+std::string deflateRaw(const std::string &data) {
+  z_stream zs;
+  std::memset(&zs, 0, sizeof(zs));
+  deflateInit2(&zs, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&zs, (uLong)data.size()), '\0');
+  zs.next_in = (Bytef *)data.data();
+  zs.avail_in = (uInt)data.size();
+  zs.next_out = (Bytef *)&out[0];
+  zs.avail_out = (uInt)out.size();
+  deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return out;
+}
+
+const char *sentenceList[] = {
+    "The Licensee shall indemnify and hold harmless the Licensor ",
+    "against all claims arising from use of the Software &amp; its ",
+    "documentation, except where such claims result from gross ",
+    "negligence. This Agreement is governed by the laws of the State. "};
+const char *runPropertiesList[] = {
+    "", "<w:rPr><w:b/></w:rPr>", "<w:rPr><w:i/><w:sz w:val=\"20\"/></w:rPr>",
+    "<w:rPr><w:rFonts w:ascii=\"Arial\" w:hAnsi=\"Arial\"/></w:rPr>"};
+
+const char *sectionXml =
+    "<w:sectPr><w:pgSz w:w=\"12240\" w:h=\"15840\"/><w:pgMar "
+    "w:top=\"1440\" w:right=\"1440\" w:bottom=\"1440\" "
+    "w:left=\"1440\" w:header=\"720\" w:footer=\"720\" "
+    "w:gutter=\"0\"/></w:sectPr></w:body></w:document>";
+
+/* A 3x3 table of short cells */
+const std::string &tableXml() {
+  static std::string xml;
+  if (xml.empty()) {
+    xml = "<w:tbl><w:tblPr><w:tblW w:w=\"0\" w:type=\"auto\"/></w:tblPr>";
+    for (int row = 0; row < 3; row++) {
+      xml += "<w:tr>";
+      for (int column = 0; column < 3; column++)
+        xml += "<w:tc><w:tcPr><w:tcW w:w=\"3116\" w:type=\"dxa\"/>"
+               "</w:tcPr><w:p><w:r><w:t>Cell " +
+               std::to_string(row * 3 + column) + "</w:t></w:r></w:p></w:tc>";
+      xml += "</w:tr>";
+    }
+    xml += "</w:tbl>";
+  }
+  return xml;
+}
+
+// body paragraphs of fixture text that fill a letter page with 1" margins
+const int corpusParagraphsPerPage = 17;
+const int64_t emuPerPixel = 9525;
+// 6.5", the text width of the page above
+const int64_t corpusImageWidthMax = 5943600;
+
+/* styleTotal styles alternating paragraph and character. Each is based on
+ * the one of its kind before, restarting at the root every eighth, and
+ * sets something of its own.
+ */
+std::string corpusStylesXml(int styleTotal) {
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<w:styles xmlns:w=\"http://schemas.openxmlformats.org/"
+      "wordprocessingml/2006/main\"><w:docDefaults><w:rPrDefault><w:rPr>"
+      "<w:rFonts w:ascii=\"Calibri\" w:hAnsi=\"Calibri\"/>"
+      "<w:sz w:val=\"22\"/></w:rPr></w:rPrDefault><w:pPrDefault><w:pPr>"
+      "<w:spacing w:after=\"160\"/></w:pPr></w:pPrDefault></w:docDefaults>"
+      "<w:style w:type=\"paragraph\" w:default=\"1\" w:styleId=\"Normal\">"
+      "<w:name w:val=\"Normal\"/></w:style>"
+      "<w:style w:type=\"character\" w:default=\"1\" "
+      "w:styleId=\"DefaultParagraphFont\"><w:name "
+      "w:val=\"Default Paragraph Font\"/></w:style>";
+  for (int i = 0; i < styleTotal; i++) {
+    bool paragraph = i % 2 == 0;
+    std::string id = (paragraph ? "Corpus" : "CorpusChar") + std::to_string(i);
+    std::string basedOn =
+        i < 2 || i % 16 < 2
+            ? std::string(paragraph ? "Normal" : "DefaultParagraphFont")
+            : (paragraph ? "Corpus" : "CorpusChar") + std::to_string(i - 2);
+    xml += std::string("<w:style w:type=\"") +
+           (paragraph ? "paragraph" : "character") + "\" w:styleId=\"" + id +
+           "\"><w:name w:val=\"" + id + "\"/><w:basedOn w:val=\"" + basedOn +
+           "\"/>";
+    if (paragraph)
+      xml += "<w:pPr><w:spacing w:before=\"" + std::to_string(i % 5 * 20) +
+             "\"/></w:pPr>";
+    xml += "<w:rPr>" + std::string(i % 3 == 0 ? "<w:b/>" : "<w:i/>") +
+           "<w:sz w:val=\"" + std::to_string(20 + i % 4 * 2) +
+           "\"/></w:rPr></w:style>";
+  }
+  return xml + "</w:styles>";
+}
+
+/* The example tables of the JPEG standard: luminance quantization at
+ * quality 75 in zigzag order, and the luminance Huffman codes, which
+ * cover every symbol so they serve the chroma components too
+ */
+const uint8_t jpegQuantList[64] = {
+    8,  6,  6,  7,  6,  5,  8,  7,  7,  7,  9,  9,  8,  10, 12, 20,
+    13, 12, 11, 11, 12, 25, 18, 19, 15, 20, 29, 26, 31, 30, 29, 26,
+    28, 28, 32, 36, 46, 39, 32, 34, 44, 35, 28, 28, 40, 55, 41, 44,
+    48, 49, 52, 52, 52, 31, 39, 57, 61, 56, 50, 60, 46, 51, 52, 50};
+const uint8_t jpegZigzagList[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+const uint8_t jpegDcCountList[16] = {0, 1, 5, 1, 1, 1, 1, 1,
+                                     1, 0, 0, 0, 0, 0, 0, 0};
+const uint8_t jpegDcValueList[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+const uint8_t jpegAcCountList[16] = {0, 2, 1, 3, 3, 2, 4, 3,
+                                     5, 5, 4, 4, 0, 0, 1, 0x7D};
+const uint8_t jpegAcValueList[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06,
+    0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08,
+    0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45,
+    0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75,
+    0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3,
+    0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6,
+    0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9,
+    0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4,
+    0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA};
+
+/* Baseline JPEG, 4:2:0 YCbCr with a restart marker after every MCU row,
+ * the shape of what cameras and office suites embed
+ */
+class JpegWriter {
+public:
+  std::string out;
+
+  JpegWriter() {
+    buildCodes(jpegDcCountList, jpegDcValueList, dcCodeList, dcLengthList);
+    buildCodes(jpegAcCountList, jpegAcValueList, acCodeList, acLengthList);
+    const double pi = 3.14159265358979323846;
+    for (int u = 0; u < 8; u++)
+      for (int x = 0; x < 8; x++)
+        dctTable[u][x] = (float)((u == 0 ? std::sqrt(0.5) : 1.0) / 2 *
+                                 std::cos((2 * x + 1) * u * pi / 16));
+  }
+
+  void write(const unsigned char *pixels, size_t stride, int width,
+             int height) {
+    int mcuX = (width + 15) / 16, mcuY = (height + 15) / 16;
+    out = std::string("\xFF\xD8", 2);
+    putSegment(0xDB, std::string(1, '\0') +
+                         std::string((const char *)jpegQuantList, 64));
+    std::string frame = {8,
+                         (char)(height >> 8),
+                         (char)height,
+                         (char)(width >> 8),
+                         (char)width,
+                         3,
+                         1,
+                         0x22,
+                         0,
+                         2,
+                         0x11,
+                         0,
+                         3,
+                         0x11,
+                         0};
+    putSegment(0xC0, frame);
+    putSegment(0xC4, huffmanSegment(0x00, jpegDcCountList, jpegDcValueList) +
+                         huffmanSegment(0x10, jpegAcCountList,
+                                        jpegAcValueList));
+    putSegment(0xDD, std::string{(char)(mcuX >> 8), (char)mcuX});
+    putSegment(0xDA, std::string{3, 1, 0, 2, 0, 3, 0, 0, 63, 0});
+
+    float block[4][64], cb[64], cr[64];
+    for (int my = 0; my < mcuY; my++) {
+      if (my > 0) {
+        flushBits();
+        out.push_back((char)0xFF);
+        out.push_back((char)(0xD0 + (my - 1) % 8));
+      }
+      int predictorList[3] = {0, 0, 0};
+      for (int mx = 0; mx < mcuX; mx++) {
+        std::fill(cb, cb + 64, 0.0f);
+        std::fill(cr, cr + 64, 0.0f);
+        for (int y = 0; y < 16; y++) {
+          int sourceY = std::min(my * 16 + y, height - 1);
+          for (int x = 0; x < 16; x++) {
+            int sourceX = std::min(mx * 16 + x, width - 1);
+            const unsigned char *pixel =
+                pixels + (size_t)sourceY * stride + (size_t)sourceX * 4;
+            float r = pixel[0], g = pixel[1], b = pixel[2];
+            block[(y / 8) * 2 + x / 8][(y % 8) * 8 + x % 8] =
+                0.299f * r + 0.587f * g + 0.114f * b - 128;
+            int chroma = (y / 2) * 8 + x / 2;
+            cb[chroma] += (-0.168736f * r - 0.331264f * g + 0.5f * b) / 4;
+            cr[chroma] += (0.5f * r - 0.418688f * g - 0.081312f * b) / 4;
+          }
+        }
+        for (int i = 0; i < 4; i++)
+          encodeBlock(block[i], predictorList[0]);
+        encodeBlock(cb, predictorList[1]);
+        encodeBlock(cr, predictorList[2]);
+      }
+    }
+    flushBits();
+    out += std::string("\xFF\xD9", 2);
+  }
+
+private:
+  static void buildCodes(const uint8_t *countList, const uint8_t *valueList,
+                         uint16_t *codeList, uint8_t *lengthList) {
+    int code = 0, index = 0;
+    for (int length = 1; length <= 16; length++, code <<= 1)
+      for (int i = 0; i < countList[length - 1]; i++, code++, index++) {
+        codeList[valueList[index]] = (uint16_t)code;
+        lengthList[valueList[index]] = (uint8_t)length;
+      }
+  }
+  static std::string huffmanSegment(char tableClass, const uint8_t *countList,
+                                    const uint8_t *valueList) {
+    std::string segment(1, tableClass);
+    segment.append((const char *)countList, 16);
+    int valueTotal = 0;
+    for (int i = 0; i < 16; i++)
+      valueTotal += countList[i];
+    return segment.append((const char *)valueList, valueTotal);
+  }
+  void putSegment(int marker, const std::string &payload) {
+    out.push_back((char)0xFF);
+    out.push_back((char)marker);
+    out.push_back((char)((payload.size() + 2) >> 8));
+    out.push_back((char)(payload.size() + 2));
+    out += payload;
+  }
+  void putBits(uint32_t code, int length) {
+    bitBuffer = bitBuffer << length | code;
+    bitTotal += length;
+    for (; bitTotal >= 8; bitTotal -= 8) {
+      char byte = (char)(bitBuffer >> (bitTotal - 8));
+      out.push_back(byte);
+      if (byte == (char)0xFF)
+        out.push_back(0);
+    }
+    bitBuffer &= (1u << bitTotal) - 1;
+  }
+  /* Pads the last byte with ones */
+  void flushBits() {
+    if (bitTotal)
+      putBits((1u << (8 - bitTotal)) - 1, 8 - bitTotal);
+  }
+  /* Size category and bits of a coefficient */
+  void putValue(int value, int &category, uint32_t &bits) {
+    int magnitude = std::abs(value);
+    for (category = 0; magnitude >> category; category++)
+      ;
+    bits = (uint32_t)(value < 0 ? value - 1 : value) & ((1u << category) - 1);
+  }
+  void encodeBlock(const float *samples, int &predictor) {
+    float rowList[8][8], coefList[64];
+    for (int y = 0; y < 8; y++)
+      for (int u = 0; u < 8; u++) {
+        float sum = 0;
+        for (int x = 0; x < 8; x++)
+          sum += dctTable[u][x] * samples[y * 8 + x];
+        rowList[y][u] = sum;
+      }
+    for (int v = 0; v < 8; v++)
+      for (int u = 0; u < 8; u++) {
+        float sum = 0;
+        for (int y = 0; y < 8; y++)
+          sum += dctTable[v][y] * rowList[y][u];
+        coefList[v * 8 + u] = sum;
+      }
+    int quantized[64];
+    for (int k = 0; k < 64; k++)
+      quantized[k] =
+          (int)std::lround(coefList[jpegZigzagList[k]] / jpegQuantList[k]);
+    int category;
+    uint32_t bits;
+    putValue(quantized[0] - predictor, category, bits);
+    predictor = quantized[0];
+    putBits(dcCodeList[category], dcLengthList[category]);
+    putBits(bits, category);
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+      if (quantized[k] == 0) {
+        run++;
+        continue;
+      }
+      for (; run >= 16; run -= 16)
+        putBits(acCodeList[0xF0], acLengthList[0xF0]);
+      putValue(quantized[k], category, bits);
+      int symbol = run << 4 | category;
+      putBits(acCodeList[symbol], acLengthList[symbol]);
+      putBits(bits, category);
+      run = 0;
+    }
+    if (run)
+      putBits(acCodeList[0], acLengthList[0]);
+  }
+
+  uint16_t dcCodeList[256], acCodeList[256];
+  uint8_t dcLengthList[256], acLengthList[256];
+  float dctTable[8][8];
+  uint32_t bitBuffer = 0;
+  int bitTotal = 0;
+};
+
+/* A gradient under a little noise, so it neither vanishes under deflate
+ * nor stays the size of its pixels. A PNG, or a JPEG when jpeg is set.
+ */
+std::string corpusImage(int size, bool jpeg, std::mt19937 &rng) {
+  size_t stride = (size_t)size * 4;
+  std::vector<unsigned char> pixels(stride * size);
+  for (int y = 0; y < size; y++) {
+    unsigned char *row = pixels.data() + y * stride;
+    for (int x = 0; x < size; x++) {
+      unsigned noise = rng() & 0x0F;
+      row[x * 4] = (unsigned char)(x * 255 / size + noise);
+      row[x * 4 + 1] = (unsigned char)(y * 255 / size + noise);
+      row[x * 4 + 2] = (unsigned char)(128 + noise);
+      row[x * 4 + 3] = 255;
+    }
+  }
+  if (jpeg) {
+    JpegWriter writer;
+    writer.write(pixels.data(), stride, size, size);
+    return writer.out;
+  }
+  std::vector<char> png;
+  batch::encodePng(pixels.data(), stride, size, size, 6, png);
+  return std::string(png.begin(), png.end());
+}
+
+/* An inline picture of the image related as rId<100 + imageIndex> */
+std::string corpusDrawingXml(int imageIndex, int size) {
+  int64_t extent = std::min<int64_t>(size * emuPerPixel, corpusImageWidthMax);
+  std::string id = std::to_string(imageIndex + 1);
+  return "<w:r><w:drawing><wp:inline><wp:extent cx=\"" +
+         std::to_string(extent) + "\" cy=\"" + std::to_string(extent) +
+         "\"/><wp:docPr id=\"" + id + "\" name=\"Picture " + id +
+         "\"/><a:graphic><a:graphicData uri=\"http://"
+         "schemas.openxmlformats.org/drawingml/2006/picture\"><pic:pic>"
+         "<pic:blipFill><a:blip r:embed=\"rId" +
+         std::to_string(100 + imageIndex) +
+         "\"/></pic:blipFill></pic:pic></a:graphicData></a:graphic>"
+         "</wp:inline></w:drawing></w:r>";
+}
+
+std::string corpusDocumentXml(const CorpusOptions &options,
+                              std::mt19937 &rng) {
+  int paragraphTotal = std::max(options.pageTotal, 1) * corpusParagraphsPerPage;
+  int paragraphStyleTotal = (options.styleTotal + 1) / 2;
+  int characterStyleTotal = options.styleTotal / 2;
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<w:document xmlns:r=\"http://schemas.openxmlformats.org/"
+      "officeDocument/2006/relationships\" xmlns:w=\"http://"
+      "schemas.openxmlformats.org/wordprocessingml/2006/main\" "
+      "xmlns:wp=\"http://schemas.openxmlformats.org/drawingml/2006/"
+      "wordprocessingDrawing\" xmlns:a=\"http://schemas.openxmlformats.org/"
+      "drawingml/2006/main\" xmlns:pic=\"http://"
+      "schemas.openxmlformats.org/drawingml/2006/picture\"><w:body>";
+  int imageIndex = 0;
+  for (int i = 0; i < paragraphTotal; i++) {
+    xml += "<w:p><w:pPr>";
+    if (paragraphStyleTotal)
+      xml += "<w:pStyle w:val=\"Corpus" +
+             std::to_string(i % paragraphStyleTotal * 2) + "\"/>";
+    xml += "</w:pPr>";
+    for (int j = 0; j < 4; j++) {
+      uint32_t pick = rng();
+      xml += "<w:r>";
+      if (characterStyleTotal && j % 2)
+        xml += "<w:rPr><w:rStyle w:val=\"CorpusChar" +
+               std::to_string(pick % characterStyleTotal * 2 + 1) +
+               "\"/></w:rPr>";
+      else
+        xml += runPropertiesList[pick % 4];
+      xml += "<w:t xml:space=\"preserve\">";
+      xml += sentenceList[(pick >> 8) % 4];
+      xml += "</w:t></w:r>";
+    }
+    // pictures spread evenly, each in a paragraph of its own
+    if (imageIndex < options.imageTotal &&
+        (int64_t)(imageIndex + 1) * paragraphTotal /
+                (options.imageTotal + 1) ==
+            i) {
+      xml += "</w:p><w:p>" + corpusDrawingXml(imageIndex, options.imageSize);
+      imageIndex++;
+    }
+    xml += "</w:p>";
+    if (options.tableEvery > 0 &&
+        i % options.tableEvery == options.tableEvery - 1)
+      xml += tableXml();
+  }
+  for (; imageIndex < options.imageTotal; imageIndex++)
+    xml += "<w:p>" + corpusDrawingXml(imageIndex, options.imageSize) +
+           "</w:p>";
+  return xml + sectionXml;
+}
+
+} // namespace
+
+bool writeFixtureZip(std::string fileName,
+                     const std::vector<FixturePart> &partList) {
+  std::ofstream outFile(fileName, std::ios::binary);
+  if (!outFile)
+    return false;
+  std::string centralDirectory, header;
+  uint32_t offset = 0;
+  for (const FixturePart &part : partList) {
+    std::string compressed = part.deflate ? deflateRaw(part.data) : part.data;
+    uint32_t crc = (uint32_t)crc32(
+        crc32(0L, Z_NULL, 0), (const Bytef *)part.data.data(),
+        (uInt)part.data.size());
+    uint16_t method = part.deflate ? 8 : 0;
+
+    header.clear();
+    putLE32(header, 0x04034b50);
+    putLE16(header, 20);
+    putLE16(header, 0);
+    putLE16(header, method);
+    putLE32(header, 0x50A10000); // 2020-05-01 00:00
+    putLE32(header, crc);
+    putLE32(header, (uint32_t)compressed.size());
+    putLE32(header, (uint32_t)part.data.size());
+    putLE16(header, (uint16_t)part.filePath.size());
+    putLE16(header, 0);
+    header += part.filePath;
+    outFile.write(header.data(), header.size());
+    outFile.write(compressed.data(), compressed.size());
+
+    putLE32(centralDirectory, 0x02014b50);
+    putLE16(centralDirectory, 20);
+    putLE16(centralDirectory, 20);
+    putLE16(centralDirectory, 0);
+    putLE16(centralDirectory, method);
+    putLE32(centralDirectory, 0x50A10000);
+    putLE32(centralDirectory, crc);
+    putLE32(centralDirectory, (uint32_t)compressed.size());
+    putLE32(centralDirectory, (uint32_t)part.data.size());
+    putLE16(centralDirectory, (uint16_t)part.filePath.size());
+    putLE16(centralDirectory, 0);
+    putLE16(centralDirectory, 0);
+    putLE16(centralDirectory, 0);
+    putLE16(centralDirectory, 0);
+    putLE32(centralDirectory, 0);
+    putLE32(centralDirectory, offset);
+    centralDirectory += part.filePath;
+    offset += (uint32_t)(header.size() + compressed.size());
+  }
+  outFile.write(centralDirectory.data(), centralDirectory.size());
+
+  std::string end;
+  putLE32(end, 0x06054b50);
+  putLE16(end, 0);
+  putLE16(end, 0);
+  putLE16(end, (uint16_t)partList.size());
+  putLE16(end, (uint16_t)partList.size());
+  putLE32(end, (uint32_t)centralDirectory.size());
+  putLE32(end, offset);
+  putLE16(end, 0);
+  outFile.write(end.data(), end.size());
+  return (bool)outFile;
+}
+
+std::string fixtureDocumentXml(int paragraphTotal, int tableEvery) {
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<w:document xmlns:r=\"http://schemas.openxmlformats.org/"
+      "officeDocument/2006/relationships\" xmlns:w=\"http://"
+      "schemas.openxmlformats.org/wordprocessingml/2006/main\"><w:body>";
+  for (int i = 0; i < paragraphTotal; i++) {
+    xml += "<w:p w:rsidR=\"001734CC\" w:rsidRDefault=\"007818F1\"><w:pPr>"
+           "<w:spacing w:after=\"160\"/></w:pPr>";
+    for (int j = 0; j < 4; j++) {
+      xml += "<w:r>";
+      xml += runPropertiesList[(i + j) % 4];
+      xml += "<w:t xml:space=\"preserve\">";
+      xml += sentenceList[(i * 3 + j) % 4];
+      xml += "</w:t></w:r>";
+    }
+    xml += "</w:p>";
+    if (tableEvery > 0 && i % tableEvery == tableEvery - 1)
+      xml += tableXml();
+  }
+  xml += sectionXml;
+  return xml;
+}
+
+std::vector<FixturePart>
+fixtureDocxParts(std::string documentXml,
+                 const std::vector<FixturePart> &mediaList,
+                 std::string stylesXml) {
+  const std::string relationshipType =
+      "http://schemas.openxmlformats.org/officeDocument/2006/relationships/";
+  std::string contentTypes =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/"
+      "content-types\"><Default Extension=\"png\" "
+      "ContentType=\"image/png\"/><Default Extension=\"jpeg\" "
+      "ContentType=\"image/jpeg\"/><Default Extension=\"rels\" "
+      "ContentType=\"application/"
+      "vnd.openxmlformats-package.relationships+xml\"/><Default "
+      "Extension=\"xml\" ContentType=\"application/xml\"/><Override "
+      "PartName=\"/word/document.xml\" ContentType=\"application/"
+      "vnd.openxmlformats-officedocument.wordprocessingml.document.main+xml\"/>"
+      "<Override PartName=\"/word/styles.xml\" ContentType=\"application/"
+      "vnd.openxmlformats-officedocument.wordprocessingml.styles+xml\"/>"
+      "</Types>";
+  std::string packageRelationships =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/"
+      "relationships\"><Relationship Id=\"rId1\" Type=\"" +
+      relationshipType +
+      "officeDocument\" Target=\"word/document.xml\"/></Relationships>";
+  std::string documentRelationships =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/"
+      "relationships\"><Relationship Id=\"rId1\" Type=\"" +
+      relationshipType + "styles\" Target=\"styles.xml\"/>";
+  for (size_t i = 0; i < mediaList.size(); i++) {
+    std::string target = mediaList[i].filePath;
+    if (target.rfind("word/", 0) == 0)
+      target.erase(0, 5);
+    documentRelationships += "<Relationship Id=\"rId" +
+                             std::to_string(100 + i) + "\" Type=\"" +
+                             relationshipType + "image\" Target=\"" + target +
+                             "\"/>";
+  }
+  documentRelationships += "</Relationships>";
+  std::string styles = stylesXml;
+  if (styles.empty())
+    styles =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<w:styles xmlns:w=\"http://schemas.openxmlformats.org/"
+        "wordprocessingml/2006/main\"><w:docDefaults><w:rPrDefault><w:rPr>"
+        "<w:sz w:val=\"22\"/></w:rPr></w:rPrDefault></w:docDefaults>"
+        "<w:style w:type=\"paragraph\" w:default=\"1\" "
+        "w:styleId=\"Normal\"><w:name w:val=\"Normal\"/></w:style>"
+        "</w:styles>";
+
+  std::vector<FixturePart> partList = {
+      {"[Content_Types].xml", contentTypes, true},
+      {"_rels/.rels", packageRelationships, true},
+      {"word/document.xml", documentXml, true},
+      {"word/_rels/document.xml.rels", documentRelationships, true},
+      {"word/styles.xml", styles, true}};
+  partList.insert(partList.end(), mediaList.begin(), mediaList.end());
+  return partList;
+}
+
+std::string corpusArchiveName(const CorpusOptions &options) {
+  std::string fileName =
+      fixtureDirectory() + "/corpus-p" + std::to_string(options.pageTotal) +
+      "-t" + std::to_string(options.tableEvery) + "-i" +
+      std::to_string(options.imageTotal) + "x" +
+      std::to_string(options.imageSize) + (options.jpeg ? "j" : "") + "-s" +
+      std::to_string(options.styleTotal) +
+      (options.deflate ? "-deflate" : "-store") + "-" +
+      std::to_string(options.seed) + ".docx";
+  static std::map<std::string, bool> writtenMap;
+  bool &written = writtenMap[fileName];
+  if (written)
+    return fileName;
+  written = true;
+
+  // std::mt19937 is specified to the bit, the distributions are not
+  std::mt19937 rng(options.seed);
+  std::vector<FixturePart> mediaList;
+  for (int i = 0; i < options.imageTotal; i++)
+    mediaList.push_back({"word/media/image" + std::to_string(i + 1) +
+                             (options.jpeg ? ".jpeg" : ".png"),
+                         corpusImage(options.imageSize, options.jpeg, rng),
+                         true});
+  std::string documentXml = corpusDocumentXml(options, rng);
+  std::vector<FixturePart> partList = fixtureDocxParts(
+      documentXml, mediaList,
+      options.styleTotal ? corpusStylesXml(options.styleTotal) : "");
+  for (FixturePart &part : partList)
+    part.deflate = options.deflate;
+  writeFixtureZip(fileName, partList);
+  return fileName;
+}
+
+std::string fixtureDirectory() {
+  std::filesystem::path dirPath =
+      std::filesystem::temp_directory_path() / "bookfiler-docx-benchmark";
+  std::error_code ec;
+  std::filesystem::create_directories(dirPath, ec);
+  return dirPath.string();
+}
+
+} // namespace benchmark
+} // namespace bookfiler
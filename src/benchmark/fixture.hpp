@@ -0,0 +1,78 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_BENCHMARK_FIXTURE_H
+#define BOOKFILER_MODULE_DOCX_BENCHMARK_FIXTURE_H
+
+// C++
+#include <string>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+class FixturePart {
+public:
+  std::string filePath, data;
+  bool deflate;
+};
+
+/* Writes a plain zip archive, deflated parts use zlib level 6
+ * @return false if the file could not be written
+ */
+bool writeFixtureZip(std::string fileName,
+                     const std::vector<FixturePart> &partList);
+/* word/document.xml with paragraphTotal paragraphs of contract-like text in
+ * a few run formats. With tableEvery > 0 a 3x3 table follows every
+ * tableEvery-th paragraph.
+ */
+std::string fixtureDocumentXml(int paragraphTotal, int tableEvery = 0);
+/* A complete docx around documentXml: content types, package and document
+ * relationships, stylesXml or a small styles part when it is empty, and
+ * mediaList related to the main document as rId100, rId101, ... in order
+ */
+std::vector<FixturePart>
+fixtureDocxParts(std::string documentXml,
+                 const std::vector<FixturePart> &mediaList = {},
+                 std::string stylesXml = std::string());
+/* The knobs of a generated document. Everything derives from these and
+ * seed, so the same options give the same bytes on every machine.
+ */
+class CorpusOptions {
+public:
+  // about this many pages of body text; tables and images add to it
+  int pageTotal = 10;
+  // a 3x3 table after every tableEvery-th paragraph, 0 for none
+  int tableEvery = 0;
+  // inline pictures spread evenly through the body
+  int imageTotal = 0;
+  // each picture is an imageSize x imageSize RGBA PNG
+  int imageSize = 256;
+  // baseline 4:2:0 JPEG pictures instead
+  bool jpeg = false;
+  // paragraph and character styles in based-on chains, 0 for a bare part
+  int styleTotal = 0;
+  // every part STOREd when false
+  bool deflate = true;
+  uint32_t seed = 1;
+};
+
+/* Writes the document options describe into fixtureDirectory(), once per
+ * process, and returns its path. The name spells out the options.
+ */
+std::string corpusArchiveName(const CorpusOptions &options);
+/* Scratch directory for generated archives, created on first use */
+std::string fixtureDirectory();
+
+} // namespace benchmark
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_BENCHMARK_FIXTURE_H
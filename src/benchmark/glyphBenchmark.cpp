@@ -0,0 +1,125 @@
+// C++
+#include <algorithm>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/glyphCache.hpp"
+#include "../core/rasterizer.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int paragraphTotal = 1600;
+const uint32_t pageTotal = 100;
+const int32_t dpi = 96;
+
+std::string glyphArchiveName() {
+  static std::string fileName;
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/glyph.docx";
+  writeFixtureZip(fileName,
+                  fixtureDocxParts(fixtureDocumentXml(paragraphTotal, 25)));
+  return fileName;
+}
+
+/* Draws the first pageTotal pages straight through PageRasterizer, so the
+ * tile cache is out of the picture
+ */
+uint32_t renderPages(const DocumentLayout &layout,
+                     std::vector<unsigned char> &pixels) {
+  PageRasterizer rasterizer(layout, dpi);
+  uint32_t pageEnd =
+      std::min<uint32_t>(pageTotal, (uint32_t)layout.getPageList().size());
+  for (uint32_t pageIndex = 0; pageIndex < pageEnd; pageIndex++) {
+    int32_t width, height;
+    rasterizer.getPageSize(pageIndex, width, height);
+    pixels.resize((size_t)width * height * 4);
+    rasterizer.render(pageIndex, {pixels.data(), (size_t)width * 4, width,
+                                  height, 0, 0});
+    doNotOptimize(pixels.data());
+  }
+  return pageEnd;
+}
+
+double hitRate(uint64_t hits, uint64_t misses) {
+  return hits + misses ? (double)hits / (double)(hits + misses) : 0;
+}
+
+} // namespace
+
+void registerGlyphBenchmarks(Registry &registry) {
+  /* The same 100 pages with the glyph atlas and shaped run cache emptied
+   * before every pass, kept between passes, and turned off. A pass repeats
+   * the same few hundred glyphs, so hit rates round to 1.00 even cold; the
+   * per pass miss and rasterize counts are what tell the rows apart.
+   */
+  for (const char *mode : {"cold", "warm", "uncached"}) {
+    registry.add(std::string("glyph/pages100/") + mode, [mode](State &state) {
+      DocxImpl docx;
+      std::shared_ptr<const DocumentLayout> layout;
+      if (docx.openFile(glyphArchiveName()) != MZ_OK ||
+          docx.getLayout(layout) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      std::string modeName = mode;
+      GlyphAtlas::Stats savedGlyph = glyphAtlas().getStats();
+      ShapedRunCache::Stats savedRun = shapedRunCache().getStats();
+      if (modeName == "uncached") {
+        glyphAtlas().setByteBudget(0);
+        shapedRunCache().setByteBudget(0);
+      }
+      std::vector<unsigned char> pixels;
+      glyphAtlas().clear();
+      shapedRunCache().clear();
+      if (modeName == "warm")
+        renderPages(*layout, pixels);
+      GlyphAtlas::Stats glyphBefore = glyphAtlas().getStats();
+      ShapedRunCache::Stats runBefore = shapedRunCache().getStats();
+      uint64_t pagesDone = 0;
+      while (state.keepRunning()) {
+        if (modeName == "cold") {
+          // only the pass that starts empty is timed
+          state.pauseTiming();
+          glyphAtlas().clear();
+          shapedRunCache().clear();
+          state.resumeTiming();
+        }
+        pagesDone += renderPages(*layout, pixels);
+      }
+      GlyphAtlas::Stats glyphStats = glyphAtlas().getStats();
+      ShapedRunCache::Stats runStats = shapedRunCache().getStats();
+      uint64_t glyphHits = glyphStats.hitTotal - glyphBefore.hitTotal;
+      uint64_t glyphMisses = glyphStats.missTotal - glyphBefore.missTotal;
+      uint64_t runHits = runStats.hitTotal - runBefore.hitTotal;
+      uint64_t runMisses = runStats.missTotal - runBefore.missTotal;
+      double passTotal = (double)std::max(1LL, state.getIterations());
+      state.setItemsProcessed((long long)pagesDone);
+      state.setCounter("glyphHitRate", hitRate(glyphHits, glyphMisses));
+      state.setCounter("glyphMisses", glyphMisses / passTotal);
+      state.setCounter(
+          "glyphRasterized",
+          (glyphStats.rasterizeTotal - glyphBefore.rasterizeTotal) /
+              passTotal);
+      state.setCounter("runHitRate", hitRate(runHits, runMisses));
+      state.setCounter("runMisses", runMisses / passTotal);
+      state.setCounter("atlasBytes", (double)glyphStats.byteTotal);
+      if (modeName == "uncached") {
+        glyphAtlas().setByteBudget(savedGlyph.byteBudget);
+        shapedRunCache().setByteBudget(savedRun.byteBudget);
+      }
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
@@ -0,0 +1,199 @@
+// C++
+#include <memory>
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/bufferPool.hpp"
+#include "../core/docxImpl.hpp"
+#include "../core/jpegDecoder.hpp"
+#include "../core/mediaCache.hpp"
+#include "../core/pixelKernel.hpp"
+#include "../core/pngDecoder.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const uint32_t dpi = 96;
+const int32_t imageSize = 1280;
+// a full width picture at 96 dpi, 6.5"
+const int32_t drawnSize = 624;
+
+/* The bytes of the one picture of a generated document */
+std::string mediaData(bool jpeg) {
+  CorpusOptions options;
+  options.pageTotal = 1;
+  options.imageTotal = 1;
+  options.imageSize = imageSize;
+  options.jpeg = jpeg;
+  DocxImpl docx;
+  std::shared_ptr<const ZipPart> part;
+  if (docx.openFile(corpusArchiveName(options)) != MZ_OK ||
+      docx.getRelatedPart("rId100", part) != MZ_OK)
+    return std::string();
+  return std::string(part->data);
+}
+
+/* 100 JPEG pictures a little larger than they are drawn */
+std::string mediaArchiveName() {
+  CorpusOptions options;
+  options.pageTotal = 20;
+  options.imageTotal = 100;
+  options.imageSize = imageSize;
+  options.jpeg = true;
+  return corpusArchiveName(options);
+}
+
+/* A premultiplied gradient fading from opaque to clear */
+RasterImage fadingImage(int32_t size) {
+  RasterImage image;
+  image.width = image.height = size;
+  image.stride = (size_t)size * 4;
+  image.pixels = pixmapBufferPool().acquire(image.byteSize());
+  for (int32_t y = 0; y < size; y++) {
+    unsigned char *row = image.pixels.get() + (size_t)y * image.stride;
+    for (int32_t x = 0; x < size; x++) {
+      unsigned char alpha = (unsigned char)(255 - x * 255 / size);
+      row[x * 4] = (unsigned char)(alpha * y / size);
+      row[x * 4 + 1] = (unsigned char)(alpha / 2);
+      row[x * 4 + 2] = alpha;
+      row[x * 4 + 3] = alpha;
+    }
+  }
+  return image;
+}
+
+/* Runs the benchmark body with kernel selected, restoring the previous
+ * choice afterwards
+ */
+void withKernel(const PixelKernel *kernel, State &state,
+                const benchmark_cb_t &benchmarkCallback) {
+  std::string previousName = pixelKernel().name;
+  pixelSelectKernel(kernel->name);
+  benchmarkCallback(state);
+  pixelSelectKernel(previousName);
+}
+
+/* Every page of the media document at dpi, the tiles drawn again each
+ * pass and with clearMedia the pictures decoded again too
+ */
+void renderMedia(State &state, bool clearMedia) {
+  DocxImpl docx;
+  std::shared_ptr<const DocumentLayout> layout;
+  if (docx.openFile(mediaArchiveName()) != MZ_OK ||
+      docx.getLayout(layout) != MZ_OK)
+    return state.skipWithError("open error");
+  uint32_t pageTotal = (uint32_t)layout->getPageList().size();
+  // every picture fits, so warm passes decode nothing
+  size_t budget = mediaCache().getStats().byteBudget;
+  mediaCache().setByteBudget((size_t)256 << 20);
+  mediaCache().clear();
+  if (!clearMedia)
+    for (uint32_t pageIndex = 0; pageIndex < pageTotal; pageIndex++) {
+      std::shared_ptr<const RasterImage> image;
+      docx.getPageImage(pageIndex, dpi, image);
+    }
+  MediaCache::Stats before = mediaCache().getStats();
+  while (state.keepRunning()) {
+    tileCache().clear();
+    if (clearMedia)
+      mediaCache().clear();
+    for (uint32_t pageIndex = 0; pageIndex < pageTotal; pageIndex++) {
+      std::shared_ptr<const RasterImage> image;
+      if (docx.getPageImage(pageIndex, dpi, image) != MZ_OK)
+        state.skipWithError("render error");
+    }
+  }
+  MediaCache::Stats stats = mediaCache().getStats();
+  mediaCache().setByteBudget(budget);
+  mediaCache().clear();
+  state.setItemsProcessed(state.getIterations() * pageTotal);
+  state.setCounter("pages", (double)pageTotal);
+  state.setCounter("decodes", (double)(stats.missTotal - before.missTotal) /
+                                  (double)state.getIterations());
+}
+
+} // namespace
+
+void registerImageBenchmarks(Registry &registry) {
+  // the whole image, as drawn at full size
+  registry.add("image/decode/png", [](State &state) {
+    std::string data = mediaData(false);
+    RasterImage image;
+    while (state.keepRunning()) {
+      PngDecoder decoder;
+      if (decoder.open(data) != MZ_OK || decoder.decode(image) != MZ_OK)
+        state.skipWithError("decode error");
+    }
+    state.setBytesProcessed(state.getIterations() * imageSize * imageSize *
+                            4);
+  });
+
+  for (uint32_t denominator : {1, 2, 4, 8}) {
+    // 1/denominator of the image straight from the DCT coefficients
+    registry.add("image/decode/jpeg/" + std::to_string(denominator),
+                 [denominator](State &state) {
+                   std::string data = mediaData(true);
+                   RasterImage image;
+                   while (state.keepRunning()) {
+                     JpegDecoder decoder;
+                     if (decoder.open(data) != MZ_OK ||
+                         decoder.decode(denominator, image) != MZ_OK)
+                       state.skipWithError("decode error");
+                   }
+                   state.setBytesProcessed(state.getIterations() *
+                                           imageSize * imageSize * 4);
+                 });
+  }
+
+  // what a render does on a miss: sniff, decode at 1/2, resample
+  registry.add("image/decode/drawn", [](State &state) {
+    std::string data = mediaData(true);
+    RasterImage image;
+    while (state.keepRunning())
+      if (mediaDecode(data, drawnSize, drawnSize, image) != MZ_OK)
+        state.skipWithError("decode error");
+    state.setItemsProcessed(state.getIterations());
+  });
+
+  for (const PixelKernel *kernel : pixelKernelList()) {
+    std::string prefix = std::string("image/") + kernel->name;
+    registry.add(prefix + "/scale", [kernel](State &state) {
+      withKernel(kernel, state, [](State &state) {
+        RasterImage source = fadingImage(imageSize), scaled;
+        while (state.keepRunning())
+          pixelScale(source, drawnSize, drawnSize, scaled);
+        state.setBytesProcessed(state.getIterations() * drawnSize *
+                                drawnSize * 4);
+      });
+    });
+    registry.add(prefix + "/composite", [kernel](State &state) {
+      withKernel(kernel, state, [](State &state) {
+        RasterImage source = fadingImage(drawnSize),
+                    target = fadingImage(drawnSize);
+        while (state.keepRunning())
+          pixelComposite(source, target.pixels.get(), target.stride,
+                         target.width, target.height, 0, 0);
+        state.setBytesProcessed(state.getIterations() * drawnSize *
+                                drawnSize * 4);
+      });
+    });
+  }
+
+  // every page with 100 pictures, decoding each
+  registry.add("image/render/cold",
+               [](State &state) { renderMedia(state, true); });
+  // every page again, the pictures come from mediaCache()
+  registry.add("image/render/warm",
+               [](State &state) { renderMedia(state, false); });
+}
+
+} // namespace benchmark
+} // namespace bookfiler
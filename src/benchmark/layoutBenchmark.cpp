@@ -0,0 +1,131 @@
+// C++
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/layout.hpp"
+#include "../core/threadPool.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int paragraphTotal = 4000;
+
+std::string layoutArchiveName() {
+  static std::string fileName;
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/layout.docx";
+  writeFixtureZip(fileName,
+                  fixtureDocxParts(fixtureDocumentXml(paragraphTotal, 25)));
+  return fileName;
+}
+
+int32_t loadLayoutModel(std::shared_ptr<const DocumentModel> &model) {
+  DocxImpl docx;
+  int32_t err = docx.openFile(layoutArchiveName());
+  if (err != MZ_OK)
+    return err;
+  return docx.getModel(model);
+}
+
+/* A copy of model with one body paragraph in the middle turned bold and
+ * larger, the kind of edit that moves every line after it
+ */
+DocumentModel editedModel(const DocumentModel &model,
+                          uint32_t &paragraphIndex) {
+  DocumentModel edited = model;
+  paragraphIndex = (uint32_t)edited.paragraphList.size() / 2;
+  while (paragraphIndex < edited.paragraphList.size() &&
+         edited.paragraphList[paragraphIndex].cellIndex != documentNone)
+    paragraphIndex++;
+  const DocumentParagraph &paragraph = edited.paragraphList[paragraphIndex];
+  for (uint32_t runIndex = paragraph.runBegin; runIndex < paragraph.runEnd;
+       runIndex++) {
+    DocumentRun &run = edited.runList[runIndex];
+    RunProperties properties = edited.resolvedRunTable.get(run.resolvedId);
+    properties.flags |= RunProperties::bold;
+    properties.halfPoints = 32;
+    run.resolvedId = edited.resolvedRunTable.intern(properties);
+  }
+  return edited;
+}
+
+void setLayoutCounters(State &state, const DocumentLayout &layout) {
+  DocumentLayout::Stats stats = layout.getStats();
+  state.setCounter("pages", (double)layout.getPageList().size());
+  state.setCounter("measured", (double)stats.measuredTotal);
+  state.setCounter("reused", (double)stats.reusedTotal);
+  state.setCounter("placed", (double)stats.placedTotal);
+  state.setCounter("copied", (double)stats.copiedTotal);
+}
+
+} // namespace
+
+void registerLayoutBenchmarks(Registry &registry) {
+  /* Measuring every paragraph on one thread, then on the module pool, with
+   * the same sequential pagination pass after it
+   */
+  for (const char *mode : {"serial", "parallel"}) {
+    registry.add(std::string("layout/paginate/") + mode, [mode](State &state) {
+      std::shared_ptr<const DocumentModel> model;
+      if (loadLayoutModel(model) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      ThreadPool serialPool(1);
+      ThreadPool &pool = std::string(mode) == "serial" ? serialPool
+                                                         : defaultThreadPool();
+      LayoutOptions options;
+      options.recordBoxes = true;
+      DocumentLayout layout(*model, options);
+      while (state.keepRunning())
+        doNotOptimize(layout.paginate(pool));
+      state.setItemsProcessed(state.getIterations() *
+                              (long long)model->paragraphList.size());
+      state.setCounter("threads", (double)pool.size());
+      setLayoutCounters(state, layout);
+    });
+  }
+
+  /* Laying the document out again after one paragraph in the middle
+   * changed: from scratch, and from the layout before the edit
+   */
+  for (const char *mode : {"full", "incremental"}) {
+    registry.add(std::string("layout/relayout/") + mode, [mode](State &state) {
+      std::shared_ptr<const DocumentModel> model;
+      if (loadLayoutModel(model) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      LayoutOptions options;
+      options.recordBoxes = true;
+      DocumentLayout previous(*model, options);
+      previous.paginate();
+      uint32_t paragraphIndex;
+      DocumentModel edited = editedModel(*model, paragraphIndex);
+      std::vector<uint32_t> dirtyList = {paragraphIndex};
+      bool incremental = std::string(mode) == "incremental";
+      DocumentLayout layout(edited, options);
+      while (state.keepRunning()) {
+        if (incremental)
+          doNotOptimize(layout.paginate(previous, dirtyList));
+        else
+          doNotOptimize(layout.paginate());
+      }
+      state.setItemsProcessed(state.getIterations());
+      setLayoutCounters(state, layout);
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
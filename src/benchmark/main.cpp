@@ -0,0 +1,56 @@
+// C++
+#include <iostream>
+#include <string>
+
+// Local Project
+#include "benchmark.hpp"
+
+/* Usage: benchmark [--filter=substring] [--min-time=seconds] [--json=file]
+ */
+int main(int argc, char *argv[]) {
+  std::string filter, jsonFileName;
+  double minSeconds = 0.5;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--filter=", 0) == 0)
+      filter = arg.substr(9);
+    else if (arg.rfind("--min-time=", 0) == 0)
+      minSeconds = std::stod(arg.substr(11));
+    else if (arg.rfind("--json=", 0) == 0)
+      jsonFileName = arg.substr(7);
+    else {
+      std::cout << "Usage: " << argv[0]
+                << " [--filter=substring] [--min-time=seconds] [--json=file]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  bookfiler::benchmark::Registry registry;
+  bookfiler::benchmark::registerZipIndexBenchmarks(registry);
+  bookfiler::benchmark::registerZipStreamBenchmarks(registry);
+  bookfiler::benchmark::registerZipBatchBenchmarks(registry);
+  bookfiler::benchmark::registerZipWriterBenchmarks(registry);
+  bookfiler::benchmark::registerDocumentParseBenchmarks(registry);
+  bookfiler::benchmark::registerDocxOpenBenchmarks(registry);
+  bookfiler::benchmark::registerXmlScanBenchmarks(registry);
+  bookfiler::benchmark::registerStyleBenchmarks(registry);
+  bookfiler::benchmark::registerPageCountBenchmarks(registry);
+  bookfiler::benchmark::registerLayoutBenchmarks(registry);
+  bookfiler::benchmark::registerRasterBenchmarks(registry);
+  bookfiler::benchmark::registerGlyphBenchmarks(registry);
+  bookfiler::benchmark::registerCorpusBenchmarks(registry);
+  bookfiler::benchmark::registerTraceBenchmarks(registry);
+  bookfiler::benchmark::registerMemoryBenchmarks(registry);
+  bookfiler::benchmark::registerAllocationBenchmarks(registry);
+  bookfiler::benchmark::registerTextIndexBenchmarks(registry);
+  bookfiler::benchmark::registerDiskCacheBenchmarks(registry);
+  bookfiler::benchmark::registerImageBenchmarks(registry);
+  bookfiler::benchmark::registerConcurrencyBenchmarks(registry);
+  int failTotal = registry.run(filter, minSeconds);
+  if (!jsonFileName.empty() && !registry.writeJson(jsonFileName, minSeconds)) {
+    std::cout << "Could not write " << jsonFileName << std::endl;
+    return 1;
+  }
+  return failTotal == 0 ? 0 : 1;
+}
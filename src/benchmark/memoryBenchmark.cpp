@@ -0,0 +1,89 @@
+// C++
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/memoryAccountant.hpp"
+#include "../core/tileCache.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+// documents held open at once, each laid out with its first tile drawn
+const size_t documentTotal = 100;
+const size_t budgetBytes = (size_t)16 << 20;
+
+/* Restores the module budget and empties the shared caches around a run */
+class BudgetScope {
+public:
+  explicit BudgetScope(size_t byteBudget)
+      : previous(memoryAccountant().getByteBudget()) {
+    tileCache().clear();
+    memoryAccountant().setByteBudget(byteBudget);
+  }
+  ~BudgetScope() {
+    memoryAccountant().setByteBudget(previous);
+    tileCache().clear();
+  }
+
+private:
+  size_t previous;
+};
+
+} // namespace
+
+void registerMemoryBenchmarks(Registry &registry) {
+  const std::pair<const char *, size_t> budgetList[] = {
+      {"unbounded", 0}, {"budget", budgetBytes}};
+  for (const auto &budgetPair : budgetList) {
+    size_t byteBudget = budgetPair.second;
+
+    // a server's working set: many open documents, each visited twice, the
+    // second visit reloading whatever was evicted
+    std::string name = std::string("memory/documents/") + budgetPair.first;
+    registry.add(name, [byteBudget](State &state) {
+      BudgetScope scope(byteBudget);
+      CorpusOptions options;
+      options.pageTotal = 20;
+      std::string fileName = corpusArchiveName(options);
+      size_t peakBytes = 0;
+      uint64_t evictionBase = memoryAccountant().getStats().modelEvictionTotal;
+      while (state.keepRunning()) {
+        std::vector<std::unique_ptr<DocxImpl>> documentList;
+        for (size_t i = 0; i < documentTotal; i++) {
+          documentList.push_back(std::make_unique<DocxImpl>());
+          if (documentList.back()->openFile(fileName) != MZ_OK)
+            state.skipWithError("open error");
+        }
+        for (int visit = 0; visit < 2; visit++) {
+          for (std::unique_ptr<DocxImpl> &docx : documentList) {
+            std::shared_ptr<const RasterImage> tile;
+            if (docx->getTile(0, 96, 0, 0, tile) != MZ_OK)
+              state.skipWithError("tile error");
+            size_t usedBytes = memoryAccountant().getUsage().total();
+            peakBytes = std::max(peakBytes, usedBytes);
+          }
+        }
+      }
+      uint64_t evictionTotal =
+          memoryAccountant().getStats().modelEvictionTotal - evictionBase;
+      state.setItemsProcessed(state.getIterations() *
+                              (long long)documentTotal * 2);
+      state.setCounter("peakBytes", (double)peakBytes);
+      state.setCounter("modelEvictions", (double)evictionTotal);
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
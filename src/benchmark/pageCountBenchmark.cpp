@@ -0,0 +1,109 @@
+// C++
+#include <map>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/layout.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const char *appXml =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Properties xmlns=\"http://schemas.openxmlformats.org/officeDocument/"
+    "2006/extended-properties\"><Template>Normal.dotm</Template>"
+    "<TotalTime>0</TotalTime><Pages>42</Pages><Words>9000</Words>"
+    "</Properties>";
+
+std::string pageCountArchiveName(int paragraphTotal) {
+  static std::map<int, std::string> fileNameMap;
+  std::string &fileName = fileNameMap[paragraphTotal];
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/pages" + std::to_string(paragraphTotal) +
+             ".docx";
+  std::vector<FixturePart> partList =
+      fixtureDocxParts(fixtureDocumentXml(paragraphTotal, 25));
+  partList.push_back({"docProps/app.xml", appXml, true});
+  writeFixtureZip(fileName, partList);
+  return fileName;
+}
+
+} // namespace
+
+void registerPageCountBenchmarks(Registry &registry) {
+  for (int paragraphTotal : {100, 2000, 20000}) {
+    std::string suffix = "/" + std::to_string(paragraphTotal);
+
+    // open plus the docProps/app.xml lookup
+    registry.add("pageCount/stored" + suffix, [paragraphTotal](State &state) {
+      std::string fileName = pageCountArchiveName(paragraphTotal);
+      while (state.keepRunning()) {
+        DocxImpl docx;
+        uint32_t pageTotal = 0;
+        if (docx.openFile(fileName) != MZ_OK ||
+            docx.getPagesTotalStored(pageTotal) != MZ_OK)
+          state.skipWithError("page count error");
+        doNotOptimize(pageTotal);
+      }
+      state.setItemsProcessed(state.getIterations());
+    });
+
+    // open, parse and paginate with the cache emptied every time
+    registry.add("pageCount/layoutCold" + suffix,
+                 [paragraphTotal](State &state) {
+                   std::string fileName = pageCountArchiveName(paragraphTotal);
+                   uint32_t pageTotal = 0;
+                   while (state.keepRunning()) {
+                     pageCountCache().clear();
+                     DocxImpl docx;
+                     if (docx.openFile(fileName) != MZ_OK ||
+                         docx.getPagesTotalLayout(pageTotal) != MZ_OK)
+                       state.skipWithError("page count error");
+                   }
+                   state.setItemsProcessed(state.getIterations());
+                   state.setCounter("pages", (double)pageTotal);
+                 });
+
+    // reopening a file already counted
+    registry.add("pageCount/layoutCached" + suffix,
+                 [paragraphTotal](State &state) {
+                   std::string fileName = pageCountArchiveName(paragraphTotal);
+                   while (state.keepRunning()) {
+                     DocxImpl docx;
+                     uint32_t pageTotal = 0;
+                     if (docx.openFile(fileName) != MZ_OK ||
+                         docx.getPagesTotalLayout(pageTotal) != MZ_OK)
+                       state.skipWithError("page count error");
+                     doNotOptimize(pageTotal);
+                   }
+                   state.setItemsProcessed(state.getIterations());
+                 });
+
+    // the pagination pass alone over a parsed model
+    registry.add("pageCount/paginate" + suffix, [paragraphTotal](State &state) {
+      std::string fileName = pageCountArchiveName(paragraphTotal);
+      DocxImpl docx;
+      std::shared_ptr<const DocumentModel> model;
+      if (docx.openFile(fileName) != MZ_OK || docx.getModel(model) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      while (state.keepRunning()) {
+        DocumentLayout layout(*model);
+        doNotOptimize(layout.paginate());
+      }
+      state.setBytesProcessed(state.getIterations() * model->text.size());
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
@@ -0,0 +1,183 @@
+// C++
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+// Local Project
+#include "../core/bufferPool.hpp"
+#include "../core/docxImpl.hpp"
+#include "../core/renderScheduler.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int paragraphTotal = 400;
+const uint32_t dpi = 96;
+
+std::string rasterArchiveName() {
+  static std::string fileName;
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/raster.docx";
+  writeFixtureZip(fileName,
+                  fixtureDocxParts(fixtureDocumentXml(paragraphTotal, 10)));
+  return fileName;
+}
+
+void setCacheCounters(State &state, const TileCache::Stats &before) {
+  TileCache::Stats stats = tileCache().getStats();
+  state.setCounter("hits", (double)(stats.hitTotal - before.hitTotal));
+  state.setCounter("misses", (double)(stats.missTotal - before.missTotal));
+  state.setCounter("evictions",
+                   (double)(stats.evictionTotal - before.evictionTotal));
+}
+
+} // namespace
+
+void registerRasterBenchmarks(Registry &registry) {
+  // every page rendered from nothing
+  registry.add("raster/pageCold", [](State &state) {
+    DocxImpl docx;
+    if (docx.openFile(rasterArchiveName()) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    TileCache::Stats before = tileCache().getStats();
+    uint32_t pageIndex = 0;
+    while (state.keepRunning()) {
+      tileCache().clear();
+      std::shared_ptr<const RasterImage> image;
+      if (docx.getPageImage(pageIndex, dpi, image) != MZ_OK)
+        state.skipWithError("render error");
+      pageIndex = (pageIndex + 1) % 8;
+    }
+    state.setItemsProcessed(state.getIterations());
+    setCacheCounters(state, before);
+  });
+
+  // the same page again, tiles come from the cache
+  registry.add("raster/pageWarm", [](State &state) {
+    DocxImpl docx;
+    if (docx.openFile(rasterArchiveName()) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    tileCache().clear();
+    std::shared_ptr<const RasterImage> image;
+    docx.getPageImage(0, dpi, image);
+    TileCache::Stats before = tileCache().getStats();
+    while (state.keepRunning()) {
+      if (docx.getPageImage(0, dpi, image) != MZ_OK)
+        state.skipWithError("render error");
+    }
+    state.setItemsProcessed(state.getIterations());
+    setCacheCounters(state, before);
+  });
+
+  /* Scroll down 12 pages and back up with a budget of about 8 pages, the
+   * way a viewer does. The pages scrolled back over last are hits.
+   */
+  registry.add("raster/scrollBack", [](State &state) {
+    DocxImpl docx;
+    if (docx.openFile(rasterArchiveName()) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    TileCache::Stats saved = tileCache().getStats();
+    tileCache().setByteBudget((size_t)8 * 816 * 1056 * 4);
+    TileCache::Stats before = tileCache().getStats();
+    while (state.keepRunning()) {
+      tileCache().clear();
+      std::shared_ptr<const RasterImage> image;
+      for (uint32_t pageIndex = 0; pageIndex < 12; pageIndex++)
+        docx.getPageImage(pageIndex, dpi, image);
+      for (uint32_t pageIndex = 12; pageIndex-- > 0;)
+        docx.getPageImage(pageIndex, dpi, image);
+    }
+    state.setItemsProcessed(state.getIterations() * 24);
+    setCacheCounters(state, before);
+    tileCache().setByteBudget(saved.byteBudget);
+  });
+
+  /* Background rendering of one visible page through RenderScheduler, time
+   * to the first update (the preview) against time to the last tile
+   */
+  registry.add("raster/scheduledPage", [](State &state) {
+    auto docx = std::make_shared<DocxImpl>();
+    if (docx->openFile(rasterArchiveName()) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    std::shared_ptr<const DocumentLayout> layout;
+    docx->getLayout(layout);
+    std::mutex mutex;
+    std::condition_variable updated;
+    std::chrono::steady_clock::time_point firstUpdate;
+    bool hasUpdate = false;
+    RenderScheduler scheduler(docx, [&](const RenderUpdate &) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!hasUpdate)
+        firstUpdate = std::chrono::steady_clock::now();
+      hasUpdate = true;
+      updated.notify_all();
+    });
+    double firstSeconds = 0, lastSeconds = 0;
+    uint32_t pageIndex = 0;
+    while (state.keepRunning()) {
+      tileCache().clear();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        hasUpdate = false;
+      }
+      auto start = std::chrono::steady_clock::now();
+      scheduler.requestPage(pageIndex, dpi, renderVisible);
+      scheduler.wait();
+      auto end = std::chrono::steady_clock::now();
+      std::lock_guard<std::mutex> lock(mutex);
+      firstSeconds +=
+          std::chrono::duration<double>(firstUpdate - start).count();
+      lastSeconds += std::chrono::duration<double>(end - start).count();
+      pageIndex = (pageIndex + 1) % 8;
+    }
+    double iterations = (double)std::max<long long>(state.getIterations(), 1);
+    state.setItemsProcessed(state.getIterations());
+    state.setCounter("firstUpdateMs", firstSeconds * 1000 / iterations);
+    state.setCounter("lastTileMs", lastSeconds * 1000 / iterations);
+  });
+
+  /* Page sized buffers, past malloc's mmap threshold, recycled through the
+   * pool against fresh allocations that fault their pages in every time
+   */
+  for (bool pooled : {true, false}) {
+    registry.add(
+        pooled ? "raster/bufferPooled" : "raster/bufferNew",
+        [pooled](State &state) {
+          size_t pageBytes = (size_t)816 * 1056 * 4;
+          while (state.keepRunning()) {
+            if (pooled) {
+              auto pixels = pixmapBufferPool().acquire(pageBytes);
+              std::memset(pixels.get(), 0xFF, pageBytes);
+              doNotOptimize(pixels.get());
+            } else {
+              std::unique_ptr<unsigned char[]> pixels(
+                  new unsigned char[pageBytes]);
+              std::memset(pixels.get(), 0xFF, pageBytes);
+              doNotOptimize(pixels.get());
+            }
+          }
+          state.setBytesProcessed(state.getIterations() * pageBytes);
+        });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
@@ -0,0 +1,168 @@
+// C++
+#include <string>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int paragraphTotal = 4000;
+const int paragraphStyleTotal = 12;
+const int characterStyleTotal = 8;
+
+/* Heading-like paragraph styles each based on the one before, down to
+ * Normal, and a chain of character styles; every level sets something
+ */
+std::string styleHeavyStylesXml() {
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<w:styles xmlns:w=\"http://schemas.openxmlformats.org/"
+      "wordprocessingml/2006/main\"><w:docDefaults><w:rPrDefault><w:rPr>"
+      "<w:rFonts w:ascii=\"Calibri\" w:hAnsi=\"Calibri\"/>"
+      "<w:sz w:val=\"22\"/></w:rPr></w:rPrDefault><w:pPrDefault><w:pPr>"
+      "<w:spacing w:after=\"160\" w:line=\"259\" w:lineRule=\"auto\"/>"
+      "</w:pPr></w:pPrDefault></w:docDefaults>"
+      "<w:style w:type=\"paragraph\" w:default=\"1\" w:styleId=\"Normal\">"
+      "<w:name w:val=\"Normal\"/></w:style>"
+      "<w:style w:type=\"character\" w:default=\"1\" "
+      "w:styleId=\"DefaultParagraphFont\"><w:name "
+      "w:val=\"Default Paragraph Font\"/></w:style>";
+  for (int i = 0; i < paragraphStyleTotal; i++) {
+    xml += "<w:style w:type=\"paragraph\" w:styleId=\"Level" +
+           std::to_string(i) + "\"><w:basedOn w:val=\"" +
+           (i == 0 ? std::string("Normal") : "Level" + std::to_string(i - 1)) +
+           "\"/><w:pPr><w:spacing w:before=\"" + std::to_string(i * 20) +
+           "\"/>" + (i % 3 == 0 ? "<w:keepNext/>" : "") +
+           "</w:pPr><w:rPr><w:sz w:val=\"" + std::to_string(20 + i % 6 * 2) +
+           "\"/>" + (i % 4 == 1 ? "<w:b/>" : "") + "</w:rPr></w:style>";
+  }
+  for (int i = 0; i < characterStyleTotal; i++) {
+    xml += "<w:style w:type=\"character\" w:styleId=\"Emphasis" +
+           std::to_string(i) + "\"><w:basedOn w:val=\"" +
+           (i == 0 ? std::string("DefaultParagraphFont")
+                   : "Emphasis" + std::to_string(i - 1)) +
+           "\"/><w:rPr>" + (i % 2 ? "<w:i/>" : "<w:caps w:val=\"0\"/>") +
+           "<w:color w:val=\"" + (i % 3 ? "1F3864" : "C00000") +
+           "\"/></w:rPr></w:style>";
+  }
+  return xml + "</w:styles>";
+}
+
+std::string styleHeavyDocumentXml() {
+  std::string xml =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+      "<w:document xmlns:w=\"http://schemas.openxmlformats.org/"
+      "wordprocessingml/2006/main\"><w:body>";
+  for (int i = 0; i < paragraphTotal; i++) {
+    xml += "<w:p><w:pPr><w:pStyle w:val=\"Level" +
+           std::to_string(i % paragraphStyleTotal) + "\"/></w:pPr>";
+    for (int j = 0; j < 6; j++) {
+      xml += "<w:r><w:rPr>";
+      if (j % 2)
+        xml += "<w:rStyle w:val=\"Emphasis" +
+               std::to_string((i + j) % characterStyleTotal) + "\"/>";
+      if (j == 4)
+        xml += "<w:b w:val=\"0\"/>";
+      xml += "</w:rPr><w:t xml:space=\"preserve\">Styled text </w:t></w:r>";
+    }
+    xml += "</w:p>";
+  }
+  return xml + "<w:sectPr/></w:body></w:document>";
+}
+
+std::string styleArchiveName() {
+  static std::string fileName;
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/styles.docx";
+  writeFixtureZip(fileName, fixtureDocxParts(styleHeavyDocumentXml(), {},
+                                             styleHeavyStylesXml()));
+  return fileName;
+}
+
+int32_t loadStyleModel(std::shared_ptr<const DocumentModel> &model) {
+  DocxImpl docx;
+  int32_t err = docx.openFile(styleArchiveName());
+  if (err != MZ_OK)
+    return err;
+  return docx.getModel(model);
+}
+
+} // namespace
+
+void registerStyleBenchmarks(Registry &registry) {
+  /* Effective formatting of every run by walking docDefaults, the basedOn
+   * chains and direct formatting each time, what a per run lookup costs
+   */
+  registry.add("style/walkPerRun", [](State &state) {
+    std::shared_ptr<const DocumentModel> model;
+    if (loadStyleModel(model) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    uint64_t sum = 0;
+    while (state.keepRunning()) {
+      for (const DocumentParagraph &paragraph : model->paragraphList) {
+        const ParagraphProperties &paragraphDirect =
+            model->paragraphPropertiesTable.get(paragraph.propertiesId);
+        for (uint32_t runIndex = paragraph.runBegin;
+             runIndex < paragraph.runEnd; runIndex++) {
+          RunProperties resolved = model->styleSheet.resolveRun(
+              paragraphDirect, model->runPropertiesTable.get(
+                                   model->runList[runIndex].propertiesId));
+          sum += resolved.halfPoints + resolved.flags;
+        }
+      }
+    }
+    doNotOptimize(sum);
+    state.setItemsProcessed(state.getIterations() *
+                            (long long)model->runList.size());
+  });
+
+  // the same answers from the table resolved at load
+  registry.add("style/resolvedLookup", [](State &state) {
+    std::shared_ptr<const DocumentModel> model;
+    if (loadStyleModel(model) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    uint64_t sum = 0;
+    while (state.keepRunning()) {
+      for (const DocumentRun &run : model->runList) {
+        const RunProperties &resolved = model->getRunProperties(run);
+        sum += resolved.halfPoints + resolved.flags;
+      }
+    }
+    doNotOptimize(sum);
+    state.setItemsProcessed(state.getIterations() *
+                            (long long)model->runList.size());
+    state.setCounter("runSets", (double)model->resolvedRunTable.size());
+    state.setCounter("paragraphSets",
+                     (double)model->resolvedParagraphTable.size());
+  });
+
+  // what flattening adds to opening the document
+  registry.add("style/flatten", [](State &state) {
+    std::shared_ptr<const DocumentModel> loaded;
+    if (loadStyleModel(loaded) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    DocumentModel model = *loaded;
+    while (state.keepRunning())
+      model.styleSheet.resolve(model);
+    state.setItemsProcessed(state.getIterations() *
+                            (long long)model.runList.size());
+  });
+}
+
+} // namespace benchmark
+} // namespace bookfiler
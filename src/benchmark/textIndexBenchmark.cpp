@@ -0,0 +1,136 @@
+// C++
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/textExtractor.hpp"
+#include "../core/textIndex.hpp"
+#include "../core/threadPool.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+// a collection of distinct documents, 20 pages each
+const int documentTotal = 100;
+
+std::vector<std::string> collectionNameList() {
+  static std::vector<std::string> nameList;
+  if (nameList.empty()) {
+    for (int i = 0; i < documentTotal; i++) {
+      CorpusOptions options;
+      options.pageTotal = 20;
+      options.tableEvery = 8;
+      options.seed = 1000 + i;
+      nameList.push_back(corpusArchiveName(options));
+    }
+  }
+  return nameList;
+}
+
+/* Opens, extracts and tokenizes every document on the module pool and adds
+ * them in order, as ModuleExport::indexText does. @return the text bytes
+ */
+uint64_t buildIndex(const std::vector<std::unique_ptr<DocxImpl>> &docxList,
+                    TextIndex &index) {
+  std::atomic<uint64_t> textBytes{0};
+  std::vector<std::future<TextIndexDocument>> futureList;
+  for (const std::unique_ptr<DocxImpl> &docx : docxList) {
+    DocxImpl *docxPtr = docx.get();
+    futureList.push_back(defaultThreadPool().submit([docxPtr, &textBytes]() {
+      TextIndexDocument document;
+      docxPtr->extractText(
+          [&document, &textBytes](const TextParagraph &paragraph) {
+            document.addParagraph(paragraph);
+            textBytes.fetch_add(paragraph.text.size(),
+                                std::memory_order_relaxed);
+          });
+      return document;
+    }));
+  }
+  for (std::future<TextIndexDocument> &future : futureList)
+    index.add(future.get());
+  return textBytes;
+}
+
+std::vector<std::unique_ptr<DocxImpl>> openCollection(State &state) {
+  std::vector<std::unique_ptr<DocxImpl>> docxList;
+  for (const std::string &fileName : collectionNameList()) {
+    docxList.push_back(std::make_unique<DocxImpl>());
+    if (docxList.back()->openFile(fileName) != MZ_OK)
+      state.skipWithError("open error");
+  }
+  return docxList;
+}
+
+} // namespace
+
+void registerTextIndexBenchmarks(Registry &registry) {
+  // the text alone, compare documentParse/stream for the whole model
+  registry.add("textIndex/extract", [](State &state) {
+    DocxImpl docx;
+    if (docx.openFile(collectionNameList()[0]) != MZ_OK)
+      return state.skipWithError("open error");
+    uint64_t textBytes = 0;
+    while (state.keepRunning()) {
+      textBytes = 0;
+      if (docx.extractText([&textBytes](const TextParagraph &paragraph) {
+            textBytes += paragraph.text.size();
+          }) != MZ_OK)
+        state.skipWithError("extract error");
+    }
+    state.setItemsProcessed(state.getIterations());
+    state.setBytesProcessed(state.getIterations() * textBytes);
+  });
+
+  registry.add("textIndex/build", [](State &state) {
+    std::vector<std::unique_ptr<DocxImpl>> docxList = openCollection(state);
+    TextIndex::Stats stats;
+    uint64_t textBytes = 0;
+    while (state.keepRunning()) {
+      TextIndex index;
+      textBytes = buildIndex(docxList, index);
+      stats = index.getStats();
+    }
+    state.setItemsProcessed(state.getIterations() * documentTotal);
+    state.setBytesProcessed(state.getIterations() * textBytes);
+    state.setCounter("terms", (double)stats.termTotal);
+    state.setCounter("occurrences", (double)stats.occurrenceTotal);
+    state.setCounter("postingKiB", stats.postingBytes / 1024.0);
+    state.setCounter("compression",
+                     (double)stats.rawBytes / stats.postingBytes);
+  });
+
+  const std::pair<const char *, const char *> queryList[] = {
+      {"term", "Licensor"},
+      {"phrase", "gross negligence"},
+      {"miss", "indemnify Software"}};
+  for (const auto &queryPair : queryList) {
+    std::string query = queryPair.second;
+    registry.add(std::string("textIndex/search/") + queryPair.first,
+                 [query](State &state) {
+                   std::vector<std::unique_ptr<DocxImpl>> docxList =
+                       openCollection(state);
+                   TextIndex index;
+                   buildIndex(docxList, index);
+                   size_t hitTotal = 0;
+                   while (state.keepRunning())
+                     hitTotal = index.search(query, (size_t)-1).size();
+                   state.setItemsProcessed(state.getIterations());
+                   state.setCounter("hits", (double)hitTotal);
+                 });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
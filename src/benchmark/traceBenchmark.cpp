@@ -0,0 +1,96 @@
+// C++
+#include <string>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/trace.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const std::pair<const char *, TraceMode> modeList[] = {
+    {"off", TraceMode::Off},
+    {"stats", TraceMode::Stats},
+    {"events", TraceMode::Events}};
+
+/* Restores the module tracer when the benchmark ends */
+class ModeScope {
+public:
+  explicit ModeScope(TraceMode mode) : previous(tracer().getMode()) {
+    tracer().clear();
+    tracer().setMode(mode);
+  }
+  ~ModeScope() {
+    tracer().setMode(previous);
+    tracer().clear();
+  }
+
+private:
+  TraceMode previous;
+};
+
+} // namespace
+
+void registerTraceBenchmarks(Registry &registry) {
+  for (const auto &modePair : modeList) {
+    std::string suffix = std::string("/") + modePair.first;
+    TraceMode mode = modePair.second;
+
+    // an empty span, what each instrumented call pays on top of its work
+    registry.add("trace/span" + suffix, [mode](State &state) {
+      ModeScope scope(mode);
+      DocumentMetrics metrics;
+      DocumentMetrics *metricsPtr = &metrics;
+      while (state.keepRunning()) {
+        BOOKFILER_TRACE_SPAN(EntryLocate, metricsPtr);
+        BOOKFILER_TRACE_ADD(metricsPtr, partsTouched, 1);
+      }
+      state.setItemsProcessed(state.getIterations());
+      state.setCounter("dropped", (double)tracer().getDroppedTotal());
+    });
+
+    // the finest traced call: a part name looked up and viewed in place
+    registry.add("trace/locate" + suffix, [mode](State &state) {
+      ModeScope scope(mode);
+      CorpusOptions options;
+      options.deflate = false;
+      ZipReader zipReader;
+      zipReader.setMetrics(std::make_shared<DocumentMetrics>());
+      if (zipReader.open(corpusArchiveName(options)) != MZ_OK) {
+        state.skipWithError("open error");
+        return;
+      }
+      std::string_view view;
+      while (state.keepRunning()) {
+        if (zipReader.getView("word/styles.xml", view) != MZ_OK)
+          state.skipWithError("view error");
+      }
+      state.setItemsProcessed(state.getIterations());
+    });
+
+    // opening, parsing and laying out a document, spans and all
+    registry.add("trace/layout" + suffix, [mode](State &state) {
+      ModeScope scope(mode);
+      CorpusOptions options;
+      options.pageTotal = 20;
+      std::string fileName = corpusArchiveName(options);
+      while (state.keepRunning()) {
+        DocxImpl docx;
+        std::shared_ptr<const DocumentLayout> layout;
+        if (docx.openFile(fileName) != MZ_OK || docx.getLayout(layout) != MZ_OK)
+          state.skipWithError("layout error");
+      }
+      state.setItemsProcessed(state.getIterations());
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
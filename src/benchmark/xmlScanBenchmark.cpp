@@ -0,0 +1,135 @@
+// C++
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "../core/xmlReader.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+// the unzipped copy of resources/test.docx
+const std::string resourceWordDirectory = "resources/test - Copy/word";
+
+class XmlInput {
+public:
+  std::string name, data;
+};
+
+std::vector<XmlInput> xmlInputList() {
+  std::vector<XmlInput> inputList;
+  std::error_code ec;
+  for (auto &dirEntry :
+       std::filesystem::directory_iterator(resourceWordDirectory, ec)) {
+    if (dirEntry.path().extension() != ".xml")
+      continue;
+    std::ifstream inFile(dirEntry.path(), std::ios::binary);
+    std::stringstream dataStream;
+    dataStream << inFile.rdbuf();
+    inputList.push_back({dirEntry.path().filename().string(), dataStream.str()});
+  }
+  inputList.push_back({"synthetic.xml", fixtureDocumentXml(5000, 20)});
+  return inputList;
+}
+
+/* Run text in several scripts, most of it outside ASCII */
+std::string multilingualText() {
+  const char *sentenceList[] = {
+      "Der Lizenznehmer stellt den Lizenzgeber frei — ",
+      "Le licencié garantit le concédant contre toute réclamation. ",
+      "被许可人应赔偿许可人因使用软件而产生的所有索赔。",
+      "Лицензиат освобождает лицензиара от любых претензий. "};
+  std::string text;
+  for (int i = 0; text.size() < (1 << 20); i++)
+    text += sentenceList[i % 4];
+  return text;
+}
+
+/* Runs the benchmark body with kernel selected, restoring the previous
+ * choice afterwards
+ */
+void withKernel(const XmlScanKernel *kernel, State &state,
+                const benchmark_cb_t &benchmarkCallback) {
+  std::string previousName = xmlScanKernel().name;
+  xmlSelectScanKernel(kernel->name);
+  benchmarkCallback(state);
+  xmlSelectScanKernel(previousName);
+}
+
+} // namespace
+
+void registerXmlScanBenchmarks(Registry &registry) {
+  static const std::vector<XmlInput> inputList = xmlInputList();
+  static const std::string utf8Text = multilingualText();
+
+  for (const XmlScanKernel *kernel : xmlScanKernelList()) {
+    std::string prefix = std::string("xmlScan/") + kernel->name;
+    for (const XmlInput &input : inputList) {
+      registry.add(prefix + "/tokenize/" + input.name, [kernel, &input](
+                                                           State &state) {
+        withKernel(kernel, state, [&input](State &state) {
+          XmlReader reader;
+          long long eventTotal = 0;
+          while (state.keepRunning()) {
+            reader.open(std::string_view(input.data));
+            int32_t err;
+            while ((err = reader.next()) == MZ_OK)
+              eventTotal++;
+            if (err != MZ_END_OF_STREAM)
+              state.skipWithError("parse error");
+          }
+          state.setBytesProcessed(state.getIterations() * input.data.size());
+          state.setItemsProcessed(eventTotal);
+        });
+      });
+    }
+
+    registry.add(prefix + "/unescape/synthetic.xml", [kernel](State &state) {
+      withKernel(kernel, state, [](State &state) {
+        const std::string &xml = inputList.back().data;
+        std::string out;
+        out.reserve(xml.size());
+        while (state.keepRunning()) {
+          out.clear();
+          xmlUnescape(xml, out);
+          doNotOptimize(out.data());
+        }
+        state.setBytesProcessed(state.getIterations() * xml.size());
+      });
+    });
+
+    registry.add(prefix + "/utf8/synthetic.xml", [kernel](State &state) {
+      const std::string &xml = inputList.back().data;
+      while (state.keepRunning()) {
+        if (!kernel->validUtf8(xml.data(), xml.size()))
+          state.skipWithError("rejected valid input");
+      }
+      state.setBytesProcessed(state.getIterations() * xml.size());
+    });
+
+    registry.add(prefix + "/utf8/multilingual", [kernel](State &state) {
+      while (state.keepRunning()) {
+        if (!kernel->validUtf8(utf8Text.data(), utf8Text.size()))
+          state.skipWithError("rejected valid input");
+      }
+      state.setBytesProcessed(state.getIterations() * utf8Text.size());
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
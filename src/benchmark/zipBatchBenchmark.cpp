@@ -0,0 +1,90 @@
+// C++
+#include <random>
+#include <thread>
+
+// Local Project
+#include "../core/zip.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int mediaTotal = 48;
+const size_t mediaSize = 512 << 10;
+
+/* Deflated media compress poorly but still cost a full inflate, like the
+ * bitmaps and EMF files producers put in word/media
+ */
+std::string mediaArchiveName(std::vector<std::string> &partNameList,
+                             long long &byteTotal) {
+  static std::string fileName;
+  static std::vector<std::string> nameList;
+  static long long bytes = 0;
+  if (fileName.empty()) {
+    fileName = fixtureDirectory() + "/media.docx";
+    std::vector<FixturePart> partList;
+    std::mt19937 rng(3);
+    std::string document;
+    while (document.size() < (1 << 20))
+      document += "<w:p><w:r><w:t>Lorem ipsum dolor sit amet</w:t></w:r></w:p>";
+    partList.push_back({"word/document.xml", document, true});
+    partList.push_back({"word/styles.xml", document.substr(0, 64 << 10), true});
+    for (int i = 0; i < mediaTotal; i++) {
+      std::string media(mediaSize, '\0');
+      for (size_t j = 0; j < mediaSize; j++)
+        media[j] = (char)((rng() & 0x3F) + (j & 0x40));
+      partList.push_back(
+          {"word/media/image" + std::to_string(i + 1) + ".emf", media, true});
+    }
+    for (FixturePart &part : partList) {
+      nameList.push_back(part.filePath);
+      bytes += part.data.size();
+    }
+    writeFixtureZip(fileName, partList);
+  }
+  partNameList = nameList;
+  byteTotal = bytes;
+  return fileName;
+}
+
+} // namespace
+
+void registerZipBatchBenchmarks(Registry &registry) {
+  std::vector<size_t> threadTotalList = {1, 2, 4, 8};
+  size_t hardwareTotal = std::thread::hardware_concurrency();
+  if (hardwareTotal > 8)
+    threadTotalList.push_back(hardwareTotal);
+
+  for (size_t threadTotal : threadTotalList) {
+    registry.add(
+        "zipBatch/media/threads:" + std::to_string(threadTotal),
+        [threadTotal](State &state) {
+          std::vector<std::string> partNameList;
+          long long byteTotal = 0;
+          std::string fileName = mediaArchiveName(partNameList, byteTotal);
+          ZipReader zipReader;
+          if (zipReader.open(fileName) != MZ_OK)
+            return state.skipWithError("open error");
+          ThreadPool pool(threadTotal);
+          while (state.keepRunning()) {
+            auto futureList = zipReader.extractBatch(partNameList, nullptr, pool);
+            for (auto &future : futureList) {
+              if (future.get()->err != MZ_OK)
+                state.skipWithError("extract error");
+            }
+          }
+          state.setBytesProcessed(state.getIterations() * byteTotal);
+          state.setItemsProcessed(state.getIterations() * partNameList.size());
+          state.setCounter("threads", (double)threadTotal);
+        });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
@@ -0,0 +1,137 @@
+// C++
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+
+// Local Project
+#include "../core/zip.hpp"
+#include "../core/zipIndex.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int partTotalList[] = {10, 100, 1000, 10000};
+
+std::string partName(int i) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "word/media/image%05d.png", i);
+  return name;
+}
+
+std::string archiveName(int partTotal) {
+  static std::set<int> writtenSet;
+  std::string fileName =
+      fixtureDirectory() + "/parts" + std::to_string(partTotal) + ".zip";
+  if (!writtenSet.insert(partTotal).second)
+    return fileName;
+  std::vector<FixturePart> partList;
+  for (int i = 0; i < partTotal; i++)
+    partList.push_back({partName(i), std::string(64, (char)('a' + i % 26)),
+                        false});
+  writeFixtureZip(fileName, partList);
+  return fileName;
+}
+
+/* The path ZipReader used before the index: walk every entry through
+ * minizip and deep copy it into a ZipFileMap
+ */
+int32_t minizipOpen(void *reader, std::string fileName,
+                    std::shared_ptr<ZipFileMap> fileMap) {
+  int32_t err = mz_zip_reader_open_file(reader, fileName.c_str());
+  if (err != MZ_OK)
+    return err;
+  err = mz_zip_reader_goto_first_entry(reader);
+  mz_zip_file *fileInfo = nullptr;
+  while (err == MZ_OK) {
+    err = mz_zip_reader_entry_get_info(reader, &fileInfo);
+    if (err != MZ_OK)
+      break;
+    fileMap->insert(fileInfo);
+    err = mz_zip_reader_goto_next_entry(reader);
+  }
+  return err == MZ_END_OF_LIST ? MZ_OK : err;
+}
+
+} // namespace
+
+void registerZipIndexBenchmarks(Registry &registry) {
+  for (int partTotal : partTotalList) {
+    std::string suffix = "/" + std::to_string(partTotal);
+
+    registry.add("zipIndex/open/minizip" + suffix, [partTotal](State &state) {
+      std::string fileName = archiveName(partTotal);
+      while (state.keepRunning()) {
+        void *reader = nullptr;
+        mz_zip_reader_create(&reader);
+        std::shared_ptr<ZipFileMap> fileMap = std::make_shared<ZipFileMap>();
+        int32_t err = minizipOpen(reader, fileName, fileMap);
+        mz_zip_reader_delete(&reader);
+        if (err != MZ_OK || (int)fileMap->getMap().size() != partTotal)
+          state.skipWithError("minizip error " + std::to_string(err));
+      }
+      state.setItemsProcessed(state.getIterations() * partTotal);
+    });
+
+    registry.add("zipIndex/open/mmap" + suffix, [partTotal](State &state) {
+      std::string fileName = archiveName(partTotal);
+      while (state.keepRunning()) {
+        ZipIndex index;
+        int32_t err = index.open(fileName);
+        if (err != MZ_OK || (int)index.getEntries().size() != partTotal)
+          state.skipWithError("index error " + std::to_string(err));
+      }
+      state.setItemsProcessed(state.getIterations() * partTotal);
+    });
+
+    registry.add("zipIndex/locate/minizip" + suffix, [partTotal](State &state) {
+      std::string fileName = archiveName(partTotal);
+      void *reader = nullptr;
+      mz_zip_reader_create(&reader);
+      if (mz_zip_reader_open_file(reader, fileName.c_str()) != MZ_OK)
+        state.skipWithError("minizip open error");
+      std::mt19937 rng(1);
+      std::vector<std::string> nameList;
+      for (int i = 0; i < 1024; i++)
+        nameList.push_back(partName(rng() % partTotal));
+      size_t i = 0;
+      while (state.keepRunning()) {
+        int32_t err = mz_zip_reader_locate_entry(
+            reader, nameList[i++ & 1023].c_str(), 0);
+        if (err != MZ_OK)
+          state.skipWithError("minizip error " + std::to_string(err));
+      }
+      mz_zip_reader_delete(&reader);
+      state.setItemsProcessed(state.getIterations());
+    });
+
+    registry.add("zipIndex/locate/mmap" + suffix, [partTotal](State &state) {
+      std::string fileName = archiveName(partTotal);
+      ZipIndex index;
+      if (index.open(fileName) != MZ_OK)
+        state.skipWithError("index open error");
+      std::mt19937 rng(1);
+      std::vector<std::string> nameList;
+      for (int i = 0; i < 1024; i++)
+        nameList.push_back(partName(rng() % partTotal));
+      size_t i = 0;
+      while (state.keepRunning()) {
+        const ZipIndexEntry *entryPtr = index.find(nameList[i++ & 1023]);
+        if (!entryPtr)
+          state.skipWithError("entry not found");
+        doNotOptimize(entryPtr);
+      }
+      state.setItemsProcessed(state.getIterations());
+    });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
@@ -0,0 +1,120 @@
+// C++
+#include <memory>
+#include <random>
+
+// Local Project
+#include "../core/bufferPool.hpp"
+#include "../core/zipIndex.hpp"
+#include "../core/zipStream.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const size_t mediaSize = 4 << 20;
+const size_t documentSize = 32 << 20;
+
+/* Stored random media plus one large deflated document.xml */
+std::string streamArchiveName() {
+  static std::string fileName;
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/stream.zip";
+  std::mt19937 rng(2);
+  std::string media(mediaSize, '\0');
+  for (char &c : media)
+    c = (char)rng();
+  std::string document;
+  document.reserve(documentSize + 128);
+  int i = 0;
+  while (document.size() < documentSize)
+    document += "<w:p w:rsidR=\"001734CC\"><w:r><w:t>Paragraph " +
+                std::to_string(i++) + " of the contract</w:t></w:r></w:p>";
+  writeFixtureZip(fileName, {{"word/media/image1.png", media, false},
+                             {"word/document.xml", document, true}});
+  return fileName;
+}
+
+} // namespace
+
+void registerZipStreamBenchmarks(Registry &registry) {
+  registry.add("zipStream/media/copy", [](State &state) {
+    ZipIndex index;
+    index.open(streamArchiveName());
+    const ZipIndexEntry *entryPtr = index.find("word/media/image1.png");
+    if (!entryPtr)
+      return state.skipWithError("fixture missing entry");
+    while (state.keepRunning()) {
+      std::shared_ptr<unsigned char> buffer =
+          partBufferPool().acquire(entryPtr->uncompressedSize);
+      if (index.extract(*entryPtr, (char *)buffer.get(),
+                        entryPtr->uncompressedSize) != MZ_OK)
+        state.skipWithError("extract error");
+      doNotOptimize(buffer);
+    }
+    state.setBytesProcessed(state.getIterations() * mediaSize);
+  });
+
+  registry.add("zipStream/media/view", [](State &state) {
+    ZipIndex index;
+    index.open(streamArchiveName());
+    const ZipIndexEntry *entryPtr = index.find("word/media/image1.png");
+    if (!entryPtr)
+      return state.skipWithError("fixture missing entry");
+    while (state.keepRunning()) {
+      std::string_view view;
+      if (index.getStoredView(*entryPtr, view) != MZ_OK)
+        state.skipWithError("view error");
+      doNotOptimize(view);
+    }
+    state.setBytesProcessed(state.getIterations() * mediaSize);
+  });
+
+  registry.add("zipStream/document/extract", [](State &state) {
+    ZipIndex index;
+    index.open(streamArchiveName());
+    const ZipIndexEntry *entryPtr = index.find("word/document.xml");
+    if (!entryPtr)
+      return state.skipWithError("fixture missing entry");
+    while (state.keepRunning()) {
+      std::shared_ptr<unsigned char> buffer =
+          partBufferPool().acquire(entryPtr->uncompressedSize);
+      if (index.extract(*entryPtr, (char *)buffer.get(),
+                        entryPtr->uncompressedSize) != MZ_OK)
+        state.skipWithError("extract error");
+    }
+    state.setBytesProcessed(state.getIterations() *
+                            entryPtr->uncompressedSize);
+    state.setCounter("bufferKiB", entryPtr->uncompressedSize / 1024.0);
+  });
+
+  registry.add("zipStream/document/stream", [](State &state) {
+    ZipIndex index;
+    index.open(streamArchiveName());
+    const ZipIndexEntry *entryPtr = index.find("word/document.xml");
+    if (!entryPtr)
+      return state.skipWithError("fixture missing entry");
+    ZipInflateStream stream;
+    while (state.keepRunning()) {
+      stream.open(index, *entryPtr);
+      std::string_view chunk;
+      int32_t err;
+      while ((err = stream.read(chunk)) == MZ_OK)
+        doNotOptimize(chunk);
+      if (err != MZ_END_OF_STREAM)
+        state.skipWithError("stream error " + std::to_string(err));
+    }
+    state.setBytesProcessed(state.getIterations() *
+                            entryPtr->uncompressedSize);
+    state.setCounter("bufferKiB", 64);
+  });
+}
+
+} // namespace benchmark
+} // namespace bookfiler
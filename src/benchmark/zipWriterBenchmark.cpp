@@ -0,0 +1,167 @@
+// C++
+#include <random>
+#include <string>
+#include <vector>
+
+// Local Project
+#include "../core/docxImpl.hpp"
+#include "../core/mappedFile.hpp"
+#include "../core/threadPool.hpp"
+#include "../core/zipWriter.hpp"
+#include "benchmark.hpp"
+#include "fixture.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+namespace benchmark {
+
+namespace {
+
+const int paragraphTotal = 2000;
+const int mediaTotal = 32;
+const size_t mediaSize = (size_t)2 << 20;
+
+/* Around 50 MB on disk, nearly all of it deflated images */
+std::string saveArchiveName() {
+  static std::string fileName;
+  if (!fileName.empty())
+    return fileName;
+  fileName = fixtureDirectory() + "/save.docx";
+  std::mt19937 rng(13);
+  std::vector<FixturePart> mediaList;
+  for (int i = 0; i < mediaTotal; i++) {
+    std::string media(mediaSize, '\0');
+    for (size_t j = 0; j < mediaSize; j++)
+      media[j] = (char)((rng() & 0x3F) + (j & 0x40));
+    mediaList.push_back(
+        {"word/media/image" + std::to_string(i + 1) + ".png", media, true});
+  }
+  writeFixtureZip(fileName,
+                  fixtureDocxParts(fixtureDocumentXml(paragraphTotal, 20),
+                                   mediaList));
+  return fileName;
+}
+
+std::string saveOutputName() { return fixtureDirectory() + "/saved.docx"; }
+
+/* document.xml with one more word in the first text run, what a template
+ * fill or a redaction produces
+ */
+std::string editedDocumentXml(DocxImpl &docx) {
+  std::shared_ptr<ZipPart> part =
+      docx.getZipReader()->extractPart("word/document.xml");
+  if (part->err != MZ_OK)
+    return std::string();
+  std::string xml(part->data);
+  size_t textPos = xml.find("<w:t");
+  if (textPos != std::string::npos)
+    xml.insert(xml.find('>', textPos) + 1, "Filled ");
+  return xml;
+}
+
+uint64_t fileSize(const std::string &fileName) {
+  MappedFile mappedFile;
+  return mappedFile.open(fileName) == MZ_OK ? mappedFile.size() : 0;
+}
+
+} // namespace
+
+void registerZipWriterBenchmarks(Registry &registry) {
+  // the floor: the archive written out as it is
+  registry.add("zipWriter/copyFile", [](State &state) {
+    MappedFile mappedFile;
+    if (mappedFile.open(saveArchiveName()) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    while (state.keepRunning()) {
+      ZipFdSink sink;
+      if (sink.open(saveOutputName()) != MZ_OK ||
+          sink.write((const char *)mappedFile.data(),
+                     (size_t)mappedFile.size()) != MZ_OK ||
+          sink.close() != MZ_OK)
+        state.skipWithError("write error");
+    }
+    state.setBytesProcessed(state.getIterations() *
+                            (long long)mappedFile.size());
+  });
+
+  /* Saving with document.xml replaced: everything else copied compressed,
+   * document.xml deflated on the module pool meanwhile
+   */
+  registry.add("zipWriter/save", [](State &state) {
+    DocxImpl docx;
+    if (docx.openFile(saveArchiveName()) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    docx.setPart("word/document.xml", editedDocumentXml(docx));
+    while (state.keepRunning()) {
+      if (docx.saveFile(saveOutputName()) != MZ_OK)
+        state.skipWithError("save error");
+    }
+    state.setBytesProcessed(state.getIterations() *
+                            (long long)fileSize(saveArchiveName()));
+    state.setCounter("outputBytes", (double)fileSize(saveOutputName()));
+  });
+
+  // the same result by inflating every part and deflating it again
+  registry.add("zipWriter/roundTrip", [](State &state) {
+    DocxImpl docx;
+    if (docx.openFile(saveArchiveName()) != MZ_OK) {
+      state.skipWithError("open error");
+      return;
+    }
+    std::string documentXml = editedDocumentXml(docx);
+    const ZipIndex &index = docx.getZipReader()->getIndex();
+    while (state.keepRunning()) {
+      std::vector<ZipReplacement> replacementList;
+      for (const ZipIndexEntry &entry : index.getEntries()) {
+        std::string filePath(entry.filePath);
+        if (filePath == "word/document.xml") {
+          replacementList.push_back({filePath, documentXml, false});
+          continue;
+        }
+        std::shared_ptr<ZipPart> part =
+            docx.getZipReader()->extractPart(filePath);
+        replacementList.push_back({filePath, std::string(part->data), false});
+      }
+      ZipFdSink sink;
+      if (sink.open(saveOutputName()) != MZ_OK ||
+          zipRewrite(index, replacementList, sink) != MZ_OK ||
+          sink.close() != MZ_OK)
+        state.skipWithError("save error");
+    }
+    state.setBytesProcessed(state.getIterations() *
+                            (long long)fileSize(saveArchiveName()));
+  });
+
+  /* One large part deflated in blocks on one thread and on the module
+   * pool; ratio is compressed over uncompressed size
+   */
+  for (const char *mode : {"serial", "parallel"}) {
+    registry.add(std::string("zipWriter/deflate/") + mode,
+                 [mode](State &state) {
+                   std::string xml = fixtureDocumentXml(20000, 25);
+                   ThreadPool serialPool(1);
+                   ThreadPool &pool = std::string(mode) == "serial"
+                                          ? serialPool
+                                          : defaultThreadPool();
+                   ZipDeflatedPart part;
+                   while (state.keepRunning()) {
+                     if (zipDeflate(xml, 6, part, pool) != MZ_OK)
+                       state.skipWithError("deflate error");
+                   }
+                   state.setBytesProcessed(state.getIterations() *
+                                           (long long)xml.size());
+                   state.setCounter("ratio", (double)part.compressedSize /
+                                                 (double)xml.size());
+                   state.setCounter("threads", (double)pool.size());
+                 });
+  }
+}
+
+} // namespace benchmark
+} // namespace bookfiler
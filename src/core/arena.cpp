@@ -0,0 +1,90 @@
+// C++
+#include <algorithm>
+
+// Local Project
+#include "arena.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const size_t chunkAlignment = alignof(std::max_align_t);
+
+} // namespace
+
+MonotonicArena::MonotonicArena(size_t chunkMin_,
+                               std::pmr::memory_resource *upstream_)
+    : upstream(upstream_), chunkMin(std::max<size_t>(chunkMin_, 64)),
+      nextChunkSize(chunkMin) {}
+
+MonotonicArena::~MonotonicArena() {
+  for (const Chunk &chunk : chunkList)
+    upstream->deallocate(chunk.data, chunk.size, chunkAlignment);
+}
+
+void MonotonicArena::release() {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto largestIt = std::max_element(
+      chunkList.begin(), chunkList.end(),
+      [](const Chunk &a, const Chunk &b) { return a.size < b.size; });
+  Chunk kept{nullptr, 0};
+  if (largestIt != chunkList.end())
+    kept = *largestIt;
+  for (const Chunk &chunk : chunkList)
+    if (chunk.data != kept.data)
+      upstream->deallocate(chunk.data, chunk.size, chunkAlignment);
+  chunkList.clear();
+  cursor = end = nullptr;
+  stats = Stats();
+  if (kept.data) {
+    chunkList.push_back(kept);
+    cursor = kept.data;
+    end = kept.data + kept.size;
+    stats.chunkBytes = kept.size;
+    stats.chunkTotal = 1;
+  }
+}
+
+MonotonicArena::Stats MonotonicArena::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+void *MonotonicArena::do_allocate(size_t bytes, size_t alignment) {
+  std::lock_guard<std::mutex> lock(mutex);
+  stats.allocationTotal++;
+  stats.usedBytes += bytes;
+  uintptr_t aligned = ((uintptr_t)cursor + alignment - 1) & ~(alignment - 1);
+  if (cursor && aligned + bytes <= (uintptr_t)end) {
+    cursor = (unsigned char *)(aligned + bytes);
+    return (void *)aligned;
+  }
+  if (bytes + alignment > nextChunkSize / 2) {
+    // its own chunk, the current one keeps serving small requests
+    size_t size = bytes + alignment;
+    auto *data = (unsigned char *)upstream->allocate(size, chunkAlignment);
+    chunkList.push_back({data, size});
+    stats.chunkBytes += size;
+    stats.chunkTotal++;
+    return (void *)(((uintptr_t)data + alignment - 1) & ~(alignment - 1));
+  }
+  addChunk(nextChunkSize);
+  nextChunkSize = std::min(nextChunkSize * 2, chunkMax);
+  aligned = ((uintptr_t)cursor + alignment - 1) & ~(alignment - 1);
+  cursor = (unsigned char *)(aligned + bytes);
+  return (void *)aligned;
+}
+
+void MonotonicArena::addChunk(size_t size) {
+  auto *data = (unsigned char *)upstream->allocate(size, chunkAlignment);
+  chunkList.push_back({data, size});
+  cursor = data;
+  end = data + size;
+  stats.chunkBytes += size;
+  stats.chunkTotal++;
+}
+
+} // namespace bookfiler
@@ -0,0 +1,82 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_ARENA_H
+#define BOOKFILER_MODULE_DOCX_ARENA_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* MonotonicArena
+ * Bump allocation out of chunks taken from upstream, each chunk twice the
+ * last up to chunkMax; a request larger than half a chunk gets a chunk of
+ * its own. Deallocation does nothing, everything goes at once in release()
+ * or the destructor, so tearing down whatever lives in the arena is one
+ * free a chunk instead of one a node. Use it through std::pmr containers.
+ * Thread safe, the layout measures paragraphs into one arena from every
+ * pool thread.
+ */
+class MonotonicArena : public std::pmr::memory_resource {
+public:
+  class Stats {
+  public:
+    uint64_t allocationTotal = 0;
+    // bytes handed out, and bytes of the chunks they came from
+    size_t usedBytes = 0, chunkBytes = 0;
+    size_t chunkTotal = 0;
+  };
+
+  explicit MonotonicArena(
+      size_t chunkMin = 4096,
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+  ~MonotonicArena();
+  MonotonicArena(const MonotonicArena &) = delete;
+  MonotonicArena &operator=(const MonotonicArena &) = delete;
+  /* Frees every chunk but the largest, which is kept for what comes next.
+   * Nothing allocated before may be used afterwards.
+   */
+  void release();
+  Stats getStats() const;
+
+private:
+  class Chunk {
+  public:
+    unsigned char *data;
+    size_t size;
+  };
+
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(
+      const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+  void addChunk(size_t size);
+
+  static constexpr size_t chunkMax = (size_t)1 << 20;
+  std::pmr::memory_resource *upstream;
+  size_t chunkMin, nextChunkSize;
+  mutable std::mutex mutex;
+  std::vector<Chunk> chunkList;
+  // free space of the last chunk
+  unsigned char *cursor = nullptr, *end = nullptr;
+  Stats stats;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_ARENA_H
@@ -0,0 +1,152 @@
+// C++
+#include <new>
+
+// Local Project
+#include "bufferPool.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const size_t classShiftMin = 12;
+// 4 KiB to 16 MiB, larger requests are allocated to size and not kept
+const size_t classTotal = 13;
+const size_t pooledMax = (size_t)1 << (classShiftMin + classTotal - 1);
+const std::align_val_t blockAlignment{64};
+
+/* classTotal for requests above pooledMax */
+size_t classIndex(size_t size) {
+  if (size > pooledMax)
+    return classTotal;
+  size_t shift = classShiftMin;
+  while (((size_t)1 << shift) < size)
+    shift++;
+  return shift - classShiftMin;
+}
+
+size_t blockSizeOf(size_t size, size_t index) {
+  if (index == classTotal)
+    return size;
+  return (size_t)1 << (index + classShiftMin);
+}
+
+unsigned char *allocateBlock(size_t blockSize) {
+  return (unsigned char *)::operator new(blockSize, blockAlignment);
+}
+
+void freeBlock(unsigned char *block) {
+  ::operator delete(block, blockAlignment);
+}
+
+} // namespace
+
+class BufferPool::Shared {
+public:
+  ~Shared() {
+    for (auto &freeList : freeListList)
+      for (unsigned char *block : freeList)
+        freeBlock(block);
+  }
+
+  void release(unsigned char *block, size_t index, size_t blockSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.outstandingBytes -= blockSize;
+    if (index == classTotal || stats.idleBytes + blockSize > retainMax) {
+      freeBlock(block);
+      return;
+    }
+    freeListList[index].push_back(block);
+    stats.idleBytes += blockSize;
+  }
+
+  void trimTo(size_t idleMax) {
+    // largest classes first, they free the most for the fewest calls
+    for (size_t index = classTotal; index-- > 0 && stats.idleBytes > idleMax;) {
+      auto &freeList = freeListList[index];
+      while (!freeList.empty() && stats.idleBytes > idleMax) {
+        freeBlock(freeList.back());
+        freeList.pop_back();
+        stats.idleBytes -= (size_t)1 << (index + classShiftMin);
+      }
+    }
+  }
+
+  std::mutex mutex;
+  std::vector<unsigned char *> freeListList[classTotal];
+  size_t retainMax;
+  Stats stats;
+};
+
+BufferPool::BufferPool(size_t retainMax) : shared(std::make_shared<Shared>()) {
+  shared->retainMax = retainMax;
+}
+
+BufferPool::~BufferPool() {}
+
+std::shared_ptr<unsigned char> BufferPool::acquire(size_t size) {
+  size_t index = classIndex(size);
+  size_t blockSize = blockSizeOf(size, index);
+  unsigned char *block = nullptr;
+  if (index < classTotal) {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    auto &freeList = shared->freeListList[index];
+    if (!freeList.empty()) {
+      block = freeList.back();
+      freeList.pop_back();
+      shared->stats.idleBytes -= blockSize;
+      shared->stats.reuseTotal++;
+      shared->stats.acquireTotal++;
+      shared->stats.outstandingBytes += blockSize;
+    }
+  }
+  if (!block) {
+    // may throw std::bad_alloc, counted once it hasn't
+    block = allocateBlock(blockSize);
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    shared->stats.acquireTotal++;
+    shared->stats.outstandingBytes += blockSize;
+  }
+  std::weak_ptr<Shared> weakShared = shared;
+  return std::shared_ptr<unsigned char>(
+      block, [weakShared, index, blockSize](unsigned char *block) {
+        if (auto pool = weakShared.lock())
+          pool->release(block, index, blockSize);
+        else
+          freeBlock(block);
+      });
+}
+
+void BufferPool::setRetainMax(size_t retainMax) {
+  std::lock_guard<std::mutex> lock(shared->mutex);
+  shared->retainMax = retainMax;
+  shared->trimTo(retainMax);
+}
+
+void BufferPool::trim() {
+  std::lock_guard<std::mutex> lock(shared->mutex);
+  shared->trimTo(0);
+}
+
+BufferPool::Stats BufferPool::getStats() const {
+  std::lock_guard<std::mutex> lock(shared->mutex);
+  return shared->stats;
+}
+
+size_t BufferPool::classSize(size_t size) {
+  return blockSizeOf(size, classIndex(size));
+}
+
+BufferPool &pixmapBufferPool() {
+  static BufferPool pool;
+  return pool;
+}
+
+BufferPool &partBufferPool() {
+  static BufferPool pool((size_t)16 << 20);
+  return pool;
+}
+
+} // namespace bookfiler
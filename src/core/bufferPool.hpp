@@ -0,0 +1,71 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_BUFFER_POOL_H
+#define BOOKFILER_MODULE_DOCX_BUFFER_POOL_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* BufferPool
+ * Recycles large byte buffers by size class, powers of two from 4 KiB to
+ * 16 MiB. Larger requests get a block of their own size that is freed on
+ * return.
+ * acquire() hands out a shared_ptr whose deleter puts the block back on its
+ * class's free list, so a buffer returns to the pool when its last user
+ * drops it and the next acquire of that class skips the allocator. At most
+ * retainMax bytes sit idle, anything beyond is freed. Blocks are 64 byte
+ * aligned for the SIMD kernels. Thread safe, buffers may outlive the pool.
+ */
+class BufferPool {
+public:
+  class Stats {
+  public:
+    uint64_t acquireTotal = 0, reuseTotal = 0;
+    // bytes handed out and not yet returned, bytes on the free lists
+    size_t outstandingBytes = 0, idleBytes = 0;
+  };
+
+  explicit BufferPool(size_t retainMax = (size_t)64 << 20);
+  ~BufferPool();
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  /* At least size bytes, contents undefined */
+  std::shared_ptr<unsigned char> acquire(size_t size);
+  void setRetainMax(size_t retainMax);
+  /* Frees every idle block */
+  void trim();
+  Stats getStats() const;
+  /* Bytes actually allocated for a request of size */
+  static size_t classSize(size_t size);
+
+private:
+  class Shared;
+  std::shared_ptr<Shared> shared;
+};
+
+/* Module wide pool for pixmaps and decoded images */
+BufferPool &pixmapBufferPool();
+/* Module wide pool for inflated parts, shared by every document, the idle
+ * bytes kept are the "partPoolBytes" setting
+ */
+BufferPool &partBufferPool();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_BUFFER_POOL_H
@@ -11,4 +11,15 @@
 
 #define BOOKFILER_MODULE_DOCX_DEBUG 1
 
+/* SSE2/AVX2 XML scanning and SSE4.1/AVX2 pixel kernels on x86-64, chosen
+ * at runtime. Set to 0 to build only the scalar kernels.
+ */
+#define BOOKFILER_MODULE_DOCX_SIMD 1
+
+/* Trace spans around archive open, entry lookup, inflate, parse, layout,
+ * render and image decode, and the per document counters. Set to 0 to
+ * compile them out.
+ */
+#define BOOKFILER_MODULE_DOCX_TRACE 1
+
 #endif // BOOKFILER_MODULE_DOCX_CONFIG_H
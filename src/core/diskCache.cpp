@@ -0,0 +1,461 @@
+// C++
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+/* zlib
+ * License: zlib
+ */
+#include <zlib.h>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "diskCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const char cacheMagic[8] = {'B', 'F', 'D', 'O', 'C', 'X', 'C', 'M'};
+// raise whenever the parser or a record below changes what it stores
+const uint32_t formatVersion = 1;
+const uint32_t byteOrderMark = 0x01020304;
+const size_t sectionTotalMax = 64;
+
+enum SectionKind : uint32_t {
+  paragraphSection,
+  runSection,
+  tableSection,
+  cellSection,
+  sectionSection,
+  objectSection,
+  textSection,
+  stringSection,
+  stringLengthSection,
+  runPropertiesSection,
+  paragraphPropertiesSection,
+  resolvedRunSection,
+  resolvedParagraphSection,
+  styleSection,
+  runDefaultsSection,
+  paragraphDefaultsSection
+};
+
+class FileHeader {
+public:
+  char magic[8];
+  uint32_t version, byteOrder;
+  uint64_t contentHash, fileBytes;
+  uint32_t pageTotal, sectionTotal;
+  // payload, then header with headerCrc 0 followed by the section table
+  uint32_t payloadCrc, headerCrc;
+};
+static_assert(sizeof(FileHeader) == 48, "FileHeader is written as is");
+
+uint32_t crcUpdate(uint32_t crc, const void *data, size_t size) {
+  auto *p = (const Bytef *)data;
+  // zlib takes 32 bit lengths
+  while (size > 0) {
+    uInt chunk = (uInt)std::min<size_t>(size, (size_t)1 << 30);
+    crc = (uint32_t)crc32(crc, p, chunk);
+    p += chunk;
+    size -= chunk;
+  }
+  return crc;
+}
+
+/* Lays sections out one after the other, each 8 byte aligned */
+class PayloadWriter {
+public:
+  template <class T>
+  void add(uint32_t kind, const T *data, size_t count) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "sections are copied byte for byte");
+    payload.resize((payload.size() + 7) & ~(size_t)7, '\0');
+    sectionList.push_back(
+        {kind, (uint32_t)sizeof(T), (uint64_t)payload.size(), count});
+    payload.append((const char *)data, sizeof(T) * count);
+  }
+  template <class T> void add(uint32_t kind, const PropertyTable<T> &table) {
+    std::vector<T> valueList;
+    valueList.reserve(table.size());
+    for (uint32_t id = 0; id < table.size(); id++)
+      valueList.push_back(table.get(id));
+    add(kind, valueList.data(), valueList.size());
+  }
+
+  std::string payload;
+  std::vector<DiskCacheEntry::Section> sectionList;
+};
+
+bool validRunProperties(const RunProperties &properties, size_t stringTotal) {
+  return properties.styleId < stringTotal && properties.fontId < stringTotal;
+}
+
+template <class T>
+bool validTable(const PropertyTable<T> &table, size_t stringTotal) {
+  for (uint32_t id = 0; id < table.size(); id++) {
+    if (table.get(id).styleId >= stringTotal)
+      return false;
+    if constexpr (std::is_same<T, RunProperties>::value)
+      if (!validRunProperties(table.get(id), stringTotal))
+        return false;
+  }
+  return true;
+}
+
+/* Every index the layout and renderer follow lands inside its array */
+bool validModel(const DocumentModel &model) {
+  size_t stringTotal = model.stringPool.size();
+  for (const DocumentParagraph &paragraph : model.paragraphList) {
+    if (paragraph.runBegin > paragraph.runEnd ||
+        paragraph.runEnd > model.runList.size() ||
+        paragraph.propertiesId >= model.paragraphPropertiesTable.size() ||
+        paragraph.resolvedId >= model.resolvedParagraphTable.size() ||
+        (paragraph.cellIndex != documentNone &&
+         paragraph.cellIndex >= model.cellList.size()))
+      return false;
+  }
+  for (const DocumentRun &run : model.runList) {
+    if ((uint64_t)run.textOffset + run.textLength > model.text.size() ||
+        run.propertiesId >= model.runPropertiesTable.size() ||
+        run.resolvedId >= model.resolvedRunTable.size() ||
+        (run.objectIndex != documentNone &&
+         run.objectIndex >= model.objectList.size()))
+      return false;
+  }
+  for (const DocumentTable &table : model.tableList) {
+    if (table.paragraphBegin > table.paragraphEnd ||
+        table.paragraphEnd > model.paragraphList.size() ||
+        table.cellBegin > table.cellEnd ||
+        table.cellEnd > model.cellList.size() ||
+        (table.parentCell != documentNone &&
+         table.parentCell >= model.cellList.size()))
+      return false;
+  }
+  for (const DocumentCell &cell : model.cellList) {
+    if (cell.tableIndex >= model.tableList.size() ||
+        cell.paragraphBegin > cell.paragraphEnd ||
+        cell.paragraphEnd > model.paragraphList.size())
+      return false;
+  }
+  for (const DocumentSection &section : model.sectionList) {
+    if (section.paragraphEnd > model.paragraphList.size() ||
+        section.headerRelId >= stringTotal ||
+        section.footerRelId >= stringTotal)
+      return false;
+  }
+  for (const DocumentObject &object : model.objectList) {
+    if (object.relId >= stringTotal)
+      return false;
+  }
+  for (const StyleDefinition &style : model.styleSheet.styleList) {
+    if (style.styleId >= stringTotal || style.basedOn >= stringTotal ||
+        !validRunProperties(style.runProperties, stringTotal) ||
+        style.paragraphProperties.styleId >= stringTotal)
+      return false;
+  }
+  return !model.sectionList.empty() &&
+         validRunProperties(model.styleSheet.runDefaults, stringTotal) &&
+         validTable(model.runPropertiesTable, stringTotal) &&
+         validTable(model.paragraphPropertiesTable, stringTotal) &&
+         validTable(model.resolvedRunTable, stringTotal) &&
+         validTable(model.resolvedParagraphTable, stringTotal);
+}
+
+} // namespace
+
+int32_t DiskCacheEntry::loadModel(DocumentModel &model) const {
+  const unsigned char *payload = mappedFile->data() + payloadOffset;
+  uint64_t payloadBytes = mappedFile->size() - payloadOffset;
+  if (crcUpdate(0, payload, (size_t)payloadBytes) != payloadCrc)
+    return MZ_CRC_ERROR;
+
+  // sections were bounds checked by DiskCache::find
+  auto section = [this](uint32_t kind) -> const Section * {
+    for (const Section &candidate : sectionList)
+      if (candidate.kind == kind)
+        return &candidate;
+    return nullptr;
+  };
+  bool complete = true;
+  auto copy = [&](uint32_t kind, auto &list) {
+    using T = typename std::decay<decltype(list[0])>::type;
+    const Section *found = section(kind);
+    if (!found || found->elementBytes != sizeof(T)) {
+      complete = false;
+      return;
+    }
+    list.resize((size_t)found->count);
+    if (!list.empty())
+      std::memcpy(&list[0], payload + found->offset, sizeof(T) * list.size());
+  };
+  auto intern = [&](uint32_t kind, auto &table) {
+    using T = typename std::decay<decltype(table.get(0))>::type;
+    std::vector<T> valueList;
+    copy(kind, valueList);
+    table.clear();
+    // distinct values intern to the ids they were stored under
+    for (size_t id = 0; id < valueList.size() && complete; id++)
+      complete = table.intern(valueList[id]) == id;
+  };
+
+  model.clear();
+  copy(paragraphSection, model.paragraphList);
+  copy(runSection, model.runList);
+  copy(tableSection, model.tableList);
+  copy(cellSection, model.cellList);
+  copy(sectionSection, model.sectionList);
+  copy(objectSection, model.objectList);
+  copy(textSection, model.text);
+  std::string storage;
+  std::vector<uint32_t> lengthList;
+  copy(stringSection, storage);
+  copy(stringLengthSection, lengthList);
+  size_t stringOffset = 0;
+  for (size_t id = 0; id < lengthList.size() && complete; id++) {
+    if (lengthList[id] > storage.size() - stringOffset) {
+      complete = false;
+      break;
+    }
+    complete = model.stringPool.intern(std::string_view(
+                   storage.data() + stringOffset, lengthList[id])) == id;
+    stringOffset += lengthList[id];
+  }
+  intern(runPropertiesSection, model.runPropertiesTable);
+  intern(paragraphPropertiesSection, model.paragraphPropertiesTable);
+  intern(resolvedRunSection, model.resolvedRunTable);
+  intern(resolvedParagraphSection, model.resolvedParagraphTable);
+  copy(styleSection, model.styleSheet.styleList);
+  std::vector<RunProperties> runDefaults;
+  std::vector<ParagraphProperties> paragraphDefaults;
+  copy(runDefaultsSection, runDefaults);
+  copy(paragraphDefaultsSection, paragraphDefaults);
+  if (!complete || runDefaults.size() != 1 || paragraphDefaults.size() != 1)
+    return MZ_FORMAT_ERROR;
+  model.styleSheet.runDefaults = runDefaults[0];
+  model.styleSheet.paragraphDefaults = paragraphDefaults[0];
+  model.styleSheet.index();
+  return validModel(model) ? MZ_OK : MZ_FORMAT_ERROR;
+}
+
+void DiskCache::setDirectory(std::string directory_) {
+  if (!directory_.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::u8path(directory_),
+                                        ec);
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  directory = directory_;
+  storedSet.clear();
+}
+
+std::string DiskCache::getDirectory() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return directory;
+}
+
+bool DiskCache::isEnabled() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !directory.empty();
+}
+
+std::string DiskCache::entryFileName(uint64_t contentHash) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bfdc",
+                (unsigned long long)contentHash);
+  return (std::filesystem::u8path(directory) / name).u8string();
+}
+
+std::shared_ptr<const DiskCacheEntry> DiskCache::find(uint64_t contentHash) {
+  std::string fileName;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (directory.empty())
+      return nullptr;
+    fileName = entryFileName(contentHash);
+  }
+  auto mappedFile = std::make_shared<MappedFile>();
+  if (mappedFile->open(fileName) != MZ_OK) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.missTotal++;
+    return nullptr;
+  }
+
+  auto entry = std::make_shared<DiskCacheEntry>();
+  FileHeader header;
+  uint64_t fileBytes = mappedFile->size();
+  bool good = fileBytes >= sizeof(header);
+  if (good) {
+    std::memcpy(&header, mappedFile->data(), sizeof(header));
+    good = std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0 &&
+           header.version == formatVersion &&
+           header.byteOrder == byteOrderMark &&
+           header.contentHash == contentHash &&
+           header.fileBytes == fileBytes &&
+           header.sectionTotal <= sectionTotalMax &&
+           sizeof(header) + header.sectionTotal *
+                                sizeof(DiskCacheEntry::Section) <=
+               fileBytes;
+  }
+  if (good) {
+    entry->payloadOffset =
+        sizeof(header) + header.sectionTotal * sizeof(DiskCacheEntry::Section);
+    uint32_t headerCrc = header.headerCrc;
+    header.headerCrc = 0;
+    good = crcUpdate(crcUpdate(0, &header, sizeof(header)),
+                     mappedFile->data() + sizeof(header),
+                     (size_t)(entry->payloadOffset - sizeof(header))) ==
+           headerCrc;
+  }
+  if (good) {
+    entry->sectionList.resize(header.sectionTotal);
+    std::memcpy(entry->sectionList.data(), mappedFile->data() + sizeof(header),
+                entry->sectionList.size() * sizeof(DiskCacheEntry::Section));
+    uint64_t payloadBytes = fileBytes - entry->payloadOffset;
+    for (const DiskCacheEntry::Section &section : entry->sectionList) {
+      good = good && section.elementBytes != 0 &&
+             section.offset <= payloadBytes &&
+             section.count <=
+                 (payloadBytes - section.offset) / section.elementBytes;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!good) {
+    stats.staleTotal++;
+    stats.missTotal++;
+    storedSet.erase(contentHash);
+    mappedFile = nullptr;
+    std::error_code ec;
+    std::filesystem::remove(std::filesystem::u8path(fileName), ec);
+    return nullptr;
+  }
+  stats.hitTotal++;
+  storedSet.insert(contentHash);
+  entry->mappedFile = mappedFile;
+  entry->contentHash = contentHash;
+  entry->pageTotal = header.pageTotal;
+  entry->payloadCrc = header.payloadCrc;
+  return entry;
+}
+
+int32_t DiskCache::store(uint64_t contentHash, const DocumentModel &model,
+                         uint32_t pageTotal) {
+  std::string fileName;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (directory.empty() || storedSet.count(contentHash))
+      return MZ_OK;
+    // claimed, other documents with the same contents leave it to us
+    storedSet.insert(contentHash);
+    fileName = entryFileName(contentHash);
+  }
+
+  PayloadWriter writer;
+  writer.add(paragraphSection, model.paragraphList.data(),
+             model.paragraphList.size());
+  writer.add(runSection, model.runList.data(), model.runList.size());
+  writer.add(tableSection, model.tableList.data(), model.tableList.size());
+  writer.add(cellSection, model.cellList.data(), model.cellList.size());
+  writer.add(sectionSection, model.sectionList.data(),
+             model.sectionList.size());
+  writer.add(objectSection, model.objectList.data(), model.objectList.size());
+  writer.add(textSection, model.text.data(), model.text.size());
+  std::string storage;
+  std::vector<uint32_t> lengthList;
+  for (uint32_t id = 0; id < model.stringPool.size(); id++) {
+    std::string_view value = model.stringPool.get(id);
+    storage.append(value);
+    lengthList.push_back((uint32_t)value.size());
+  }
+  writer.add(stringSection, storage.data(), storage.size());
+  writer.add(stringLengthSection, lengthList.data(), lengthList.size());
+  writer.add(runPropertiesSection, model.runPropertiesTable);
+  writer.add(paragraphPropertiesSection, model.paragraphPropertiesTable);
+  writer.add(resolvedRunSection, model.resolvedRunTable);
+  writer.add(resolvedParagraphSection, model.resolvedParagraphTable);
+  const StyleSheet &styleSheet = model.styleSheet;
+  writer.add(styleSection, styleSheet.styleList.data(),
+             styleSheet.styleList.size());
+  writer.add(runDefaultsSection, &styleSheet.runDefaults, 1);
+  writer.add(paragraphDefaultsSection, &styleSheet.paragraphDefaults, 1);
+
+  FileHeader header;
+  std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.version = formatVersion;
+  header.byteOrder = byteOrderMark;
+  header.contentHash = contentHash;
+  size_t tableBytes =
+      writer.sectionList.size() * sizeof(DiskCacheEntry::Section);
+  header.fileBytes = sizeof(header) + tableBytes + writer.payload.size();
+  header.pageTotal = pageTotal;
+  header.sectionTotal = (uint32_t)writer.sectionList.size();
+  header.payloadCrc =
+      crcUpdate(0, writer.payload.data(), writer.payload.size());
+  header.headerCrc = 0;
+  header.headerCrc =
+      crcUpdate(crcUpdate(0, &header, sizeof(header)),
+                writer.sectionList.data(), tableBytes);
+
+  // a name of its own per thread, renamed over the entry when complete
+  std::filesystem::path path = std::filesystem::u8path(fileName);
+  std::filesystem::path partialPath = path;
+  partialPath += ".partial" + std::to_string(std::hash<std::thread::id>()(
+                                  std::this_thread::get_id()));
+  bool written;
+  {
+    std::ofstream file(partialPath, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)writer.sectionList.data(), tableBytes);
+    file.write(writer.payload.data(), writer.payload.size());
+    written = (bool)file;
+  }
+  std::error_code ec;
+  if (written)
+    std::filesystem::rename(partialPath, path, ec);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!written || ec) {
+    std::filesystem::remove(partialPath, ec);
+    storedSet.erase(contentHash);
+    return MZ_WRITE_ERROR;
+  }
+  stats.storeTotal++;
+  stats.storeBytes += header.fileBytes;
+  return MZ_OK;
+}
+
+void DiskCache::discard(uint64_t contentHash) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (directory.empty())
+    return;
+  stats.staleTotal++;
+  storedSet.erase(contentHash);
+  std::error_code ec;
+  std::filesystem::remove(
+      std::filesystem::u8path(entryFileName(contentHash)), ec);
+}
+
+DiskCache::Stats DiskCache::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+DiskCache &diskCache() {
+  static DiskCache cache;
+  return cache;
+}
+
+} // namespace bookfiler
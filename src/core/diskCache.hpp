@@ -0,0 +1,116 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_DISK_CACHE_H
+#define BOOKFILER_MODULE_DOCX_DISK_CACHE_H
+
+// C++
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Local Project
+#include "document.hpp"
+#include "mappedFile.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* DiskCacheEntry
+ * One cache file, mapped. Its header and section table were checked when
+ * it was found; the payload is checked when the model is loaded.
+ */
+class DiskCacheEntry {
+public:
+  /* An entry of the file's section table, offset is into the payload */
+  class Section {
+  public:
+    uint32_t kind, elementBytes;
+    uint64_t offset, count;
+  };
+
+  uint64_t getContentHash() const { return contentHash; }
+  /* Page count of the default layout */
+  uint32_t getPageTotal() const { return pageTotal; }
+  /* Copies the model out of the mapping, styles already resolved.
+   * MZ_CRC_ERROR	-105	the payload does not match its checksum
+   * MZ_FORMAT_ERROR	-103	a section or an index is out of range
+   */
+  int32_t loadModel(DocumentModel &model) const;
+
+private:
+  friend class DiskCache;
+
+  std::shared_ptr<const MappedFile> mappedFile;
+  uint64_t contentHash = 0;
+  uint32_t pageTotal = 0, payloadCrc = 0;
+  uint64_t payloadOffset = 0;
+  std::vector<Section> sectionList;
+};
+
+/* DiskCache
+ * Parsed models and their page counts kept on disk across processes, one
+ * file per archive named by ZipIndex::getContentHash, which covers the
+ * path, CRC and size of every entry. A hit costs a mapping and a copy of
+ * the flat model arrays: no XML is read, styles are not resolved again and
+ * nothing is paginated for the page count.
+ *
+ * The file is a header, a table of sections and the sections, each an
+ * array of the model's trivially copyable records, 8 byte aligned. The
+ * header carries the format version, the byte order, the content hash,
+ * the file size and checksums of header and payload. A file that fails
+ * any check, or holds indices out of range, is removed and written again
+ * on the next store. Files are written next to their name and renamed
+ * over it, so readers never see one half written. Thread safe.
+ */
+class DiskCache {
+public:
+  class Stats {
+  public:
+    uint64_t hitTotal = 0, missTotal = 0, staleTotal = 0;
+    uint64_t storeTotal = 0, storeBytes = 0;
+  };
+
+  /* Files are written here, created if missing. Empty, the default, turns
+   * the cache off.
+   */
+  void setDirectory(std::string directory);
+  std::string getDirectory() const;
+  bool isEnabled() const;
+  /* nullptr on a miss. A stale or damaged file is removed. */
+  std::shared_ptr<const DiskCacheEntry> find(uint64_t contentHash);
+  /* Writes the entry for contentHash unless this process already found or
+   * wrote a good one. model must have its styles resolved.
+   */
+  int32_t store(uint64_t contentHash, const DocumentModel &model,
+                uint32_t pageTotal);
+  /* Removes an entry whose model failed to load */
+  void discard(uint64_t contentHash);
+  Stats getStats() const;
+
+private:
+  std::string entryFileName(uint64_t contentHash) const;
+
+  mutable std::mutex mutex;
+  std::string directory;
+  // entries known good on disk, not looked at again
+  std::unordered_set<uint64_t> storedSet;
+  Stats stats;
+};
+
+/* Module wide cache, the directory is the "diskCacheDirectory" setting */
+DiskCache &diskCache();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_DISK_CACHE_H
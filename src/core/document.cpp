@@ -0,0 +1,333 @@
+// Local Project
+#include "document.hpp"
+#include "zipIndex.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+// basedOn chains longer than this are cut, it also stops cycles
+const size_t styleChainMax = 32;
+
+inline uint32_t hashCombine(uint32_t hash, uint32_t value) {
+  hash ^= value + 0x9E3779B9u + (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+} // namespace
+
+StringPool::StringPool() { clear(); }
+
+void StringPool::clear() {
+  storage.clear();
+  spanList.clear();
+  hashList.clear();
+  slots.assign(16, 0);
+  intern(std::string_view());
+}
+
+uint32_t StringPool::find(std::string_view value) const {
+  uint32_t hash = zipIndexHash(value);
+  uint32_t mask = (uint32_t)slots.size() - 1;
+  uint32_t slot = hash & mask;
+  while (slots[slot] != 0) {
+    uint32_t id = slots[slot] - 1;
+    if (hashList[id] == hash && get(id) == value)
+      return id;
+    slot = (slot + 1) & mask;
+  }
+  return documentNone;
+}
+
+uint32_t StringPool::intern(std::string_view value) {
+  uint32_t hash = zipIndexHash(value);
+  uint32_t mask = (uint32_t)slots.size() - 1;
+  uint32_t slot = hash & mask;
+  while (slots[slot] != 0) {
+    uint32_t id = slots[slot] - 1;
+    if (hashList[id] == hash && get(id) == value)
+      return id;
+    slot = (slot + 1) & mask;
+  }
+  uint32_t id = (uint32_t)spanList.size();
+  spanList.push_back({(uint32_t)storage.size(), (uint32_t)value.size()});
+  hashList.push_back(hash);
+  storage.append(value.data(), value.size());
+  slots[slot] = id + 1;
+  if (spanList.size() * 2 > slots.size())
+    rehash(slots.size() * 2);
+  return id;
+}
+
+void StringPool::rehash(size_t slotTotal) {
+  slots.assign(slotTotal, 0);
+  uint32_t mask = (uint32_t)slotTotal - 1;
+  for (size_t id = 0; id < spanList.size(); id++) {
+    uint32_t slot = hashList[id] & mask;
+    while (slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    slots[slot] = (uint32_t)(id + 1);
+  }
+}
+
+size_t StringPool::memoryUsage() const {
+  return storage.capacity() +
+         spanList.capacity() * sizeof(std::pair<uint32_t, uint32_t>) +
+         hashList.capacity() * sizeof(uint32_t) +
+         slots.capacity() * sizeof(uint32_t);
+}
+
+void RunProperties::apply(const RunProperties &other) {
+  if (other.fontId != 0)
+    fontId = other.fontId;
+  if (other.colorSet) {
+    color = other.color;
+    colorSet = true;
+  }
+  if (other.halfPoints != 0)
+    halfPoints = other.halfPoints;
+  flags = (uint8_t)((flags & ~other.flagsSet) | (other.flags & other.flagsSet));
+  flagsSet |= other.flagsSet;
+}
+
+bool RunProperties::operator==(const RunProperties &other) const {
+  return styleId == other.styleId && fontId == other.fontId &&
+         color == other.color && halfPoints == other.halfPoints &&
+         flags == other.flags && flagsSet == other.flagsSet &&
+         colorSet == other.colorSet;
+}
+
+uint32_t RunProperties::hash() const {
+  uint32_t hash = styleId;
+  hash = hashCombine(hash, fontId);
+  hash = hashCombine(hash, color);
+  hash = hashCombine(hash, halfPoints | (flags << 16) | (flagsSet << 24));
+  return hashCombine(hash, colorSet);
+}
+
+void ParagraphProperties::apply(const ParagraphProperties &other) {
+  auto take = [](int32_t &field, int32_t value) {
+    if (value != propertyUnset)
+      field = value;
+  };
+  take(indentLeft, other.indentLeft);
+  take(indentRight, other.indentRight);
+  take(indentFirstLine, other.indentFirstLine);
+  take(spacingBefore, other.spacingBefore);
+  take(spacingAfter, other.spacingAfter);
+  if (other.spacingLine != propertyUnset) {
+    spacingLine = other.spacingLine;
+    lineRule = other.lineRule;
+  }
+  take(numId, other.numId);
+  take(numLevel, other.numLevel);
+  if (other.justification != justificationUnset)
+    justification = other.justification;
+  flags = (uint8_t)((flags & ~other.flagsSet) | (other.flags & other.flagsSet));
+  flagsSet |= other.flagsSet;
+}
+
+bool ParagraphProperties::operator==(const ParagraphProperties &other) const {
+  return styleId == other.styleId && indentLeft == other.indentLeft &&
+         indentRight == other.indentRight &&
+         indentFirstLine == other.indentFirstLine &&
+         spacingBefore == other.spacingBefore &&
+         spacingAfter == other.spacingAfter &&
+         spacingLine == other.spacingLine && numId == other.numId &&
+         numLevel == other.numLevel && justification == other.justification &&
+         lineRule == other.lineRule && flags == other.flags &&
+         flagsSet == other.flagsSet;
+}
+
+uint32_t ParagraphProperties::hash() const {
+  uint32_t hash = styleId;
+  hash = hashCombine(hash, (uint32_t)indentLeft);
+  hash = hashCombine(hash, (uint32_t)indentRight);
+  hash = hashCombine(hash, (uint32_t)indentFirstLine);
+  hash = hashCombine(hash, (uint32_t)spacingBefore);
+  hash = hashCombine(hash, (uint32_t)spacingAfter);
+  hash = hashCombine(hash, (uint32_t)spacingLine);
+  hash = hashCombine(hash, (uint32_t)numId);
+  hash = hashCombine(hash, (uint32_t)numLevel);
+  return hashCombine(hash, justification | (lineRule << 8) | (flags << 16) |
+                               (flagsSet << 24));
+}
+
+void StyleSheet::index() {
+  styleIndexMap.clear();
+  defaultParagraphStyle = defaultCharacterStyle = 0;
+  for (size_t i = 0; i < styleList.size(); i++) {
+    const StyleDefinition &style = styleList[i];
+    // the first definition of an id wins, as in Word
+    styleIndexMap.emplace(style.styleId, (uint32_t)i);
+    if (!style.isDefault)
+      continue;
+    if (style.type == StyleDefinition::paragraph && !defaultParagraphStyle)
+      defaultParagraphStyle = style.styleId;
+    else if (style.type == StyleDefinition::character &&
+             !defaultCharacterStyle)
+      defaultCharacterStyle = style.styleId;
+  }
+}
+
+const StyleDefinition *StyleSheet::find(uint32_t styleId) const {
+  auto styleIt = styleIndexMap.find(styleId);
+  return styleIt == styleIndexMap.end() ? nullptr
+                                        : &styleList[styleIt->second];
+}
+
+uint32_t StyleSheet::defaultStyle(uint8_t type) const {
+  return type == StyleDefinition::paragraph ? defaultParagraphStyle
+                                            : defaultCharacterStyle;
+}
+
+size_t StyleSheet::chain(uint32_t styleId, uint8_t type,
+                         const StyleDefinition **chainList) const {
+  if (styleId == 0)
+    styleId = defaultStyle(type);
+  size_t chainTotal = 0;
+  while (styleId != 0 && chainTotal < styleChainMax) {
+    const StyleDefinition *style = find(styleId);
+    // a paragraph style named in rStyle and the like are ignored
+    if (!style || style->type != type)
+      break;
+    chainList[chainTotal++] = style;
+    styleId = style->basedOn;
+  }
+  return chainTotal;
+}
+
+RunProperties
+StyleSheet::resolveRun(const ParagraphProperties &paragraphDirect,
+                       const RunProperties &runDirect) const {
+  const StyleDefinition *chainList[styleChainMax];
+  RunProperties resolved = runDefaults;
+  for (size_t i = chain(paragraphDirect.styleId, StyleDefinition::paragraph,
+                        chainList);
+       i-- > 0;)
+    resolved.apply(chainList[i]->runProperties);
+  for (size_t i =
+           chain(runDirect.styleId, StyleDefinition::character, chainList);
+       i-- > 0;)
+    resolved.apply(chainList[i]->runProperties);
+  resolved.apply(runDirect);
+  resolved.styleId = 0;
+  return resolved;
+}
+
+ParagraphProperties
+StyleSheet::resolveParagraph(const ParagraphProperties &paragraphDirect) const {
+  const StyleDefinition *chainList[styleChainMax];
+  ParagraphProperties resolved = paragraphDefaults;
+  for (size_t i = chain(paragraphDirect.styleId, StyleDefinition::paragraph,
+                        chainList);
+       i-- > 0;)
+    resolved.apply(chainList[i]->paragraphProperties);
+  resolved.apply(paragraphDirect);
+  resolved.styleId = 0;
+  return resolved;
+}
+
+void StyleSheet::resolve(DocumentModel &model) const {
+  model.resolvedRunTable.clear();
+  model.resolvedParagraphTable.clear();
+  const StyleDefinition *chainList[styleChainMax];
+
+  // run formatting every style contributes with its chain, walked once
+  std::vector<RunProperties> styleRunList(styleList.size());
+  for (size_t i = 0; i < styleList.size(); i++) {
+    for (size_t j = chain(styleList[i].styleId, styleList[i].type, chainList);
+         j-- > 0;)
+      styleRunList[i].apply(chainList[j]->runProperties);
+  }
+  auto styleRun = [&](uint32_t styleId,
+                      uint8_t type) -> const RunProperties * {
+    if (styleId == 0)
+      styleId = defaultStyle(type);
+    const StyleDefinition *style = find(styleId);
+    if (!style || style->type != type)
+      return nullptr;
+    return &styleRunList[style - styleList.data()];
+  };
+
+  // by direct paragraph properties id, then by (paragraph style, direct run
+  // properties id)
+  std::vector<uint32_t> paragraphMemo(model.paragraphPropertiesTable.size(),
+                                      documentNone);
+  std::unordered_map<uint64_t, uint32_t> runMemo;
+  for (DocumentParagraph &paragraph : model.paragraphList) {
+    const ParagraphProperties &paragraphDirect =
+        model.paragraphPropertiesTable.get(paragraph.propertiesId);
+    uint32_t &paragraphId = paragraphMemo[paragraph.propertiesId];
+    if (paragraphId == documentNone)
+      paragraphId = model.resolvedParagraphTable.intern(
+          resolveParagraph(paragraphDirect));
+    paragraph.resolvedId = paragraphId;
+
+    const RunProperties *paragraphStyleRun =
+        styleRun(paragraphDirect.styleId, StyleDefinition::paragraph);
+    for (uint32_t runIndex = paragraph.runBegin; runIndex < paragraph.runEnd;
+         runIndex++) {
+      DocumentRun &run = model.runList[runIndex];
+      uint64_t key = (uint64_t)paragraphDirect.styleId << 32 | run.propertiesId;
+      auto memoIt = runMemo.find(key);
+      if (memoIt != runMemo.end()) {
+        run.resolvedId = memoIt->second;
+        continue;
+      }
+      const RunProperties &runDirect =
+          model.runPropertiesTable.get(run.propertiesId);
+      RunProperties resolved = runDefaults;
+      if (paragraphStyleRun)
+        resolved.apply(*paragraphStyleRun);
+      if (const RunProperties *characterStyleRun =
+              styleRun(runDirect.styleId, StyleDefinition::character))
+        resolved.apply(*characterStyleRun);
+      resolved.apply(runDirect);
+      resolved.styleId = 0;
+      run.resolvedId = model.resolvedRunTable.intern(resolved);
+      runMemo.emplace(key, run.resolvedId);
+    }
+  }
+}
+
+void StyleSheet::clear() {
+  runDefaults = RunProperties();
+  paragraphDefaults = ParagraphProperties();
+  styleList.clear();
+  index();
+}
+
+size_t DocumentModel::memoryUsage() const {
+  return paragraphList.capacity() * sizeof(DocumentParagraph) +
+         runList.capacity() * sizeof(DocumentRun) +
+         tableList.capacity() * sizeof(DocumentTable) +
+         cellList.capacity() * sizeof(DocumentCell) +
+         sectionList.capacity() * sizeof(DocumentSection) +
+         objectList.capacity() * sizeof(DocumentObject) + text.capacity() +
+         stringPool.memoryUsage() + runPropertiesTable.memoryUsage() +
+         paragraphPropertiesTable.memoryUsage() +
+         styleSheet.styleList.capacity() * sizeof(StyleDefinition) +
+         resolvedRunTable.memoryUsage() + resolvedParagraphTable.memoryUsage();
+}
+
+void DocumentModel::clear() {
+  paragraphList.clear();
+  runList.clear();
+  tableList.clear();
+  cellList.clear();
+  sectionList.clear();
+  objectList.clear();
+  text.clear();
+  stringPool.clear();
+  runPropertiesTable.clear();
+  paragraphPropertiesTable.clear();
+  styleSheet.clear();
+  resolvedRunTable.clear();
+  resolvedParagraphTable.clear();
+}
+
+} // namespace bookfiler
@@ -0,0 +1,328 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_DOCUMENT_H
+#define BOOKFILER_MODULE_DOCX_DOCUMENT_H
+
+// C++
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* Index value meaning "no element" */
+const uint32_t documentNone = 0xFFFFFFFF;
+/* Numeric property value meaning "not set here, inherit" */
+const int32_t propertyUnset = INT32_MIN;
+const uint32_t colorAuto = 0xFF000000;
+
+/* StringPool
+ * Interns style ids, font names and relationship ids. Id 0 is the empty
+ * string, ids are dense and stable for the life of the pool.
+ */
+class StringPool {
+public:
+  StringPool();
+  uint32_t intern(std::string_view value);
+  /* @return documentNone if value was never interned */
+  uint32_t find(std::string_view value) const;
+  std::string_view get(uint32_t id) const {
+    return std::string_view(storage.data() + spanList[id].first,
+                            spanList[id].second);
+  }
+  size_t size() const { return spanList.size(); }
+  size_t memoryUsage() const;
+  void clear();
+
+private:
+  void rehash(size_t slotTotal);
+
+  std::string storage;
+  std::vector<std::pair<uint32_t, uint32_t>> spanList;
+  std::vector<uint32_t> hashList;
+  /* open addressing table of id + 1, 0 is an empty slot */
+  std::vector<uint32_t> slots;
+};
+
+/* PropertyTable
+ * Deduplicates property sets so identical formatting is stored once and
+ * referenced by id. T needs operator== and a hash() member.
+ */
+template <class T> class PropertyTable {
+public:
+  PropertyTable() { clear(); }
+  uint32_t intern(const T &value) {
+    uint32_t hash = value.hash();
+    uint32_t mask = (uint32_t)slots.size() - 1;
+    uint32_t slot = hash & mask;
+    while (slots[slot] != 0) {
+      if (valueList[slots[slot] - 1] == value)
+        return slots[slot] - 1;
+      slot = (slot + 1) & mask;
+    }
+    valueList.push_back(value);
+    slots[slot] = (uint32_t)valueList.size();
+    if (valueList.size() * 2 > slots.size())
+      rehash(slots.size() * 2);
+    return (uint32_t)valueList.size() - 1;
+  }
+  const T &get(uint32_t id) const { return valueList[id]; }
+  size_t size() const { return valueList.size(); }
+  size_t memoryUsage() const {
+    return valueList.capacity() * sizeof(T) +
+           slots.capacity() * sizeof(uint32_t);
+  }
+  /* Id 0 is always the default constructed value */
+  void clear() {
+    valueList.clear();
+    slots.assign(16, 0);
+    intern(T());
+  }
+
+private:
+  void rehash(size_t slotTotal) {
+    slots.assign(slotTotal, 0);
+    uint32_t mask = (uint32_t)slotTotal - 1;
+    for (size_t i = 0; i < valueList.size(); i++) {
+      uint32_t slot = valueList[i].hash() & mask;
+      while (slots[slot] != 0)
+        slot = (slot + 1) & mask;
+      slots[slot] = (uint32_t)(i + 1);
+    }
+  }
+
+  std::vector<T> valueList;
+  std::vector<uint32_t> slots;
+};
+
+/* Character formatting. Every field can be unset so the same type serves
+ * direct formatting and style definitions.
+ */
+class RunProperties {
+public:
+  enum Flag : uint8_t {
+    bold = 1 << 0,
+    italic = 1 << 1,
+    underline = 1 << 2,
+    strike = 1 << 3,
+    vanish = 1 << 4,
+    caps = 1 << 5,
+    superscript = 1 << 6,
+    subscript = 1 << 7
+  };
+  // StringPool ids, 0 when unset
+  uint32_t styleId = 0, fontId = 0;
+  uint32_t color = colorAuto;
+  // font size in half points, 0 when unset
+  uint16_t halfPoints = 0;
+  uint8_t flags = 0, flagsSet = 0;
+  bool colorSet = false;
+
+  void setFlag(uint8_t flag, bool value) {
+    flagsSet |= flag;
+    flags = value ? (flags | flag) : (flags & ~flag);
+  }
+  /* Takes every field set in other, styleId excepted */
+  void apply(const RunProperties &other);
+  bool operator==(const RunProperties &other) const;
+  uint32_t hash() const;
+};
+
+/* Paragraph formatting, lengths are in twips (1/1440 inch) */
+class ParagraphProperties {
+public:
+  enum Justification : uint8_t { left, center, right, both, justificationUnset };
+  enum LineRule : uint8_t { lineAuto, lineExact, lineAtLeast };
+  enum Flag : uint8_t {
+    keepNext = 1 << 0,
+    keepLines = 1 << 1,
+    pageBreakBefore = 1 << 2,
+    widowControl = 1 << 3
+  };
+  uint32_t styleId = 0;
+  int32_t indentLeft = propertyUnset, indentRight = propertyUnset,
+          indentFirstLine = propertyUnset;
+  int32_t spacingBefore = propertyUnset, spacingAfter = propertyUnset,
+          spacingLine = propertyUnset;
+  // numbering instance and level from w:numPr
+  int32_t numId = propertyUnset, numLevel = propertyUnset;
+  uint8_t justification = justificationUnset, lineRule = lineAuto;
+  uint8_t flags = 0, flagsSet = 0;
+
+  void setFlag(uint8_t flag, bool value) {
+    flagsSet |= flag;
+    flags = value ? (flags | flag) : (flags & ~flag);
+  }
+  /* Takes every field set in other, styleId excepted. lineRule goes with
+   * spacingLine.
+   */
+  void apply(const ParagraphProperties &other);
+  bool operator==(const ParagraphProperties &other) const;
+  uint32_t hash() const;
+};
+
+/* Text is a slice of DocumentModel::text. Tabs and breaks are stored as
+ * '\t', '\n' and '\f' (page break) so a run is always plain text.
+ */
+class DocumentRun {
+public:
+  uint32_t textOffset, textLength;
+  uint32_t propertiesId;
+  // DocumentModel::objectList index for drawings, documentNone for text
+  uint32_t objectIndex;
+  // DocumentModel::resolvedRunTable id, set by StyleSheet::resolve
+  uint32_t resolvedId;
+};
+
+class DocumentParagraph {
+public:
+  // [runBegin, runEnd) in DocumentModel::runList
+  uint32_t runBegin, runEnd;
+  uint32_t propertiesId;
+  // enclosing table cell, documentNone in the body
+  uint32_t cellIndex;
+  // DocumentModel::resolvedParagraphTable id, set by StyleSheet::resolve
+  uint32_t resolvedId;
+};
+
+class DocumentTable {
+public:
+  uint32_t paragraphBegin, paragraphEnd, cellBegin, cellEnd;
+  uint32_t rowCount, columnCount;
+  // enclosing cell for nested tables, documentNone otherwise
+  uint32_t parentCell;
+};
+
+class DocumentCell {
+public:
+  uint32_t tableIndex, row, column, columnSpan;
+  uint32_t paragraphBegin, paragraphEnd;
+  int32_t width;
+};
+
+class DocumentSection {
+public:
+  // paragraphs before paragraphEnd not in an earlier section
+  uint32_t paragraphEnd;
+  int32_t pageWidth = 12240, pageHeight = 15840;
+  int32_t marginTop = 1440, marginBottom = 1440, marginLeft = 1440,
+          marginRight = 1440, marginHeader = 720, marginFooter = 720;
+  // StringPool ids of the default header and footer relationship ids
+  uint32_t headerRelId = 0, footerRelId = 0;
+};
+
+/* Inline drawing, extents are in EMU (1/914400 inch) */
+class DocumentObject {
+public:
+  uint32_t relId;
+  int64_t width, height;
+};
+
+/* A w:style of word/styles.xml, ids are StringPool ids */
+class StyleDefinition {
+public:
+  enum Type : uint8_t { paragraph, character, table, numbering };
+  uint32_t styleId = 0, basedOn = 0;
+  uint8_t type = paragraph;
+  // w:default, the style of paragraphs or runs naming none
+  bool isDefault = false;
+  RunProperties runProperties;
+  ParagraphProperties paragraphProperties;
+};
+
+class DocumentModel;
+
+/* StyleSheet
+ * docDefaults and the styles of word/styles.xml. A run's formatting is
+ * docDefaults, then its paragraph's style and that style's basedOn chain,
+ * then its character style and chain, then direct formatting; a later
+ * level wins for every field it sets. resolve() does that walk once per
+ * distinct combination when the document is loaded, so layout reads
+ * effective formatting by id.
+ */
+class StyleSheet {
+public:
+  RunProperties runDefaults;
+  ParagraphProperties paragraphDefaults;
+  std::vector<StyleDefinition> styleList;
+
+  /* Rebuilds the lookup, call after styleList changes */
+  void index();
+  /* @return nullptr if styleId is not defined */
+  const StyleDefinition *find(uint32_t styleId) const;
+  /* The walk for a single run or paragraph, each call follows the chains
+   * again
+   */
+  RunProperties resolveRun(const ParagraphProperties &paragraphDirect,
+                           const RunProperties &runDirect) const;
+  ParagraphProperties
+  resolveParagraph(const ParagraphProperties &paragraphDirect) const;
+  /* Fills the model's resolved tables and every resolvedId. Resolved
+   * properties have styleId 0 so identical formatting from different
+   * styles is stored once.
+   */
+  void resolve(DocumentModel &model) const;
+  void clear();
+
+private:
+  /* The chain starting at styleId, most derived first */
+  size_t chain(uint32_t styleId, uint8_t type,
+               const StyleDefinition **chainList) const;
+  uint32_t defaultStyle(uint8_t type) const;
+
+  std::unordered_map<uint32_t, uint32_t> styleIndexMap;
+  uint32_t defaultParagraphStyle = 0, defaultCharacterStyle = 0;
+};
+
+/* DocumentModel
+ * Flat arrays instead of a node per element. Paragraphs, runs, tables and
+ * sections index into each other and all text lives in one buffer, so the
+ * model is a small multiple of the document's text size.
+ */
+class DocumentModel {
+public:
+  std::vector<DocumentParagraph> paragraphList;
+  std::vector<DocumentRun> runList;
+  std::vector<DocumentTable> tableList;
+  std::vector<DocumentCell> cellList;
+  std::vector<DocumentSection> sectionList;
+  std::vector<DocumentObject> objectList;
+  std::string text;
+  StringPool stringPool;
+  PropertyTable<RunProperties> runPropertiesTable;
+  PropertyTable<ParagraphProperties> paragraphPropertiesTable;
+  StyleSheet styleSheet;
+  // formatting after styles, what layout and rendering read
+  PropertyTable<RunProperties> resolvedRunTable;
+  PropertyTable<ParagraphProperties> resolvedParagraphTable;
+
+  const RunProperties &getRunProperties(const DocumentRun &run) const {
+    return resolvedRunTable.get(run.resolvedId);
+  }
+  const ParagraphProperties &
+  getParagraphProperties(const DocumentParagraph &paragraph) const {
+    return resolvedParagraphTable.get(paragraph.resolvedId);
+  }
+  std::string_view getText(const DocumentRun &run) const {
+    return std::string_view(text.data() + run.textOffset, run.textLength);
+  }
+  /* Bytes held by the model including unused capacity */
+  size_t memoryUsage() const;
+  void clear();
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_DOCUMENT_H
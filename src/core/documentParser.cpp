@@ -0,0 +1,621 @@
+// C++
+#include <algorithm>
+#include <charconv>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "documentParser.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const std::string_view wordNamespace =
+    "http://schemas.openxmlformats.org/wordprocessingml/2006/main";
+const std::string_view relNamespace =
+    "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+
+bool matchPrefixed(std::string_view name, std::string_view prefix,
+                   std::string_view local) {
+  return name.size() == prefix.size() + local.size() &&
+         name.compare(0, prefix.size(), prefix) == 0 &&
+         name.compare(prefix.size(), local.size(), local) == 0;
+}
+
+int32_t parseInt(std::string_view value) {
+  int32_t result = propertyUnset;
+  if (!value.empty() && value[0] == '+')
+    value.remove_prefix(1);
+  std::from_chars(value.data(), value.data() + value.size(), result);
+  return result;
+}
+
+uint32_t parseColor(std::string_view value) {
+  uint32_t result = colorAuto;
+  if (value.size() == 6)
+    std::from_chars(value.data(), value.data() + 6, result, 16);
+  return result;
+}
+
+std::string_view afterColon(std::string_view name) {
+  size_t colon = name.find(':');
+  return colon == std::string_view::npos ? name : name.substr(colon + 1);
+}
+
+int64_t parseStylePoints(std::string_view style, std::string_view key) {
+  size_t keyPos = style.find(key);
+  if (keyPos == std::string_view::npos)
+    return 0;
+  std::string_view value = style.substr(keyPos + key.size());
+  double points = 0;
+  const char *valueEnd = value.data() + value.size();
+  auto result = std::from_chars(value.data(), valueEnd, points);
+  std::string_view unit(result.ptr, std::min<size_t>(2, valueEnd - result.ptr));
+  if (unit == "in")
+    points *= 72;
+  else if (unit == "px")
+    points *= 0.75;
+  return (int64_t)points;
+}
+
+} // namespace
+
+DocumentParser::DocumentParser() {}
+
+int32_t DocumentParser::parse(ZipInflateStream &stream, DocumentModel &model) {
+  XmlReader xmlReader;
+  xmlReader.open(
+      [&stream](std::string_view &chunk) { return stream.read(chunk); });
+  return parse(xmlReader, model);
+}
+
+int32_t DocumentParser::parse(XmlReader &reader_, DocumentModel &model_) {
+  reader = &reader_;
+  model = &model_;
+  scanKernel = &xmlScanKernel();
+  wordPrefix = "w:";
+  relPrefix = "r:";
+  skipDepth = 0;
+  inParagraph = inParagraphProperties = inRun = inRunProperties = inText =
+      inSectionProperties = inDrawing = sectionPending = false;
+  tableStack.clear();
+  cellStack.clear();
+
+  int32_t err;
+  while ((err = reader->next()) == MZ_OK) {
+    if (skipDepth != 0) {
+      if (reader->getEvent() == XmlEvent::EndElement &&
+          reader->getDepth() < skipDepth)
+        skipDepth = 0;
+      continue;
+    }
+    switch (reader->getEvent()) {
+    case XmlEvent::StartElement:
+      startElement();
+      break;
+    case XmlEvent::EndElement:
+      endElement();
+      break;
+    case XmlEvent::Text:
+      if (inText) {
+        if (reader->isCData())
+          model->text.append(reader->getText());
+        else
+          xmlUnescape(reader->getText(), model->text);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  // content after the last section break belongs to a default section
+  if (model->sectionList.empty() ||
+      model->sectionList.back().paragraphEnd < model->paragraphList.size()) {
+    DocumentSection lastSection;
+    lastSection.paragraphEnd = (uint32_t)model->paragraphList.size();
+    model->sectionList.push_back(lastSection);
+  }
+  model->styleSheet.resolve(*model);
+  return err == MZ_END_OF_STREAM ? MZ_OK : err;
+}
+
+int32_t DocumentParser::parseStyles(XmlReader &reader_, DocumentModel &model_) {
+  reader = &reader_;
+  model = &model_;
+  wordPrefix = "w:";
+  relPrefix = "r:";
+  skipDepth = 0;
+  inRunProperties = inParagraphProperties = inStyle = false;
+  model->styleSheet.clear();
+
+  int32_t err;
+  while ((err = reader->next()) == MZ_OK) {
+    if (skipDepth != 0) {
+      if (reader->getEvent() == XmlEvent::EndElement &&
+          reader->getDepth() < skipDepth)
+        skipDepth = 0;
+      continue;
+    }
+    if (reader->getEvent() == XmlEvent::StartElement)
+      styleStartElement();
+    else if (reader->getEvent() == XmlEvent::EndElement)
+      styleEndElement();
+  }
+  model->styleSheet.index();
+  return err == MZ_END_OF_STREAM ? MZ_OK : err;
+}
+
+std::string_view DocumentParser::wordLocal(std::string_view name) const {
+  if (wordPrefix.empty())
+    return name.find(':') == std::string_view::npos ? name
+                                                    : std::string_view();
+  if (name.size() > wordPrefix.size() &&
+      name.compare(0, wordPrefix.size(), wordPrefix) == 0)
+    return name.substr(wordPrefix.size());
+  return std::string_view();
+}
+
+std::string_view DocumentParser::wordAttribute(std::string_view local) const {
+  for (const XmlAttribute &attribute : reader->getAttributes()) {
+    if (matchPrefixed(attribute.name, wordPrefix, local))
+      return attribute.value;
+  }
+  return std::string_view();
+}
+
+std::string_view DocumentParser::relAttribute(std::string_view local) const {
+  for (const XmlAttribute &attribute : reader->getAttributes()) {
+    if (matchPrefixed(attribute.name, relPrefix, local))
+      return attribute.value;
+  }
+  return std::string_view();
+}
+
+bool DocumentParser::wordOnOff() const {
+  std::string_view value = wordAttribute("val");
+  return !(value == "0" || value == "false" || value == "off");
+}
+
+int32_t DocumentParser::wordInt(std::string_view local) const {
+  return parseInt(wordAttribute(local));
+}
+
+void DocumentParser::flushRunText() {
+  if (model->text.size() == runTextStart)
+    return;
+  // the whole run at once, a Text event may end inside a sequence
+  if (!scanKernel->validUtf8(model->text.data() + runTextStart,
+                             model->text.size() - runTextStart))
+    utf8Repair(model->text, runTextStart);
+  uint32_t textEnd = (uint32_t)model->text.size();
+  if (runPropertiesId == documentNone)
+    runPropertiesId = model->runPropertiesTable.intern(runProperties);
+  // resolvedId stays unset until StyleSheet::resolve
+  model->runList.push_back({runTextStart, textEnd - runTextStart,
+                            runPropertiesId, documentNone, documentNone});
+  runTextStart = textEnd;
+}
+
+void DocumentParser::rootElement() {
+  // find the prefixes bound to the namespaces we read
+  for (const XmlAttribute &attribute : reader->getAttributes()) {
+    std::string prefix;
+    if (attribute.name == "xmlns")
+      prefix = "";
+    else if (attribute.name.compare(0, 6, "xmlns:") == 0)
+      prefix = std::string(attribute.name.substr(6)) + ":";
+    else
+      continue;
+    if (attribute.value == wordNamespace)
+      wordPrefix = prefix;
+    else if (attribute.value == relNamespace)
+      relPrefix = prefix;
+  }
+}
+
+void DocumentParser::startElement() {
+  std::string_view name = reader->getName();
+  if (reader->getDepth() == 1) {
+    rootElement();
+    return;
+  }
+
+  std::string_view local = wordLocal(name);
+  if (local.empty()) {
+    if (name == "mc:Fallback") {
+      // the preceding mc:Choice holds the same content
+      skipDepth = reader->getDepth();
+    } else if (inDrawing) {
+      std::string_view drawingLocal = afterColon(name);
+      if (drawingLocal == "extent") {
+        std::string_view cx, cy;
+        for (const XmlAttribute &attribute : reader->getAttributes()) {
+          if (attribute.name == "cx")
+            cx = attribute.value;
+          else if (attribute.name == "cy")
+            cy = attribute.value;
+        }
+        std::from_chars(cx.data(), cx.data() + cx.size(), object.width);
+        std::from_chars(cy.data(), cy.data() + cy.size(), object.height);
+      } else if (drawingLocal == "blip") {
+        object.relId = model->stringPool.intern(relAttribute("embed"));
+      } else if (drawingLocal == "shape") {
+        // VML, the size is in the CSS style: "width:468pt;height:276pt"
+        std::string_view style;
+        for (const XmlAttribute &attribute : reader->getAttributes()) {
+          if (attribute.name == "style")
+            style = attribute.value;
+        }
+        object.width = parseStylePoints(style, "width:") * 12700;
+        object.height = parseStylePoints(style, "height:") * 12700;
+      } else if (drawingLocal == "imagedata") {
+        object.relId = model->stringPool.intern(relAttribute("id"));
+      }
+    }
+    return;
+  }
+
+  if (local == "p") {
+    if (inParagraph)
+      return;
+    inParagraph = true;
+    paragraph.runBegin = (uint32_t)model->runList.size();
+    paragraph.cellIndex = cellStack.empty() ? documentNone : cellStack.back();
+    paragraphProperties = ParagraphProperties();
+  } else if (local == "pPr") {
+    if (inParagraph && !inRun)
+      inParagraphProperties = true;
+  } else if (local == "r") {
+    if (!inParagraph || inRun)
+      return;
+    inRun = true;
+    runProperties = RunProperties();
+    runPropertiesId = documentNone;
+    runTextStart = (uint32_t)model->text.size();
+  } else if (local == "rPr") {
+    if (inRun)
+      inRunProperties = true;
+    else
+      skipDepth = reader->getDepth(); // paragraph mark formatting
+  } else if (local == "pPrChange" || local == "rPrChange" ||
+             local == "sectPrChange" || local == "txbxContent" ||
+             local == "del") {
+    // revisions, deleted text and text boxes are not body text
+    skipDepth = reader->getDepth();
+  } else if (local == "t") {
+    inText = inRun;
+  } else if (local == "tab" && inRun && !inRunProperties) {
+    model->text.push_back('\t');
+  } else if (local == "br" && inRun) {
+    model->text.push_back(wordAttribute("type") == "page" ? '\f' : '\n');
+  } else if (local == "cr" && inRun) {
+    model->text.push_back('\n');
+  } else if (local == "noBreakHyphen" && inRun) {
+    model->text.push_back('-');
+  } else if (local == "softHyphen" && inRun) {
+    model->text.append("\xC2\xAD");
+  } else if (local == "drawing" || local == "pict") {
+    if (inRun) {
+      inDrawing = true;
+      object = DocumentObject{0, 0, 0};
+    }
+  } else if (local == "tbl") {
+    TableState state{(uint32_t)model->tableList.size(), 0, 0};
+    DocumentTable table;
+    table.paragraphBegin = (uint32_t)model->paragraphList.size();
+    table.paragraphEnd = table.paragraphBegin;
+    table.cellBegin = table.cellEnd = (uint32_t)model->cellList.size();
+    table.rowCount = table.columnCount = 0;
+    table.parentCell = cellStack.empty() ? documentNone : cellStack.back();
+    model->tableList.push_back(table);
+    tableStack.push_back(state);
+  } else if (local == "tr") {
+    if (tableStack.empty())
+      return;
+    TableState &state = tableStack.back();
+    state.row = model->tableList[state.tableIndex].rowCount++;
+    state.column = 0;
+  } else if (local == "tc") {
+    if (tableStack.empty())
+      return;
+    TableState &state = tableStack.back();
+    DocumentCell cell;
+    cell.tableIndex = state.tableIndex;
+    cell.row = state.row;
+    cell.column = state.column;
+    cell.columnSpan = 1;
+    cell.paragraphBegin = cell.paragraphEnd =
+        (uint32_t)model->paragraphList.size();
+    cell.width = 0;
+    cellStack.push_back((uint32_t)model->cellList.size());
+    model->cellList.push_back(cell);
+  } else if (local == "tcW") {
+    if (!cellStack.empty())
+      model->cellList[cellStack.back()].width = wordInt("w");
+  } else if (local == "gridSpan") {
+    int32_t span = wordInt("val");
+    if (!cellStack.empty() && span > 1)
+      model->cellList[cellStack.back()].columnSpan = (uint32_t)span;
+  } else if (local == "sectPr") {
+    inSectionProperties = true;
+    section = DocumentSection();
+  } else if (inSectionProperties) {
+    sectionProperty(local);
+  } else if (inRunProperties) {
+    runProperty(local);
+  } else if (inParagraphProperties) {
+    paragraphProperty(local);
+  }
+}
+
+void DocumentParser::endElement() {
+  std::string_view local = wordLocal(reader->getName());
+  if (local.empty())
+    return;
+  if (local == "p") {
+    if (!inParagraph)
+      return;
+    inParagraph = false;
+    paragraph.runEnd = (uint32_t)model->runList.size();
+    paragraph.propertiesId =
+        model->paragraphPropertiesTable.intern(paragraphProperties);
+    model->paragraphList.push_back(paragraph);
+    if (sectionPending) {
+      // a section break in pPr ends its section with this paragraph
+      section.paragraphEnd = (uint32_t)model->paragraphList.size();
+      model->sectionList.push_back(section);
+      sectionPending = false;
+    }
+  } else if (local == "pPr") {
+    inParagraphProperties = false;
+  } else if (local == "r") {
+    if (!inRun)
+      return;
+    flushRunText();
+    inRun = inText = inRunProperties = false;
+  } else if (local == "rPr") {
+    inRunProperties = false;
+  } else if (local == "t") {
+    inText = false;
+  } else if (local == "drawing" || local == "pict") {
+    if (!inDrawing)
+      return;
+    inDrawing = false;
+    flushRunText();
+    if (runPropertiesId == documentNone)
+      runPropertiesId = model->runPropertiesTable.intern(runProperties);
+    model->runList.push_back({(uint32_t)model->text.size(), 0, runPropertiesId,
+                              (uint32_t)model->objectList.size(),
+                              documentNone});
+    model->objectList.push_back(object);
+  } else if (local == "tc") {
+    if (cellStack.empty() || tableStack.empty())
+      return;
+    DocumentCell &cell = model->cellList[cellStack.back()];
+    cell.paragraphEnd = (uint32_t)model->paragraphList.size();
+    TableState &state = tableStack.back();
+    state.column += cell.columnSpan;
+    DocumentTable &table = model->tableList[state.tableIndex];
+    table.columnCount = std::max(table.columnCount, state.column);
+    cellStack.pop_back();
+  } else if (local == "tbl") {
+    if (tableStack.empty())
+      return;
+    DocumentTable &table = model->tableList[tableStack.back().tableIndex];
+    table.paragraphEnd = (uint32_t)model->paragraphList.size();
+    table.cellEnd = (uint32_t)model->cellList.size();
+    tableStack.pop_back();
+  } else if (local == "sectPr") {
+    if (!inSectionProperties)
+      return;
+    inSectionProperties = false;
+    if (inParagraphProperties) {
+      sectionPending = true;
+    } else {
+      section.paragraphEnd = (uint32_t)model->paragraphList.size();
+      model->sectionList.push_back(section);
+    }
+  }
+}
+
+void DocumentParser::styleStartElement() {
+  if (reader->getDepth() == 1) {
+    rootElement();
+    return;
+  }
+  std::string_view local = wordLocal(reader->getName());
+  if (local.empty()) {
+    if (reader->getName() == "mc:Fallback")
+      skipDepth = reader->getDepth();
+    return;
+  }
+  if (local == "docDefaults") {
+    runProperties = RunProperties();
+    paragraphProperties = ParagraphProperties();
+  } else if (local == "style") {
+    inStyle = true;
+    style = StyleDefinition();
+    std::string_view type = wordAttribute("type");
+    if (type == "character")
+      style.type = StyleDefinition::character;
+    else if (type == "table")
+      style.type = StyleDefinition::table;
+    else if (type == "numbering")
+      style.type = StyleDefinition::numbering;
+    style.styleId = model->stringPool.intern(wordAttribute("styleId"));
+    std::string_view isDefault = wordAttribute("default");
+    style.isDefault = isDefault == "1" || isDefault == "true" ||
+                      isDefault == "on";
+    runProperties = RunProperties();
+    paragraphProperties = ParagraphProperties();
+  } else if (local == "basedOn") {
+    if (inStyle)
+      style.basedOn = model->stringPool.intern(wordAttribute("val"));
+  } else if (local == "tblStylePr" || local == "tblPr" || local == "trPr" ||
+             local == "tcPr" || local == "latentStyles") {
+    // conditional table formatting is not applied
+    skipDepth = reader->getDepth();
+  } else if (local == "rPr") {
+    inRunProperties = true;
+  } else if (local == "pPr") {
+    inParagraphProperties = true;
+  } else if (inRunProperties) {
+    runProperty(local);
+  } else if (inParagraphProperties) {
+    paragraphProperty(local);
+  }
+}
+
+void DocumentParser::styleEndElement() {
+  std::string_view local = wordLocal(reader->getName());
+  StyleSheet &styleSheet = model->styleSheet;
+  if (local == "rPr") {
+    inRunProperties = false;
+  } else if (local == "pPr") {
+    inParagraphProperties = false;
+  } else if (local == "style") {
+    if (!inStyle)
+      return;
+    inStyle = false;
+    style.runProperties = runProperties;
+    style.paragraphProperties = paragraphProperties;
+    styleSheet.styleList.push_back(style);
+  } else if (local == "docDefaults") {
+    styleSheet.runDefaults = runProperties;
+    styleSheet.paragraphDefaults = paragraphProperties;
+  }
+}
+
+void DocumentParser::runProperty(std::string_view local) {
+  if (local == "rStyle") {
+    runProperties.styleId = model->stringPool.intern(wordAttribute("val"));
+  } else if (local == "b") {
+    runProperties.setFlag(RunProperties::bold, wordOnOff());
+  } else if (local == "i") {
+    runProperties.setFlag(RunProperties::italic, wordOnOff());
+  } else if (local == "u") {
+    std::string_view value = wordAttribute("val");
+    runProperties.setFlag(RunProperties::underline,
+                          value != "none" && value != "0");
+  } else if (local == "strike" || local == "dstrike") {
+    runProperties.setFlag(RunProperties::strike, wordOnOff());
+  } else if (local == "vanish") {
+    runProperties.setFlag(RunProperties::vanish, wordOnOff());
+  } else if (local == "caps") {
+    runProperties.setFlag(RunProperties::caps, wordOnOff());
+  } else if (local == "vertAlign") {
+    std::string_view value = wordAttribute("val");
+    runProperties.setFlag(RunProperties::superscript, value == "superscript");
+    runProperties.setFlag(RunProperties::subscript, value == "subscript");
+  } else if (local == "sz") {
+    int32_t halfPoints = wordInt("val");
+    if (halfPoints > 0 && halfPoints < 0xFFFF)
+      runProperties.halfPoints = (uint16_t)halfPoints;
+  } else if (local == "rFonts") {
+    std::string_view font = wordAttribute("ascii");
+    if (font.empty())
+      font = wordAttribute("hAnsi");
+    if (!font.empty())
+      runProperties.fontId = model->stringPool.intern(font);
+  } else if (local == "color") {
+    runProperties.color = parseColor(wordAttribute("val"));
+    runProperties.colorSet = true;
+  }
+}
+
+void DocumentParser::paragraphProperty(std::string_view local) {
+  ParagraphProperties &pp = paragraphProperties;
+  if (local == "pStyle") {
+    pp.styleId = model->stringPool.intern(wordAttribute("val"));
+  } else if (local == "jc") {
+    std::string_view value = wordAttribute("val");
+    if (value == "left" || value == "start")
+      pp.justification = ParagraphProperties::left;
+    else if (value == "center")
+      pp.justification = ParagraphProperties::center;
+    else if (value == "right" || value == "end")
+      pp.justification = ParagraphProperties::right;
+    else if (value == "both" || value == "distribute")
+      pp.justification = ParagraphProperties::both;
+  } else if (local == "spacing") {
+    int32_t value;
+    if ((value = wordInt("before")) != propertyUnset)
+      pp.spacingBefore = value;
+    if ((value = wordInt("after")) != propertyUnset)
+      pp.spacingAfter = value;
+    if ((value = wordInt("line")) != propertyUnset)
+      pp.spacingLine = value;
+    std::string_view rule = wordAttribute("lineRule");
+    if (rule == "exact")
+      pp.lineRule = ParagraphProperties::lineExact;
+    else if (rule == "atLeast")
+      pp.lineRule = ParagraphProperties::lineAtLeast;
+  } else if (local == "ind") {
+    int32_t value;
+    if ((value = wordInt("left")) != propertyUnset ||
+        (value = wordInt("start")) != propertyUnset)
+      pp.indentLeft = value;
+    if ((value = wordInt("right")) != propertyUnset ||
+        (value = wordInt("end")) != propertyUnset)
+      pp.indentRight = value;
+    if ((value = wordInt("firstLine")) != propertyUnset)
+      pp.indentFirstLine = value;
+    if ((value = wordInt("hanging")) != propertyUnset)
+      pp.indentFirstLine = -value;
+  } else if (local == "keepNext") {
+    pp.setFlag(ParagraphProperties::keepNext, wordOnOff());
+  } else if (local == "keepLines") {
+    pp.setFlag(ParagraphProperties::keepLines, wordOnOff());
+  } else if (local == "pageBreakBefore") {
+    pp.setFlag(ParagraphProperties::pageBreakBefore, wordOnOff());
+  } else if (local == "widowControl") {
+    pp.setFlag(ParagraphProperties::widowControl, wordOnOff());
+  } else if (local == "ilvl") {
+    pp.numLevel = wordInt("val");
+  } else if (local == "numId") {
+    pp.numId = wordInt("val");
+  }
+}
+
+void DocumentParser::sectionProperty(std::string_view local) {
+  int32_t value;
+  if (local == "pgSz") {
+    if ((value = wordInt("w")) > 0)
+      section.pageWidth = value;
+    if ((value = wordInt("h")) > 0)
+      section.pageHeight = value;
+  } else if (local == "pgMar") {
+    if ((value = wordInt("top")) != propertyUnset)
+      section.marginTop = value;
+    if ((value = wordInt("bottom")) != propertyUnset)
+      section.marginBottom = value;
+    if ((value = wordInt("left")) != propertyUnset)
+      section.marginLeft = value;
+    if ((value = wordInt("right")) != propertyUnset)
+      section.marginRight = value;
+    if ((value = wordInt("header")) != propertyUnset)
+      section.marginHeader = value;
+    if ((value = wordInt("footer")) != propertyUnset)
+      section.marginFooter = value;
+  } else if (local == "headerReference" || local == "footerReference") {
+    std::string_view type = wordAttribute("type");
+    if (!type.empty() && type != "default")
+      return;
+    uint32_t relId = model->stringPool.intern(relAttribute("id"));
+    if (local == "headerReference")
+      section.headerRelId = relId;
+    else
+      section.footerRelId = relId;
+  }
+}
+
+} // namespace bookfiler
@@ -0,0 +1,87 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_DOCUMENT_PARSER_H
+#define BOOKFILER_MODULE_DOCX_DOCUMENT_PARSER_H
+
+// C++
+#include <string>
+#include <vector>
+
+// Local Project
+#include "document.hpp"
+#include "xmlReader.hpp"
+#include "zipStream.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* DocumentParser
+ * Builds a DocumentModel from the events of word/document.xml in a single
+ * pass. Only the state of the innermost paragraph, run and table is kept,
+ * nothing is buffered per element. The main namespace prefix is taken from
+ * the root element so documents not using "w:" still parse. Malformed
+ * UTF-8 in run text is replaced with U+FFFD. word/styles.xml is read with
+ * the same property handling; parse styles first, parse() resolves the
+ * document against model.styleSheet when it finishes.
+ */
+class DocumentParser {
+public:
+  DocumentParser();
+  /* @return MZ_OK or the reader's error */
+  int32_t parse(XmlReader &reader, DocumentModel &model);
+  int32_t parse(ZipInflateStream &stream, DocumentModel &model);
+  /* Replaces model.styleSheet with the styles part read from reader */
+  int32_t parseStyles(XmlReader &reader, DocumentModel &model);
+
+private:
+  void rootElement();
+  void startElement();
+  void endElement();
+  void styleStartElement();
+  void styleEndElement();
+  void runProperty(std::string_view local);
+  void paragraphProperty(std::string_view local);
+  void sectionProperty(std::string_view local);
+  void flushRunText();
+  std::string_view wordLocal(std::string_view name) const;
+  std::string_view wordAttribute(std::string_view local) const;
+  std::string_view relAttribute(std::string_view local) const;
+  bool wordOnOff() const;
+  int32_t wordInt(std::string_view local) const;
+
+  class TableState {
+  public:
+    uint32_t tableIndex, row, column;
+  };
+
+  XmlReader *reader = nullptr;
+  DocumentModel *model = nullptr;
+  const XmlScanKernel *scanKernel = nullptr;
+  std::string wordPrefix, relPrefix;
+  // depth of an element whose subtree is ignored, 0 when not skipping
+  size_t skipDepth = 0;
+  bool inParagraph = false, inParagraphProperties = false, inRun = false,
+       inRunProperties = false, inText = false, inSectionProperties = false,
+       inDrawing = false, sectionPending = false, inStyle = false;
+  DocumentParagraph paragraph;
+  ParagraphProperties paragraphProperties;
+  RunProperties runProperties;
+  uint32_t runPropertiesId = documentNone, runTextStart = 0;
+  DocumentSection section;
+  DocumentObject object;
+  StyleDefinition style;
+  std::vector<TableState> tableStack;
+  std::vector<uint32_t> cellStack;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_DOCUMENT_PARSER_H
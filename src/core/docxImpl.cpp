@@ -0,0 +1,660 @@
+// C++
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// Local Project
+#include "docxImpl.hpp"
+#include "documentParser.hpp"
+#include "bufferPool.hpp"
+#include "mediaCache.hpp"
+#include "rasterizer.hpp"
+#include "xmlReader.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+/* A layout and the model it points into, shared as one */
+class LayoutHolder {
+public:
+  LayoutHolder(std::shared_ptr<const DocumentModel> model_,
+               LayoutOptions options)
+      : model(std::move(model_)), layout(*model, options) {}
+  std::shared_ptr<const DocumentModel> model;
+  DocumentLayout layout;
+};
+
+std::atomic<uint64_t> editTotal{0};
+
+} // namespace
+
+DocxImpl::DocxImpl() {
+  auto archive = std::make_shared<DocxArchive>();
+  archive->metrics = std::make_shared<DocumentMetrics>();
+  archive->documentRelationships = std::make_shared<OpcRelationshipList>();
+  auto initial = std::make_shared<DocxSnapshot>();
+  initial->archive = archive;
+  snapshot = initial;
+  memoryAccountant().addDocument(this);
+}
+
+DocxImpl::~DocxImpl() {
+  // first, the accountant may be releasing from this document
+  memoryAccountant().removeDocument(this);
+  setCharge(modelCharge, 0);
+  setCharge(layoutCharge, 0);
+}
+
+int32_t DocxImpl::openFile(std::string fileName_) {
+  // read while the old document is still served, nobody sees it until it
+  // is published
+  auto archive = std::make_shared<DocxArchive>();
+  archive->fileName = fileName_;
+  archive->metrics = std::make_shared<DocumentMetrics>();
+  archive->documentRelationships = std::make_shared<OpcRelationshipList>();
+  archive->zipReader = std::make_shared<ZipReader>();
+  archive->zipReader->setMetrics(archive->metrics);
+  archive->err = archive->zipReader->open(fileName_);
+  archive->contentHash = archive->zipReader->getIndex().getContentHash();
+  if (archive->err == MZ_OK && diskCache().isEnabled()) {
+    archive->cacheEntry = diskCache().find(archive->contentHash);
+    if (archive->cacheEntry)
+      BOOKFILER_TRACE_ADD(archive->metrics, cacheHits, 1);
+    else
+      BOOKFILER_TRACE_ADD(archive->metrics, cacheMisses, 1);
+  }
+  if (archive->err == MZ_OK && !archive->cacheEntry)
+    archive->err = archive->openPackage();
+  {
+    std::lock_guard<std::mutex> lock(partMutex);
+    replacementMap.clear();
+  }
+  auto next = std::make_shared<DocxSnapshot>();
+  next->archive = archive;
+  {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    publish(next);
+  }
+  return archive->err;
+}
+
+int32_t DocxArchive::openPackage() {
+  if (packageOpen.load(std::memory_order_acquire))
+    return packageErr;
+  std::lock_guard<std::mutex> lock(packageMutex);
+  if (packageOpen)
+    return packageErr;
+  if (!zipReader)
+    return MZ_PARAM_ERROR;
+  packageErr = package.open(zipReader);
+  if (packageErr == MZ_OK) {
+    std::shared_ptr<const OpcRelationshipList> relationships;
+    packageErr =
+        package.getRelationships(package.getMainPartName(), relationships);
+    if (packageErr == MZ_OK)
+      documentRelationships = relationships;
+  }
+  // failures stick until the next openFile, as they did when eager
+  packageOpen.store(true, std::memory_order_release);
+  return packageErr;
+}
+
+void DocxImpl::publish(std::shared_ptr<const DocxSnapshot> next) {
+  setCharge(modelCharge, next->model ? next->model->memoryUsage() : 0);
+  setCharge(layoutCharge, next->layout ? next->layout->memoryUsage() : 0);
+  std::atomic_store_explicit(&snapshot, std::move(next),
+                             std::memory_order_release);
+}
+
+int32_t DocxImpl::parseModel(DocxArchive &archive,
+                             DocumentModel &parsedModel) {
+  int32_t parseErr = archive.openPackage();
+  if (parseErr != MZ_OK)
+    return parseErr;
+  // streamed, the main part is not kept inflated
+  ZipInflateStream stream;
+  parseErr = archive.zipReader->openStream(archive.package.getMainPartName(),
+                                           stream);
+  if (parseErr != MZ_OK)
+    return parseErr;
+  DocumentParser parser;
+  // styles first, the document is resolved against them as it finishes
+  std::shared_ptr<const ZipPart> stylesPart;
+  if (getDocumentPart(archive, "styles", stylesPart) == MZ_OK) {
+    XmlReader stylesReader;
+    stylesReader.open(stylesPart->data);
+    // a broken styles part leaves the document unstyled, not unreadable
+    if (parser.parseStyles(stylesReader, parsedModel) != MZ_OK)
+      parsedModel.styleSheet.clear();
+  }
+  return parser.parse(stream, parsedModel);
+}
+
+int32_t DocxImpl::getModel(std::shared_ptr<const DocumentModel> &model_) {
+  std::shared_ptr<const DocxSnapshot> current;
+  int32_t modelErr = loadModel(current);
+  if (modelErr == MZ_OK)
+    model_ = current->model;
+  return modelErr;
+}
+
+int32_t DocxImpl::loadModel(std::shared_ptr<const DocxSnapshot> &current) {
+  touch();
+  current = loadSnapshot();
+  if (current->model)
+    return MZ_OK;
+  std::unique_lock<std::mutex> buildLock(modelMutex);
+  // built while this thread waited
+  current = loadSnapshot();
+  if (current->model)
+    return MZ_OK;
+  DocxArchive &archive = *current->archive;
+  if (!archive.zipReader)
+    return MZ_PARAM_ERROR;
+  BOOKFILER_TRACE_SPAN(Parse, archive.metrics);
+  auto parsedModel = std::make_shared<DocumentModel>();
+  int32_t parseErr = MZ_END_OF_LIST;
+  if (std::shared_ptr<const DiskCacheEntry> entry = archive.getCacheEntry()) {
+    parseErr = entry->loadModel(*parsedModel);
+    if (parseErr != MZ_OK) {
+      diskCache().discard(entry->getContentHash());
+      archive.dropCacheEntry();
+    }
+  }
+  if (parseErr != MZ_OK)
+    parseErr = parseModel(archive, *parsedModel);
+  if (parseErr != MZ_OK)
+    return parseErr;
+  BOOKFILER_TRACE_RAISE(archive.metrics, arenaPeakBytes,
+                        parsedModel->memoryUsage());
+  {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::shared_ptr<const DocxSnapshot> latest = loadSnapshot();
+    // unless openFile or updateModel got there first, then only the caller
+    // gets the model of the document it asked about
+    bool publishable = latest->archive == current->archive && !latest->model;
+    auto next =
+        std::make_shared<DocxSnapshot>(publishable ? *latest : *current);
+    next->model = parsedModel;
+    if (publishable)
+      publish(next);
+    current = next;
+  }
+  buildLock.unlock();
+  memoryAccountant().enforce(this);
+  return MZ_OK;
+}
+
+int32_t DocxImpl::extractText(const text_paragraph_cb_t &callback) {
+  std::shared_ptr<DocxArchive> archive = loadSnapshot()->archive;
+  if (!archive->zipReader)
+    return MZ_PARAM_ERROR;
+  int32_t extractErr = archive->openPackage();
+  if (extractErr != MZ_OK)
+    return extractErr;
+  BOOKFILER_TRACE_SPAN(Parse, archive->metrics);
+  ZipInflateStream stream;
+  extractErr = archive->zipReader->openStream(
+      archive->package.getMainPartName(), stream);
+  if (extractErr != MZ_OK)
+    return extractErr;
+  TextExtractor extractor;
+  return extractor.extract(stream, callback);
+}
+
+int32_t DocxImpl::updateModel(std::shared_ptr<const DocumentModel> edited,
+                              const std::vector<uint32_t> &dirtyParagraphList) {
+  // no layout is built meanwhile, the incremental one starts from this
+  std::lock_guard<std::mutex> layoutLock(layoutMutex);
+  std::shared_ptr<const DocxSnapshot> current = loadSnapshot();
+  if (!current->archive->zipReader || !edited)
+    return MZ_PARAM_ERROR;
+  const std::shared_ptr<DocumentMetrics> &metrics = current->archive->metrics;
+  BOOKFILER_TRACE_RAISE(metrics, arenaPeakBytes, edited->memoryUsage());
+  std::shared_ptr<const DocumentLayout> editedLayout;
+  if (current->layout) {
+    BOOKFILER_TRACE_SPAN(Layout, metrics);
+    auto holder = std::make_shared<LayoutHolder>(
+        edited, current->layout->getOptions());
+    holder->layout.paginate(*current->layout, dirtyParagraphList);
+    editedLayout =
+        std::shared_ptr<const DocumentLayout>(holder, &holder->layout);
+    BOOKFILER_TRACE_RAISE(metrics, arenaPeakBytes,
+                          edited->memoryUsage() +
+                              holder->layout.memoryUsage());
+  }
+  std::lock_guard<std::mutex> lock(publishMutex);
+  std::shared_ptr<const DocxSnapshot> latest = loadSnapshot();
+  if (latest->archive != current->archive)
+    return MZ_PARAM_ERROR;
+  auto next = std::make_shared<DocxSnapshot>(*latest);
+  // never 0, distinct for every edit of every document, published with
+  // the model so whoever sees the edited model sees it too
+  next->editHash = (editTotal.fetch_add(1) + 1) * 0x9E3779B97F4A7C15ull;
+  next->model = edited;
+  next->layout = editedLayout;
+  publish(next);
+  return MZ_OK;
+}
+
+void DocxImpl::setPart(std::string partName, std::string data) {
+  if (!partName.empty() && partName[0] == '/')
+    partName.erase(0, 1);
+  std::lock_guard<std::mutex> lock(partMutex);
+  ZipReplacement &replacement = replacementMap[partName];
+  replacement.filePath = partName;
+  replacement.data = std::move(data);
+  replacement.remove = false;
+}
+
+void DocxImpl::removePart(std::string partName) {
+  if (!partName.empty() && partName[0] == '/')
+    partName.erase(0, 1);
+  std::lock_guard<std::mutex> lock(partMutex);
+  ZipReplacement &replacement = replacementMap[partName];
+  replacement.filePath = partName;
+  replacement.data.clear();
+  replacement.remove = true;
+}
+
+int32_t DocxImpl::save(ZipSink &sink) {
+  std::shared_ptr<ZipReader> zipReader = loadSnapshot()->archive->zipReader;
+  if (!zipReader || !zipReader->getIndex().isOpen())
+    return MZ_PARAM_ERROR;
+  std::vector<ZipReplacement> replacementList;
+  {
+    std::lock_guard<std::mutex> lock(partMutex);
+    for (const auto &replacementPair : replacementMap)
+      replacementList.push_back(replacementPair.second);
+  }
+  return zipRewrite(zipReader->getIndex(), replacementList, sink);
+}
+
+int32_t DocxImpl::saveFile(std::string fileName) {
+  std::filesystem::path path = std::filesystem::u8path(fileName);
+  std::filesystem::path partialPath = path;
+  partialPath += ".partial";
+  ZipFdSink sink;
+  int32_t saveErr = sink.open(partialPath.u8string());
+  if (saveErr != MZ_OK)
+    return saveErr;
+  saveErr = save(sink);
+  int32_t closeErr = sink.close();
+  if (saveErr == MZ_OK)
+    saveErr = closeErr;
+  std::error_code renameErr;
+  // the mapping of an opened target keeps the old file's contents alive
+  if (saveErr == MZ_OK)
+    std::filesystem::rename(partialPath, path, renameErr);
+  if (saveErr == MZ_OK && renameErr)
+    saveErr = MZ_WRITE_ERROR;
+  if (saveErr != MZ_OK)
+    std::filesystem::remove(partialPath, renameErr);
+  return saveErr;
+}
+
+int32_t DocxImpl::getRelatedPart(std::string_view relId,
+                                 std::shared_ptr<const ZipPart> &part) {
+  std::shared_ptr<DocxArchive> archive = loadSnapshot()->archive;
+  if (archive->openPackage() != MZ_OK)
+    return MZ_END_OF_LIST;
+  const OpcRelationship *relationship =
+      archive->documentRelationships->find(relId);
+  if (!relationship || relationship->external)
+    return MZ_END_OF_LIST;
+  touch();
+  int32_t partErr = archive->package.getPart(relationship->target, part);
+  memoryAccountant().enforce(this);
+  return partErr;
+}
+
+int32_t DocxImpl::getDocumentPart(std::string_view kind,
+                                  std::shared_ptr<const ZipPart> &part) {
+  return getDocumentPart(*loadSnapshot()->archive, kind, part);
+}
+
+int32_t DocxImpl::getDocumentPart(DocxArchive &archive,
+                                  std::string_view kind,
+                                  std::shared_ptr<const ZipPart> &part) {
+  if (archive.openPackage() != MZ_OK)
+    return MZ_END_OF_LIST;
+  const OpcRelationship *relationship =
+      archive.documentRelationships->findKind(kind);
+  if (!relationship || relationship->external)
+    return MZ_END_OF_LIST;
+  touch();
+  int32_t partErr = archive.package.getPart(relationship->target, part);
+  memoryAccountant().enforce(this);
+  return partErr;
+}
+
+int32_t DocxImpl::getPagesTotalStored(uint32_t &pageTotal) {
+  std::shared_ptr<DocxArchive> archive = loadSnapshot()->archive;
+  if (!archive->zipReader)
+    return MZ_PARAM_ERROR;
+  int32_t pageErr = archive->openPackage();
+  if (pageErr != MZ_OK)
+    return pageErr;
+  const OpcRelationship *relationship =
+      archive->package.getPackageRelationships().findKind(
+          "extended-properties");
+  std::string partName = relationship && !relationship->external
+                             ? std::string(relationship->target)
+                             : std::string("docProps/app.xml");
+  std::shared_ptr<const ZipPart> part;
+  pageErr = archive->package.getPart(partName, part);
+  if (pageErr != MZ_OK)
+    return pageErr;
+
+  XmlReader reader;
+  reader.open(part->data);
+  bool inPages = false, found = false;
+  uint32_t value = 0;
+  while ((pageErr = reader.next()) == MZ_OK) {
+    XmlEvent event = reader.getEvent();
+    if (event == XmlEvent::StartElement) {
+      std::string_view name = reader.getName();
+      name = name.substr(name.find(':') + 1);
+      inPages = reader.getDepth() == 2 && name == "Pages";
+    } else if (event == XmlEvent::Text && inPages) {
+      for (char c : reader.getText()) {
+        if (c < '0' || c > '9')
+          continue;
+        value = value * 10 + (uint32_t)(c - '0');
+        found = true;
+      }
+    } else if (event == XmlEvent::EndElement && inPages) {
+      break;
+    }
+  }
+  if (!found)
+    return MZ_END_OF_LIST;
+  pageTotal = value;
+  return MZ_OK;
+}
+
+int32_t DocxImpl::getPagesTotalLayout(uint32_t &pageTotal) {
+  std::shared_ptr<const DocxSnapshot> current = loadSnapshot();
+  DocxArchive &archive = *current->archive;
+  if (!archive.zipReader)
+    return MZ_PARAM_ERROR;
+  if (current->editHash != 0) {
+    int32_t pageErr = loadLayout(current);
+    if (pageErr == MZ_OK)
+      pageTotal = (uint32_t)current->layout->getPageList().size();
+    return pageErr;
+  }
+  if (pageCountCache().find(archive.contentHash, pageTotal)) {
+    BOOKFILER_TRACE_ADD(archive.metrics, cacheHits, 1);
+    return MZ_OK;
+  }
+  if (std::shared_ptr<const DiskCacheEntry> entry = archive.getCacheEntry()) {
+    BOOKFILER_TRACE_ADD(archive.metrics, cacheHits, 1);
+    pageTotal = entry->getPageTotal();
+    pageCountCache().insert(archive.contentHash, pageTotal);
+    return MZ_OK;
+  }
+  BOOKFILER_TRACE_ADD(archive.metrics, cacheMisses, 1);
+  int32_t pageErr = loadModel(current);
+  if (pageErr != MZ_OK)
+    return pageErr;
+  {
+    BOOKFILER_TRACE_SPAN(Layout, archive.metrics);
+    DocumentLayout layout(*current->model);
+    pageTotal = layout.paginate();
+  }
+  pageCountCache().insert(archive.contentHash, pageTotal);
+  storeCache(*current, pageTotal);
+  return MZ_OK;
+}
+
+void DocxImpl::storeCache(const DocxSnapshot &fileSnapshot,
+                          uint32_t pageTotal) {
+  // an edited model is not what the archive holds
+  if (fileSnapshot.editHash != 0 || !diskCache().isEnabled())
+    return;
+  diskCache().store(fileSnapshot.archive->contentHash, *fileSnapshot.model,
+                    pageTotal);
+}
+
+int32_t DocxImpl::getLayout(std::shared_ptr<const DocumentLayout> &layout_) {
+  std::shared_ptr<const DocxSnapshot> current;
+  int32_t layoutErr = loadLayout(current);
+  if (layoutErr == MZ_OK)
+    layout_ = current->layout;
+  return layoutErr;
+}
+
+int32_t DocxImpl::loadLayout(std::shared_ptr<const DocxSnapshot> &current) {
+  touch();
+  current = loadSnapshot();
+  if (current->layout)
+    return MZ_OK;
+  std::unique_lock<std::mutex> buildLock(layoutMutex);
+  current = loadSnapshot();
+  if (current->layout)
+    return MZ_OK;
+  int32_t layoutErr = loadModel(current);
+  if (layoutErr != MZ_OK)
+    return layoutErr;
+  const std::shared_ptr<DocumentMetrics> &metrics = current->archive->metrics;
+  BOOKFILER_TRACE_SPAN(Layout, metrics);
+  LayoutOptions options;
+  options.recordBoxes = true;
+  auto holder = std::make_shared<LayoutHolder>(current->model, options);
+  holder->layout.paginate();
+  BOOKFILER_TRACE_RAISE(metrics, arenaPeakBytes,
+                        current->model->memoryUsage() +
+                            holder->layout.memoryUsage());
+  {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::shared_ptr<const DocxSnapshot> latest = loadSnapshot();
+    // updateModel waits for layoutMutex, so only openFile or a release
+    // of the model can have come in between
+    bool publishable = latest->archive == current->archive &&
+                       latest->model == current->model && !latest->layout;
+    auto next =
+        std::make_shared<DocxSnapshot>(publishable ? *latest : *current);
+    next->layout =
+        std::shared_ptr<const DocumentLayout>(holder, &holder->layout);
+    if (publishable)
+      publish(next);
+    current = next;
+  }
+  buildLock.unlock();
+  storeCache(*current, (uint32_t)holder->layout.getPageList().size());
+  memoryAccountant().enforce(this);
+  return MZ_OK;
+}
+
+int32_t DocxImpl::getTile(uint32_t pageIndex, uint32_t dpi, uint32_t tileX,
+                          uint32_t tileY,
+                          std::shared_ptr<const RasterImage> &tile) {
+  std::shared_ptr<const DocxSnapshot> current;
+  int32_t tileErr = loadLayout(current);
+  if (tileErr != MZ_OK)
+    return tileErr;
+  return renderTile(*current, pageIndex, dpi, tileX, tileY, tile);
+}
+
+int32_t DocxImpl::renderTile(const DocxSnapshot &current, uint32_t pageIndex,
+                             uint32_t dpi, uint32_t tileX, uint32_t tileY,
+                             std::shared_ptr<const RasterImage> &tile) {
+  const DocumentLayout &documentLayout = *current.layout;
+  const std::shared_ptr<DocumentMetrics> &metrics = current.archive->metrics;
+  if (pageIndex >= documentLayout.getPageList().size() || dpi == 0)
+    return MZ_PARAM_ERROR;
+  TileKey key{current.getDocumentHash(), pageIndex, dpi, tileX, tileY};
+  tile = tileCache().find(key);
+  if (tile) {
+    BOOKFILER_TRACE_ADD(metrics, cacheHits, 1);
+    return MZ_OK;
+  }
+  BOOKFILER_TRACE_ADD(metrics, cacheMisses, 1);
+
+  BOOKFILER_TRACE_SPAN(Render, metrics);
+  DocxArchive &archive = *current.archive;
+  PageRasterizer rasterizer(
+      documentLayout, (int32_t)dpi,
+      [this, &archive](std::string_view relId, int32_t width,
+                       int32_t height) {
+        std::shared_ptr<const RasterImage> media;
+        getMedia(archive, relId, width, height, media);
+        return media;
+      });
+  int32_t pageWidth, pageHeight;
+  rasterizer.getPageSize(pageIndex, pageWidth, pageHeight);
+  int64_t originX = (int64_t)tileX * tileSize,
+          originY = (int64_t)tileY * tileSize;
+  if (originX >= pageWidth || originY >= pageHeight)
+    return MZ_PARAM_ERROR;
+  auto image = std::make_shared<RasterImage>();
+  image->width = std::min<int32_t>(tileSize, pageWidth - (int32_t)originX);
+  image->height = std::min<int32_t>(tileSize, pageHeight - (int32_t)originY);
+  image->stride = (size_t)image->width * 4;
+  image->pixels = pixmapBufferPool().acquire(image->byteSize());
+  BOOKFILER_TRACE_ADD(metrics, allocationTotal, 1);
+  BOOKFILER_TRACE_ADD(metrics, allocationBytes, image->byteSize());
+  rasterizer.render(pageIndex,
+                    {image->pixels.get(), image->stride, image->width,
+                     image->height, (int32_t)originX, (int32_t)originY});
+  tileCache().insert(key, image);
+  tile = image;
+  memoryAccountant().enforce(this);
+  return MZ_OK;
+}
+
+int32_t DocxImpl::getMedia(std::string_view relId, int32_t width,
+                           int32_t height,
+                           std::shared_ptr<const RasterImage> &image) {
+  return getMedia(*loadSnapshot()->archive, relId, width, height, image);
+}
+
+int32_t DocxImpl::getMedia(DocxArchive &archive, std::string_view relId,
+                           int32_t width, int32_t height,
+                           std::shared_ptr<const RasterImage> &image) {
+  if (archive.openPackage() != MZ_OK)
+    return MZ_END_OF_LIST;
+  const OpcRelationship *relationship =
+      archive.documentRelationships->find(relId);
+  if (!relationship || relationship->external)
+    return MZ_END_OF_LIST;
+  MediaKey key{archive.contentHash, std::string(relationship->target), width,
+               height};
+  image = mediaCache().find(key);
+  if (image)
+    return MZ_OK;
+  touch();
+  // read past the package, the compressed image is not worth keeping
+  std::shared_ptr<ZipPart> part = archive.zipReader->extractPart(key.partName);
+  if (!part || part->err != MZ_OK)
+    return MZ_END_OF_LIST;
+  auto decoded = std::make_shared<RasterImage>();
+  int32_t mediaErr;
+  {
+    BOOKFILER_TRACE_SPAN(Decode, archive.metrics);
+    mediaErr = mediaDecode(part->data, width, height, *decoded);
+  }
+  if (mediaErr != MZ_OK)
+    return mediaErr;
+  BOOKFILER_TRACE_ADD(archive.metrics, allocationTotal, 1);
+  BOOKFILER_TRACE_ADD(archive.metrics, allocationBytes, decoded->byteSize());
+  mediaCache().insert(key, decoded);
+  image = decoded;
+  return MZ_OK;
+}
+
+bool DocxImpl::hasTile(uint32_t pageIndex, uint32_t dpi, uint32_t tileX,
+                       uint32_t tileY) const {
+  std::shared_ptr<const DocxSnapshot> current = loadSnapshot();
+  return current->archive->zipReader &&
+         tileCache().contains(
+             {current->getDocumentHash(), pageIndex, dpi, tileX, tileY});
+}
+
+int32_t DocxImpl::getPageImage(uint32_t pageIndex, uint32_t dpi,
+                               std::shared_ptr<const RasterImage> &image) {
+  std::shared_ptr<const DocxSnapshot> current;
+  int32_t imageErr = loadLayout(current);
+  if (imageErr != MZ_OK)
+    return imageErr;
+  if (pageIndex >= current->layout->getPageList().size() || dpi == 0)
+    return MZ_PARAM_ERROR;
+  const std::shared_ptr<DocumentMetrics> &metrics = current->archive->metrics;
+  auto pageImage = std::make_shared<RasterImage>();
+  PageRasterizer(*current->layout, (int32_t)dpi)
+      .getPageSize(pageIndex, pageImage->width, pageImage->height);
+  pageImage->stride = (size_t)pageImage->width * 4;
+  pageImage->pixels = pixmapBufferPool().acquire(pageImage->byteSize());
+  BOOKFILER_TRACE_ADD(metrics, allocationTotal, 1);
+  BOOKFILER_TRACE_ADD(metrics, allocationBytes, pageImage->byteSize());
+  uint32_t tileColumns =
+      (uint32_t)((pageImage->width + tileSize - 1) / tileSize);
+  uint32_t tileRows =
+      (uint32_t)((pageImage->height + tileSize - 1) / tileSize);
+  for (uint32_t tileY = 0; tileY < tileRows; tileY++) {
+    for (uint32_t tileX = 0; tileX < tileColumns; tileX++) {
+      std::shared_ptr<const RasterImage> tile;
+      imageErr = renderTile(*current, pageIndex, dpi, tileX, tileY, tile);
+      if (imageErr != MZ_OK)
+        return imageErr;
+      unsigned char *destination =
+          pageImage->pixels.get() +
+          (size_t)tileY * tileSize * pageImage->stride +
+          (size_t)tileX * tileSize * 4;
+      for (int32_t y = 0; y < tile->height; y++)
+        std::memcpy(destination + (size_t)y * pageImage->stride,
+                    tile->pixels.get() + (size_t)y * tile->stride,
+                    tile->stride);
+    }
+  }
+  image = pageImage;
+  return MZ_OK;
+}
+
+MemoryAccountant::Usage DocxImpl::getMemoryUsage() const {
+  std::shared_ptr<const DocxSnapshot> current = loadSnapshot();
+  MemoryAccountant::Usage usage;
+  usage.modelBytes = modelCharge + layoutCharge;
+  usage.partBytes = current->archive->package.getCachedBytes();
+  if (current->archive->contentHash != 0)
+    usage.pixmapBytes =
+        tileCache().getDocumentBytes(current->getDocumentHash());
+  return usage;
+}
+
+size_t DocxImpl::releaseParts() {
+  return loadSnapshot()->archive->package.releaseParts();
+}
+
+size_t DocxImpl::releaseModel() {
+  std::unique_lock<std::mutex> layoutLock(layoutMutex, std::try_to_lock);
+  if (!layoutLock.owns_lock())
+    return 0;
+  std::unique_lock<std::mutex> modelLock(modelMutex, std::try_to_lock);
+  if (!modelLock.owns_lock())
+    return 0;
+  std::lock_guard<std::mutex> lock(publishMutex);
+  std::shared_ptr<const DocxSnapshot> current = loadSnapshot();
+  if (current->editHash != 0)
+    return 0;
+  size_t releasedBytes = modelCharge + layoutCharge;
+  // holders keep theirs, the layout keeps its model alive
+  auto next = std::make_shared<DocxSnapshot>(*current);
+  next->model = nullptr;
+  next->layout = nullptr;
+  publish(next);
+  return releasedBytes;
+}
+
+void DocxImpl::setCharge(std::atomic<size_t> &charge, size_t bytes) {
+  size_t previous = charge.exchange(bytes);
+  memoryAccountant().charge(MemoryKind::Model,
+                            (int64_t)bytes - (int64_t)previous);
+}
+
+} // namespace bookfiler
@@ -0,0 +1,291 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_DOCX_IMPL_H
+#define BOOKFILER_MODULE_DOCX_DOCX_IMPL_H
+
+// C++
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Local Project
+#include "diskCache.hpp"
+#include "document.hpp"
+#include "layout.hpp"
+#include "memoryAccountant.hpp"
+#include "opc.hpp"
+#include "textExtractor.hpp"
+#include "tileCache.hpp"
+#include "trace.hpp"
+#include "zip.hpp"
+#include "zipWriter.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* DocxArchive
+ * What one openFile opened: the archive and, read on first use, its
+ * package metadata. Every snapshot until the next openFile shares it, and
+ * readers holding one keep the archive mapped past that openFile.
+ */
+class DocxArchive {
+public:
+  /* Content types and the package and main document relationships, read
+   * by the first caller, the others wait for it. Thread safe.
+   */
+  int32_t openPackage();
+  /* The disk cache entry openFile found, nullptr once its model failed to
+   * load. Thread safe.
+   */
+  std::shared_ptr<const DiskCacheEntry> getCacheEntry() const {
+    return std::atomic_load(&cacheEntry);
+  }
+  void dropCacheEntry() {
+    std::atomic_store(&cacheEntry, std::shared_ptr<const DiskCacheEntry>());
+  }
+
+  // set by openFile before the archive is published, constant after
+  std::string fileName;
+  int32_t err = MZ_OK;
+  std::shared_ptr<DocumentMetrics> metrics;
+  std::shared_ptr<ZipReader> zipReader;
+  uint64_t contentHash = 0;
+  std::shared_ptr<const DiskCacheEntry> cacheEntry;
+  // valid once openPackage returned
+  OpcPackage package;
+  std::shared_ptr<const OpcRelationshipList> documentRelationships;
+
+private:
+  std::mutex packageMutex;
+  std::atomic<bool> packageOpen{false};
+  int32_t packageErr = MZ_OK;
+};
+
+/* DocxSnapshot
+ * One published state of a DocxImpl: the archive and, once built, the
+ * model and layout of its contents or of the last edit. Never changed
+ * after it is published, see DocxImpl.
+ */
+class DocxSnapshot {
+public:
+  std::shared_ptr<DocxArchive> archive;
+  std::shared_ptr<const DocumentModel> model;
+  std::shared_ptr<const DocumentLayout> layout;
+  // 0 until updateModel, then unique to the edit, mixed into tile keys
+  uint64_t editHash = 0;
+  /* What the document's tiles are cached under */
+  uint64_t getDocumentHash() const { return archive->contentHash ^ editHash; }
+};
+
+/* DocxImpl
+ * Everything behind the Docx interface class: the archive, its package
+ * metadata and the parsed document model. openFile reads only the content
+ * types and the package and main document relationships. The main document,
+ * styles, numbering, headers, footers, footnotes and media are read the first
+ * time something asks for them.
+ *
+ * When diskCache() holds the archive's contents, openFile reads nothing
+ * from the package at all: the model and the page count come from the
+ * cache file and the package is opened on the first part request. Errors
+ * in content types or relationships then surface there.
+ *
+ * Registered with memoryAccountant() while it lives, which may drop its
+ * cached parts, model and layout when over budget; they are read again
+ * from the archive on next use.
+ *
+ * Concurrency: every function may be called from any number of threads at
+ * once. State lives in a DocxSnapshot that is published with an atomic
+ * store and never changed after: a call loads the current one once and
+ * works on it to the end, so a model, layout or tile that is already built
+ * is reached without waiting for a build or for openFile. Whatever is
+ * missing is built by one thread while the others wait for it, then a copy
+ * of the snapshot with it added is published; openFile, updateModel and
+ * the accountant's releaseModel publish theirs the same way. A call that
+ * overlaps openFile finishes on the document it started on. Archive reads
+ * go through the memory mapped index and each keep their own inflate
+ * state, see ZipReader.
+ */
+class DocxImpl {
+public:
+  DocxImpl();
+  ~DocxImpl();
+  int32_t openFile(std::string fileName);
+  int32_t getError() const { return loadSnapshot()->archive->err; }
+  /* The file last given to openFile, as given */
+  std::string getFileName() const {
+    return loadSnapshot()->archive->fileName;
+  }
+  /* Counters since the last openFile */
+  DocumentMetrics::Snapshot getMetrics() const {
+    return loadSnapshot()->archive->metrics->getSnapshot();
+  }
+  /* Parses the main document part on first use */
+  int32_t getModel(std::shared_ptr<const DocumentModel> &model);
+  /* Streams the main document's text paragraph by paragraph straight from
+   * the archive, see TextExtractor. No model is built, so it is cheap on a
+   * document never drawn.
+   */
+  int32_t extractText(const text_paragraph_cb_t &callback);
+  /* Replaces the model with an edited copy of it. dirtyParagraphList holds
+   * the paragraphs whose runs, text or formatting changed; when the edit
+   * keeps the paragraph and table structure, a layout already built is
+   * redone incrementally from them, otherwise from scratch. Tiles rendered
+   * before the edit are no longer served.
+   * MZ_PARAM_ERROR	-102	nothing is open, or openFile replaced the
+   *				document while the layout was redone
+   */
+  int32_t updateModel(std::shared_ptr<const DocumentModel> edited,
+                      const std::vector<uint32_t> &dirtyParagraphList);
+  /* Target of a relationship of the main document, e.g. the r:embed of an
+   * image or the r:id of a header reference.
+   * MZ_END_OF_LIST	-100	no such relationship or part
+   */
+  int32_t getRelatedPart(std::string_view relId,
+                         std::shared_ptr<const ZipPart> &part);
+  /* First part related to the main document by kind: "styles",
+   * "numbering", "footnotes", "settings", "fontTable", "theme" ...
+   */
+  int32_t getDocumentPart(std::string_view kind,
+                          std::shared_ptr<const ZipPart> &part);
+  /* Page count the application that last saved the file recorded in the
+   * extended properties (docProps/app.xml). Reads one small part.
+   * MZ_END_OF_LIST	-100	no extended properties or no Pages element
+   */
+  int32_t getPagesTotalStored(uint32_t &pageTotal);
+  /* Page count from a line and page breaking pass over the model, cached
+   * by archive content hash so reopening the same file costs a lookup.
+   * After updateModel it is the page count of the edited layout.
+   */
+  int32_t getPagesTotalLayout(uint32_t &pageTotal);
+  /* Every page laid out with line boxes for drawing, built on first use.
+   * The layout keeps the model it was built from alive.
+   */
+  int32_t getLayout(std::shared_ptr<const DocumentLayout> &layout);
+  /* Tile (tileX, tileY) of a page at dpi, tileSize pixels square except at
+   * the right and bottom edges. Served from tileCache() when it has been
+   * rendered before by any DocxImpl with the same archive contents.
+   * MZ_PARAM_ERROR	-102	page or tile out of range
+   */
+  int32_t getTile(uint32_t pageIndex, uint32_t dpi, uint32_t tileX,
+                  uint32_t tileY, std::shared_ptr<const RasterImage> &tile);
+  /* The image a relationship of the main document points to, decoded and
+   * scaled to width x height pixels. Served from mediaCache() when drawn at
+   * that size before.
+   * MZ_END_OF_LIST	-100	no such relationship or part
+   * and the errors of mediaDecode
+   */
+  int32_t getMedia(std::string_view relId, int32_t width, int32_t height,
+                   std::shared_ptr<const RasterImage> &image);
+  /* Whether the tile is in tileCache(), without touching its statistics */
+  bool hasTile(uint32_t pageIndex, uint32_t dpi, uint32_t tileX,
+               uint32_t tileY) const;
+  /* Whole page at dpi, assembled from its tiles, all of one snapshot */
+  int32_t getPageImage(uint32_t pageIndex, uint32_t dpi,
+                       std::shared_ptr<const RasterImage> &image);
+  /* Contents save writes for a part instead of the opened file's, e.g. a
+   * rewritten "word/document.xml". The model, layout and pages still come
+   * from the opened file. A leading '/' is dropped.
+   */
+  void setPart(std::string partName, std::string data);
+  void removePart(std::string partName);
+  /* The opened archive with the parts set since openFile. Parts that were
+   * not set are copied as they are compressed, set ones are deflated on
+   * the module pool while that goes on.
+   * MZ_PARAM_ERROR	-102	nothing is open
+   */
+  int32_t save(ZipSink &sink);
+  /* save into a file next to fileName that is then renamed over it, so the
+   * opened file itself may be the target
+   */
+  int32_t saveFile(std::string fileName);
+  /* Both open the package first if openFile left it closed. The reference
+   * is valid until the next openFile.
+   */
+  const OpcRelationshipList &getDocumentRelationships() {
+    DocxArchive &archive = *loadSnapshot()->archive;
+    archive.openPackage();
+    return *archive.documentRelationships;
+  }
+  OpcPackage &getPackage() {
+    DocxArchive &archive = *loadSnapshot()->archive;
+    archive.openPackage();
+    return archive.package;
+  }
+  /* Bytes of the model and layout, the cached parts and the tiles of this
+   * document's current contents
+   */
+  MemoryAccountant::Usage getMemoryUsage() const;
+  /* MemoryAccountant::tick() of the last model, layout, part or tile
+   * request
+   */
+  uint64_t getLastUse() const {
+    return lastUse.load(std::memory_order_relaxed);
+  }
+  /* Drops the cached inflated parts. @return the bytes released */
+  size_t releaseParts();
+  /* Drops the model and layout unless they are being built or the model
+   * was edited, then it cannot be read again. @return the bytes released
+   */
+  size_t releaseModel();
+  std::shared_ptr<ZipReader> getZipReader() const {
+    return loadSnapshot()->archive->zipReader;
+  }
+  /* The current state, kept by the caller as long as it likes */
+  std::shared_ptr<const DocxSnapshot> loadSnapshot() const {
+    return std::atomic_load_explicit(&snapshot, std::memory_order_acquire);
+  }
+
+private:
+  /* The current snapshot with a model, or a layout, built into it on
+   * first use
+   */
+  int32_t loadModel(std::shared_ptr<const DocxSnapshot> &current);
+  int32_t loadLayout(std::shared_ptr<const DocxSnapshot> &current);
+  /* Makes next current and charges the accountant for its model and
+   * layout. publishMutex must be held.
+   */
+  void publish(std::shared_ptr<const DocxSnapshot> next);
+  /* The main document and styles, from the archive */
+  int32_t parseModel(DocxArchive &archive, DocumentModel &parsedModel);
+  int32_t getDocumentPart(DocxArchive &archive, std::string_view kind,
+                          std::shared_ptr<const ZipPart> &part);
+  int32_t getMedia(DocxArchive &archive, std::string_view relId,
+                   int32_t width, int32_t height,
+                   std::shared_ptr<const RasterImage> &image);
+  int32_t renderTile(const DocxSnapshot &current, uint32_t pageIndex,
+                     uint32_t dpi, uint32_t tileX, uint32_t tileY,
+                     std::shared_ptr<const RasterImage> &tile);
+  /* Hands a model read from the opened file to diskCache() */
+  void storeCache(const DocxSnapshot &fileSnapshot, uint32_t pageTotal);
+  void touch() { lastUse = memoryAccountant().tick(); }
+  /* Moves charge to bytes, charging the accountant the difference */
+  void setCharge(std::atomic<size_t> &charge, size_t bytes);
+
+  // read with loadSnapshot, replaced only by publish
+  std::shared_ptr<const DocxSnapshot> snapshot;
+  // held while a model or a layout is built, layout first when both are
+  std::mutex modelMutex, layoutMutex;
+  // held for the copy and publish of a snapshot, never while building
+  std::mutex publishMutex;
+  // memoryUsage of the published model and layout, written by publish
+  std::atomic<size_t> modelCharge{0}, layoutCharge{0};
+  std::atomic<uint64_t> lastUse{0};
+  std::mutex partMutex;
+  // by part name, what save writes instead of the opened file's parts
+  std::map<std::string, ZipReplacement> replacementMap;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_DOCX_IMPL_H
@@ -0,0 +1,88 @@
+// C++
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+// Local Project
+#include "fontMetrics.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+// Helvetica, ' ' through '~'
+const uint16_t proportionalWidthList[95] = {
+    278, 278, 355, 556, 556, 889, 667, 191, 333, 333, 389, 584, 278, 333,
+    278, 278, 556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 278, 278,
+    584, 584, 584, 556, 1015, 667, 667, 722, 722, 667, 611, 778, 722, 278,
+    500, 667, 556, 833, 722, 778, 667, 778, 722, 667, 611, 722, 667, 944,
+    667, 667, 611, 278, 278, 278, 469, 556, 333, 556, 556, 500, 556, 556,
+    278, 556, 556, 222, 222, 500, 222, 833, 556, 556, 556, 556, 333, 500,
+    278, 556, 500, 722, 500, 500, 500, 334, 260, 334, 584};
+
+bool isWide(uint32_t codePoint) {
+  return (codePoint >= 0x1100 && codePoint <= 0x115F) ||
+         (codePoint >= 0x2E80 && codePoint <= 0xA4CF) ||
+         (codePoint >= 0xAC00 && codePoint <= 0xD7A3) ||
+         (codePoint >= 0xF900 && codePoint <= 0xFAFF) ||
+         (codePoint >= 0xFF00 && codePoint <= 0xFF60) ||
+         (codePoint >= 0x20000 && codePoint <= 0x3FFFD);
+}
+
+bool isZeroWidth(uint32_t codePoint) {
+  return (codePoint >= 0x0300 && codePoint <= 0x036F) || codePoint == 0xAD ||
+         (codePoint >= 0x200B && codePoint <= 0x200F) || codePoint == 0xFEFF;
+}
+
+} // namespace
+
+FontMetrics::FontMetrics(bool monospace_, int32_t lineHeight_,
+                         int32_t ascent_)
+    : lineHeight(lineHeight_), ascent(ascent_), monospace(monospace_) {}
+
+const FontMetrics &FontMetrics::get(std::string_view fontName) {
+  static const FontMetrics proportional(false, 1150, 905);
+  static const FontMetrics fixed(true, 1133, 833);
+  std::string name(fontName);
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](unsigned char c) { return (char)std::tolower(c); });
+  if (name.find("courier") != std::string::npos ||
+      name.find("consolas") != std::string::npos ||
+      name.find("mono") != std::string::npos)
+    return fixed;
+  return proportional;
+}
+
+int32_t FontMetrics::advance(uint32_t codePoint, bool bold) const {
+  if (isZeroWidth(codePoint))
+    return 0;
+  if (isWide(codePoint))
+    return 1000;
+  if (monospace)
+    return 600;
+  int32_t width;
+  if (codePoint >= ' ' && codePoint <= '~')
+    width = proportionalWidthList[codePoint - ' '];
+  else if (codePoint == 0xA0)
+    width = 278;
+  else
+    width = 556;
+  // bold faces run about five percent wider
+  return bold ? width + width / 20 : width;
+}
+
+uint32_t utf8Next(const char *&p, const char *end) {
+  unsigned char c = (unsigned char)*p++;
+  if (c < 0x80)
+    return c;
+  int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+  uint32_t codePoint = c & (0x3F >> extra);
+  for (int i = 0; i < extra && p < end; i++)
+    codePoint = (codePoint << 6) | ((unsigned char)*p++ & 0x3F);
+  return codePoint;
+}
+
+} // namespace bookfiler
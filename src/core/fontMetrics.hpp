@@ -0,0 +1,51 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_FONT_METRICS_H
+#define BOOKFILER_MODULE_DOCX_FONT_METRICS_H
+
+// C++
+#include <cstdint>
+#include <string_view>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* FontMetrics
+ * Advance widths for measuring lines without loading a font. Widths are in
+ * 1/1000 em, the proportional table is Helvetica's, which Arial shares, and
+ * stands in for every proportional face. Layout only needs line breaks to
+ * land where a word processor puts them most of the time, not glyph exact.
+ */
+class FontMetrics {
+public:
+  /* Monospace for Courier, Consolas and "... Mono" faces, proportional
+   * otherwise
+   */
+  static const FontMetrics &get(std::string_view fontName);
+
+  int32_t advance(uint32_t codePoint, bool bold) const;
+  bool isMonospace() const { return monospace; }
+  // ascent + descent and ascent, 1/1000 em
+  int32_t lineHeight, ascent;
+
+private:
+  FontMetrics(bool monospace, int32_t lineHeight, int32_t ascent);
+  bool monospace;
+};
+
+/* Decodes the code point at p and advances p. Malformed input has been
+ * replaced by the parser, so this only guards against running off end.
+ */
+uint32_t utf8Next(const char *&p, const char *end);
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_FONT_METRICS_H
@@ -0,0 +1,389 @@
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+// Local Project
+#include "glyphCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const int32_t atlasPageSize = 1024;
+const size_t atlasPageBytes = (size_t)atlasPageSize * atlasPageSize;
+
+/* Part of a greeked glyph. Vertical edges are in em from the baseline,
+ * negative is up, horizontal edges are fractions of the advance.
+ */
+class GlyphRect {
+public:
+  float left, right, top, bottom;
+};
+
+int glyphRectList(uint32_t codePoint, GlyphRect *rectList) {
+  if (codePoint <= ' ' || codePoint == 0xA0 || codePoint == 0xAD)
+    return 0;
+  if (codePoint == '.' || codePoint == ',') {
+    rectList[0] = {0.3f, 0.7f, -0.12f, codePoint == ',' ? 0.12f : 0.0f};
+    return 1;
+  }
+  if (codePoint == ':' || codePoint == ';') {
+    rectList[0] = {0.3f, 0.7f, -0.5f, -0.38f};
+    rectList[1] = {0.3f, 0.7f, -0.12f, codePoint == ';' ? 0.12f : 0.0f};
+    return 2;
+  }
+  if (codePoint == '-' || codePoint == 0x2013 || codePoint == 0x2014) {
+    rectList[0] = {0.1f, 0.9f, -0.3f, -0.22f};
+    return 1;
+  }
+  if (codePoint == '_') {
+    rectList[0] = {0.0f, 1.0f, 0.1f, 0.16f};
+    return 1;
+  }
+  if (codePoint == '\'' || codePoint == '"' || codePoint == '`' ||
+      (codePoint >= 0x2018 && codePoint <= 0x201F)) {
+    rectList[0] = {0.25f, 0.75f, -0.72f, -0.5f};
+    return 1;
+  }
+  if ((codePoint >= 'A' && codePoint <= 'Z') ||
+      (codePoint >= '0' && codePoint <= '9') || codePoint == 'b' ||
+      codePoint == 'd' || codePoint == 'f' || codePoint == 'h' ||
+      codePoint == 'k' || codePoint == 'l' || codePoint == 't' ||
+      codePoint == 'i') {
+    rectList[0] = {0.1f, 0.9f, -0.72f, 0.0f};
+    return 1;
+  }
+  if (codePoint == 'g' || codePoint == 'j' || codePoint == 'p' ||
+      codePoint == 'q' || codePoint == 'y') {
+    rectList[0] = {0.1f, 0.9f, -0.52f, 0.2f};
+    return 1;
+  }
+  if (codePoint >= 'a' && codePoint <= 'z') {
+    rectList[0] = {0.1f, 0.9f, -0.52f, 0.0f};
+    return 1;
+  }
+  if (codePoint == '(' || codePoint == ')' || codePoint == '[' ||
+      codePoint == ']' || codePoint == '{' || codePoint == '}' ||
+      codePoint == '|') {
+    rectList[0] = {0.3f, 0.7f, -0.75f, 0.2f};
+    return 1;
+  }
+  if (codePoint >= 0x2E80) {
+    rectList[0] = {0.06f, 0.94f, -0.8f, 0.1f};
+    return 1;
+  }
+  rectList[0] = {0.1f, 0.9f, -0.6f, 0.0f};
+  return 1;
+}
+
+/* Greeked glyph into scratch, sets everything in mask but pixels */
+void rasterizeGlyph(const GlyphKey &key, float advance,
+                    std::vector<uint8_t> &scratch, GlyphMask &mask) {
+  GlyphRect rectList[2];
+  int rectTotal = glyphRectList(key.codePoint, rectList);
+  mask.width = mask.height = mask.left = mask.top = 0;
+  mask.stride = 0;
+  if (rectTotal == 0)
+    return;
+  float em = key.sizeFixed / 64.0f;
+  float offset = (float)key.subpixel / glyphSubpixelTotal;
+  float top = 0, bottom = 0, right = 0;
+  for (int i = 0; i < rectTotal; i++) {
+    top = std::min(top, rectList[i].top * em);
+    bottom = std::max(bottom, rectList[i].bottom * em);
+    right = std::max(right, offset + rectList[i].right * advance);
+  }
+  mask.top = (int32_t)std::floor(top);
+  mask.width = std::max(1, (int32_t)std::ceil(right));
+  mask.height = std::max(1, (int32_t)std::ceil(bottom) - mask.top);
+  mask.stride = (size_t)mask.width;
+  scratch.assign(mask.stride * mask.height, 0);
+  // ink density of the greeked stroke
+  float density = key.bold ? 0.85f : 0.6f;
+  for (int i = 0; i < rectTotal; i++) {
+    float rectLeft = offset + rectList[i].left * advance;
+    float rectRight = offset + rectList[i].right * advance;
+    float rectTop = rectList[i].top * em - mask.top;
+    float rectBottom = rectList[i].bottom * em - mask.top;
+    int32_t x0 = std::max(0, (int32_t)std::floor(rectLeft));
+    int32_t x1 = std::min(mask.width, (int32_t)std::ceil(rectRight));
+    int32_t y0 = std::max(0, (int32_t)std::floor(rectTop));
+    int32_t y1 = std::min(mask.height, (int32_t)std::ceil(rectBottom));
+    for (int32_t y = y0; y < y1; y++) {
+      float coverageY =
+          std::min(rectBottom, (float)y + 1) - std::max(rectTop, (float)y);
+      for (int32_t x = x0; x < x1; x++) {
+        float coverageX =
+            std::min(rectRight, (float)x + 1) - std::max(rectLeft, (float)x);
+        int32_t value = scratch[(size_t)y * mask.stride + x] +
+                        (int32_t)(density * coverageX * coverageY * 255 + 0.5f);
+        scratch[(size_t)y * mask.stride + x] = (uint8_t)std::min(255, value);
+      }
+    }
+  }
+}
+
+class GlyphKeyHash {
+public:
+  size_t operator()(const GlyphKey &key) const { return (size_t)key.hash(); }
+};
+
+} // namespace
+
+uint64_t GlyphKey::hash() const {
+  uint64_t value = (uint64_t)(uintptr_t)face;
+  for (uint64_t field : {(uint64_t)codePoint, (uint64_t)(uint32_t)sizeFixed,
+                         (uint64_t)bold << 8 | subpixel})
+    value = (value ^ field) * 0x100000001B3ull;
+  return value ^ (value >> 31);
+}
+
+/* One atlas generation, glyphs are packed on shelves of the last page */
+class GlyphAtlas::Generation {
+public:
+  class Entry {
+  public:
+    const uint8_t *pixels;
+    int32_t width, height, left, top;
+  };
+
+  explicit Generation(size_t byteBudget_) : byteBudget(byteBudget_) {}
+
+  /* @return false when the generation is full */
+  bool insert(const GlyphKey &key, const GlyphMask &mask, GlyphMask &placed) {
+    if (mask.width + 1 > atlasPageSize || mask.height > atlasPageSize)
+      return false;
+    if (pageList.empty() || shelfX + mask.width + 1 > atlasPageSize) {
+      shelfY += shelfHeight;
+      shelfX = 0;
+      shelfHeight = 0;
+    }
+    if (pageList.empty() || shelfY + mask.height > atlasPageSize) {
+      if ((pageList.size() + 1) * atlasPageBytes > byteBudget) {
+        full = true;
+        return false;
+      }
+      pageList.push_back(std::make_unique<uint8_t[]>(atlasPageBytes));
+      shelfX = shelfY = shelfHeight = 0;
+    }
+    uint8_t *pixels =
+        pageList.back().get() + (size_t)shelfY * atlasPageSize + shelfX;
+    for (int32_t y = 0; y < mask.height; y++)
+      std::memcpy(pixels + (size_t)y * atlasPageSize,
+                  mask.pixels + (size_t)y * mask.stride, mask.width);
+    // a blank column between glyphs
+    shelfX += mask.width + 1;
+    shelfHeight = std::max(shelfHeight, mask.height);
+    entryMap[key] = {pixels, mask.width, mask.height, mask.left, mask.top};
+    placed = {pixels, (size_t)atlasPageSize, mask.width, mask.height,
+              mask.left, mask.top};
+    return true;
+  }
+
+  std::shared_mutex mutex;
+  std::unordered_map<GlyphKey, Entry, GlyphKeyHash> entryMap;
+  std::vector<std::unique_ptr<uint8_t[]>> pageList;
+  int32_t shelfX = 0, shelfY = 0, shelfHeight = 0;
+  size_t byteBudget;
+  bool full = false;
+};
+
+GlyphAtlas::GlyphAtlas(size_t byteBudget_)
+    : current(std::make_shared<Generation>(byteBudget_)),
+      byteBudget(byteBudget_) {}
+
+GlyphAtlas::~GlyphAtlas() {}
+
+std::shared_ptr<GlyphAtlas::Generation> GlyphAtlas::pin() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return current;
+}
+
+GlyphMask GlyphAtlas::find(Generation &generation, const GlyphKey &key,
+                           float advance, std::vector<uint8_t> &scratch) {
+  {
+    std::shared_lock<std::shared_mutex> lock(generation.mutex);
+    auto entryIt = generation.entryMap.find(key);
+    if (entryIt != generation.entryMap.end()) {
+      hitTotal++;
+      const Generation::Entry &entry = entryIt->second;
+      return {entry.pixels, (size_t)atlasPageSize, entry.width, entry.height,
+              entry.left, entry.top};
+    }
+  }
+  missTotal++;
+  GlyphMask mask;
+  rasterizeGlyph(key, advance, scratch, mask);
+  mask.pixels = scratch.data();
+  if (mask.width == 0)
+    return mask;
+  rasterizeTotal++;
+  if (generation.byteBudget == 0)
+    return mask;
+
+  bool full;
+  {
+    std::unique_lock<std::shared_mutex> lock(generation.mutex);
+    auto entryIt = generation.entryMap.find(key);
+    if (entryIt != generation.entryMap.end()) {
+      const Generation::Entry &entry = entryIt->second;
+      return {entry.pixels, (size_t)atlasPageSize, entry.width, entry.height,
+              entry.left, entry.top};
+    }
+    if (generation.full)
+      return mask;
+    GlyphMask placed;
+    if (generation.insert(key, mask, placed))
+      return placed;
+    full = generation.full;
+  }
+  if (full) {
+    // later renders start on a fresh generation
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current.get() == &generation) {
+      current = std::make_shared<Generation>(byteBudget);
+      generationTotal++;
+    }
+  }
+  return mask;
+}
+
+void GlyphAtlas::setByteBudget(size_t byteBudget_) {
+  std::lock_guard<std::mutex> lock(mutex);
+  byteBudget = byteBudget_;
+  current = std::make_shared<Generation>(byteBudget);
+}
+
+void GlyphAtlas::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  current = std::make_shared<Generation>(byteBudget);
+}
+
+GlyphAtlas::Stats GlyphAtlas::getStats() const {
+  Stats stats;
+  stats.hitTotal = hitTotal;
+  stats.missTotal = missTotal;
+  stats.rasterizeTotal = rasterizeTotal;
+  stats.generationTotal = generationTotal;
+  std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(mutex));
+  std::shared_lock<std::shared_mutex> generationLock(current->mutex);
+  stats.glyphTotal = current->entryMap.size();
+  stats.byteTotal = current->pageList.size() * atlasPageBytes;
+  stats.byteBudget = byteBudget;
+  return stats;
+}
+
+ShapedRunCache::ShapedRunCache(size_t byteBudget_) : byteBudget(byteBudget_) {}
+
+std::shared_ptr<const ShapedRun>
+ShapedRunCache::get(std::string_view text, std::string_view fontName,
+                    const FontMetrics &metrics, int32_t sizeTwips, bool bold,
+                    bool caps) {
+  // key: size, flags, font name, NUL, text
+  char prefix[6];
+  std::memcpy(prefix, &sizeTwips, 4);
+  prefix[4] = (char)((bold ? 1 : 0) | (caps ? 2 : 0));
+  prefix[5] = 0;
+  size_t keySize = sizeof(prefix) + fontName.size() + 1 + text.size();
+  std::hash<std::string_view> hasher;
+  uint64_t hash = hasher(text) * 31 + hasher(fontName);
+  hash = (hash ^ (uint64_t)(uint32_t)sizeTwips) * 0x100000001B3ull ^ prefix[4];
+  auto matches = [&](const std::string &key) {
+    return key.size() == keySize &&
+           std::memcmp(key.data(), prefix, sizeof(prefix)) == 0 &&
+           std::memcmp(key.data() + sizeof(prefix), fontName.data(),
+                       fontName.size()) == 0 &&
+           std::memcmp(key.data() + sizeof(prefix) + fontName.size() + 1,
+                       text.data(), text.size()) == 0;
+  };
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto entryRange = entryMap.equal_range(hash);
+    for (auto entryIt = entryRange.first; entryIt != entryRange.second;
+         entryIt++) {
+      if (matches(entryIt->second.key)) {
+        hitTotal++;
+        return entryIt->second.run;
+      }
+    }
+  }
+  missTotal++;
+
+  auto run = std::make_shared<ShapedRun>();
+  run->glyphList.reserve(text.size());
+  const char *p = text.data(), *end = text.data() + text.size();
+  while (p < end) {
+    uint32_t offset = (uint32_t)(p - text.data());
+    uint32_t codePoint = utf8Next(p, end);
+    if (caps && codePoint >= 'a' && codePoint <= 'z')
+      codePoint -= 'a' - 'A';
+    // tabs and breaks are positioned by the line, not advanced here
+    int32_t advance =
+        codePoint < ' ' ? 0 : metrics.advance(codePoint, bold) * sizeTwips;
+    run->glyphList.push_back({offset, codePoint, advance});
+  }
+  run->glyphList.shrink_to_fit();
+
+  Entry entry;
+  entry.key.reserve(keySize);
+  entry.key.append(prefix, sizeof(prefix));
+  entry.key.append(fontName);
+  entry.key.push_back('\0');
+  entry.key.append(text);
+  entry.run = run;
+  size_t entryBytes =
+      keySize + run->glyphList.size() * sizeof(ShapedGlyph) + 96;
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  if (byteTotal + entryBytes > byteBudget) {
+    entryMap.clear();
+    byteTotal = 0;
+  }
+  if (entryBytes <= byteBudget) {
+    entryMap.emplace(hash, std::move(entry));
+    byteTotal += entryBytes;
+  }
+  return run;
+}
+
+void ShapedRunCache::setByteBudget(size_t byteBudget_) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  byteBudget = byteBudget_;
+  if (byteTotal > byteBudget) {
+    entryMap.clear();
+    byteTotal = 0;
+  }
+}
+
+void ShapedRunCache::clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  entryMap.clear();
+  byteTotal = 0;
+}
+
+ShapedRunCache::Stats ShapedRunCache::getStats() const {
+  Stats stats;
+  stats.hitTotal = hitTotal;
+  stats.missTotal = missTotal;
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  stats.runTotal = entryMap.size();
+  stats.byteTotal = byteTotal;
+  stats.byteBudget = byteBudget;
+  return stats;
+}
+
+GlyphAtlas &glyphAtlas() {
+  static GlyphAtlas atlas;
+  return atlas;
+}
+
+ShapedRunCache &shapedRunCache() {
+  static ShapedRunCache cache;
+  return cache;
+}
+
+} // namespace bookfiler
@@ -0,0 +1,159 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_GLYPH_CACHE_H
+#define BOOKFILER_MODULE_DOCX_GLYPH_CACHE_H
+
+// C++
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Local Project
+#include "fontMetrics.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* Horizontal glyph positions per pixel */
+const int32_t glyphSubpixelTotal = 4;
+
+/* face is the FontMetrics the glyph is measured with, sizeFixed the em in
+ * 1/64 pixel
+ */
+class GlyphKey {
+public:
+  const FontMetrics *face;
+  uint32_t codePoint;
+  int32_t sizeFixed;
+  uint8_t bold, subpixel;
+
+  bool operator==(const GlyphKey &other) const {
+    return face == other.face && codePoint == other.codePoint &&
+           sizeFixed == other.sizeFixed && bold == other.bold &&
+           subpixel == other.subpixel;
+  }
+  uint64_t hash() const;
+};
+
+/* Coverage mask of one glyph, already weighted by the greeked ink density.
+ * left and top are the mask's offset in pixels from the pen position on the
+ * baseline.
+ */
+class GlyphMask {
+public:
+  const uint8_t *pixels;
+  size_t stride;
+  int32_t width, height, left, top;
+};
+
+/* GlyphAtlas
+ * Rasterized glyphs packed into 8 bit atlas pages on shelves. Glyphs are
+ * looked up under a shared lock, a miss rasterizes outside any lock and
+ * inserts under an exclusive one. When the byte budget is used up the
+ * atlas starts a new generation; a renderer pins the generation it started
+ * with, so the masks it holds stay valid until it is done. A budget of 0
+ * turns the atlas off and every glyph is rasterized where it is drawn.
+ */
+class GlyphAtlas {
+public:
+  class Generation;
+  class Stats {
+  public:
+    uint64_t hitTotal = 0, missTotal = 0, rasterizeTotal = 0,
+             generationTotal = 0;
+    size_t glyphTotal = 0, byteTotal = 0, byteBudget = 0;
+  };
+
+  explicit GlyphAtlas(size_t byteBudget = (size_t)16 << 20);
+  ~GlyphAtlas();
+  std::shared_ptr<Generation> pin();
+  /* The mask of key, rasterized on a miss. scratch holds the mask when it
+   * could not be kept in the atlas and must outlive the returned view.
+   */
+  GlyphMask find(Generation &generation, const GlyphKey &key,
+                 float advance, std::vector<uint8_t> &scratch);
+  void setByteBudget(size_t byteBudget);
+  void clear();
+  Stats getStats() const;
+
+private:
+  std::mutex mutex;
+  std::shared_ptr<Generation> current;
+  size_t byteBudget;
+  std::atomic<uint64_t> hitTotal{0}, missTotal{0}, rasterizeTotal{0},
+      generationTotal{0};
+};
+
+/* One glyph of a shaped run. offset is the byte offset of its character in
+ * the run text, advance is in 1/1000 twip at the run's size.
+ */
+class ShapedGlyph {
+public:
+  uint32_t offset, codePoint;
+  int32_t advance;
+};
+
+class ShapedRun {
+public:
+  std::vector<ShapedGlyph> glyphList;
+};
+
+/* ShapedRunCache
+ * Runs mapped to glyphs and advances, keyed by text, face, size and the
+ * properties that change shaping (bold, caps). Keys hold the font name, not
+ * a document's pool id, so documents sharing styles share entries. Starts
+ * over when byteBudget is reached. Thread safe.
+ */
+class ShapedRunCache {
+public:
+  class Stats {
+  public:
+    uint64_t hitTotal = 0, missTotal = 0;
+    size_t runTotal = 0, byteTotal = 0, byteBudget = 0;
+  };
+
+  explicit ShapedRunCache(size_t byteBudget = (size_t)16 << 20);
+  std::shared_ptr<const ShapedRun> get(std::string_view text,
+                                       std::string_view fontName,
+                                       const FontMetrics &metrics,
+                                       int32_t sizeTwips, bool bold, bool caps);
+  void setByteBudget(size_t byteBudget);
+  void clear();
+  Stats getStats() const;
+
+private:
+  class Entry {
+  public:
+    std::string key;
+    std::shared_ptr<const ShapedRun> run;
+  };
+
+  mutable std::shared_mutex mutex;
+  std::unordered_multimap<uint64_t, Entry> entryMap;
+  size_t byteBudget, byteTotal = 0;
+  std::atomic<uint64_t> hitTotal{0}, missTotal{0};
+};
+
+/* Module wide caches, budgets are the "glyphAtlasBytes" and
+ * "shapedRunBytes" settings
+ */
+GlyphAtlas &glyphAtlas();
+ShapedRunCache &shapedRunCache();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_GLYPH_CACHE_H
@@ -0,0 +1,635 @@
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "bufferPool.hpp"
+#include "jpegDecoder.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+enum Marker : uint8_t {
+  sof0 = 0xC0,
+  sof1 = 0xC1,
+  sof15 = 0xCF,
+  dht = 0xC4,
+  dac = 0xCC,
+  rst0 = 0xD0,
+  rst7 = 0xD7,
+  soi = 0xD8,
+  eoi = 0xD9,
+  sos = 0xDA,
+  dqt = 0xDB,
+  dri = 0xDD,
+  app14 = 0xEE
+};
+
+/* Natural order index of each zigzag position */
+const uint8_t zigzagList[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+uint32_t getBE16(const unsigned char *p) {
+  return (uint32_t)p[0] << 8 | p[1];
+}
+
+/* Finds the marker at or after offset, skipping entropy coded bytes,
+ * stuffed zeros and restart markers. offset ends on the segment after it.
+ * @return false at the end of the data
+ */
+bool nextMarker(std::string_view data, size_t &offset, uint8_t &marker) {
+  auto *p = (const unsigned char *)data.data();
+  for (; offset + 1 < data.size(); offset++) {
+    if (p[offset] != 0xFF)
+      continue;
+    uint8_t code = p[offset + 1];
+    if (code == 0 || code == 0xFF || (code >= rst0 && code <= rst7))
+      continue;
+    marker = code;
+    offset += 2;
+    return true;
+  }
+  return false;
+}
+
+/* The payload of the segment at offset, empty if it runs past the end */
+std::string_view segmentAt(std::string_view data, size_t offset) {
+  if (data.size() - offset < 2)
+    return std::string_view();
+  uint32_t length = getBE16((const unsigned char *)data.data() + offset);
+  if (length < 2 || length > data.size() - offset)
+    return std::string_view();
+  return data.substr(offset + 2, length - 2);
+}
+
+class Component {
+public:
+  uint8_t id, h, v, quantIndex, dcIndex, acIndex;
+  int32_t predictor;
+  /* Decoded samples at the output scale, whole MCUs */
+  std::vector<unsigned char> plane;
+  size_t stride;
+};
+
+class Frame {
+public:
+  int32_t width, height;
+  std::vector<Component> componentList;
+  int32_t hMax, vMax, mcuX, mcuY;
+};
+
+/* Reads SOF0 or SOF1 */
+int32_t readFrame(std::string_view segment, Frame &frame) {
+  auto *p = (const unsigned char *)segment.data();
+  if (segment.size() < 6)
+    return MZ_FORMAT_ERROR;
+  if (p[0] != 8)
+    return MZ_SUPPORT_ERROR;
+  frame.height = (int32_t)getBE16(p + 1);
+  frame.width = (int32_t)getBE16(p + 3);
+  size_t componentTotal = p[5];
+  // a height of 0 defers it to a DNL marker, which nobody writes
+  if (frame.width == 0 || frame.height == 0)
+    return MZ_SUPPORT_ERROR;
+  if (componentTotal != 1 && componentTotal != 3)
+    return MZ_SUPPORT_ERROR;
+  if (segment.size() < 6 + componentTotal * 3)
+    return MZ_FORMAT_ERROR;
+  frame.componentList.resize(componentTotal);
+  frame.hMax = frame.vMax = 1;
+  for (size_t i = 0; i < componentTotal; i++) {
+    Component &component = frame.componentList[i];
+    component.id = p[6 + i * 3];
+    component.h = p[7 + i * 3] >> 4;
+    component.v = p[7 + i * 3] & 15;
+    component.quantIndex = p[8 + i * 3];
+    if (component.h < 1 || component.h > 4 || component.v < 1 ||
+        component.v > 4 || component.quantIndex > 3)
+      return MZ_FORMAT_ERROR;
+    frame.hMax = std::max<int32_t>(frame.hMax, component.h);
+    frame.vMax = std::max<int32_t>(frame.vMax, component.v);
+  }
+  frame.mcuX = (frame.width + 8 * frame.hMax - 1) / (8 * frame.hMax);
+  frame.mcuY = (frame.height + 8 * frame.vMax - 1) / (8 * frame.vMax);
+  return MZ_OK;
+}
+
+/* A canonical Huffman code: codes up to 9 bits from one lookup, longer
+ * ones by comparing against the last code of each length
+ */
+class HuffmanTable {
+public:
+  uint8_t fastLength[512], fastValue[512];
+  int32_t codeEnd[17], valueOffset[17];
+  uint8_t valueList[256];
+  bool defined = false;
+};
+
+/* Reads the table of a DHT segment at offset, its class and index byte
+ * first, and moves past it
+ */
+int32_t readHuffmanTable(std::string_view segment, size_t &offset,
+                         HuffmanTable &table) {
+  auto *p = (const unsigned char *)segment.data() + offset;
+  if (segment.size() - offset < 17)
+    return MZ_FORMAT_ERROR;
+  size_t valueTotal = 0;
+  for (int length = 1; length <= 16; length++)
+    valueTotal += p[length];
+  if (valueTotal > 256 || segment.size() - offset - 17 < valueTotal)
+    return MZ_FORMAT_ERROR;
+  std::memset(table.fastLength, 0, sizeof(table.fastLength));
+  std::memcpy(table.valueList, p + 17, valueTotal);
+  int32_t code = 0, index = 0;
+  for (int length = 1; length <= 16; length++) {
+    table.valueOffset[length] = index - code;
+    for (int i = 0; i < p[length]; i++, code++, index++) {
+      if (code >= 1 << length)
+        return MZ_FORMAT_ERROR;
+      if (length > 9)
+        continue;
+      int32_t first = code << (9 - length), last = (code + 1) << (9 - length);
+      for (int32_t fast = first; fast < last; fast++) {
+        table.fastLength[fast] = (uint8_t)length;
+        table.fastValue[fast] = table.valueList[index];
+      }
+    }
+    table.codeEnd[length] = code;
+    code <<= 1;
+  }
+  table.defined = true;
+  offset += 17 + valueTotal;
+  return MZ_OK;
+}
+
+/* Entropy coded bits, most significant first. Past a marker or the end
+ * it reads zeros, so a truncated image decodes to grey.
+ */
+class BitReader {
+public:
+  const unsigned char *p, *end;
+  uint64_t buffer = 0;
+  int32_t bitTotal = 0;
+  bool markerHit = false;
+
+  /* At least 57 bits buffered after */
+  void fill() {
+    while (bitTotal <= 56) {
+      uint64_t byte = 0;
+      if (p < end && !markerHit) {
+        if (*p != 0xFF) {
+          byte = *p++;
+        } else if (end - p > 1 && p[1] == 0) {
+          byte = 0xFF;
+          p += 2;
+        } else {
+          markerHit = true;
+        }
+      }
+      buffer |= byte << (56 - bitTotal);
+      bitTotal += 8;
+    }
+  }
+  uint32_t peek(int32_t length) const {
+    return (uint32_t)(buffer >> (64 - length));
+  }
+  void skip(int32_t length) {
+    buffer <<= length;
+    bitTotal -= length;
+  }
+  /* Drops buffered bits and steps over the next restart marker */
+  void restart() {
+    buffer = 0;
+    bitTotal = 0;
+    markerHit = false;
+    while (end - p > 1 && !(p[0] == 0xFF && p[1] >= rst0 && p[1] <= rst7))
+      p++;
+    if (end - p > 1)
+      p += 2;
+  }
+};
+
+/* @return the symbol, or -1 for a code not in the table */
+int32_t decodeSymbol(BitReader &reader, const HuffmanTable &table) {
+  reader.fill();
+  uint32_t fast = reader.peek(9);
+  if (table.fastLength[fast]) {
+    reader.skip(table.fastLength[fast]);
+    return table.fastValue[fast];
+  }
+  uint32_t bits = reader.peek(16);
+  for (int32_t length = 10; length <= 16; length++) {
+    int32_t code = (int32_t)(bits >> (16 - length));
+    if (code < table.codeEnd[length]) {
+      reader.skip(length);
+      return table.valueList[code + table.valueOffset[length]];
+    }
+  }
+  return -1;
+}
+
+/* The signed value of the next length bits, buffered by decodeSymbol */
+int32_t receive(BitReader &reader, int32_t length) {
+  if (length == 0)
+    return 0;
+  int32_t value = (int32_t)reader.peek(length);
+  reader.skip(length);
+  return value < 1 << (length - 1) ? value - (1 << length) + 1 : value;
+}
+
+/* idctTable[n][x][u] = C(u) / 2 * cos((2x + 1) u pi / 2n), the n point
+ * inverse DCT of the lowest n coefficients. The mean of the 8 point one is
+ * kept, so the n x n output is the block at 1/(8/n) scale.
+ */
+class IdctTable {
+public:
+  float table[4][8][8];
+  IdctTable() {
+    const double pi = 3.14159265358979323846;
+    for (int scale = 0; scale < 4; scale++) {
+      int32_t n = 1 << scale;
+      for (int32_t x = 0; x < n; x++)
+        for (int32_t u = 0; u < n; u++)
+          table[scale][x][u] =
+              (float)((u == 0 ? std::sqrt(0.5) : 1.0) / 2 *
+                      std::cos((2 * x + 1) * u * pi / (2 * n)));
+    }
+  }
+};
+
+const IdctTable idctTable;
+
+unsigned char clampSample(float value) {
+  // truncating a negative rounds up, but those clamp to 0 anyway
+  int32_t sample = (int32_t)(value + 128.5f);
+  return (unsigned char)std::min(255, std::max(0, sample));
+}
+
+/* The separable n point transform, unrolled for each n */
+template <int32_t n>
+void inverseDctRows(const int32_t *coef, uint32_t rowMask, const float (*t)[8],
+                    unsigned char *out, size_t stride) {
+  float rowList[n][n];
+  for (int32_t v = 0; v < n; v++) {
+    for (int32_t x = 0; x < n; x++) {
+      float sum = 0;
+      if (rowMask >> v & 1)
+        for (int32_t u = 0; u < n; u++)
+          sum += t[x][u] * (float)coef[v * 8 + u];
+      rowList[v][x] = sum;
+    }
+  }
+  for (int32_t y = 0; y < n; y++) {
+    for (int32_t x = 0; x < n; x++) {
+      float sum = 0;
+      for (int32_t v = 0; v < n; v++)
+        sum += t[y][v] * rowList[v][x];
+      out[y * stride + x] = clampSample(sum);
+    }
+  }
+}
+
+/* n x n samples of the dequantized natural order coef into out. Bit v of
+ * rowMask is set when row v has a coefficient other than 0, most rows of
+ * most blocks have none.
+ */
+void inverseDct(const int32_t *coef, uint32_t rowMask, bool acSeen,
+                int32_t scale, unsigned char *out, size_t stride) {
+  int32_t n = 1 << scale;
+  rowMask &= (1u << n) - 1;
+  if (!acSeen || rowMask == 0) {
+    // flat block, the DC alone
+    unsigned char sample = clampSample(rowMask ? coef[0] / 8.0f : 0.0f);
+    for (int32_t y = 0; y < n; y++)
+      std::memset(out + y * stride, sample, n);
+    return;
+  }
+  const float(*t)[8] = idctTable.table[scale];
+  switch (scale) {
+  case 3:
+    return inverseDctRows<8>(coef, rowMask, t, out, stride);
+  case 2:
+    return inverseDctRows<4>(coef, rowMask, t, out, stride);
+  case 1:
+    return inverseDctRows<2>(coef, rowMask, t, out, stride);
+  default:
+    return inverseDctRows<1>(coef, rowMask, t, out, stride);
+  }
+}
+
+class ScanState {
+public:
+  HuffmanTable dcList[4], acList[4];
+  uint16_t quantList[4][64];
+  bool quantDefined[4] = {false, false, false, false};
+  uint32_t restartInterval = 0;
+  int32_t scale;
+};
+
+/* One block: the Huffman decode, dequantization and the inverse DCT */
+int32_t decodeBlock(BitReader &reader, const ScanState &state,
+                    Component &component, unsigned char *out) {
+  const HuffmanTable &dc = state.dcList[component.dcIndex];
+  const HuffmanTable &ac = state.acList[component.acIndex];
+  const uint16_t *quant = state.quantList[component.quantIndex];
+  int32_t coef[64];
+  std::memset(coef, 0, sizeof(coef));
+  int32_t length = decodeSymbol(reader, dc);
+  if (length < 0 || length > 11)
+    return MZ_DATA_ERROR;
+  component.predictor += receive(reader, length);
+  coef[0] = component.predictor * quant[0];
+  uint32_t rowMask = coef[0] ? 1 : 0;
+  bool acSeen = false;
+  for (int32_t k = 1; k < 64;) {
+    int32_t symbol = decodeSymbol(reader, ac);
+    if (symbol < 0)
+      return MZ_DATA_ERROR;
+    int32_t run = symbol >> 4, size = symbol & 15;
+    if (size == 0) {
+      if (run != 15)
+        break;
+      k += 16;
+      continue;
+    }
+    k += run;
+    if (k > 63)
+      return MZ_DATA_ERROR;
+    uint8_t index = zigzagList[k++];
+    coef[index] = receive(reader, size) * quant[k - 1];
+    rowMask |= 1u << (index >> 3);
+    acSeen = true;
+  }
+  inverseDct(coef, rowMask, acSeen, state.scale, out, component.stride);
+  return MZ_OK;
+}
+
+/* The entropy coded data of one scan from offset, which is left past it */
+int32_t decodeScan(std::string_view data, size_t &offset,
+                   std::string_view header, Frame &frame,
+                   ScanState &state) {
+  auto *p = (const unsigned char *)header.data();
+  if (header.empty() || header.size() < 4 + (size_t)p[0] * 2)
+    return MZ_FORMAT_ERROR;
+  size_t scanTotal = p[0];
+  std::vector<Component *> scanList;
+  for (size_t i = 0; i < scanTotal; i++) {
+    uint8_t id = p[1 + i * 2], tables = p[2 + i * 2];
+    Component *component = nullptr;
+    for (Component &candidate : frame.componentList)
+      if (candidate.id == id)
+        component = &candidate;
+    if (!component || (tables >> 4) > 3 || (tables & 15) > 3)
+      return MZ_FORMAT_ERROR;
+    component->dcIndex = tables >> 4;
+    component->acIndex = tables & 15;
+    if (!state.dcList[component->dcIndex].defined ||
+        !state.acList[component->acIndex].defined ||
+        !state.quantDefined[component->quantIndex])
+      return MZ_FORMAT_ERROR;
+    component->predictor = 0;
+    scanList.push_back(component);
+  }
+  if (scanList.empty())
+    return MZ_FORMAT_ERROR;
+
+  BitReader reader;
+  reader.p = (const unsigned char *)data.data() + offset;
+  reader.end = (const unsigned char *)data.data() + data.size();
+  int32_t n = 1 << state.scale;
+  // one component alone is coded block by block, not in MCUs
+  bool interleaved = scanList.size() > 1;
+  int32_t unitX, unitY;
+  if (interleaved) {
+    unitX = frame.mcuX;
+    unitY = frame.mcuY;
+  } else {
+    Component &component = *scanList[0];
+    int32_t sampleX =
+        (frame.width * component.h + frame.hMax - 1) / frame.hMax;
+    int32_t sampleY =
+        (frame.height * component.v + frame.vMax - 1) / frame.vMax;
+    unitX = (sampleX + 7) / 8;
+    unitY = (sampleY + 7) / 8;
+  }
+  uint32_t unitCount = 0;
+  for (int32_t unitRow = 0; unitRow < unitY; unitRow++) {
+    for (int32_t unitColumn = 0; unitColumn < unitX; unitColumn++) {
+      if (state.restartInterval && unitCount &&
+          unitCount % state.restartInterval == 0) {
+        reader.restart();
+        for (Component *component : scanList)
+          component->predictor = 0;
+      }
+      unitCount++;
+      for (Component *component : scanList) {
+        int32_t blockX = interleaved ? component->h : 1;
+        int32_t blockY = interleaved ? component->v : 1;
+        for (int32_t by = 0; by < blockY; by++) {
+          for (int32_t bx = 0; bx < blockX; bx++) {
+            size_t row = (size_t)(unitRow * blockY + by) * n;
+            size_t column = (size_t)(unitColumn * blockX + bx) * n;
+            int32_t err = decodeBlock(
+                reader, state, *component,
+                component->plane.data() + row * component->stride + column);
+            if (err != MZ_OK)
+              return err;
+          }
+        }
+      }
+    }
+  }
+  offset = (size_t)(reader.p - (const unsigned char *)data.data());
+  return MZ_OK;
+}
+
+} // namespace
+
+int32_t JpegDecoder::open(std::string_view data_) {
+  data = data_;
+  width = height = 0;
+  auto *p = (const unsigned char *)data.data();
+  if (data.size() < 4 || p[0] != 0xFF || p[1] != soi)
+    return MZ_FORMAT_ERROR;
+  size_t offset = 2;
+  uint8_t marker;
+  while (nextMarker(data, offset, marker)) {
+    if (marker == sos || marker == eoi)
+      break;
+    std::string_view segment = segmentAt(data, offset);
+    if (segment.empty())
+      return MZ_FORMAT_ERROR;
+    if (marker >= sof0 && marker <= sof15 && marker != dht &&
+        marker != dac && marker != 0xC8) {
+      if (marker != sof0 && marker != sof1)
+        return MZ_SUPPORT_ERROR;
+      Frame frame;
+      int32_t err = readFrame(segment, frame);
+      if (err != MZ_OK)
+        return err;
+      if ((uint64_t)frame.width * frame.height > imagePixelMax)
+        return MZ_MEM_ERROR;
+      width = frame.width;
+      height = frame.height;
+      return MZ_OK;
+    }
+    offset += segment.size() + 2;
+  }
+  return MZ_FORMAT_ERROR;
+}
+
+int32_t JpegDecoder::decode(uint32_t scaleDenominator, RasterImage &image) {
+  int32_t scale;
+  switch (scaleDenominator) {
+  case 1:
+    scale = 3;
+    break;
+  case 2:
+    scale = 2;
+    break;
+  case 4:
+    scale = 1;
+    break;
+  case 8:
+    scale = 0;
+    break;
+  default:
+    return MZ_PARAM_ERROR;
+  }
+  if (width == 0)
+    return MZ_PARAM_ERROR;
+  Frame frame;
+  frame.width = 0;
+  ScanState state;
+  state.scale = scale;
+  int32_t n = 1 << scale;
+  int32_t adobeTransform = -1;
+  bool scanned = false;
+  size_t offset = 2;
+  uint8_t marker;
+  while (nextMarker(data, offset, marker) && marker != eoi) {
+    std::string_view segment = segmentAt(data, offset);
+    if (segment.empty())
+      return MZ_FORMAT_ERROR;
+    auto *p = (const unsigned char *)segment.data();
+    offset += segment.size() + 2;
+    int32_t err = MZ_OK;
+    if (marker == sof0 || marker == sof1) {
+      err = readFrame(segment, frame);
+      for (Component &component : frame.componentList) {
+        component.stride = (size_t)frame.mcuX * component.h * n;
+        component.plane.assign(
+            component.stride * ((size_t)frame.mcuY * component.v * n), 0);
+      }
+    } else if (marker == dht) {
+      for (size_t tableOffset = 0;
+           err == MZ_OK && tableOffset < segment.size();) {
+        uint8_t index = p[tableOffset] & 15, tableClass = p[tableOffset] >> 4;
+        if (index > 3 || tableClass > 1)
+          return MZ_FORMAT_ERROR;
+        err = readHuffmanTable(segment, tableOffset,
+                               tableClass ? state.acList[index]
+                                          : state.dcList[index]);
+      }
+    } else if (marker == dqt) {
+      for (size_t tableOffset = 0; tableOffset < segment.size();) {
+        uint8_t index = p[tableOffset] & 15, precision = p[tableOffset] >> 4;
+        size_t tableBytes = precision ? 128 : 64;
+        if (index > 3 || precision > 1 ||
+            segment.size() - tableOffset - 1 < tableBytes)
+          return MZ_FORMAT_ERROR;
+        // kept in zigzag order, as coefficients arrive
+        const unsigned char *value = p + tableOffset + 1;
+        for (int k = 0; k < 64; k++)
+          state.quantList[index][k] =
+              (uint16_t)(precision ? getBE16(value + k * 2) : value[k]);
+        state.quantDefined[index] = true;
+        tableOffset += 1 + tableBytes;
+      }
+    } else if (marker == dri) {
+      if (segment.size() < 2)
+        return MZ_FORMAT_ERROR;
+      state.restartInterval = getBE16(p);
+    } else if (marker == app14) {
+      if (segment.size() >= 12 && std::memcmp(p, "Adobe", 5) == 0)
+        adobeTransform = p[11];
+    } else if (marker == sos) {
+      if (frame.width == 0)
+        return MZ_FORMAT_ERROR;
+      err = decodeScan(data, offset, segment, frame, state);
+      scanned = true;
+    } else if (marker >= sof0 && marker <= sof15 && marker != dac &&
+               marker != 0xC8) {
+      return MZ_SUPPORT_ERROR;
+    }
+    if (err != MZ_OK)
+      return err;
+  }
+  if (!scanned)
+    return MZ_FORMAT_ERROR;
+
+  image.width = (width * n + 7) / 8;
+  image.height = (height * n + 7) / 8;
+  image.stride = (size_t)image.width * 4;
+  image.pixels = pixmapBufferPool().acquire(image.byteSize());
+  const std::vector<Component> &componentList = frame.componentList;
+  bool gray = componentList.size() == 1;
+  bool rgb = !gray && (adobeTransform == 0 ||
+                       (componentList[0].id == 'R' &&
+                        componentList[1].id == 'G' &&
+                        componentList[2].id == 'B'));
+  // nearest neighbour upsampling of subsampled components
+  std::vector<size_t> columnList[3];
+  for (size_t c = 0; c < componentList.size(); c++) {
+    columnList[c].resize(image.width);
+    for (int32_t x = 0; x < image.width; x++)
+      columnList[c][x] = (size_t)x * componentList[c].h / frame.hMax;
+  }
+  for (int32_t y = 0; y < image.height; y++) {
+    const unsigned char *rowList[3];
+    for (size_t c = 0; c < componentList.size(); c++)
+      rowList[c] = componentList[c].plane.data() +
+                   (size_t)y * componentList[c].v / frame.vMax *
+                       componentList[c].stride;
+    unsigned char *out = image.pixels.get() + (size_t)y * image.stride;
+    for (int32_t x = 0; x < image.width; x++, out += 4) {
+      int32_t first = rowList[0][columnList[0][x]];
+      if (gray) {
+        out[0] = out[1] = out[2] = (unsigned char)first;
+      } else if (rgb) {
+        out[0] = (unsigned char)first;
+        out[1] = rowList[1][columnList[1][x]];
+        out[2] = rowList[2][columnList[2][x]];
+      } else {
+        // JFIF YCbCr in 16.16 fixed point
+        int32_t cb = rowList[1][columnList[1][x]] - 128;
+        int32_t cr = rowList[2][columnList[2][x]] - 128;
+        int32_t r = first + ((91881 * cr + 32768) >> 16);
+        int32_t g = first - ((22554 * cb + 46802 * cr - 32768) >> 16);
+        int32_t b = first + ((116130 * cb + 32768) >> 16);
+        out[0] = (unsigned char)std::min(255, std::max(0, r));
+        out[1] = (unsigned char)std::min(255, std::max(0, g));
+        out[2] = (unsigned char)std::min(255, std::max(0, b));
+      }
+      out[3] = 255;
+    }
+  }
+  return MZ_OK;
+}
+
+} // namespace bookfiler
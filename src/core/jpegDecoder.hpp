@@ -0,0 +1,56 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_JPEG_DECODER_H
+#define BOOKFILER_MODULE_DOCX_JPEG_DECODER_H
+
+// C++
+#include <cstdint>
+#include <string_view>
+
+// Local Project
+#include "tileCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* JpegDecoder
+ * Baseline and extended Huffman JPEG, 8 bit, gray or three components, the
+ * kind cameras and office suites write. The image can come out at 1/2, 1/4
+ * or 1/8 of its size straight from the DCT coefficients, which skips most
+ * of the inverse transform for images drawn smaller than they are.
+ * Progressive and arithmetic coding, 12 bit samples and CMYK are not
+ * supported.
+ */
+class JpegDecoder {
+public:
+  /* Reads the markers up to the frame header.
+   * MZ_FORMAT_ERROR	-103	not a JPEG or a broken header
+   * MZ_SUPPORT_ERROR	-109	a coding process that is not supported
+   * MZ_MEM_ERROR	-4	more pixels than imagePixelMax
+   */
+  int32_t open(std::string_view data);
+  int32_t getWidth() const { return width; }
+  int32_t getHeight() const { return height; }
+  /* The image divided by scaleDenominator, 1, 2, 4 or 8, rounded up, into
+   * a buffer from pixmapBufferPool()
+   * MZ_PARAM_ERROR	-102	another denominator, or open failed
+   * MZ_DATA_ERROR	-3	broken entropy coded data
+   */
+  int32_t decode(uint32_t scaleDenominator, RasterImage &image);
+
+private:
+  std::string_view data;
+  int32_t width = 0, height = 0;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_JPEG_DECODER_H
@@ -0,0 +1,826 @@
+// C++
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Local Project
+#include "layout.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const int32_t emuPerTwip = 635;
+const int32_t defaultTabStop = 720;
+// Word's default left and right cell margin
+const int32_t cellMargin = 108;
+const int32_t lineSingle = 240;
+// narrowest column a paragraph is broken for
+const int32_t widthMin = 240;
+// paragraphs a worker takes at a time when measuring in parallel
+const size_t measureChunk = 64;
+
+int32_t valueOr(int32_t value, int32_t fallback) {
+  return value == propertyUnset ? fallback : value;
+}
+
+bool isWideBreak(uint32_t codePoint) {
+  // ideographs and kana can break between any two characters
+  return (codePoint >= 0x2E80 && codePoint <= 0x9FFF) ||
+         (codePoint >= 0xF900 && codePoint <= 0xFAFF) ||
+         (codePoint >= 0x20000 && codePoint <= 0x3FFFD);
+}
+
+/* Calls task(i) for every i below total on pool, the calling thread taking
+ * chunks too. The caller only waits for chunks that were taken, so it can
+ * not deadlock when it is itself one of pool's workers; helpers that start
+ * after everything was taken return without touching task.
+ */
+void parallelFor(ThreadPool &pool, size_t total,
+                 const std::function<void(size_t)> &task) {
+  size_t chunkTotal = (total + measureChunk - 1) / measureChunk;
+  size_t helperTotal = std::min(pool.size(), chunkTotal);
+  if (helperTotal <= 1) {
+    for (size_t i = 0; i < total; i++)
+      task(i);
+    return;
+  }
+  class Shared {
+  public:
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t doneTotal = 0;
+  };
+  auto shared = std::make_shared<Shared>();
+  const std::function<void(size_t)> *taskPtr = &task;
+  auto work = [shared, taskPtr, total]() {
+    size_t begin;
+    while ((begin = shared->next.fetch_add(measureChunk)) < total) {
+      size_t end = std::min(total, begin + measureChunk);
+      for (size_t i = begin; i < end; i++)
+        (*taskPtr)(i);
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      shared->doneTotal += end - begin;
+      if (shared->doneTotal == total)
+        shared->finished.notify_all();
+    }
+  };
+  for (size_t i = 1; i < helperTotal; i++)
+    pool.submit(work);
+  work();
+  std::unique_lock<std::mutex> lock(shared->mutex);
+  shared->finished.wait(lock, [&]() { return shared->doneTotal == total; });
+}
+
+/* Moves a line or box by how far its paragraph's text and runs moved */
+template <class T> void rebase(T &item, int64_t textDelta, int64_t runDelta) {
+  item.textBegin = (uint32_t)(item.textBegin + textDelta);
+  item.textEnd = (uint32_t)(item.textEnd + textDelta);
+  item.runBegin = (uint32_t)(item.runBegin + runDelta);
+  item.runEnd = (uint32_t)(item.runEnd + runDelta);
+}
+
+/* Same sections, tables and cells, so every paragraph gets the same column
+ * width in both
+ */
+bool sameStructure(const DocumentModel &a, const DocumentModel &b) {
+  if (a.paragraphList.size() != b.paragraphList.size() ||
+      a.sectionList.size() != b.sectionList.size() ||
+      a.tableList.size() != b.tableList.size() ||
+      a.cellList.size() != b.cellList.size())
+    return false;
+  for (size_t i = 0; i < a.sectionList.size(); i++) {
+    const DocumentSection &x = a.sectionList[i], &y = b.sectionList[i];
+    if (x.paragraphEnd != y.paragraphEnd || x.pageWidth != y.pageWidth ||
+        x.pageHeight != y.pageHeight || x.marginTop != y.marginTop ||
+        x.marginBottom != y.marginBottom || x.marginLeft != y.marginLeft ||
+        x.marginRight != y.marginRight)
+      return false;
+  }
+  for (size_t i = 0; i < a.tableList.size(); i++) {
+    const DocumentTable &x = a.tableList[i], &y = b.tableList[i];
+    if (x.paragraphBegin != y.paragraphBegin ||
+        x.paragraphEnd != y.paragraphEnd || x.cellBegin != y.cellBegin ||
+        x.columnCount != y.columnCount || x.parentCell != y.parentCell)
+      return false;
+  }
+  for (size_t i = 0; i < a.cellList.size(); i++) {
+    const DocumentCell &x = a.cellList[i], &y = b.cellList[i];
+    if (x.tableIndex != y.tableIndex || x.row != y.row ||
+        x.columnSpan != y.columnSpan || x.width != y.width ||
+        x.paragraphBegin != y.paragraphBegin ||
+        x.paragraphEnd != y.paragraphEnd)
+      return false;
+  }
+  for (size_t i = 0; i < a.paragraphList.size(); i++) {
+    if (a.paragraphList[i].cellIndex != b.paragraphList[i].cellIndex)
+      return false;
+  }
+  return true;
+}
+
+/* LineBreaker
+ * Greedy line filling. Widths are kept in 1/1000 twip, an advance in
+ * 1/1000 em times the font size in twips, so rounding never accumulates.
+ */
+class LineBreaker {
+public:
+  LineBreaker(std::vector<LayoutLine> &lineList_,
+              const ParagraphProperties &properties, int32_t width,
+              int32_t emptyHeight_, uint32_t textBegin)
+      : lineList(lineList_), emptyHeight(emptyHeight_), lineBegin(textBegin) {
+    int32_t indent = std::max(0, valueOr(properties.indentLeft, 0)) +
+                     std::max(0, valueOr(properties.indentRight, 0));
+    int32_t restWidth = std::max(width - indent, widthMin);
+    int32_t firstWidth = std::max(
+        restWidth - valueOr(properties.indentFirstLine, 0), widthMin);
+    available = (int64_t)firstWidth * 1000;
+    restAvailable = (int64_t)restWidth * 1000;
+    lineRule = properties.lineRule;
+    spacingLine = valueOr(properties.spacingLine, lineSingle);
+  }
+
+  int64_t getLineWidth() const { return lineWidth; }
+  /* Run the following add() calls belong to */
+  void setRun(uint32_t runIndex) { runCursor = runIndex; }
+
+  /* One character or object ending at textEnd */
+  void add(uint32_t textBegin, uint32_t textEnd, int64_t advance,
+           int32_t height, bool isSpace, bool breakAfter) {
+    if (!isSpace && lineWidth > 0 && lineWidth + advance > available) {
+      if (breakOffset != documentNone) {
+        uint32_t nextRunBegin = runAfterBreak;
+        emit(breakOffset, breakRunEnd, breakWidth, heightAtBreak, false);
+        lineRunBegin = nextRunBegin;
+        lineWidth -= widthAtBreak;
+        contentWidth = lineWidth;
+        lineHeight = heightSinceBreak;
+      } else {
+        emit(textBegin, contentRunEnd, contentWidth, lineHeight, false);
+        lineWidth = contentWidth = 0;
+        lineHeight = 0;
+        lineBegin = textBegin;
+      }
+    }
+    if (lineRunBegin == documentNone)
+      lineRunBegin = runCursor;
+    if (runAfterBreak == documentNone)
+      runAfterBreak = runCursor;
+    contentRunEnd = runCursor + 1;
+    lineWidth += advance;
+    lineHeight = std::max(lineHeight, height);
+    heightSinceBreak = std::max(heightSinceBreak, height);
+    if (!isSpace)
+      contentWidth = lineWidth;
+    if (isSpace || breakAfter)
+      allowBreak(textEnd);
+  }
+
+  /* Break opportunity at textOffset, before whatever is added next */
+  void allowBreak(uint32_t textOffset) {
+    breakOffset = textOffset;
+    breakRunEnd = contentRunEnd;
+    runAfterBreak = documentNone;
+    breakWidth = contentWidth;
+    widthAtBreak = lineWidth;
+    heightAtBreak = lineHeight;
+    heightSinceBreak = 0;
+  }
+
+  void forceBreak(uint32_t textEnd, bool pageBreak) {
+    emit(textEnd, contentRunEnd, contentWidth, lineHeight, pageBreak);
+    lineWidth = contentWidth = 0;
+    lineHeight = 0;
+  }
+
+  void finish(uint32_t textEnd) {
+    emit(textEnd, contentRunEnd, contentWidth, lineHeight, false);
+  }
+
+private:
+  void emit(uint32_t textEnd, uint32_t runEnd, int64_t width, int32_t height,
+            bool pageBreak) {
+    if (height == 0)
+      height = emptyHeight;
+    if (lineRule == ParagraphProperties::lineExact)
+      height = std::abs(spacingLine);
+    else if (lineRule == ParagraphProperties::lineAtLeast)
+      height = std::max(height, spacingLine);
+    else
+      height = (int32_t)((int64_t)height * spacingLine / lineSingle);
+    uint32_t runBegin = lineRunBegin == documentNone ? runEnd : lineRunBegin;
+    lineList.push_back({lineBegin, textEnd, runBegin, runEnd,
+                               (int32_t)(width / 1000), height, pageBreak});
+    lineBegin = textEnd;
+    lineRunBegin = documentNone;
+    available = restAvailable;
+    breakOffset = documentNone;
+    heightSinceBreak = 0;
+  }
+
+  std::vector<LayoutLine> &lineList;
+  int32_t emptyHeight, spacingLine;
+  uint8_t lineRule;
+  uint32_t lineBegin, breakOffset = documentNone;
+  uint32_t runCursor = 0, lineRunBegin = documentNone, contentRunEnd = 0,
+           breakRunEnd = 0, runAfterBreak = documentNone;
+  int64_t available, restAvailable;
+  int64_t lineWidth = 0, contentWidth = 0, breakWidth = 0, widthAtBreak = 0;
+  int32_t lineHeight = 0, heightAtBreak = 0, heightSinceBreak = 0;
+};
+
+} // namespace
+
+int32_t ParagraphLayout::getLineHeightTotal() const {
+  int32_t height = 0;
+  for (const LayoutLine &line : lineList)
+    height += line.height;
+  return height;
+}
+
+void ParagraphLayout::clear() {
+  lineList.clear();
+  spacingBefore = spacingAfter = 0;
+  flags = 0;
+  columnWidth = propertyUnset;
+  textBase = runBase = 0;
+}
+
+DocumentLayout::DocumentLayout(const DocumentModel &model_,
+                               LayoutOptions options_)
+    : model(model_), options(options_) {
+  fontMetricsList.resize(model.stringPool.size());
+  for (size_t i = 0; i < fontMetricsList.size(); i++)
+    fontMetricsList[i] = &FontMetrics::get(model.stringPool.get((uint32_t)i));
+}
+
+void DocumentLayout::measureParagraph(uint32_t paragraphIndex, int32_t width,
+                                      ParagraphLayout &layout) const {
+  layout.clear();
+  const DocumentParagraph &paragraph = model.paragraphList[paragraphIndex];
+  const ParagraphProperties &paragraphProperties =
+      model.getParagraphProperties(paragraph);
+  layout.spacingBefore =
+      std::max(0, valueOr(paragraphProperties.spacingBefore, 0));
+  layout.spacingAfter =
+      std::max(0, valueOr(paragraphProperties.spacingAfter, 0));
+  layout.flags = paragraphProperties.flags;
+
+  const FontMetrics &defaultMetrics = *fontMetricsList[0];
+  int32_t emptyHeight =
+      options.defaultHalfPoints * 10 * defaultMetrics.lineHeight / 1000;
+  uint32_t textBegin = paragraph.runBegin < paragraph.runEnd
+                           ? model.runList[paragraph.runBegin].textOffset
+                           : 0;
+  layout.columnWidth = width;
+  layout.textBase = textBegin;
+  layout.runBase =
+      paragraph.runBegin < paragraph.runEnd ? paragraph.runBegin : 0;
+  // broken into a scratch list, then copied out at its exact size
+  thread_local std::vector<LayoutLine> lineScratch;
+  lineScratch.clear();
+  LineBreaker breaker(lineScratch, paragraphProperties, width, emptyHeight,
+                      textBegin);
+  uint32_t textEnd = textBegin;
+
+  for (uint32_t runIndex = paragraph.runBegin; runIndex < paragraph.runEnd;
+       runIndex++) {
+    const DocumentRun &run = model.runList[runIndex];
+    const RunProperties &runProperties = model.getRunProperties(run);
+    textEnd = run.textOffset + run.textLength;
+    if (runProperties.flags & RunProperties::vanish)
+      continue;
+    breaker.setRun(runIndex);
+    int32_t sizeTwips =
+        (runProperties.halfPoints ? runProperties.halfPoints
+                                  : options.defaultHalfPoints) *
+        10;
+    const FontMetrics &metrics = *fontMetricsList[runProperties.fontId];
+    int32_t height = sizeTwips * metrics.lineHeight / 1000;
+    if (runProperties.flags &
+        (RunProperties::superscript | RunProperties::subscript))
+      sizeTwips = sizeTwips * 2 / 3;
+
+    if (run.objectIndex != documentNone) {
+      const DocumentObject &object = model.objectList[run.objectIndex];
+      breaker.allowBreak(run.textOffset);
+      breaker.add(run.textOffset, textEnd, object.width * 1000 / emuPerTwip,
+                  (int32_t)(object.height / emuPerTwip), false, true);
+      continue;
+    }
+
+    bool bold = (runProperties.flags & RunProperties::bold) != 0;
+    bool caps = (runProperties.flags & RunProperties::caps) != 0;
+    const char *runText = model.text.data() + run.textOffset;
+    const char *p = runText, *end = runText + run.textLength;
+    while (p < end) {
+      uint32_t charBegin = run.textOffset + (uint32_t)(p - runText);
+      uint32_t codePoint = utf8Next(p, end);
+      uint32_t charEnd = run.textOffset + (uint32_t)(p - runText);
+      switch (codePoint) {
+      case ' ':
+        breaker.add(charBegin, charEnd,
+                    (int64_t)metrics.advance(' ', bold) * sizeTwips, height,
+                    true, false);
+        break;
+      case '\t': {
+        int64_t stop = (int64_t)defaultTabStop * 1000;
+        int64_t position = breaker.getLineWidth();
+        breaker.add(charBegin, charEnd, (position / stop + 1) * stop - position,
+                    height, true, false);
+        break;
+      }
+      case '\n':
+        breaker.add(charBegin, charBegin, 0, height, false, false);
+        breaker.forceBreak(charEnd, false);
+        break;
+      case '\f':
+        breaker.forceBreak(charEnd, true);
+        break;
+      default:
+        if (caps && codePoint >= 'a' && codePoint <= 'z')
+          codePoint -= 'a' - 'A';
+        breaker.add(charBegin, charEnd,
+                    (int64_t)metrics.advance(codePoint, bold) * sizeTwips,
+                    height, false,
+                    codePoint == '-' || codePoint == 0xAD ||
+                        isWideBreak(codePoint));
+        break;
+      }
+    }
+  }
+  breaker.finish(textEnd);
+  layout.lineList.assign(lineScratch.begin(), lineScratch.end());
+}
+
+uint32_t DocumentLayout::paginate(ThreadPool &pool) {
+  stats = Stats();
+  resetParagraphLayouts(model.paragraphList.size());
+  if (options.pageLimit == 0)
+    measureAll(pool, nullptr, std::vector<uint8_t>());
+  pageList.clear();
+  boxList.clear();
+  alignLayout = nullptr;
+  placeFrom(0, 0);
+  if (pageList.empty() && !page.stopped)
+    pageList.push_back({0, 0, 0});
+  stats.placedTotal = (uint32_t)pageList.size();
+  return (uint32_t)pageList.size();
+}
+
+uint32_t DocumentLayout::paginate(const DocumentLayout &previous,
+                                  const std::vector<uint32_t> &dirtyList,
+                                  ThreadPool &pool) {
+  if (options.pageLimit != 0 || previous.options.pageLimit != 0 ||
+      previous.options.recordBoxes != options.recordBoxes ||
+      previous.options.defaultHalfPoints != options.defaultHalfPoints ||
+      previous.paragraphLayoutList.size() != model.paragraphList.size() ||
+      previous.pageList.empty() || !sameStructure(previous.model, model))
+    return paginate(pool);
+  stats = Stats();
+  uint32_t paragraphTotal = (uint32_t)model.paragraphList.size();
+  std::vector<uint8_t> dirtyMask(paragraphTotal, 0);
+  uint32_t firstDirty = paragraphTotal, lastDirty = 0;
+  for (uint32_t paragraphIndex : dirtyList) {
+    if (paragraphIndex >= paragraphTotal)
+      continue;
+    dirtyMask[paragraphIndex] = 1;
+    firstDirty = std::min(firstDirty, paragraphIndex);
+    lastDirty = std::max(lastDirty, paragraphIndex);
+  }
+  resetParagraphLayouts(paragraphTotal);
+  measureAll(pool, &previous, dirtyMask);
+  pageList.clear();
+  boxList.clear();
+  uint32_t previousTotal = (uint32_t)previous.pageList.size();
+  if (firstDirty == paragraphTotal) {
+    copyPages(previous, 0, previousTotal);
+    stats.copiedTotal = previousTotal;
+    return (uint32_t)pageList.size();
+  }
+
+  // the first of the pages starting at the last item at or before the
+  // first dirty paragraph, a row taller than a page starts several
+  uint32_t restart = 0;
+  for (uint32_t pageIndex = previousTotal; pageIndex-- > 0;) {
+    const LayoutPage &previousPage = previous.pageList[pageIndex];
+    if (previousPage.paragraphIndex <= firstDirty &&
+        previousPage.lineIndex == 0 &&
+        (previousPage.paragraphIndex >= paragraphTotal ||
+         startsItem(previousPage.paragraphIndex))) {
+      restart = pageIndex;
+      break;
+    }
+  }
+  while (restart > 0 && previous.pageList[restart - 1].paragraphIndex ==
+                            previous.pageList[restart].paragraphIndex)
+    restart--;
+  copyPages(previous, 0, restart);
+  stats.copiedTotal = restart;
+
+  alignLayout = &previous;
+  alignAfter = lastDirty;
+  alignPage = documentNone;
+  const LayoutPage &restartPage = previous.pageList[restart];
+  placeFrom(restartPage.sectionIndex, restartPage.paragraphIndex);
+  stats.placedTotal = (uint32_t)pageList.size() - restart;
+  if (alignPage != documentNone) {
+    copyPages(previous, alignPage, previousTotal);
+    stats.copiedTotal += previousTotal - alignPage;
+  }
+  alignLayout = nullptr;
+  if (pageList.empty())
+    pageList.push_back({0, 0, 0});
+  return (uint32_t)pageList.size();
+}
+
+size_t DocumentLayout::memoryUsage() const {
+  return pageList.capacity() * sizeof(LayoutPage) +
+         boxList.capacity() * sizeof(LayoutBox) +
+         paragraphLayoutList.capacity() * sizeof(ParagraphLayout) +
+         fontMetricsList.capacity() * sizeof(const FontMetrics *) +
+         lineArena.getStats().chunkBytes;
+}
+
+void DocumentLayout::resetParagraphLayouts(size_t paragraphTotal) {
+  paragraphLayoutList.clear();
+  lineArena.release();
+  paragraphLayoutList.reserve(paragraphTotal);
+  for (size_t i = 0; i < paragraphTotal; i++)
+    paragraphLayoutList.emplace_back(&lineArena);
+}
+
+void DocumentLayout::measureAll(ThreadPool &pool,
+                                const DocumentLayout *previous,
+                                const std::vector<uint8_t> &dirtyMask) {
+  uint32_t paragraphTotal = (uint32_t)model.paragraphList.size();
+  std::vector<int32_t> widthList(paragraphTotal, 0);
+  uint32_t paragraphBegin = 0;
+  for (const DocumentSection &section : model.sectionList) {
+    uint32_t paragraphEnd = std::min(section.paragraphEnd, paragraphTotal);
+    for (uint32_t i = paragraphBegin; i < paragraphEnd; i++)
+      widthList[i] = bodyWidth(section);
+    paragraphBegin = std::max(paragraphBegin, paragraphEnd);
+  }
+  // the same widths placeTable breaks top level cells for, nested tables
+  // are measured at the width of their cell
+  for (const DocumentCell &cell : model.cellList) {
+    if (model.tableList[cell.tableIndex].parentCell != documentNone ||
+        cell.paragraphBegin >= cell.paragraphEnd)
+      continue;
+    int32_t columnWidth =
+        cellWidth(cell, widthList[cell.paragraphBegin]) - 2 * cellMargin;
+    for (uint32_t i = cell.paragraphBegin; i < cell.paragraphEnd; i++)
+      widthList[i] = columnWidth;
+  }
+
+  std::vector<uint32_t> measureList;
+  for (uint32_t i = 0; i < paragraphTotal; i++) {
+    if (previous && !dirtyMask[i] &&
+        previous->paragraphLayoutList[i].columnWidth == widthList[i]) {
+      ParagraphLayout &layout = paragraphLayoutList[i];
+      layout = previous->paragraphLayoutList[i];
+      const DocumentParagraph &paragraph = model.paragraphList[i];
+      uint32_t textBase = paragraph.runBegin < paragraph.runEnd
+                              ? model.runList[paragraph.runBegin].textOffset
+                              : 0;
+      uint32_t runBase =
+          paragraph.runBegin < paragraph.runEnd ? paragraph.runBegin : 0;
+      int64_t textDelta = (int64_t)textBase - layout.textBase,
+              runDelta = (int64_t)runBase - layout.runBase;
+      if (textDelta != 0 || runDelta != 0)
+        for (LayoutLine &line : layout.lineList)
+          rebase(line, textDelta, runDelta);
+      layout.textBase = textBase;
+      layout.runBase = runBase;
+      stats.reusedTotal++;
+      continue;
+    }
+    measureList.push_back(i);
+  }
+  parallelFor(pool, measureList.size(), [&](size_t i) {
+    uint32_t paragraphIndex = measureList[i];
+    measureParagraph(paragraphIndex, widthList[paragraphIndex],
+                     paragraphLayoutList[paragraphIndex]);
+  });
+  stats.measuredTotal += (uint32_t)measureList.size();
+}
+
+const ParagraphLayout &DocumentLayout::measured(uint32_t paragraphIndex,
+                                                int32_t width) {
+  ParagraphLayout &layout = paragraphLayoutList[paragraphIndex];
+  if (layout.columnWidth != width) {
+    measureParagraph(paragraphIndex, width, layout);
+    stats.measuredTotal++;
+  }
+  return layout;
+}
+
+int32_t DocumentLayout::bodyWidth(const DocumentSection &section) const {
+  return std::max(section.pageWidth - section.marginLeft - section.marginRight,
+                  widthMin);
+}
+
+int32_t DocumentLayout::cellWidth(const DocumentCell &cell,
+                                  int32_t bodyWidth) const {
+  if (cell.width > 0)
+    return cell.width;
+  int32_t columnTotal =
+      (int32_t)std::max<uint32_t>(model.tableList[cell.tableIndex].columnCount,
+                                  1);
+  int32_t columnSpan = (int32_t)std::max<uint32_t>(cell.columnSpan, 1);
+  return bodyWidth * columnSpan / columnTotal;
+}
+
+void DocumentLayout::placeFrom(uint32_t sectionIndex,
+                               uint32_t paragraphIndex) {
+  page = PageState();
+  for (; sectionIndex < model.sectionList.size() && !page.stopped;
+       sectionIndex++) {
+    const DocumentSection &section = model.sectionList[sectionIndex];
+    page.sectionIndex = sectionIndex;
+    // a negative margin only means the header may overlap the text
+    page.bodyWidth = bodyWidth(section);
+    page.bodyHeight =
+        std::max(section.pageHeight - std::abs(section.marginTop) -
+                     std::abs(section.marginBottom),
+                 widthMin);
+    page.marginLeft = section.marginLeft;
+    page.marginTop = std::abs(section.marginTop);
+    if (!newPage(paragraphIndex, 0))
+      break;
+    while (paragraphIndex < section.paragraphEnd && !page.stopped) {
+      const DocumentParagraph &paragraph = model.paragraphList[paragraphIndex];
+      if (paragraph.cellIndex == documentNone) {
+        placeParagraph(paragraphIndex);
+        paragraphIndex++;
+      } else {
+        paragraphIndex = std::max(
+            placeTable(topTable(paragraph.cellIndex)), paragraphIndex + 1);
+      }
+    }
+  }
+}
+
+void DocumentLayout::copyPages(const DocumentLayout &previous,
+                               uint32_t pageBegin, uint32_t pageEnd) {
+  for (uint32_t pageIndex = pageBegin; pageIndex < pageEnd; pageIndex++) {
+    LayoutPage copy = previous.pageList[pageIndex];
+    uint32_t boxBegin = copy.boxBegin, boxEnd = copy.boxEnd;
+    copy.boxBegin = (uint32_t)boxList.size();
+    for (uint32_t boxIndex = boxBegin; boxIndex < boxEnd; boxIndex++) {
+      LayoutBox box = previous.boxList[boxIndex];
+      const ParagraphLayout &now = paragraphLayoutList[box.paragraphIndex];
+      const ParagraphLayout &before =
+          previous.paragraphLayoutList[box.paragraphIndex];
+      rebase(box, (int64_t)now.textBase - before.textBase,
+             (int64_t)now.runBase - before.runBase);
+      boxList.push_back(box);
+    }
+    copy.boxEnd = (uint32_t)boxList.size();
+    pageList.push_back(copy);
+  }
+}
+
+uint32_t DocumentLayout::findPage(uint32_t sectionIndex,
+                                  uint32_t paragraphIndex,
+                                  uint32_t lineIndex) const {
+  auto pageIt = std::lower_bound(
+      pageList.begin(), pageList.end(),
+      std::make_pair(paragraphIndex, lineIndex),
+      [](const LayoutPage &page, const std::pair<uint32_t, uint32_t> &key) {
+        return std::make_pair(page.paragraphIndex, page.lineIndex) < key;
+      });
+  if (pageIt == pageList.end() || pageIt->paragraphIndex != paragraphIndex ||
+      pageIt->lineIndex != lineIndex || pageIt->sectionIndex != sectionIndex)
+    return documentNone;
+  auto nextIt = pageIt + 1;
+  if (nextIt != pageList.end() && nextIt->paragraphIndex == paragraphIndex &&
+      nextIt->lineIndex == lineIndex)
+    return documentNone;
+  return (uint32_t)(pageIt - pageList.begin());
+}
+
+bool DocumentLayout::startsItem(uint32_t paragraphIndex) const {
+  uint32_t cellIndex = model.paragraphList[paragraphIndex].cellIndex;
+  return cellIndex == documentNone ||
+         model.tableList[topTable(cellIndex)].paragraphBegin ==
+             paragraphIndex;
+}
+
+bool DocumentLayout::newPage(uint32_t paragraphIndex, uint32_t lineIndex) {
+  if (options.pageLimit != 0 && pageList.size() >= options.pageLimit) {
+    page.stopped = true;
+    return false;
+  }
+  // past the edit a page starting where one did before starts the same
+  // run of pages, they are copied instead
+  if (alignLayout && paragraphIndex > alignAfter) {
+    alignPage = alignLayout->findPage(page.sectionIndex, paragraphIndex,
+                                      lineIndex);
+    if (alignPage != documentNone) {
+      page.stopped = true;
+      return false;
+    }
+  }
+  uint32_t boxTotal = (uint32_t)boxList.size();
+  pageList.push_back(
+      {page.sectionIndex, paragraphIndex, lineIndex, boxTotal, boxTotal});
+  page.y = 0;
+  page.empty = true;
+  return true;
+}
+
+int32_t DocumentLayout::lineOffset(const ParagraphProperties &properties,
+                                   bool firstLine, const LayoutLine &line,
+                                   int32_t columnWidth) const {
+  int32_t indentLeft = std::max(0, valueOr(properties.indentLeft, 0));
+  int32_t indentRight = std::max(0, valueOr(properties.indentRight, 0));
+  int32_t x = indentLeft;
+  if (firstLine)
+    x = std::max(0, x + valueOr(properties.indentFirstLine, 0));
+  int32_t slack = std::max(0, columnWidth - indentRight - x - line.width);
+  if (properties.justification == ParagraphProperties::center)
+    x += slack / 2;
+  else if (properties.justification == ParagraphProperties::right)
+    x += slack;
+  return x;
+}
+
+void DocumentLayout::pushBox(uint32_t paragraphIndex, const LayoutLine &line,
+                             int32_t x, int32_t y) {
+  boxList.push_back({paragraphIndex, line.textBegin, line.textEnd,
+                     line.runBegin, line.runEnd, x, y, line.width,
+                     line.height});
+  pageList.back().boxEnd = (uint32_t)boxList.size();
+}
+
+void DocumentLayout::placeParagraph(uint32_t paragraphIndex) {
+  const ParagraphLayout &scratch = measured(paragraphIndex, page.bodyWidth);
+  if ((scratch.flags & ParagraphProperties::pageBreakBefore) && !page.empty &&
+      !newPage(paragraphIndex, 0))
+    return;
+  // spacing before is dropped at the top of a page
+  int32_t spacingBefore = page.empty ? 0 : scratch.spacingBefore;
+  int32_t lineHeightTotal = scratch.getLineHeightTotal();
+  if ((scratch.flags & ParagraphProperties::keepLines) && !page.empty &&
+      page.y + spacingBefore + lineHeightTotal > page.bodyHeight &&
+      lineHeightTotal <= page.bodyHeight) {
+    if (!newPage(paragraphIndex, 0))
+      return;
+    spacingBefore = 0;
+  }
+  page.y += spacingBefore;
+  const ParagraphProperties &properties =
+      model.getParagraphProperties(model.paragraphList[paragraphIndex]);
+  for (uint32_t lineIndex = 0; lineIndex < scratch.lineList.size();
+       lineIndex++) {
+    const LayoutLine &line = scratch.lineList[lineIndex];
+    if (!page.empty && page.y + line.height > page.bodyHeight &&
+        !newPage(paragraphIndex, lineIndex))
+      return;
+    if (options.recordBoxes)
+      pushBox(paragraphIndex, line,
+              page.marginLeft + lineOffset(properties, lineIndex == 0, line,
+                                           page.bodyWidth),
+              page.marginTop + page.y);
+    page.y += line.height;
+    page.empty = false;
+    if (line.pageBreakAfter && !newPage(paragraphIndex, lineIndex + 1))
+      return;
+  }
+  page.y += scratch.spacingAfter;
+}
+
+uint32_t DocumentLayout::placeTable(uint32_t tableIndex) {
+  const DocumentTable &table = model.tableList[tableIndex];
+  uint32_t cellIndex = table.cellBegin;
+  while (cellIndex < table.cellEnd && !page.stopped) {
+    if (model.cellList[cellIndex].tableIndex != tableIndex) {
+      cellIndex++;
+      continue;
+    }
+    uint32_t row = model.cellList[cellIndex].row;
+    uint32_t rowParagraph = model.cellList[cellIndex].paragraphBegin;
+    int32_t rowHeight = 0, cellX = 0;
+    rowBoxList.clear();
+    for (; cellIndex < table.cellEnd; cellIndex++) {
+      const DocumentCell &cell = model.cellList[cellIndex];
+      // cells of nested tables are measured as part of their cell
+      if (cell.tableIndex != tableIndex)
+        continue;
+      if (cell.row != row)
+        break;
+      int32_t width = cellWidth(cell, page.bodyWidth);
+      int32_t columnWidth = width - 2 * cellMargin;
+      int32_t cellHeight = 0;
+      for (uint32_t paragraphIndex = cell.paragraphBegin;
+           paragraphIndex < cell.paragraphEnd; paragraphIndex++) {
+        const ParagraphLayout &scratch =
+            measured(paragraphIndex, columnWidth);
+        if (paragraphIndex != cell.paragraphBegin)
+          cellHeight += scratch.spacingBefore;
+        if (options.recordBoxes) {
+          const ParagraphProperties &properties =
+              model.getParagraphProperties(model.paragraphList[paragraphIndex]);
+          int32_t lineY = cellHeight;
+          for (size_t lineIndex = 0; lineIndex < scratch.lineList.size();
+               lineIndex++) {
+            const LayoutLine &line = scratch.lineList[lineIndex];
+            int32_t x = cellX + cellMargin +
+                        lineOffset(properties, lineIndex == 0, line,
+                                   columnWidth);
+            rowBoxList.push_back({paragraphIndex, line.textBegin,
+                                  line.textEnd, line.runBegin, line.runEnd,
+                                  x, lineY, line.width, line.height});
+            lineY += line.height;
+          }
+        }
+        cellHeight += scratch.getLineHeightTotal() + scratch.spacingAfter;
+      }
+      rowHeight = std::max(rowHeight, cellHeight);
+      cellX += width;
+    }
+
+    if (!page.empty && page.y + rowHeight > page.bodyHeight &&
+        !newPage(rowParagraph, 0))
+      break;
+    // a row taller than the page runs over onto the following pages, its
+    // lines go to the page they start on
+    int32_t rowTop = page.y;
+    // top to bottom, cells left to right at the same y; sorting positions
+    // keeps it stable without the buffer stable_sort takes every row
+    rowOrder.clear();
+    for (uint32_t i = 0; i < (uint32_t)rowBoxList.size(); i++)
+      rowOrder.push_back({rowBoxList[i].y, i});
+    std::sort(rowOrder.begin(), rowOrder.end());
+    for (const std::pair<int32_t, uint32_t> &order : rowOrder) {
+      const LayoutBox &box = rowBoxList[order.second];
+      while (rowTop + box.y >= page.bodyHeight) {
+        rowTop -= page.bodyHeight;
+        if (!newPage(rowParagraph, 0))
+          break;
+      }
+      if (page.stopped)
+        break;
+      pushBox(box.paragraphIndex,
+              {box.textBegin, box.textEnd, box.runBegin, box.runEnd,
+               box.width, box.height, false},
+              page.marginLeft + box.x, page.marginTop + rowTop + box.y);
+    }
+    page.y = rowTop + rowHeight;
+    page.empty = false;
+    while (page.y > page.bodyHeight && !page.stopped) {
+      int32_t overflow = page.y - page.bodyHeight;
+      if (!newPage(rowParagraph, 0))
+        break;
+      page.y = overflow;
+      page.empty = false;
+    }
+  }
+  return table.paragraphEnd;
+}
+
+uint32_t DocumentLayout::topTable(uint32_t cellIndex) const {
+  uint32_t tableIndex = model.cellList[cellIndex].tableIndex;
+  while (model.tableList[tableIndex].parentCell != documentNone)
+    tableIndex =
+        model.cellList[model.tableList[tableIndex].parentCell].tableIndex;
+  return tableIndex;
+}
+
+bool PageCountCache::find(uint64_t contentHash, uint32_t &pageTotal) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto pageTotalIt = pageTotalMap.find(contentHash);
+  if (pageTotalIt == pageTotalMap.end())
+    return false;
+  pageTotal = pageTotalIt->second;
+  return true;
+}
+
+void PageCountCache::insert(uint64_t contentHash, uint32_t pageTotal) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (pageTotalMap.size() >= entryMax)
+    pageTotalMap.clear();
+  pageTotalMap[contentHash] = pageTotal;
+}
+
+void PageCountCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  pageTotalMap.clear();
+}
+
+PageCountCache &pageCountCache() {
+  static PageCountCache cache;
+  return cache;
+}
+
+} // namespace bookfiler
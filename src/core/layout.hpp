@@ -0,0 +1,249 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_LAYOUT_H
+#define BOOKFILER_MODULE_DOCX_LAYOUT_H
+
+// C++
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Local Project
+#include "arena.hpp"
+#include "document.hpp"
+#include "fontMetrics.hpp"
+#include "threadPool.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* One line of a measured paragraph, lengths in twips */
+class LayoutLine {
+public:
+  // [textBegin, textEnd) of DocumentModel::text
+  uint32_t textBegin, textEnd;
+  // runs with content on the line, a run split by a break is in both lines
+  uint32_t runBegin, runEnd;
+  int32_t width, height;
+  // the line ends in a page break character
+  bool pageBreakAfter;
+};
+
+class ParagraphLayout {
+public:
+  ParagraphLayout() {}
+  /* Lines allocated from resource, see DocumentLayout */
+  explicit ParagraphLayout(std::pmr::memory_resource *resource)
+      : lineList(resource) {}
+
+  std::pmr::vector<LayoutLine> lineList;
+  int32_t spacingBefore = 0, spacingAfter = 0;
+  // ParagraphProperties::Flag
+  uint8_t flags = 0;
+  // the column width it was broken for, propertyUnset until measured
+  int32_t columnWidth = propertyUnset;
+  // where the paragraph's text and runs started, to move reused lines
+  uint32_t textBase = 0, runBase = 0;
+
+  int32_t getLineHeightTotal() const;
+  void clear();
+};
+
+/* A line placed on a page. Position and size are in twips from the top left
+ * corner of the page, x includes indents and justification.
+ */
+class LayoutBox {
+public:
+  uint32_t paragraphIndex;
+  uint32_t textBegin, textEnd, runBegin, runEnd;
+  int32_t x, y, width, height;
+};
+
+/* Where a page's content starts. lineIndex can equal the line count of the
+ * paragraph when the page starts with the next paragraph. [boxBegin, boxEnd)
+ * of DocumentLayout::getBoxList() when boxes are recorded.
+ */
+class LayoutPage {
+public:
+  uint32_t sectionIndex, paragraphIndex, lineIndex;
+  uint32_t boxBegin = 0, boxEnd = 0;
+};
+
+class LayoutOptions {
+public:
+  // font size of runs that set none, half points
+  uint16_t defaultHalfPoints = 22;
+  // stop paginating after this many pages, 0 for no limit
+  uint32_t pageLimit = 0;
+  // keep a LayoutBox per placed line, needed for drawing, not for counting
+  bool recordBoxes = false;
+};
+
+/* DocumentLayout
+ * Line breaking and pagination over a DocumentModel using FontMetrics. It
+ * works out where lines and pages break and how tall things are, nothing
+ * is shaped or rasterized, so counting pages costs one pass over the text.
+ * Tables are placed row by row; a row moves to the next page whole unless
+ * it is taller than a page. Every section starts a new page.
+ *
+ * Column widths do not depend on where things land, so every paragraph is
+ * measured up front, in parallel, and pagination is a sequential pass over
+ * the stored lines. The lines are kept per paragraph so a layout of an
+ * edited model can reuse them. They live in an arena of the layout, sized
+ * exactly, so a layout costs a handful of allocations however many
+ * paragraphs it holds and is freed a chunk at a time.
+ */
+class DocumentLayout {
+public:
+  class Stats {
+  public:
+    // paragraphs broken into lines and taken from a previous layout
+    uint32_t measuredTotal = 0, reusedTotal = 0;
+    // pages placed by the last paginate and copied from a previous layout
+    uint32_t placedTotal = 0, copiedTotal = 0;
+  };
+
+  DocumentLayout(const DocumentModel &model,
+                 LayoutOptions options = LayoutOptions());
+  /* Breaks paragraphIndex into lines for a column width twips wide. Safe to
+   * call from several threads.
+   */
+  void measureParagraph(uint32_t paragraphIndex, int32_t width,
+                        ParagraphLayout &layout) const;
+  /* Measures on pool, the calling thread helps, then paginates. With a
+   * pageLimit paragraphs are measured as they are placed instead.
+   * @return the page count, capped at LayoutOptions::pageLimit
+   */
+  uint32_t paginate(ThreadPool &pool = defaultThreadPool());
+  /* Lays out the model as an edit of previous's model. dirtyList are the
+   * paragraphs whose runs, text or properties changed; sections, tables and
+   * the paragraph count must be the same, otherwise everything is laid out
+   * again.
+   * Only dirty paragraphs are measured. Pages before the one holding the
+   * first dirty paragraph are copied, and placing stops at the first page
+   * after the last dirty paragraph that starts where a page of previous
+   * started; the pages from there on are copied too.
+   */
+  uint32_t paginate(const DocumentLayout &previous,
+                    const std::vector<uint32_t> &dirtyList,
+                    ThreadPool &pool = defaultThreadPool());
+  /* Lines of a paragraph as last placed, empty before paginate */
+  const ParagraphLayout &getParagraphLayout(uint32_t paragraphIndex) const {
+    return paragraphLayoutList[paragraphIndex];
+  }
+  Stats getStats() const { return stats; }
+  /* Bytes of the pages, boxes and line arena, the model not included */
+  size_t memoryUsage() const;
+  const std::vector<LayoutPage> &getPageList() const { return pageList; }
+  const std::vector<LayoutBox> &getBoxList() const { return boxList; }
+  const DocumentModel &getModel() const { return model; }
+  const LayoutOptions &getOptions() const { return options; }
+  const FontMetrics &getFontMetrics(uint32_t fontId) const {
+    return *fontMetricsList[fontId];
+  }
+
+private:
+  class PageState {
+  public:
+    uint32_t sectionIndex = 0;
+    int32_t y = 0, bodyHeight = 0, bodyWidth = 0;
+    int32_t marginLeft = 0, marginTop = 0;
+    bool empty = true, stopped = false;
+  };
+
+  /* Measures every paragraph not reused from previous, dirtyMask by
+   * paragraph when previous is set
+   */
+  void measureAll(ThreadPool &pool, const DocumentLayout *previous,
+                  const std::vector<uint8_t> &dirtyMask);
+  /* Empties paragraphLayoutList and the arena, then makes
+   * paragraphTotal empty layouts allocating from it
+   */
+  void resetParagraphLayouts(size_t paragraphTotal);
+  /* The stored lines of paragraphIndex, measured now if they are missing
+   * or were broken for another width
+   */
+  const ParagraphLayout &measured(uint32_t paragraphIndex, int32_t width);
+  int32_t bodyWidth(const DocumentSection &section) const;
+  int32_t cellWidth(const DocumentCell &cell, int32_t bodyWidth) const;
+  /* Places everything from paragraphIndex, which starts a page of
+   * sectionIndex
+   */
+  void placeFrom(uint32_t sectionIndex, uint32_t paragraphIndex);
+  /* Appends pages [pageBegin, pageEnd) of previous with their boxes, moved
+   * to where their paragraphs' text and runs are now
+   */
+  void copyPages(const DocumentLayout &previous, uint32_t pageBegin,
+                 uint32_t pageEnd);
+  /* The only page starting at that line, documentNone if there is none */
+  uint32_t findPage(uint32_t sectionIndex, uint32_t paragraphIndex,
+                    uint32_t lineIndex) const;
+  /* Whether a page can start at paragraphIndex and be placed without
+   * knowing the pages before it: a body paragraph or a table's first one
+   */
+  bool startsItem(uint32_t paragraphIndex) const;
+  bool newPage(uint32_t paragraphIndex, uint32_t lineIndex);
+  /* Line x offset within a column for indents and justification */
+  int32_t lineOffset(const ParagraphProperties &properties, bool firstLine,
+                     const LayoutLine &line, int32_t columnWidth) const;
+  void pushBox(uint32_t paragraphIndex, const LayoutLine &line, int32_t x,
+               int32_t y);
+  void placeParagraph(uint32_t paragraphIndex);
+  /* @return the paragraph after the table */
+  uint32_t placeTable(uint32_t tableIndex);
+  uint32_t topTable(uint32_t cellIndex) const;
+
+  const DocumentModel &model;
+  LayoutOptions options;
+  // by StringPool id
+  std::vector<const FontMetrics *> fontMetricsList;
+  std::vector<LayoutPage> pageList;
+  std::vector<LayoutBox> boxList;
+  PageState page;
+  // the line lists of paragraphLayoutList, declared first to outlive it
+  MonotonicArena lineArena;
+  // by paragraph
+  std::vector<ParagraphLayout> paragraphLayoutList;
+  // while paginating against a previous layout: the pages to align with,
+  // the last dirty paragraph, and the previous page placing stopped at
+  const DocumentLayout *alignLayout = nullptr;
+  uint32_t alignAfter = 0, alignPage = documentNone;
+  Stats stats;
+  // boxes of the table row being placed, y relative to the row top
+  std::vector<LayoutBox> rowBoxList;
+  // y and position in rowBoxList, the order rowBoxList is placed in
+  std::vector<std::pair<int32_t, uint32_t>> rowOrder;
+};
+
+/* PageCountCache
+ * Exact page counts by document content hash (ZipIndex::getContentHash),
+ * shared by every document in the process. Thread safe.
+ */
+class PageCountCache {
+public:
+  bool find(uint64_t contentHash, uint32_t &pageTotal) const;
+  void insert(uint64_t contentHash, uint32_t pageTotal);
+  void clear();
+
+private:
+  // entries kept before the cache starts over
+  static constexpr size_t entryMax = 1 << 16;
+  mutable std::mutex mutex;
+  std::unordered_map<uint64_t, uint32_t> pageTotalMap;
+};
+
+PageCountCache &pageCountCache();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_LAYOUT_H
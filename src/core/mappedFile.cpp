@@ -0,0 +1,103 @@
+// C
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Minizip 2.7.0
+ * License: zlib
+ */
+#include "mz.h"
+
+// Local Project
+#include "mappedFile.hpp"
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() { close(); }
+
+#ifdef _WIN32
+int32_t MappedFile::open(std::string fileName) {
+  close();
+  int wideSize =
+      MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, nullptr, 0);
+  std::wstring wideName(wideSize, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, &wideName[0],
+                      wideSize);
+  HANDLE file = CreateFileW(wideName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return MZ_OPEN_ERROR;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    return MZ_OPEN_ERROR;
+  }
+  fileHandle = file;
+  dataSize = (uint64_t)fileSize.QuadPart;
+  if (dataSize == 0)
+    return MZ_OK;
+  mapHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapHandle) {
+    close();
+    return MZ_OPEN_ERROR;
+  }
+  dataPtr = (const unsigned char *)MapViewOfFile(mapHandle, FILE_MAP_READ, 0,
+                                                 0, 0);
+  if (!dataPtr) {
+    close();
+    return MZ_OPEN_ERROR;
+  }
+  return MZ_OK;
+}
+
+void MappedFile::close() {
+  if (dataPtr)
+    UnmapViewOfFile(dataPtr);
+  if (mapHandle)
+    CloseHandle(mapHandle);
+  if (fileHandle)
+    CloseHandle(fileHandle);
+  dataPtr = nullptr;
+  mapHandle = fileHandle = nullptr;
+  dataSize = 0;
+}
+#else
+int32_t MappedFile::open(std::string fileName) {
+  close();
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    return MZ_OPEN_ERROR;
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    ::close(fd);
+    return MZ_OPEN_ERROR;
+  }
+  dataSize = (uint64_t)fileStat.st_size;
+  if (dataSize == 0) {
+    ::close(fd);
+    return MZ_OK;
+  }
+  void *ptr = mmap(nullptr, (size_t)dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping holds its own reference to the file
+  ::close(fd);
+  if (ptr == MAP_FAILED) {
+    dataSize = 0;
+    return MZ_OPEN_ERROR;
+  }
+  dataPtr = (const unsigned char *)ptr;
+  return MZ_OK;
+}
+
+void MappedFile::close() {
+  if (dataPtr)
+    munmap((void *)dataPtr, (size_t)dataSize);
+  dataPtr = nullptr;
+  dataSize = 0;
+}
+#endif
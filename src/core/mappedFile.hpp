@@ -0,0 +1,49 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_MAPPED_FILE_H
+#define BOOKFILER_MODULE_DOCX_MAPPED_FILE_H
+
+// C++
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/* MappedFile
+ * Read-only memory mapping of a whole file. The mapping is immutable once
+ * opened so it may be shared between threads without locking.
+ */
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /* UTF8 encoded file path
+   * @return MZ_OK on success, MZ_OPEN_ERROR when the file can't be mapped
+   */
+  int32_t open(std::string fileName);
+  void close();
+
+  const unsigned char *data() const { return dataPtr; }
+  uint64_t size() const { return dataSize; }
+  std::string_view view() const {
+    return std::string_view((const char *)dataPtr, (size_t)dataSize);
+  }
+
+private:
+  const unsigned char *dataPtr = nullptr;
+  uint64_t dataSize = 0;
+#ifdef _WIN32
+  void *fileHandle = nullptr;
+  void *mapHandle = nullptr;
+#endif
+};
+
+#endif // BOOKFILER_MODULE_DOCX_MAPPED_FILE_H
@@ -0,0 +1,134 @@
+// C++
+#include <algorithm>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "jpegDecoder.hpp"
+#include "mediaCache.hpp"
+#include "pixelKernel.hpp"
+#include "pngDecoder.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+uint64_t MediaKey::hash() const {
+  uint64_t value = documentHash;
+  for (unsigned char c : partName)
+    value = (value ^ c) * 0x100000001B3ull;
+  for (int32_t field : {width, height})
+    value = (value ^ (uint32_t)field) * 0x100000001B3ull;
+  return value ^ (value >> 29);
+}
+
+MediaCache::MediaCache(size_t byteBudget) { stats.byteBudget = byteBudget; }
+
+std::shared_ptr<const RasterImage> MediaCache::find(const MediaKey &key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto entryIt = entryMap.find(key);
+  if (entryIt == entryMap.end()) {
+    stats.missTotal++;
+    return nullptr;
+  }
+  stats.hitTotal++;
+  entryList.splice(entryList.begin(), entryList, entryIt->second);
+  return entryIt->second->second;
+}
+
+void MediaCache::insert(const MediaKey &key,
+                        std::shared_ptr<const RasterImage> image) {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t imageBytes = image->byteSize();
+  auto entryIt = entryMap.find(key);
+  if (entryIt != entryMap.end()) {
+    stats.byteTotal -= entryIt->second->second->byteSize();
+    entryList.erase(entryIt->second);
+    entryMap.erase(entryIt);
+  }
+  if (imageBytes > stats.byteBudget)
+    return;
+  evictTo(stats.byteBudget - imageBytes);
+  entryList.emplace_front(key, std::move(image));
+  entryMap[key] = entryList.begin();
+  stats.byteTotal += imageBytes;
+}
+
+void MediaCache::setByteBudget(size_t byteBudget) {
+  std::lock_guard<std::mutex> lock(mutex);
+  stats.byteBudget = byteBudget;
+  evictTo(byteBudget);
+}
+
+void MediaCache::trim(size_t byteMax) {
+  std::lock_guard<std::mutex> lock(mutex);
+  evictTo(byteMax);
+}
+
+void MediaCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entryList.clear();
+  entryMap.clear();
+  stats.byteTotal = 0;
+}
+
+MediaCache::Stats MediaCache::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats result = stats;
+  result.imageTotal = entryList.size();
+  return result;
+}
+
+void MediaCache::evictTo(size_t byteMax) {
+  while (stats.byteTotal > byteMax && !entryList.empty()) {
+    stats.byteTotal -= entryList.back().second->byteSize();
+    entryMap.erase(entryList.back().first);
+    entryList.pop_back();
+    stats.evictionTotal++;
+  }
+}
+
+MediaCache &mediaCache() {
+  static MediaCache cache;
+  return cache;
+}
+
+int32_t mediaDecode(std::string_view data, int32_t width, int32_t height,
+                    RasterImage &image) {
+  if (width <= 0 || height <= 0 ||
+      (uint64_t)width * (uint64_t)height > imagePixelMax)
+    return MZ_PARAM_ERROR;
+  RasterImage decoded;
+  PngDecoder png;
+  JpegDecoder jpeg;
+  int32_t err = png.open(data);
+  if (err == MZ_OK) {
+    err = png.decode(decoded);
+  } else if (err == MZ_FORMAT_ERROR) {
+    err = jpeg.open(data);
+    if (err == MZ_FORMAT_ERROR)
+      return MZ_SUPPORT_ERROR;
+    if (err != MZ_OK)
+      return err;
+    // the DCT does the first halvings for free
+    uint32_t denominator = 1;
+    while (denominator < 8 &&
+           (jpeg.getWidth() + denominator * 2 - 1) / (denominator * 2) >=
+               (uint32_t)width &&
+           (jpeg.getHeight() + denominator * 2 - 1) / (denominator * 2) >=
+               (uint32_t)height)
+      denominator *= 2;
+    err = jpeg.decode(denominator, decoded);
+  }
+  if (err != MZ_OK)
+    return err;
+  pixelScale(decoded, width, height, image);
+  return MZ_OK;
+}
+
+} // namespace bookfiler
@@ -0,0 +1,103 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_MEDIA_CACHE_H
+#define BOOKFILER_MODULE_DOCX_MEDIA_CACHE_H
+
+// C++
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Local Project
+#include "tileCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* An embedded image decoded and scaled to the pixel size it is drawn at.
+ * documentHash is ZipIndex::getContentHash, like TileKey.
+ */
+class MediaKey {
+public:
+  uint64_t documentHash;
+  std::string partName;
+  int32_t width, height;
+
+  bool operator==(const MediaKey &other) const {
+    return documentHash == other.documentHash && width == other.width &&
+           height == other.height && partName == other.partName;
+  }
+  uint64_t hash() const;
+};
+
+/* MediaCache
+ * Decoded images in least recently used order, bounded by the bytes of
+ * pixels held, so tiles of the same page and zoom level decode each image
+ * once. Thread safe.
+ */
+class MediaCache {
+public:
+  class Stats {
+  public:
+    uint64_t hitTotal = 0, missTotal = 0, evictionTotal = 0;
+    size_t byteTotal = 0, byteBudget = 0, imageTotal = 0;
+  };
+
+  explicit MediaCache(size_t byteBudget = (size_t)64 << 20);
+  /* Counts a hit and marks the image most recently used, or counts a miss
+   * and returns nullptr
+   */
+  std::shared_ptr<const RasterImage> find(const MediaKey &key);
+  /* Replaces any image under key, then evicts down to the budget. An image
+   * larger than the whole budget is not kept.
+   */
+  void insert(const MediaKey &key, std::shared_ptr<const RasterImage> image);
+  void setByteBudget(size_t byteBudget);
+  /* Evicts least recently used images down to byteMax, the budget stays */
+  void trim(size_t byteMax);
+  void clear();
+  Stats getStats() const;
+
+private:
+  class KeyHash {
+  public:
+    size_t operator()(const MediaKey &key) const { return (size_t)key.hash(); }
+  };
+  using entry_t = std::pair<MediaKey, std::shared_ptr<const RasterImage>>;
+
+  void evictTo(size_t byteMax);
+
+  mutable std::mutex mutex;
+  // front is the most recently used
+  std::list<entry_t> entryList;
+  std::unordered_map<MediaKey, std::list<entry_t>::iterator, KeyHash> entryMap;
+  Stats stats;
+};
+
+/* Module wide cache, the budget is the "mediaCacheBytes" setting */
+MediaCache &mediaCache();
+
+/* Decodes a PNG or JPEG, told apart by signature, to exactly width x
+ * height. JPEG is decoded at the smallest 1/2, 1/4 or 1/8 scale that is
+ * still no smaller than the target, then resampled.
+ * MZ_SUPPORT_ERROR	-109	neither format, or a variant not supported
+ * and the errors of PngDecoder and JpegDecoder
+ */
+int32_t mediaDecode(std::string_view data, int32_t width, int32_t height,
+                    RasterImage &image);
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_MEDIA_CACHE_H
@@ -0,0 +1,132 @@
+// C++
+#include <algorithm>
+
+// Local Project
+#include "bufferPool.hpp"
+#include "docxImpl.hpp"
+#include "memoryAccountant.hpp"
+#include "mediaCache.hpp"
+#include "tileCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+MemoryAccountant::MemoryAccountant() {}
+
+void MemoryAccountant::setByteBudget(size_t byteBudget_) {
+  byteBudget.store(byteBudget_, std::memory_order_relaxed);
+  enforce();
+}
+
+void MemoryAccountant::addDocument(DocxImpl *document) {
+  std::lock_guard<std::mutex> lock(mutex);
+  documentList.push_back(document);
+}
+
+void MemoryAccountant::removeDocument(DocxImpl *document) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto documentIt =
+      std::find(documentList.begin(), documentList.end(), document);
+  if (documentIt == documentList.end())
+    return;
+  *documentIt = documentList.back();
+  documentList.pop_back();
+}
+
+void MemoryAccountant::charge(MemoryKind kind, int64_t bytes) {
+  (kind == MemoryKind::Model ? modelBytes : partBytes)
+      .fetch_add(bytes, std::memory_order_relaxed);
+}
+
+MemoryAccountant::Usage MemoryAccountant::getUsage() const {
+  Usage usage;
+  // a release may be counted before the charge it undoes on another thread
+  usage.modelBytes =
+      (size_t)std::max<int64_t>(0, modelBytes.load(std::memory_order_relaxed));
+  usage.partBytes =
+      (size_t)std::max<int64_t>(0, partBytes.load(std::memory_order_relaxed)) +
+      partBufferPool().getStats().idleBytes;
+  usage.pixmapBytes = tileCache().getStats().byteTotal +
+                      mediaCache().getStats().byteTotal +
+                      pixmapBufferPool().getStats().idleBytes;
+  return usage;
+}
+
+void MemoryAccountant::enforce(const DocxImpl *current) {
+  size_t budget = getByteBudget();
+  if (budget == 0 || getUsage().total() <= budget)
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  // another thread may have evicted while this one waited
+  Usage usage = getUsage();
+  size_t before = usage.total();
+  if (before <= budget)
+    return;
+
+  // cold pixmaps, the tiles a trim leaves unheld go back to the pool idle
+  size_t restBytes = usage.modelBytes + usage.partBytes;
+  size_t tileMax = budget > restBytes ? budget - restBytes : 0;
+  if (tileCache().getStats().byteTotal > tileMax) {
+    tileCache().trim(tileMax);
+    pixmapEvictionTotal++;
+  }
+  // then decoded images, which cost more to redo than a tile
+  size_t tileBytes = tileCache().getStats().byteTotal;
+  size_t mediaMax = tileMax > tileBytes ? tileMax - tileBytes : 0;
+  if (mediaCache().getStats().byteTotal > mediaMax) {
+    mediaCache().trim(mediaMax);
+    pixmapEvictionTotal++;
+  }
+  pixmapBufferPool().trim();
+  usage = getUsage();
+
+  if (usage.total() > budget) {
+    std::vector<std::pair<uint64_t, DocxImpl *>> idleList;
+    for (DocxImpl *document : documentList)
+      if (document != current)
+        idleList.emplace_back(document->getLastUse(), document);
+    std::sort(idleList.begin(), idleList.end());
+    // inflated parts, then whole models, least recently used first
+    for (const auto &idlePair : idleList) {
+      if (usage.total() <= budget)
+        break;
+      if (idlePair.second->releaseParts() == 0)
+        continue;
+      partEvictionTotal++;
+      partBufferPool().trim();
+      usage = getUsage();
+    }
+    for (const auto &idlePair : idleList) {
+      if (usage.total() <= budget)
+        break;
+      if (idlePair.second->releaseModel() == 0)
+        continue;
+      modelEvictionTotal++;
+      usage = getUsage();
+    }
+  }
+  evictedBytes += before - std::min(before, usage.total());
+}
+
+MemoryAccountant::Stats MemoryAccountant::getStats() const {
+  Stats stats;
+  stats.usage = getUsage();
+  stats.byteBudget = getByteBudget();
+  std::lock_guard<std::mutex> lock(mutex);
+  stats.documentTotal = documentList.size();
+  stats.pixmapEvictionTotal = pixmapEvictionTotal;
+  stats.partEvictionTotal = partEvictionTotal;
+  stats.modelEvictionTotal = modelEvictionTotal;
+  stats.evictedBytes = evictedBytes;
+  return stats;
+}
+
+MemoryAccountant &memoryAccountant() {
+  // never destroyed, documents held by other statics leave it on exit
+  static MemoryAccountant *accountant = new MemoryAccountant();
+  return *accountant;
+}
+
+} // namespace bookfiler
@@ -0,0 +1,103 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_MEMORY_ACCOUNTANT_H
+#define BOOKFILER_MODULE_DOCX_MEMORY_ACCOUNTANT_H
+
+// C++
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+class DocxImpl;
+
+/* What a charge is for */
+enum class MemoryKind { Model, Part };
+
+/* MemoryAccountant
+ * Bytes held for open documents, module wide: parsed models and their
+ * layouts, inflated parts in the OpcPackage caches and the idle blocks of
+ * partBufferPool(), and pixmaps, which are the tiles in tileCache(), the
+ * decoded images in mediaCache() and the idle blocks of pixmapBufferPool().
+ * Every DocxImpl registers itself while it lives.
+ *
+ * With a budget set, enforce() evicts once usage is over it, cheapest to
+ * rebuild first: cold tiles then cold images in least recently used order,
+ * then the
+ * inflated parts, then the models and layouts of idle documents, least
+ * recently used first. An evicted model is parsed again from the archive
+ * on next use. The document calling enforce, documents busy parsing or
+ * laying out, and edited documents, whose model exists nowhere else, keep
+ * theirs. Thread safe.
+ */
+class MemoryAccountant {
+public:
+  class Usage {
+  public:
+    size_t modelBytes = 0, partBytes = 0, pixmapBytes = 0;
+
+    size_t total() const { return modelBytes + partBytes + pixmapBytes; }
+  };
+  class Stats {
+  public:
+    Usage usage;
+    // 0 when there is no budget
+    size_t byteBudget = 0;
+    size_t documentTotal = 0;
+    // evictions by stage, tiles count once per enforce that dropped some
+    uint64_t pixmapEvictionTotal = 0, partEvictionTotal = 0,
+             modelEvictionTotal = 0;
+    uint64_t evictedBytes = 0;
+  };
+
+  MemoryAccountant();
+  /* 0, the default, for no budget. A lower budget is enforced at once. */
+  void setByteBudget(size_t byteBudget);
+  size_t getByteBudget() const {
+    return byteBudget.load(std::memory_order_relaxed);
+  }
+  void addDocument(DocxImpl *document);
+  void removeDocument(DocxImpl *document);
+  /* bytes may be negative to give back what was charged */
+  void charge(MemoryKind kind, int64_t bytes);
+  /* A value that grows with every call, for least recently used order */
+  uint64_t tick() {
+    return tickTotal.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  Usage getUsage() const;
+  /* Evicts until usage is within the budget or nothing more can go.
+   * current is the document that just grew, it is not evicted from.
+   * Returns at once while within the budget.
+   */
+  void enforce(const DocxImpl *current = nullptr);
+  Stats getStats() const;
+
+private:
+  std::atomic<size_t> byteBudget{0};
+  std::atomic<int64_t> modelBytes{0}, partBytes{0};
+  std::atomic<uint64_t> tickTotal{0};
+  // held while evicting, documents leave through removeDocument under it
+  mutable std::mutex mutex;
+  std::vector<DocxImpl *> documentList;
+  uint64_t pixmapEvictionTotal = 0, partEvictionTotal = 0,
+           modelEvictionTotal = 0, evictedBytes = 0;
+};
+
+/* Module wide accountant, the budget is the "memoryBudgetBytes" setting */
+MemoryAccountant &memoryAccountant();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_MEMORY_ACCOUNTANT_H
@@ -0,0 +1,358 @@
+// C++
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// Local Project
+#include "memoryAccountant.hpp"
+#include "opc.hpp"
+#include "xmlReader.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const std::string contentTypesPartName = "[Content_Types].xml";
+const std::string defaultMainPartName = "word/document.xml";
+
+std::string_view localName(std::string_view name) {
+  size_t colon = name.find(':');
+  return colon == std::string_view::npos ? name : name.substr(colon + 1);
+}
+
+int hexValue(char c) {
+  return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+std::string lowerCase(std::string_view value) {
+  std::string result(value);
+  std::transform(result.begin(), result.end(), result.begin(),
+                 [](unsigned char c) { return (char)std::tolower(c); });
+  return result;
+}
+
+/* Targets are URIs, "my%20image.png" is stored as "my image.png" */
+void percentDecode(std::string_view value, std::string &result) {
+  result.clear();
+  for (size_t i = 0; i < value.size(); i++) {
+    if (value[i] == '%' && i + 2 < value.size() &&
+        std::isxdigit((unsigned char)value[i + 1]) &&
+        std::isxdigit((unsigned char)value[i + 2])) {
+      result.push_back((char)(hexValue(value[i + 1]) * 16 +
+                              hexValue(value[i + 2])));
+      i += 2;
+    } else {
+      result.push_back(value[i]);
+    }
+  }
+}
+
+/* Scratch reused across the relationships of a part */
+class ResolveScratch {
+public:
+  std::string decoded, partName;
+  std::vector<std::string_view> segmentList;
+};
+
+/* The part name target points to from sourcePart, in scratch.partName */
+void resolveTarget(std::string_view sourcePart, std::string_view target,
+                   ResolveScratch &scratch) {
+  percentDecode(target, scratch.decoded);
+  std::vector<std::string_view> &segmentList = scratch.segmentList;
+  segmentList.clear();
+  std::string_view path(scratch.decoded);
+  if (!path.empty() && path[0] == '/') {
+    path.remove_prefix(1);
+  } else {
+    size_t slash = sourcePart.rfind('/');
+    std::string_view directory = slash == std::string_view::npos
+                                     ? std::string_view()
+                                     : sourcePart.substr(0, slash);
+    while (!directory.empty()) {
+      size_t next = directory.find('/');
+      segmentList.push_back(directory.substr(0, next));
+      directory = next == std::string_view::npos ? std::string_view()
+                                                 : directory.substr(next + 1);
+    }
+  }
+  while (!path.empty()) {
+    size_t next = path.find('/');
+    std::string_view segment = path.substr(0, next);
+    path = next == std::string_view::npos ? std::string_view()
+                                          : path.substr(next + 1);
+    if (segment == "..") {
+      if (!segmentList.empty())
+        segmentList.pop_back();
+    } else if (!segment.empty() && segment != ".") {
+      segmentList.push_back(segment);
+    }
+  }
+  std::string &partName = scratch.partName;
+  partName.clear();
+  for (std::string_view segment : segmentList) {
+    if (!partName.empty())
+      partName.push_back('/');
+    partName.append(segment);
+  }
+}
+
+} // namespace
+
+std::string_view OpcRelationship::getKind() const {
+  size_t slash = type.rfind('/');
+  return slash == std::string_view::npos ? type : type.substr(slash + 1);
+}
+
+std::string_view OpcRelationshipList::store(std::string_view text) {
+  if (text.empty())
+    return std::string_view();
+  auto *data = (char *)textArena.allocate(text.size(), 1);
+  std::memcpy(data, text.data(), text.size());
+  return std::string_view(data, text.size());
+}
+
+void OpcRelationshipList::clear() {
+  relationshipList.clear();
+  textArena.release();
+}
+
+const OpcRelationship *OpcRelationshipList::find(std::string_view id) const {
+  for (const OpcRelationship &relationship : relationshipList) {
+    if (relationship.id == id)
+      return &relationship;
+  }
+  return nullptr;
+}
+
+const OpcRelationship *
+OpcRelationshipList::findKind(std::string_view kind) const {
+  for (const OpcRelationship &relationship : relationshipList) {
+    if (relationship.getKind() == kind)
+      return &relationship;
+  }
+  return nullptr;
+}
+
+int32_t opcParseRelationships(std::string_view xml,
+                              std::string_view sourcePart,
+                              OpcRelationshipList &relationshipList) {
+  XmlReader reader;
+  reader.open(xml);
+  int32_t err;
+  std::string text;
+  ResolveScratch scratch;
+  while ((err = reader.next()) == MZ_OK) {
+    if (reader.getEvent() != XmlEvent::StartElement ||
+        localName(reader.getName()) != "Relationship")
+      continue;
+    OpcRelationship relationship;
+    text.clear();
+    xmlUnescape(reader.getAttribute("Id"), text);
+    relationship.id = relationshipList.store(text);
+    text.clear();
+    xmlUnescape(reader.getAttribute("Type"), text);
+    relationship.type = relationshipList.store(text);
+    relationship.external = reader.getAttribute("TargetMode") == "External";
+    text.clear();
+    xmlUnescape(reader.getAttribute("Target"), text);
+    if (!relationship.external) {
+      resolveTarget(sourcePart, text, scratch);
+      text.swap(scratch.partName);
+    }
+    relationship.target = relationshipList.store(text);
+    relationshipList.relationshipList.push_back(relationship);
+  }
+  return err == MZ_END_OF_STREAM ? MZ_OK : err;
+}
+
+std::string opcRelationshipsPartName(std::string_view sourcePart) {
+  size_t slash = sourcePart.rfind('/');
+  if (slash == std::string_view::npos)
+    return "_rels/" + std::string(sourcePart) + ".rels";
+  return std::string(sourcePart.substr(0, slash)) + "/_rels/" +
+         std::string(sourcePart.substr(slash + 1)) + ".rels";
+}
+
+OpcPackage::OpcPackage() {}
+
+OpcPackage::~OpcPackage() { close(); }
+
+int32_t OpcPackage::open(std::shared_ptr<ZipReader> zipReader_) {
+  close();
+  zipReader = zipReader_;
+
+  std::shared_ptr<ZipPart> contentTypesPart =
+      zipReader->extractPart(contentTypesPartName);
+  partLoadTotal++;
+  if (contentTypesPart->err != MZ_OK)
+    return contentTypesPart->err == MZ_END_OF_LIST ? MZ_FORMAT_ERROR
+                                                   : contentTypesPart->err;
+  XmlReader reader;
+  reader.open(contentTypesPart->data);
+  int32_t err;
+  std::string contentType, text;
+  ResolveScratch scratch;
+  while ((err = reader.next()) == MZ_OK) {
+    if (reader.getEvent() != XmlEvent::StartElement)
+      continue;
+    std::string_view name = localName(reader.getName());
+    contentType.clear();
+    xmlUnescape(reader.getAttribute("ContentType"), contentType);
+    text.clear();
+    if (name == "Default") {
+      xmlUnescape(reader.getAttribute("Extension"), text);
+      defaultTypeMap[lowerCase(text)] = contentType;
+    } else if (name == "Override") {
+      xmlUnescape(reader.getAttribute("PartName"), text);
+      resolveTarget("", text, scratch);
+      overrideTypeMap[lowerCase(scratch.partName)] = contentType;
+    }
+  }
+  if (err != MZ_END_OF_STREAM)
+    return err;
+
+  // a package without relationships still opens with the usual main part
+  std::shared_ptr<ZipPart> relationshipsPart =
+      zipReader->extractPart(opcRelationshipsPartName(""));
+  partLoadTotal++;
+  if (relationshipsPart->err == MZ_OK) {
+    err = opcParseRelationships(relationshipsPart->data, "",
+                                packageRelationships);
+    if (err != MZ_OK)
+      return err;
+  }
+  const OpcRelationship *mainRelationship =
+      packageRelationships.findKind("officeDocument");
+  mainPartName = mainRelationship && !mainRelationship->external
+                     ? std::string(mainRelationship->target)
+                     : defaultMainPartName;
+  return MZ_OK;
+}
+
+void OpcPackage::close() {
+  std::lock_guard<std::mutex> lock(mutex);
+  zipReader = nullptr;
+  defaultTypeMap.clear();
+  overrideTypeMap.clear();
+  packageRelationships.clear();
+  mainPartName.clear();
+  relationshipsCache.clear();
+  partCache.clear();
+  partLoadTotal = 0;
+  memoryAccountant().charge(MemoryKind::Part, -(int64_t)cachedBytes);
+  cachedBytes = 0;
+}
+
+std::string OpcPackage::getContentType(std::string_view partName) const {
+  std::string key = lowerCase(partName);
+  auto overrideIt = overrideTypeMap.find(key);
+  if (overrideIt != overrideTypeMap.end())
+    return overrideIt->second;
+  size_t dot = key.rfind('.');
+  if (dot == std::string::npos || key.find('/', dot) != std::string::npos)
+    return std::string();
+  auto defaultIt = defaultTypeMap.find(key.substr(dot + 1));
+  return defaultIt == defaultTypeMap.end() ? std::string()
+                                           : defaultIt->second;
+}
+
+int32_t OpcPackage::getRelationships(
+    std::string_view sourcePart,
+    std::shared_ptr<const OpcRelationshipList> &relationshipList) {
+  std::string key(sourcePart);
+  std::shared_ptr<ZipReader> reader;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cacheIt = relationshipsCache.find(key);
+    if (cacheIt != relationshipsCache.end()) {
+      relationshipList = cacheIt->second;
+      return MZ_OK;
+    }
+    if (!zipReader)
+      return MZ_PARAM_ERROR;
+    reader = zipReader;
+  }
+
+  // parsed outside the lock, two threads may both parse the same part
+  auto parsedList = std::make_shared<OpcRelationshipList>();
+  std::shared_ptr<ZipPart> relationshipsPart =
+      reader->extractPart(opcRelationshipsPartName(sourcePart));
+  if (relationshipsPart->err == MZ_OK) {
+    int32_t err =
+        opcParseRelationships(relationshipsPart->data, sourcePart, *parsedList);
+    if (err != MZ_OK)
+      return err;
+  } else if (relationshipsPart->err != MZ_END_OF_LIST) {
+    return relationshipsPart->err;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto insertPair = relationshipsCache.emplace(key, parsedList);
+  if (insertPair.second && relationshipsPart->err == MZ_OK)
+    partLoadTotal++;
+  relationshipList = insertPair.first->second;
+  return MZ_OK;
+}
+
+int32_t OpcPackage::getPart(std::string_view partName,
+                            std::shared_ptr<const ZipPart> &part) {
+  std::string key(partName);
+  std::shared_ptr<ZipReader> reader;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!zipReader)
+      return MZ_PARAM_ERROR;
+    auto cacheIt = partCache.find(key);
+    if (cacheIt != partCache.end()) {
+      BOOKFILER_TRACE_ADD(zipReader->getMetrics(), cacheHits, 1);
+      part = cacheIt->second;
+      return MZ_OK;
+    }
+    reader = zipReader;
+  }
+  BOOKFILER_TRACE_ADD(reader->getMetrics(), cacheMisses, 1);
+
+  std::shared_ptr<ZipPart> loadedPart = reader->extractPart(key);
+  if (loadedPart->err != MZ_OK)
+    return loadedPart->err;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto insertPair = partCache.emplace(key, loadedPart);
+  if (insertPair.second) {
+    partLoadTotal++;
+    cachedBytes += loadedPart->bufferSize;
+    memoryAccountant().charge(MemoryKind::Part,
+                              (int64_t)loadedPart->bufferSize);
+  }
+  part = insertPair.first->second;
+  return MZ_OK;
+}
+
+size_t OpcPackage::getPartLoadTotal() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return partLoadTotal;
+}
+
+size_t OpcPackage::getCachedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return cachedBytes;
+}
+
+size_t OpcPackage::releaseParts() {
+  // swapped out and freed outside the lock
+  std::unordered_map<std::string, std::shared_ptr<const ZipPart>> released;
+  size_t releasedBytes;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    released.swap(partCache);
+    releasedBytes = cachedBytes;
+    cachedBytes = 0;
+  }
+  memoryAccountant().charge(MemoryKind::Part, -(int64_t)releasedBytes);
+  return releasedBytes;
+}
+
+} // namespace bookfiler
@@ -0,0 +1,143 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_OPC_H
+#define BOOKFILER_MODULE_DOCX_OPC_H
+
+// C++
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Local Project
+#include "arena.hpp"
+#include "zip.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* One <Relationship> of a .rels part. Internal targets are resolved to the
+ * part name as stored in the archive, "word/media/image1.png". The text
+ * lives in the arena of the OpcRelationshipList holding it.
+ */
+class OpcRelationship {
+public:
+  std::string_view id, type, target;
+  bool external = false;
+  /* Last segment of type: "styles", "image", "header", ... The transitional
+   * and strict namespaces give the same kind.
+   */
+  std::string_view getKind() const;
+};
+
+/* Relationships of one source part. Their strings are copied into an
+ * arena the list owns, one allocation for all of them, so the list cannot
+ * be copied.
+ */
+class OpcRelationshipList {
+public:
+  OpcRelationshipList() : textArena(1024) {}
+  OpcRelationshipList(const OpcRelationshipList &) = delete;
+  OpcRelationshipList &operator=(const OpcRelationshipList &) = delete;
+  /* @return nullptr if there is no relationship with that id */
+  const OpcRelationship *find(std::string_view id) const;
+  /* @return the first relationship of that kind or nullptr */
+  const OpcRelationship *findKind(std::string_view kind) const;
+  const std::vector<OpcRelationship> &getList() const {
+    return relationshipList;
+  }
+
+  /* Copies text into the arena, valid as long as the list */
+  std::string_view store(std::string_view text);
+  void clear();
+
+  std::vector<OpcRelationship> relationshipList;
+
+private:
+  MonotonicArena textArena;
+};
+
+/* Parses a .rels part. Relative targets are resolved against the directory
+ * of sourcePart, "" for the package relationships.
+ * @return MZ_OK or MZ_FORMAT_ERROR
+ */
+int32_t opcParseRelationships(std::string_view xml,
+                              std::string_view sourcePart,
+                              OpcRelationshipList &relationshipList);
+/* "word/document.xml" -> "word/_rels/document.xml.rels",
+ * "" -> "_rels/.rels"
+ */
+std::string opcRelationshipsPartName(std::string_view sourcePart);
+
+/* OpcPackage
+ * The Open Packaging Conventions view of a docx archive. open() reads only
+ * [Content_Types].xml and _rels/.rels, everything else is read when first
+ * asked for and then cached, so parts nobody looks at are never inflated.
+ * Lookups are thread safe, open() and close() must not overlap them.
+ */
+class OpcPackage {
+public:
+  OpcPackage();
+  ~OpcPackage();
+  int32_t open(std::shared_ptr<ZipReader> zipReader);
+  void close();
+  /* Override for the part, else the default for its extension, else "" */
+  std::string getContentType(std::string_view partName) const;
+  /* Target of the officeDocument relationship, "word/document.xml" */
+  const std::string &getMainPartName() const { return mainPartName; }
+  const OpcRelationshipList &getPackageRelationships() const {
+    return packageRelationships;
+  }
+  /* Relationships of sourcePart, parsed on first use. A part without a
+   * .rels part has an empty list.
+   */
+  int32_t getRelationships(
+      std::string_view sourcePart,
+      std::shared_ptr<const OpcRelationshipList> &relationshipList);
+  /* Inflated on first use and shared afterwards. Stored parts are views
+   * into the archive mapping.
+   * MZ_END_OF_LIST	-100	no such part
+   */
+  int32_t getPart(std::string_view partName,
+                  std::shared_ptr<const ZipPart> &part);
+  /* Parts read from the archive so far, .rels parts included */
+  size_t getPartLoadTotal() const;
+  /* Bytes of inflated parts in the cache, charged to memoryAccountant().
+   * Views into the archive mapping cost nothing.
+   */
+  size_t getCachedBytes() const;
+  /* Drops the cached parts, holders keep theirs. The next getPart reads
+   * the archive again.
+   * @return the bytes the cache held
+   */
+  size_t releaseParts();
+  std::shared_ptr<ZipReader> getZipReader() const { return zipReader; }
+
+private:
+  std::shared_ptr<ZipReader> zipReader;
+  // lower case extension and part name without the leading '/'
+  std::unordered_map<std::string, std::string> defaultTypeMap,
+      overrideTypeMap;
+  OpcRelationshipList packageRelationships;
+  std::string mainPartName;
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, std::shared_ptr<const OpcRelationshipList>>
+      relationshipsCache;
+  std::unordered_map<std::string, std::shared_ptr<const ZipPart>> partCache;
+  size_t partLoadTotal = 0;
+  size_t cachedBytes = 0;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_OPC_H
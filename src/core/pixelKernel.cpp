@@ -0,0 +1,499 @@
+// C++
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+// Local Project
+#include "bufferPool.hpp"
+#include "config.hpp"
+#include "pixelKernel.hpp"
+
+#if BOOKFILER_MODULE_DOCX_SIMD && (defined(__x86_64__) || defined(_M_X64))
+#define BOOKFILER_PIXEL_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define BOOKFILER_PIXEL_KERNEL_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BOOKFILER_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define BOOKFILER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BOOKFILER_TARGET_SSE41
+#define BOOKFILER_TARGET_AVX2
+#endif
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+/* scalar, the reference the others match byte for byte */
+
+void scalarHalveRow(const unsigned char *row0, const unsigned char *row1,
+                    unsigned char *dst, int32_t width) {
+  for (int32_t i = 0; i < width * 4; i++) {
+    int32_t channel = i & 3, x = (i >> 2) * 8 + channel;
+    dst[i] = (unsigned char)((row0[x] + row0[x + 4] + row1[x] + row1[x + 4] +
+                              2) >>
+                             2);
+  }
+}
+
+inline unsigned char lerp(uint32_t a, uint32_t b, uint32_t weight) {
+  return (unsigned char)((a * (256 - weight) + b * weight + 128) >> 8);
+}
+
+void scalarBlendRows(const unsigned char *row0, const unsigned char *row1,
+                     uint32_t weight, unsigned char *dst, size_t byteTotal) {
+  for (size_t i = 0; i < byteTotal; i++)
+    dst[i] = lerp(row0[i], row1[i], weight);
+}
+
+void scalarSampleRow(const unsigned char *src, const ScaleTap *tapList,
+                     unsigned char *dst, int32_t width) {
+  for (int32_t x = 0; x < width; x++) {
+    const unsigned char *left = src + (size_t)tapList[x].index * 4;
+    for (int channel = 0; channel < 4; channel++)
+      dst[x * 4 + channel] =
+          lerp(left[channel], left[channel + 4], tapList[x].weight);
+  }
+}
+
+/* d * (255 - alpha) / 255 rounded, exact for every 8 bit input */
+inline uint32_t fadeChannel(uint32_t d, uint32_t inverseAlpha) {
+  uint32_t t = d * inverseAlpha + 128;
+  return (t + (t >> 8)) >> 8;
+}
+
+void scalarCompositeRow(const unsigned char *src, unsigned char *dst,
+                        int32_t width) {
+  for (int32_t x = 0; x < width; x++, src += 4, dst += 4) {
+    uint32_t alpha = src[3];
+    if (alpha == 255) {
+      std::memcpy(dst, src, 4);
+    } else if (alpha != 0 || src[0] || src[1] || src[2]) {
+      for (int channel = 0; channel < 4; channel++)
+        dst[channel] = (unsigned char)std::min<uint32_t>(
+            255, src[channel] + fadeChannel(dst[channel], 255 - alpha));
+    }
+  }
+}
+
+const PixelKernel scalarKernel = {"scalar", scalarHalveRow, scalarBlendRows,
+                                  scalarSampleRow, scalarCompositeRow};
+
+#if BOOKFILER_PIXEL_KERNEL_X86
+
+/* sse4.1, two to four pixels a step */
+
+BOOKFILER_TARGET_SSE41 void sse41HalveRow(const unsigned char *row0,
+                                          const unsigned char *row1,
+                                          unsigned char *dst, int32_t width) {
+  const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+  int32_t x = 0;
+  // 4 source pixels of each row give 2
+  for (; width - x >= 2; x += 2) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+    __m128i b = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+    __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                _mm_unpacklo_epi8(b, zero));
+    __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                 _mm_unpackhi_epi8(b, zero));
+    low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+    high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+    __m128i sum = _mm_srli_epi16(
+        _mm_add_epi16(_mm_unpacklo_epi64(low, high), two), 2);
+    _mm_storel_epi64((__m128i *)(dst + x * 4), _mm_packus_epi16(sum, sum));
+  }
+  scalarHalveRow(row0 + x * 8, row1 + x * 8, dst + x * 4, width - x);
+}
+
+/* a * (256 - w) + b * w + 128 >> 8 on 16 bit lanes, fits unsigned */
+BOOKFILER_TARGET_SSE41 inline __m128i sse41Lerp(__m128i a, __m128i b,
+                                                __m128i weight,
+                                                __m128i inverse) {
+  __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, inverse),
+                              _mm_mullo_epi16(b, weight));
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+BOOKFILER_TARGET_SSE41 void sse41BlendRows(const unsigned char *row0,
+                                           const unsigned char *row1,
+                                           uint32_t weight, unsigned char *dst,
+                                           size_t byteTotal) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i weightVector = _mm_set1_epi16((short)weight),
+                inverse = _mm_set1_epi16((short)(256 - weight));
+  size_t i = 0;
+  for (; byteTotal - i >= 16; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(row0 + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(row1 + i));
+    __m128i low = sse41Lerp(_mm_unpacklo_epi8(a, zero),
+                            _mm_unpacklo_epi8(b, zero), weightVector, inverse);
+    __m128i high = sse41Lerp(_mm_unpackhi_epi8(a, zero),
+                             _mm_unpackhi_epi8(b, zero), weightVector, inverse);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(low, high));
+  }
+  scalarBlendRows(row0 + i, row1 + i, weight, dst + i, byteTotal - i);
+}
+
+/* One destination pixel in the low 4 lanes */
+BOOKFILER_TARGET_SSE41 inline __m128i sse41Sample(const unsigned char *src,
+                                                  const ScaleTap &tap) {
+  __m128i pair = _mm_cvtepu8_epi16(
+      _mm_loadl_epi64((const __m128i *)(src + tap.index * 4)));
+  __m128i weight = _mm_unpacklo_epi64(_mm_set1_epi16((short)(256 - tap.weight)),
+                                      _mm_set1_epi16((short)tap.weight));
+  __m128i product = _mm_mullo_epi16(pair, weight);
+  product = _mm_add_epi16(product, _mm_srli_si128(product, 8));
+  return _mm_srli_epi16(_mm_add_epi16(product, _mm_set1_epi16(128)), 8);
+}
+
+BOOKFILER_TARGET_SSE41 void sse41SampleRow(const unsigned char *src,
+                                           const ScaleTap *tapList,
+                                           unsigned char *dst, int32_t width) {
+  int32_t x = 0;
+  for (; width - x >= 2; x += 2) {
+    __m128i pixels = _mm_unpacklo_epi64(sse41Sample(src, tapList[x]),
+                                        sse41Sample(src, tapList[x + 1]));
+    _mm_storel_epi64((__m128i *)(dst + x * 4),
+                     _mm_packus_epi16(pixels, pixels));
+  }
+  scalarSampleRow(src, tapList + x, dst + x * 4, width - x);
+}
+
+BOOKFILER_TARGET_SSE41 inline __m128i sse41Fade(__m128i d, __m128i inverse) {
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(d, inverse), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+BOOKFILER_TARGET_SSE41 void sse41CompositeRow(const unsigned char *src,
+                                              unsigned char *dst,
+                                              int32_t width) {
+  const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi8(-1);
+  const __m128i alphaShuffle =
+      _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+  int32_t x = 0;
+  for (; width - x >= 4; x += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + x * 4));
+    __m128i alpha = _mm_shuffle_epi8(s, alphaShuffle);
+    if (_mm_test_all_ones(_mm_cmpeq_epi8(alpha, ones))) {
+      _mm_storeu_si128((__m128i *)(dst + x * 4), s);
+      continue;
+    }
+    if (_mm_testz_si128(s, s))
+      continue;
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + x * 4));
+    __m128i inverse = _mm_xor_si128(alpha, ones);
+    __m128i low = sse41Fade(_mm_unpacklo_epi8(d, zero),
+                            _mm_unpacklo_epi8(inverse, zero));
+    __m128i high = sse41Fade(_mm_unpackhi_epi8(d, zero),
+                             _mm_unpackhi_epi8(inverse, zero));
+    _mm_storeu_si128((__m128i *)(dst + x * 4),
+                     _mm_adds_epu8(s, _mm_packus_epi16(low, high)));
+  }
+  scalarCompositeRow(src + x * 4, dst + x * 4, width - x);
+}
+
+const PixelKernel sse41Kernel = {"sse41", sse41HalveRow, sse41BlendRows,
+                                 sse41SampleRow, sse41CompositeRow};
+
+/* avx2, four to eight pixels a step */
+
+BOOKFILER_TARGET_AVX2 void avx2HalveRow(const unsigned char *row0,
+                                        const unsigned char *row1,
+                                        unsigned char *dst, int32_t width) {
+  const __m256i zero = _mm256_setzero_si256(), two = _mm256_set1_epi16(2);
+  int32_t x = 0;
+  // 8 source pixels of each row give 4
+  for (; width - x >= 4; x += 4) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(row0 + x * 8));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(row1 + x * 8));
+    __m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero),
+                                   _mm256_unpacklo_epi8(b, zero));
+    __m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero),
+                                    _mm256_unpackhi_epi8(b, zero));
+    low = _mm256_add_epi16(low, _mm256_srli_si256(low, 8));
+    high = _mm256_add_epi16(high, _mm256_srli_si256(high, 8));
+    __m256i sum = _mm256_srli_epi16(
+        _mm256_add_epi16(_mm256_unpacklo_epi64(low, high), two), 2);
+    // each lane holds two results, gather them into the low lane
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum),
+                                              _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128((__m128i *)(dst + x * 4),
+                     _mm256_castsi256_si128(packed));
+  }
+  sse41HalveRow(row0 + x * 8, row1 + x * 8, dst + x * 4, width - x);
+}
+
+BOOKFILER_TARGET_AVX2 inline __m256i avx2Lerp(__m256i a, __m256i b,
+                                              __m256i weight,
+                                              __m256i inverse) {
+  __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(a, inverse),
+                                 _mm256_mullo_epi16(b, weight));
+  return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(128)), 8);
+}
+
+BOOKFILER_TARGET_AVX2 void avx2BlendRows(const unsigned char *row0,
+                                         const unsigned char *row1,
+                                         uint32_t weight, unsigned char *dst,
+                                         size_t byteTotal) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i weightVector = _mm256_set1_epi16((short)weight),
+                inverse = _mm256_set1_epi16((short)(256 - weight));
+  size_t i = 0;
+  for (; byteTotal - i >= 32; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(row0 + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(row1 + i));
+    __m256i low =
+        avx2Lerp(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero),
+                 weightVector, inverse);
+    __m256i high =
+        avx2Lerp(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero),
+                 weightVector, inverse);
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(low, high));
+  }
+  sse41BlendRows(row0 + i, row1 + i, weight, dst + i, byteTotal - i);
+}
+
+/* Destination pixels for two taps, one in the low 4 lanes of each half */
+BOOKFILER_TARGET_AVX2 inline __m256i avx2Sample(const unsigned char *src,
+                                                const ScaleTap &first,
+                                                const ScaleTap &second) {
+  __m256i pairs = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(
+      _mm_loadl_epi64((const __m128i *)(src + first.index * 4)),
+      _mm_loadl_epi64((const __m128i *)(src + second.index * 4))));
+  __m128i firstWeight =
+      _mm_unpacklo_epi64(_mm_set1_epi16((short)(256 - first.weight)),
+                         _mm_set1_epi16((short)first.weight));
+  __m128i secondWeight =
+      _mm_unpacklo_epi64(_mm_set1_epi16((short)(256 - second.weight)),
+                         _mm_set1_epi16((short)second.weight));
+  __m256i product = _mm256_mullo_epi16(
+      pairs, _mm256_inserti128_si256(_mm256_castsi128_si256(firstWeight),
+                                     secondWeight, 1));
+  product = _mm256_add_epi16(product, _mm256_srli_si256(product, 8));
+  return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_set1_epi16(128)),
+                           8);
+}
+
+BOOKFILER_TARGET_AVX2 void avx2SampleRow(const unsigned char *src,
+                                         const ScaleTap *tapList,
+                                         unsigned char *dst, int32_t width) {
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int32_t x = 0;
+  for (; width - x >= 4; x += 4) {
+    // lanes hold pixels (0, 2) and (1, 3)
+    __m256i pixels =
+        _mm256_unpacklo_epi64(avx2Sample(src, tapList[x], tapList[x + 1]),
+                              avx2Sample(src, tapList[x + 2], tapList[x + 3]));
+    __m256i packed = _mm256_permutevar8x32_epi32(
+        _mm256_packus_epi16(pixels, pixels), order);
+    _mm_storeu_si128((__m128i *)(dst + x * 4),
+                     _mm256_castsi256_si128(packed));
+  }
+  sse41SampleRow(src, tapList + x, dst + x * 4, width - x);
+}
+
+BOOKFILER_TARGET_AVX2 inline __m256i avx2Fade(__m256i d, __m256i inverse) {
+  __m256i t =
+      _mm256_add_epi16(_mm256_mullo_epi16(d, inverse), _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+BOOKFILER_TARGET_AVX2 void avx2CompositeRow(const unsigned char *src,
+                                            unsigned char *dst,
+                                            int32_t width) {
+  const __m256i zero = _mm256_setzero_si256(), ones = _mm256_set1_epi8(-1);
+  const __m256i alphaShuffle = _mm256_setr_epi8(
+      3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15, 3, 3, 3, 3, 7,
+      7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+  int32_t x = 0;
+  for (; width - x >= 8; x += 8) {
+    __m256i s = _mm256_loadu_si256((const __m256i *)(src + x * 4));
+    __m256i alpha = _mm256_shuffle_epi8(s, alphaShuffle);
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(alpha, ones)) == -1) {
+      _mm256_storeu_si256((__m256i *)(dst + x * 4), s);
+      continue;
+    }
+    if (_mm256_testz_si256(s, s))
+      continue;
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + x * 4));
+    __m256i inverse = _mm256_xor_si256(alpha, ones);
+    __m256i low = avx2Fade(_mm256_unpacklo_epi8(d, zero),
+                           _mm256_unpacklo_epi8(inverse, zero));
+    __m256i high = avx2Fade(_mm256_unpackhi_epi8(d, zero),
+                            _mm256_unpackhi_epi8(inverse, zero));
+    _mm256_storeu_si256((__m256i *)(dst + x * 4),
+                        _mm256_adds_epu8(s, _mm256_packus_epi16(low, high)));
+  }
+  sse41CompositeRow(src + x * 4, dst + x * 4, width - x);
+}
+
+const PixelKernel avx2Kernel = {"avx2", avx2HalveRow, avx2BlendRows,
+                                avx2SampleRow, avx2CompositeRow};
+
+void cpuFeatures(bool &sse41, bool &avx2) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  int leafMax = info[0];
+  __cpuid(info, 1);
+  sse41 = (info[2] & (1 << 19)) != 0;
+  avx2 = false;
+  // the OS must save the ymm registers
+  if (leafMax < 7 || !(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) ||
+      (_xgetbv(0) & 6) != 6)
+    return;
+  __cpuidex(info, 7, 0);
+  avx2 = (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  sse41 = __builtin_cpu_supports("sse4.1");
+  avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // BOOKFILER_PIXEL_KERNEL_X86
+
+std::vector<const PixelKernel *> supportedKernels() {
+  std::vector<const PixelKernel *> kernelList = {&scalarKernel};
+#if BOOKFILER_PIXEL_KERNEL_X86
+  bool sse41, avx2;
+  cpuFeatures(sse41, avx2);
+  // the avx2 kernel finishes rows with the sse4.1 one
+  if (sse41)
+    kernelList.push_back(&sse41Kernel);
+  if (sse41 && avx2)
+    kernelList.push_back(&avx2Kernel);
+#endif
+  return kernelList;
+}
+
+std::atomic<const PixelKernel *> selectedKernel{nullptr};
+
+/* Source pixel and weight in 1/256 for each of total destination pixels,
+ * sampled at pixel centres. The last index is clamped with weight 0.
+ */
+void scaleTaps(int32_t sourceTotal, int32_t total,
+               std::vector<ScaleTap> &tapList) {
+  tapList.resize(total);
+  for (int32_t i = 0; i < total; i++) {
+    int64_t position =
+        std::max<int64_t>(0, (int64_t)(2 * i + 1) * sourceTotal * 128 / total -
+                                 128);
+    uint32_t index = (uint32_t)(position >> 8);
+    uint32_t weight = (uint32_t)(position & 255);
+    if (index >= (uint32_t)sourceTotal - 1) {
+      index = (uint32_t)sourceTotal - 1;
+      weight = 0;
+    }
+    tapList[i] = {index, weight};
+  }
+}
+
+} // namespace
+
+const std::vector<const PixelKernel *> &pixelKernelList() {
+  static const std::vector<const PixelKernel *> kernelList =
+      supportedKernels();
+  return kernelList;
+}
+
+const PixelKernel &pixelKernel() {
+  const PixelKernel *kernel = selectedKernel.load(std::memory_order_acquire);
+  if (!kernel) {
+    kernel = pixelKernelList().back();
+    selectedKernel.store(kernel, std::memory_order_release);
+  }
+  return *kernel;
+}
+
+bool pixelSelectKernel(std::string_view kernelName) {
+  for (const PixelKernel *kernel : pixelKernelList()) {
+    if (kernelName == kernel->name) {
+      selectedKernel.store(kernel, std::memory_order_release);
+      return true;
+    }
+  }
+  return false;
+}
+
+void pixelPremultiply(unsigned char *row, int32_t width) {
+  for (int32_t x = 0; x < width; x++, row += 4) {
+    uint32_t alpha = row[3];
+    if (alpha == 255)
+      continue;
+    for (int channel = 0; channel < 3; channel++)
+      row[channel] = (unsigned char)fadeChannel(row[channel], alpha);
+  }
+}
+
+void pixelScale(const RasterImage &src, int32_t width, int32_t height,
+                RasterImage &dst) {
+  const PixelKernel &kernel = pixelKernel();
+  RasterImage current = src;
+  while (current.width >= 2 * width && current.height >= 2 * height) {
+    RasterImage half;
+    half.width = current.width / 2;
+    half.height = current.height / 2;
+    half.stride = (size_t)half.width * 4;
+    half.pixels = pixmapBufferPool().acquire(half.byteSize());
+    for (int32_t y = 0; y < half.height; y++) {
+      const unsigned char *row0 =
+          current.pixels.get() + (size_t)(2 * y) * current.stride;
+      kernel.halveRow(row0, row0 + current.stride,
+                      half.pixels.get() + (size_t)y * half.stride, half.width);
+    }
+    current = half;
+  }
+  if (current.width == width && current.height == height) {
+    dst = current;
+    return;
+  }
+
+  std::vector<ScaleTap> columnList, rowList;
+  scaleTaps(current.width, width, columnList);
+  scaleTaps(current.height, height, rowList);
+  // one pixel past the row repeats the last, for the clamped taps
+  std::vector<unsigned char> scratch(((size_t)current.width + 1) * 4);
+  size_t rowBytes = (size_t)current.width * 4;
+  dst.width = width;
+  dst.height = height;
+  dst.stride = (size_t)width * 4;
+  dst.pixels = pixmapBufferPool().acquire(dst.byteSize());
+  for (int32_t y = 0; y < height; y++) {
+    const ScaleTap &tap = rowList[y];
+    const unsigned char *row0 =
+        current.pixels.get() + (size_t)tap.index * current.stride;
+    const unsigned char *row1 =
+        tap.weight ? row0 + current.stride : row0;
+    kernel.blendRows(row0, row1, tap.weight, scratch.data(), rowBytes);
+    std::memcpy(scratch.data() + rowBytes, scratch.data() + rowBytes - 4, 4);
+    kernel.sampleRow(scratch.data(), columnList.data(),
+                     dst.pixels.get() + (size_t)y * dst.stride, width);
+  }
+}
+
+void pixelComposite(const RasterImage &src, unsigned char *target,
+                    size_t targetStride, int32_t targetWidth,
+                    int32_t targetHeight, int32_t x, int32_t y) {
+  int32_t x0 = std::max(0, x), x1 = std::min(targetWidth, x + src.width);
+  int32_t y0 = std::max(0, y), y1 = std::min(targetHeight, y + src.height);
+  if (x0 >= x1 || y0 >= y1)
+    return;
+  const PixelKernel &kernel = pixelKernel();
+  for (int32_t row = y0; row < y1; row++)
+    kernel.compositeRow(src.pixels.get() + (size_t)(row - y) * src.stride +
+                            (size_t)(x0 - x) * 4,
+                        target + (size_t)row * targetStride + (size_t)x0 * 4,
+                        x1 - x0);
+}
+
+} // namespace bookfiler
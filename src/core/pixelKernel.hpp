@@ -0,0 +1,86 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_PIXEL_KERNEL_H
+#define BOOKFILER_MODULE_DOCX_PIXEL_KERNEL_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Local Project
+#include "tileCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* A destination pixel of a horizontal resample: the left source pixel and
+ * the weight, 0 to 256, of the one to its right
+ */
+class ScaleTap {
+public:
+  uint32_t index, weight;
+};
+
+/* PixelKernel
+ * The per row loops image scaling and compositing spend their time in, on
+ * premultiplied RGBA. One kernel per instruction set, the best one the CPU
+ * supports is picked the first time pixelKernel() is called. Every kernel
+ * gives the same bytes as the scalar one.
+ */
+class PixelKernel {
+public:
+  const char *name;
+  /* dst[x] = the rounded mean of pixels 2x and 2x + 1 of row0 and row1 */
+  void (*halveRow)(const unsigned char *row0, const unsigned char *row1,
+                   unsigned char *dst, int32_t width);
+  /* dst = row0 + (row1 - row0) * weight / 256 over byteTotal bytes, weight
+   * 0 to 256
+   */
+  void (*blendRows)(const unsigned char *row0, const unsigned char *row1,
+                    uint32_t weight, unsigned char *dst, size_t byteTotal);
+  /* dst[x] = src[tap.index] + (src[tap.index + 1] - src[tap.index]) *
+   * tap.weight / 256, src must hold a pixel past the last index
+   */
+  void (*sampleRow)(const unsigned char *src, const ScaleTap *tapList,
+                    unsigned char *dst, int32_t width);
+  /* dst = src + dst * (255 - src alpha) / 255, every channel */
+  void (*compositeRow)(const unsigned char *src, unsigned char *dst,
+                       int32_t width);
+};
+
+const PixelKernel &pixelKernel();
+/* Every kernel this CPU can run, scalar first */
+const std::vector<const PixelKernel *> &pixelKernelList();
+/* Overrides the automatic choice, meant for benchmarks and debugging.
+ * Not synchronized with renders running on other threads.
+ * @return false if no supported kernel has that name
+ */
+bool pixelSelectKernel(std::string_view kernelName);
+
+/* Straight alpha to premultiplied, in place */
+void pixelPremultiply(unsigned char *row, int32_t width);
+/* Resamples src to width x height into a buffer from pixmapBufferPool():
+ * halved in both directions while at least twice the size, then bilinear
+ */
+void pixelScale(const RasterImage &src, int32_t width, int32_t height,
+                RasterImage &dst);
+/* Draws src premultiplied over target pixels at (x, y), clipped to
+ * targetWidth x targetHeight
+ */
+void pixelComposite(const RasterImage &src, unsigned char *target,
+                    size_t targetStride, int32_t targetWidth,
+                    int32_t targetHeight, int32_t x, int32_t y);
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_PIXEL_KERNEL_H
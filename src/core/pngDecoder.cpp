@@ -0,0 +1,341 @@
+// C++
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/* zlib
+ * License: zlib
+ */
+#include <zlib.h>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "bufferPool.hpp"
+#include "pixelKernel.hpp"
+#include "pngDecoder.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const unsigned char pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                       '\n'};
+enum ColorType : uint8_t {
+  gray = 0,
+  rgb = 2,
+  palette = 3,
+  grayAlpha = 4,
+  rgbAlpha = 6
+};
+
+uint32_t getBE32(const unsigned char *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+         p[3];
+}
+
+/* Calls callback(type, data) for every chunk until it returns false.
+ * @return false if a chunk runs past the end
+ */
+template <class F> bool forEachChunk(std::string_view data, F &&callback) {
+  size_t offset = sizeof(pngSignature);
+  while (data.size() - offset >= 12) {
+    auto *p = (const unsigned char *)data.data() + offset;
+    uint32_t length = getBE32(p);
+    if (length > data.size() - offset - 12)
+      return false;
+    std::string_view type(data.data() + offset + 4, 4);
+    if (!callback(type, std::string_view(data.data() + offset + 8, length)))
+      return true;
+    offset += 12 + (size_t)length;
+  }
+  return true;
+}
+
+/* The seven Adam7 passes, or the whole image as one */
+class Pass {
+public:
+  int32_t x0, y0, dx, dy;
+};
+const Pass adam7List[7] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8},
+                           {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2},
+                           {0, 1, 1, 2}};
+const Pass wholePass = {0, 0, 1, 1};
+
+uint8_t paeth(int32_t a, int32_t b, int32_t c) {
+  int32_t p = a + b - c;
+  int32_t pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+  return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+/* Undoes the filter of row in place, previous is the row above unfiltered
+ * or nullptr for the first
+ */
+bool unfilter(uint8_t filter, unsigned char *row, const unsigned char *previous,
+              size_t rowBytes, size_t pixelBytes) {
+  switch (filter) {
+  case 0:
+    return true;
+  case 1:
+    for (size_t i = pixelBytes; i < rowBytes; i++)
+      row[i] = (unsigned char)(row[i] + row[i - pixelBytes]);
+    return true;
+  case 2:
+    if (previous)
+      for (size_t i = 0; i < rowBytes; i++)
+        row[i] = (unsigned char)(row[i] + previous[i]);
+    return true;
+  case 3:
+    for (size_t i = 0; i < rowBytes; i++) {
+      int32_t left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+      int32_t up = previous ? previous[i] : 0;
+      row[i] = (unsigned char)(row[i] + ((left + up) >> 1));
+    }
+    return true;
+  case 4:
+    for (size_t i = 0; i < rowBytes; i++) {
+      int32_t left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+      int32_t up = previous ? previous[i] : 0;
+      int32_t upLeft = previous && i >= pixelBytes ? previous[i - pixelBytes]
+                                                   : 0;
+      row[i] = (unsigned char)(row[i] + paeth(left, up, upLeft));
+    }
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+int32_t PngDecoder::open(std::string_view data_) {
+  data = data_;
+  width = height = 0;
+  if (data.size() < sizeof(pngSignature) + 25 ||
+      std::memcmp(data.data(), pngSignature, sizeof(pngSignature)) != 0)
+    return MZ_FORMAT_ERROR;
+  auto *header = (const unsigned char *)data.data() + sizeof(pngSignature);
+  if (getBE32(header) != 13 || std::memcmp(header + 4, "IHDR", 4) != 0)
+    return MZ_FORMAT_ERROR;
+  uint32_t headerWidth = getBE32(header + 8),
+           headerHeight = getBE32(header + 12);
+  bitDepth = header[16];
+  colorType = header[17];
+  interlaced = header[20] == 1;
+  if (headerWidth == 0 || headerHeight == 0 || headerWidth > 0x7FFFFFFF ||
+      headerHeight > 0x7FFFFFFF || header[18] != 0 || header[19] != 0 ||
+      header[20] > 1)
+    return MZ_FORMAT_ERROR;
+  bool depthValid;
+  switch (colorType) {
+  case gray:
+    depthValid = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 ||
+                 bitDepth == 8 || bitDepth == 16;
+    break;
+  case palette:
+    depthValid = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 ||
+                 bitDepth == 8;
+    break;
+  case rgb:
+  case grayAlpha:
+  case rgbAlpha:
+    depthValid = bitDepth == 8 || bitDepth == 16;
+    break;
+  default:
+    depthValid = false;
+  }
+  if (!depthValid)
+    return MZ_SUPPORT_ERROR;
+  if ((uint64_t)headerWidth * headerHeight > imagePixelMax)
+    return MZ_MEM_ERROR;
+  width = (int32_t)headerWidth;
+  height = (int32_t)headerHeight;
+  return MZ_OK;
+}
+
+int32_t PngDecoder::decode(RasterImage &image) {
+  if (width == 0)
+    return MZ_PARAM_ERROR;
+  // palette entries as RGBA, and the colour tRNS makes transparent
+  unsigned char paletteList[256 * 4];
+  for (int i = 0; i < 256; i++) {
+    std::memset(paletteList + i * 4, 0, 3);
+    paletteList[i * 4 + 3] = 255;
+  }
+  int32_t keyList[3] = {-1, -1, -1};
+  std::vector<std::string_view> dataList;
+  bool complete = forEachChunk(
+      data, [&](std::string_view type, std::string_view chunk) {
+        auto *p = (const unsigned char *)chunk.data();
+        if (type == "PLTE") {
+          for (size_t i = 0; i < chunk.size() / 3 && i < 256; i++)
+            std::memcpy(paletteList + i * 4, p + i * 3, 3);
+        } else if (type == "tRNS") {
+          if (colorType == palette) {
+            for (size_t i = 0; i < chunk.size() && i < 256; i++)
+              paletteList[i * 4 + 3] = p[i];
+          } else if (colorType == gray && chunk.size() >= 2) {
+            keyList[0] = p[0] << 8 | p[1];
+          } else if (colorType == rgb && chunk.size() >= 6) {
+            for (int i = 0; i < 3; i++)
+              keyList[i] = p[i * 2] << 8 | p[i * 2 + 1];
+          }
+        } else if (type == "IDAT") {
+          dataList.push_back(chunk);
+        }
+        return type != "IEND";
+      });
+  if (!complete || dataList.empty())
+    return MZ_FORMAT_ERROR;
+
+  int channelTotal = colorType == rgb         ? 3
+                     : colorType == grayAlpha ? 2
+                     : colorType == rgbAlpha  ? 4
+                                              : 1;
+  size_t bitsPerPixel = (size_t)channelTotal * bitDepth;
+  size_t pixelBytes = std::max<size_t>(1, bitsPerPixel / 8);
+  const Pass *passList = interlaced ? adam7List : &wholePass;
+  int passTotal = interlaced ? 7 : 1;
+  size_t rawBytes = 0;
+  for (int pass = 0; pass < passTotal; pass++) {
+    const Pass &passInfo = passList[pass];
+    int64_t passWidth =
+        (width - passInfo.x0 + passInfo.dx - 1) / passInfo.dx;
+    int64_t passHeight =
+        (height - passInfo.y0 + passInfo.dy - 1) / passInfo.dy;
+    if (passWidth > 0 && passHeight > 0)
+      rawBytes += (size_t)passHeight * (1 + (passWidth * bitsPerPixel + 7) / 8);
+  }
+
+  // the filtered rows of every pass one after the other
+  std::vector<unsigned char> raw(rawBytes);
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (inflateInit(&stream) != Z_OK)
+    return MZ_MEM_ERROR;
+  stream.next_out = raw.data();
+  stream.avail_out = (uInt)raw.size();
+  int inflateErr = Z_OK;
+  for (std::string_view chunk : dataList) {
+    stream.next_in = (Bytef *)chunk.data();
+    stream.avail_in = (uInt)chunk.size();
+    inflateErr = inflate(&stream, Z_NO_FLUSH);
+    if (inflateErr != Z_OK)
+      break;
+  }
+  size_t inflatedBytes = raw.size() - stream.avail_out;
+  inflateEnd(&stream);
+  // a missing Adler-32 or trailing bytes are let pass, short rows are not
+  if ((inflateErr != Z_OK && inflateErr != Z_STREAM_END &&
+       inflateErr != Z_BUF_ERROR) ||
+      inflatedBytes != raw.size())
+    return MZ_DATA_ERROR;
+
+  image.width = width;
+  image.height = height;
+  image.stride = (size_t)width * 4;
+  image.pixels = pixmapBufferPool().acquire(image.byteSize());
+  unsigned char *pixels = image.pixels.get();
+  if (interlaced)
+    std::memset(pixels, 0, image.byteSize());
+  int maxValue = (1 << bitDepth) - 1;
+  // the tRNS colour as 16 bit samples, -1 matches nothing
+  int32_t keySample[3];
+  for (int c = 0; c < 3; c++)
+    keySample[c] = keyList[c] < 0 || keyList[c] > maxValue
+                       ? -1
+                       : (int32_t)((int64_t)keyList[c] * 0xFFFF / maxValue);
+  unsigned char *rowBegin = raw.data();
+  for (int pass = 0; pass < passTotal; pass++) {
+    const Pass &passInfo = passList[pass];
+    int32_t passWidth =
+        (width - passInfo.x0 + passInfo.dx - 1) / passInfo.dx;
+    int32_t passHeight =
+        (height - passInfo.y0 + passInfo.dy - 1) / passInfo.dy;
+    if (passWidth <= 0 || passHeight <= 0)
+      continue;
+    size_t rowBytes = ((size_t)passWidth * bitsPerPixel + 7) / 8;
+    const unsigned char *previous = nullptr;
+    for (int32_t y = 0; y < passHeight; y++) {
+      unsigned char *row = rowBegin + 1;
+      if (!unfilter(rowBegin[0], row, previous, rowBytes, pixelBytes))
+        return MZ_DATA_ERROR;
+      unsigned char *out =
+          pixels + (size_t)(passInfo.y0 + y * passInfo.dy) * image.stride;
+      // 8 bit truecolour rows of a plain image need no per sample work
+      if (bitDepth == 8 && passInfo.dx == 1 && colorType == rgbAlpha) {
+        std::memcpy(out, row, rowBytes);
+      } else if (bitDepth == 8 && passInfo.dx == 1 && colorType == rgb &&
+                 keyList[0] < 0) {
+        for (int32_t x = 0; x < passWidth; x++) {
+          std::memcpy(out + (size_t)x * 4, row + (size_t)x * 3, 3);
+          out[(size_t)x * 4 + 3] = 255;
+        }
+      } else {
+        for (int32_t x = 0; x < passWidth; x++) {
+          unsigned char *pixel =
+              out + (size_t)(passInfo.x0 + x * passInfo.dx) * 4;
+          // samples as 16 bit values, the high byte is what is drawn
+          int32_t sample[4];
+          if (bitDepth < 8) {
+            size_t bit = (size_t)x * bitDepth;
+            int32_t value = (row[bit >> 3] >> (8 - bitDepth - (bit & 7))) &
+                            maxValue;
+            sample[0] = value;
+            if (colorType == gray)
+              sample[0] = value * 0xFFFF / maxValue;
+          } else {
+            for (int c = 0; c < channelTotal; c++)
+              sample[c] = bitDepth == 8
+                              ? row[(size_t)x * channelTotal + c] * 0x101
+                              : row[((size_t)x * channelTotal + c) * 2] << 8 |
+                                    row[((size_t)x * channelTotal + c) * 2 + 1];
+          }
+          switch (colorType) {
+          case palette: {
+            int32_t index = bitDepth == 8 ? sample[0] >> 8 : sample[0];
+            std::memcpy(pixel, paletteList + index * 4, 4);
+            break;
+          }
+          case gray: {
+            pixel[0] = pixel[1] = pixel[2] = (unsigned char)(sample[0] >> 8);
+            pixel[3] = sample[0] == keySample[0] ? 0 : 255;
+            break;
+          }
+          case grayAlpha:
+            pixel[0] = pixel[1] = pixel[2] = (unsigned char)(sample[0] >> 8);
+            pixel[3] = (unsigned char)(sample[1] >> 8);
+            break;
+          case rgb: {
+            bool keyed = true;
+            for (int c = 0; c < 3; c++) {
+              pixel[c] = (unsigned char)(sample[c] >> 8);
+              keyed = keyed && sample[c] == keySample[c];
+            }
+            pixel[3] = keyed ? 0 : 255;
+            break;
+          }
+          default:
+            for (int c = 0; c < 4; c++)
+              pixel[c] = (unsigned char)(sample[c] >> 8);
+          }
+        }
+      }
+      previous = row;
+      rowBegin += 1 + rowBytes;
+    }
+  }
+  for (int32_t y = 0; y < height; y++)
+    pixelPremultiply(pixels + (size_t)y * image.stride, width);
+  return MZ_OK;
+}
+
+} // namespace bookfiler
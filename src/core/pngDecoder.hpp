@@ -0,0 +1,54 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_PNG_DECODER_H
+#define BOOKFILER_MODULE_DOCX_PNG_DECODER_H
+
+// C++
+#include <cstdint>
+#include <string_view>
+
+// Local Project
+#include "tileCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* PngDecoder
+ * Every colour type and bit depth of PNG, Adam7 included, decoded with
+ * zlib into premultiplied 8 bit RGBA. A tRNS chunk gives palette alpha or
+ * the transparent colour; gamma, colour profiles and ancillary chunks are
+ * ignored, and so are chunk CRCs, the image data has its own Adler-32.
+ */
+class PngDecoder {
+public:
+  /* Reads the header.
+   * MZ_FORMAT_ERROR	-103	not a PNG or a broken header
+   * MZ_SUPPORT_ERROR	-109	an unknown colour type or bit depth
+   * MZ_MEM_ERROR	-4	more pixels than imagePixelMax
+   */
+  int32_t open(std::string_view data);
+  int32_t getWidth() const { return width; }
+  int32_t getHeight() const { return height; }
+  /* The whole image into a buffer from pixmapBufferPool().
+   * MZ_DATA_ERROR	-3	the image data does not inflate
+   */
+  int32_t decode(RasterImage &image);
+
+private:
+  std::string_view data;
+  int32_t width = 0, height = 0;
+  uint8_t bitDepth = 0, colorType = 0;
+  bool interlaced = false;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_PNG_DECODER_H
@@ -0,0 +1,246 @@
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Local Project
+#include "glyphCache.hpp"
+#include "pixelKernel.hpp"
+#include "rasterizer.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const int32_t twipsPerInch = 1440;
+const int32_t emuPerTwip = 635;
+const int32_t defaultTabStop = 720;
+
+/* Blends color over the rectangle, edges are antialiased by coverage.
+ * Coordinates are page pixels.
+ */
+void fillRect(const RasterTarget &target, float left, float top, float right,
+              float bottom, uint32_t color, float alpha) {
+  left -= target.originX;
+  right -= target.originX;
+  top -= target.originY;
+  bottom -= target.originY;
+  int32_t x0 = std::max(0, (int32_t)std::floor(left));
+  int32_t x1 = std::min(target.width, (int32_t)std::ceil(right));
+  int32_t y0 = std::max(0, (int32_t)std::floor(top));
+  int32_t y1 = std::min(target.height, (int32_t)std::ceil(bottom));
+  if (x0 >= x1 || y0 >= y1)
+    return;
+  int32_t red = (color >> 16) & 0xFF, green = (color >> 8) & 0xFF,
+          blue = color & 0xFF;
+  for (int32_t y = y0; y < y1; y++) {
+    float coverageY = std::min(bottom, (float)y + 1) - std::max(top, (float)y);
+    unsigned char *row = target.pixels + (size_t)y * target.stride;
+    for (int32_t x = x0; x < x1; x++) {
+      float coverageX =
+          std::min(right, (float)x + 1) - std::max(left, (float)x);
+      int32_t weight = (int32_t)(alpha * coverageX * coverageY * 256 + 0.5f);
+      unsigned char *pixel = row + (size_t)x * 4;
+      pixel[0] = (unsigned char)(pixel[0] + (((red - pixel[0]) * weight) >> 8));
+      pixel[1] =
+          (unsigned char)(pixel[1] + (((green - pixel[1]) * weight) >> 8));
+      pixel[2] =
+          (unsigned char)(pixel[2] + (((blue - pixel[2]) * weight) >> 8));
+    }
+  }
+}
+
+/* Blends color through a glyph mask whose top left is page pixel (x, y) */
+void blendMask(const RasterTarget &target, const GlyphMask &mask, int32_t x,
+               int32_t y, uint32_t color) {
+  x -= target.originX;
+  y -= target.originY;
+  int32_t x0 = std::max(0, x), x1 = std::min(target.width, x + mask.width);
+  int32_t y0 = std::max(0, y), y1 = std::min(target.height, y + mask.height);
+  if (x0 >= x1 || y0 >= y1)
+    return;
+  int32_t red = (color >> 16) & 0xFF, green = (color >> 8) & 0xFF,
+          blue = color & 0xFF;
+  for (int32_t row = y0; row < y1; row++) {
+    const uint8_t *coverage =
+        mask.pixels + (size_t)(row - y) * mask.stride + (x0 - x);
+    unsigned char *pixel = target.pixels + (size_t)row * target.stride +
+                           (size_t)x0 * 4;
+    for (int32_t column = x0; column < x1; column++, coverage++, pixel += 4) {
+      // 0..255 onto 0..256
+      int32_t weight = *coverage + (*coverage >> 7);
+      if (weight == 0)
+        continue;
+      pixel[0] = (unsigned char)(pixel[0] + (((red - pixel[0]) * weight) >> 8));
+      pixel[1] =
+          (unsigned char)(pixel[1] + (((green - pixel[1]) * weight) >> 8));
+      pixel[2] =
+          (unsigned char)(pixel[2] + (((blue - pixel[2]) * weight) >> 8));
+    }
+  }
+}
+
+} // namespace
+
+PageRasterizer::PageRasterizer(const DocumentLayout &layout_, int32_t dpi_,
+                               media_lookup_cb_t mediaLookup_)
+    : layout(layout_), dpi(dpi_), mediaLookup(std::move(mediaLookup_)),
+      scale((float)dpi_ / twipsPerInch) {}
+
+void PageRasterizer::getPageSize(uint32_t pageIndex, int32_t &width,
+                                 int32_t &height) const {
+  const DocumentSection &section =
+      layout.getModel()
+          .sectionList[layout.getPageList()[pageIndex].sectionIndex];
+  width = std::max<int32_t>(
+      1, (int32_t)(((int64_t)section.pageWidth * dpi + twipsPerInch - 1) /
+                   twipsPerInch));
+  height = std::max<int32_t>(
+      1, (int32_t)(((int64_t)section.pageHeight * dpi + twipsPerInch - 1) /
+                   twipsPerInch));
+}
+
+void PageRasterizer::render(uint32_t pageIndex,
+                            const RasterTarget &target) const {
+  for (int32_t y = 0; y < target.height; y++)
+    std::memset(target.pixels + (size_t)y * target.stride, 0xFF,
+                (size_t)target.width * 4);
+  const LayoutPage &page = layout.getPageList()[pageIndex];
+  const std::vector<LayoutBox> &boxList = layout.getBoxList();
+  float targetTop = (float)target.originY,
+        targetBottom = (float)(target.originY + target.height);
+  // masks found in this generation stay valid until the render is done
+  std::shared_ptr<GlyphAtlas::Generation> generation = glyphAtlas().pin();
+  std::vector<uint8_t> scratch;
+  for (uint32_t boxIndex = page.boxBegin; boxIndex < page.boxEnd; boxIndex++) {
+    const LayoutBox &box = boxList[boxIndex];
+    // descenders and drawings can reach a little outside the line
+    float boxTop = (box.y - box.height) * scale,
+          boxBottom = (box.y + 2 * box.height) * scale;
+    if (boxBottom < targetTop || boxTop > targetBottom)
+      continue;
+    drawBox(box, target, *generation, scratch);
+  }
+}
+
+void PageRasterizer::drawBox(const LayoutBox &box, const RasterTarget &target,
+                             GlyphAtlas::Generation &generation,
+                             std::vector<uint8_t> &scratch) const {
+  const DocumentModel &model = layout.getModel();
+  const LayoutOptions &options = layout.getOptions();
+  float targetLeft = (float)target.originX,
+        targetRight = (float)(target.originX + target.width);
+  float lineLeft = box.x * scale;
+  // no ascent is kept per line, four fifths down is close for text
+  float baseline = (box.y + box.height * 4 / 5) * scale;
+  // 1/1000 twip from the line start, the unit LineBreaker measured in
+  int64_t cursor = 0;
+  // whole pixels keep glyph rows on the atlas grid
+  int32_t baselinePixel = (int32_t)std::lround(baseline);
+
+  for (uint32_t runIndex = box.runBegin; runIndex < box.runEnd; runIndex++) {
+    const DocumentRun &run = model.runList[runIndex];
+    const RunProperties &runProperties = model.getRunProperties(run);
+    if (runProperties.flags & RunProperties::vanish)
+      continue;
+    uint32_t color = runProperties.color == colorAuto ? 0 : runProperties.color;
+    int32_t sizeTwips =
+        (runProperties.halfPoints ? runProperties.halfPoints
+                                  : options.defaultHalfPoints) *
+        10;
+    int32_t runBaseline = baselinePixel;
+    if (runProperties.flags & RunProperties::superscript)
+      runBaseline -= (int32_t)std::lround(sizeTwips * scale / 3);
+    if (runProperties.flags & RunProperties::subscript)
+      runBaseline += (int32_t)std::lround(sizeTwips * scale / 6);
+    if (runProperties.flags &
+        (RunProperties::superscript | RunProperties::subscript))
+      sizeTwips = sizeTwips * 2 / 3;
+    float em = sizeTwips * scale;
+    int64_t runStart = cursor;
+
+    if (run.objectIndex != documentNone) {
+      const DocumentObject &object = model.objectList[run.objectIndex];
+      float left = lineLeft + cursor * scale / 1000;
+      float right = left + object.width * scale / emuPerTwip;
+      float bottom = (box.y + box.height) * scale;
+      float top = bottom - object.height * scale / emuPerTwip;
+      cursor += object.width * 1000 / emuPerTwip;
+      if (right < targetLeft || left > targetRight ||
+          bottom < target.originY || top > target.originY + target.height)
+        continue;
+      // the same whole pixel rectangle in every tile, so they line up
+      int32_t x0 = (int32_t)std::lround(left), x1 = (int32_t)std::lround(right);
+      int32_t y0 = (int32_t)std::lround(top), y1 = (int32_t)std::lround(bottom);
+      std::shared_ptr<const RasterImage> image;
+      if (mediaLookup && x1 > x0 && y1 > y0)
+        image = mediaLookup(model.stringPool.get(object.relId), x1 - x0,
+                            y1 - y0);
+      if (image) {
+        pixelComposite(*image, target.pixels, target.stride, target.width,
+                       target.height, x0 - target.originX,
+                       y0 - target.originY);
+        continue;
+      }
+      fillRect(target, left, top, right, bottom, 0xE8E8E8, 1.0f);
+      fillRect(target, left, top, right, top + 1, 0xA0A0A0, 1.0f);
+      fillRect(target, left, bottom - 1, right, bottom, 0xA0A0A0, 1.0f);
+      fillRect(target, left, top, left + 1, bottom, 0xA0A0A0, 1.0f);
+      fillRect(target, right - 1, top, right, bottom, 0xA0A0A0, 1.0f);
+      continue;
+    }
+
+    const FontMetrics &metrics = layout.getFontMetrics(runProperties.fontId);
+    bool bold = (runProperties.flags & RunProperties::bold) != 0;
+    bool caps = (runProperties.flags & RunProperties::caps) != 0;
+    std::shared_ptr<const ShapedRun> shaped = shapedRunCache().get(
+        model.getText(run), model.stringPool.get(runProperties.fontId),
+        metrics, sizeTwips, bold, caps);
+    const std::vector<ShapedGlyph> &glyphList = shaped->glyphList;
+    // runs split across lines are shaped once, start at this line's slice
+    uint32_t sliceBegin =
+        box.textBegin > run.textOffset ? box.textBegin - run.textOffset : 0;
+    uint32_t sliceEnd = box.textEnd - run.textOffset;
+    auto glyphIt = std::lower_bound(
+        glyphList.begin(), glyphList.end(), sliceBegin,
+        [](const ShapedGlyph &glyph, uint32_t offset) {
+          return glyph.offset < offset;
+        });
+    int32_t sizeFixed = (int32_t)(em * 64 + 0.5f);
+    for (; glyphIt != glyphList.end() && glyphIt->offset < sliceEnd;
+         glyphIt++) {
+      uint32_t codePoint = glyphIt->codePoint;
+      if (codePoint == '\t') {
+        int64_t stop = (int64_t)defaultTabStop * 1000;
+        cursor = (cursor / stop + 1) * stop;
+        continue;
+      }
+      float left = lineLeft + cursor * scale / 1000;
+      float width = glyphIt->advance * scale / 1000;
+      cursor += glyphIt->advance;
+      if (codePoint <= ' ' || left + width < targetLeft || left > targetRight)
+        continue;
+      float penPixel = std::floor(left);
+      GlyphKey key{&metrics, codePoint, sizeFixed, (uint8_t)bold,
+                   (uint8_t)((left - penPixel) * glyphSubpixelTotal)};
+      GlyphMask mask = glyphAtlas().find(generation, key, width, scratch);
+      blendMask(target, mask, (int32_t)penPixel + mask.left,
+                runBaseline + mask.top, color);
+    }
+
+    float runLeft = lineLeft + runStart * scale / 1000;
+    float runRight = lineLeft + cursor * scale / 1000;
+    float stroke = std::max(1.0f, em / 18);
+    if (runProperties.flags & RunProperties::underline)
+      fillRect(target, runLeft, runBaseline + em / 10, runRight,
+               runBaseline + em / 10 + stroke, color, 1.0f);
+    if (runProperties.flags & RunProperties::strike)
+      fillRect(target, runLeft, runBaseline - em * 0.3f, runRight,
+               runBaseline - em * 0.3f + stroke, color, 1.0f);
+  }
+}
+
+} // namespace bookfiler
@@ -0,0 +1,77 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_RASTERIZER_H
+#define BOOKFILER_MODULE_DOCX_RASTERIZER_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Local Project
+#include "glyphCache.hpp"
+#include "layout.hpp"
+#include "tileCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* A rectangle of a page at some resolution, RGBA. pixels[0] is page pixel
+ * (originX, originY).
+ */
+class RasterTarget {
+public:
+  unsigned char *pixels;
+  size_t stride;
+  int32_t width, height, originX, originY;
+};
+
+/* The image under a document relationship id at width x height pixels,
+ * premultiplied RGBA, or nullptr to draw a placeholder instead
+ */
+using media_lookup_cb_t = std::function<std::shared_ptr<const RasterImage>(
+    std::string_view relId, int32_t width, int32_t height)>;
+
+/* PageRasterizer
+ * Draws laid out pages into any rectangle of the page, so a page can be
+ * rendered a tile at a time. Glyphs are drawn as greeked boxes sized from
+ * FontMetrics (cap height, x-height, descenders) since no font rasterizer is
+ * linked in; their masks come from glyphAtlas() and runs are shaped through
+ * shapedRunCache(). Drawings are composited from mediaLookup at their extent
+ * in whole pixels, or drawn as placeholder frames when it has no image. The
+ * layout must have been paginated with LayoutOptions::recordBoxes.
+ */
+class PageRasterizer {
+public:
+  PageRasterizer(const DocumentLayout &layout, int32_t dpi,
+                 media_lookup_cb_t mediaLookup = nullptr);
+  /* Page pixel size, rounded up */
+  void getPageSize(uint32_t pageIndex, int32_t &width, int32_t &height) const;
+  void render(uint32_t pageIndex, const RasterTarget &target) const;
+
+private:
+  void drawBox(const LayoutBox &box, const RasterTarget &target,
+               GlyphAtlas::Generation &generation,
+               std::vector<uint8_t> &scratch) const;
+
+  const DocumentLayout &layout;
+  int32_t dpi;
+  media_lookup_cb_t mediaLookup;
+  // pixels per twip
+  float scale;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_RASTERIZER_H
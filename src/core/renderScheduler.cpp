@@ -0,0 +1,295 @@
+// Local Project
+#include "renderScheduler.hpp"
+#include "rasterizer.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+// previews are drawn at dpi / previewDivisor, if that is previewDpiMin or more
+const uint32_t previewDivisor = 4;
+const uint32_t previewDpiMin = 12;
+
+// the scheduler whose callback the calling thread is running, if any
+thread_local const void *deliveringState = nullptr;
+
+} // namespace
+
+RenderScheduler::RenderScheduler(std::shared_ptr<DocxImpl> docx_,
+                                 render_update_cb_t callback_,
+                                 WorkStealingPool &pool_)
+    : state(std::make_shared<State>(std::move(docx_), std::move(callback_),
+                                    pool_)) {}
+
+RenderScheduler::~RenderScheduler() {
+  cancelAll();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->closed = true;
+  if (!state->pool.isWorkerThread()) {
+    state->idle.wait(lock, [this]() { return state->runningTotal == 0; });
+    return;
+  }
+  /* Waiting for the running tasks here would wait for this one. They hold
+   * the state, so only callbacks already past their cancel check, on
+   * other threads, are waited for before the callback's owner goes away.
+   */
+  size_t ownTotal = deliveringState == state.get() ? 1 : 0;
+  state->idle.wait(
+      lock, [this, ownTotal]() { return state->deliveringTotal == ownTotal; });
+}
+
+void RenderScheduler::requestPage(uint32_t pageIndex, uint32_t dpi,
+                                  uint32_t rank) {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  auto ticketRange = state->ticketMap.equal_range(pageIndex);
+  for (auto ticketIt = ticketRange.first; ticketIt != ticketRange.second;
+       ticketIt++) {
+    const std::shared_ptr<Ticket> &ticket = ticketIt->second;
+    if (!ticket->wholePage || ticket->dpi != dpi)
+      continue;
+    if (rank < ticket->rank) {
+      // still queued: move it up, already rendering: nothing to do
+      for (auto jobIt = state->queue.begin(); jobIt != state->queue.end();
+           jobIt++) {
+        if (jobIt->second.ticket == ticket) {
+          Job job = jobIt->second;
+          state->queue.erase(jobIt);
+          state->queue.emplace(std::make_pair(rank, state->sequence++), job);
+          break;
+        }
+      }
+      ticket->rank = rank;
+    }
+    return;
+  }
+  auto ticket = std::make_shared<Ticket>();
+  ticket->pageIndex = pageIndex;
+  ticket->dpi = dpi;
+  ticket->rank = rank;
+  ticket->wholePage = true;
+  state->ticketMap.emplace(pageIndex, ticket);
+  state->stats.requestTotal++;
+  state->enqueue({ticket, documentNone, documentNone}, rank);
+}
+
+void RenderScheduler::requestTile(uint32_t pageIndex, uint32_t dpi,
+                                  uint32_t tileX, uint32_t tileY,
+                                  uint32_t rank) {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  auto ticket = std::make_shared<Ticket>();
+  ticket->pageIndex = pageIndex;
+  ticket->dpi = dpi;
+  ticket->rank = rank;
+  ticket->remaining = 1;
+  state->ticketMap.emplace(pageIndex, ticket);
+  state->stats.requestTotal++;
+  state->enqueue({ticket, tileX, tileY}, rank);
+}
+
+void RenderScheduler::setViewport(uint32_t firstPage, uint32_t lastPage,
+                                  uint32_t dpi) {
+  uint32_t prefetch = prefetchTotal;
+  uint32_t low = firstPage >= prefetch ? firstPage - prefetch : 0;
+  uint64_t high = (uint64_t)lastPage + prefetch;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (auto ticketIt = state->ticketMap.begin();
+         ticketIt != state->ticketMap.end();) {
+      if (ticketIt->first >= low && ticketIt->first <= high) {
+        ticketIt++;
+        continue;
+      }
+      ticketIt->second->cancelled = true;
+      state->stats.cancelTotal++;
+      ticketIt = state->ticketMap.erase(ticketIt);
+    }
+    state->dropCancelled();
+  }
+  // the page count is not known without a layout, pages past the end fail
+  // quietly when they run
+  for (uint32_t pageIndex = firstPage; pageIndex <= lastPage; pageIndex++)
+    requestPage(pageIndex, dpi, renderVisible);
+  for (uint32_t distance = 1; distance <= prefetch; distance++) {
+    requestPage(lastPage + distance, dpi, renderPrefetch);
+    if (firstPage >= distance)
+      requestPage(firstPage - distance, dpi, renderPrefetch);
+  }
+}
+
+void RenderScheduler::cancelPage(uint32_t pageIndex) {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  auto ticketRange = state->ticketMap.equal_range(pageIndex);
+  for (auto ticketIt = ticketRange.first; ticketIt != ticketRange.second;
+       ticketIt++) {
+    ticketIt->second->cancelled = true;
+    state->stats.cancelTotal++;
+  }
+  state->ticketMap.erase(ticketRange.first, ticketRange.second);
+  state->dropCancelled();
+}
+
+void RenderScheduler::cancelAll() {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  for (auto &ticketPair : state->ticketMap) {
+    ticketPair.second->cancelled = true;
+    state->stats.cancelTotal++;
+  }
+  state->ticketMap.clear();
+  state->queue.clear();
+}
+
+void RenderScheduler::wait() {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->idle.wait(lock, [this]() { return state->runningTotal == 0; });
+}
+
+RenderScheduler::Stats RenderScheduler::getStats() const {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  return state->stats;
+}
+
+RenderScheduler::State::State(std::shared_ptr<DocxImpl> docx_,
+                              render_update_cb_t callback_,
+                              WorkStealingPool &pool_)
+    : docx(std::move(docx_)), callback(std::move(callback_)), pool(pool_) {}
+
+void RenderScheduler::State::enqueue(Job job, uint32_t rank) {
+  queue.emplace(std::make_pair(rank, sequence++), std::move(job));
+  // one pool task per queued job, each runs whatever is most urgent then
+  submit([this]() { runNext(); });
+}
+
+void RenderScheduler::State::dropCancelled() {
+  for (auto jobIt = queue.begin(); jobIt != queue.end();) {
+    if (jobIt->second.ticket->cancelled)
+      jobIt = queue.erase(jobIt);
+    else
+      jobIt++;
+  }
+}
+
+void RenderScheduler::State::submit(std::function<void()> task) {
+  runningTotal++;
+  // the task holds its own reference, the scheduler can go away while it
+  // still runs or has the mutex
+  pool.submit([task, taskState = shared_from_this()]() {
+    task();
+    std::lock_guard<std::mutex> lock(taskState->mutex);
+    if (--taskState->runningTotal == 0)
+      taskState->idle.notify_all();
+  });
+}
+
+void RenderScheduler::State::runNext() {
+  Job job;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty())
+      return;
+    job = queue.begin()->second;
+    queue.erase(queue.begin());
+  }
+  if (job.ticket->cancelled)
+    return;
+  if (job.tileX == documentNone)
+    renderPage(job.ticket);
+  else
+    renderTile(job.ticket, job.tileX, job.tileY);
+}
+
+void RenderScheduler::State::renderPage(
+    const std::shared_ptr<Ticket> &ticket) {
+  std::shared_ptr<const DocumentLayout> layout;
+  if (docx->getLayout(layout) != MZ_OK ||
+      ticket->pageIndex >= layout->getPageList().size()) {
+    finishTicket(ticket);
+    return;
+  }
+  int32_t pageWidth, pageHeight;
+  PageRasterizer(*layout, (int32_t)ticket->dpi)
+      .getPageSize(ticket->pageIndex, pageWidth, pageHeight);
+  uint32_t tileColumns = (uint32_t)((pageWidth + tileSize - 1) / tileSize);
+  uint32_t tileRows = (uint32_t)((pageHeight + tileSize - 1) / tileSize);
+
+  // a page scrolled back to is already in the cache, no preview needed
+  uint32_t previewDpi = ticket->dpi / previewDivisor;
+  if (previewDpi >= previewDpiMin &&
+      !docx->hasTile(ticket->pageIndex, ticket->dpi, 0, 0)) {
+    std::shared_ptr<const RasterImage> preview;
+    if (docx->getPageImage(ticket->pageIndex, previewDpi, preview) == MZ_OK)
+      deliver(ticket, {ticket->pageIndex, previewDpi, 0, 0, true, preview});
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ticket->cancelled)
+      return;
+    if (tileColumns * tileRows > 0) {
+      ticket->remaining = tileColumns * tileRows;
+      // this worker's deque is last in first out, queue the bottom right
+      // tile first so the top left is drawn first
+      for (uint32_t tileY = tileRows; tileY-- > 0;)
+        for (uint32_t tileX = tileColumns; tileX-- > 0;)
+          submit([this, ticket, tileX, tileY]() {
+            renderTile(ticket, tileX, tileY);
+          });
+      return;
+    }
+  }
+  // no tiles to count it down
+  finishTicket(ticket);
+}
+
+void RenderScheduler::State::renderTile(const std::shared_ptr<Ticket> &ticket,
+                                        uint32_t tileX, uint32_t tileY) {
+  if (!ticket->cancelled) {
+    std::shared_ptr<const RasterImage> tile;
+    if (docx->getTile(ticket->pageIndex, ticket->dpi, tileX, tileY, tile) ==
+        MZ_OK)
+      deliver(ticket, {ticket->pageIndex, ticket->dpi,
+                       (int32_t)tileX * tileSize, (int32_t)tileY * tileSize,
+                       false, tile});
+  }
+  if (--ticket->remaining == 0)
+    finishTicket(ticket);
+}
+
+void RenderScheduler::State::finishTicket(
+    const std::shared_ptr<Ticket> &ticket) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto ticketRange = ticketMap.equal_range(ticket->pageIndex);
+  for (auto ticketIt = ticketRange.first; ticketIt != ticketRange.second;
+       ticketIt++) {
+    if (ticketIt->second == ticket) {
+      ticketMap.erase(ticketIt);
+      return;
+    }
+  }
+}
+
+void RenderScheduler::State::deliver(const std::shared_ptr<Ticket> &ticket,
+                                     const RenderUpdate &update) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ticket->cancelled || closed)
+      return;
+    deliveringTotal++;
+  }
+  const void *outerState = deliveringState;
+  deliveringState = this;
+  callback(update);
+  deliveringState = outerState;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (update.preview)
+    stats.previewTotal++;
+  else
+    stats.tileTotal++;
+  // the destructor on a worker may wait for one left, its own
+  deliveringTotal--;
+  idle.notify_all();
+}
+
+} // namespace bookfiler
@@ -0,0 +1,154 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_RENDER_SCHEDULER_H
+#define BOOKFILER_MODULE_DOCX_RENDER_SCHEDULER_H
+
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Local Project
+#include "docxImpl.hpp"
+#include "tileCache.hpp"
+#include "workStealingPool.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* Queue ranks, lower runs first */
+const uint32_t renderVisible = 0;
+const uint32_t renderPrefetch = 1;
+
+/* One finished image and where it goes on the page */
+class RenderUpdate {
+public:
+  uint32_t pageIndex, dpi;
+  // page pixel at dpi of the image's top left corner
+  int32_t x, y;
+  // a whole page at low resolution, the tiles that follow replace it
+  bool preview;
+  std::shared_ptr<const RasterImage> image;
+};
+
+using render_update_cb_t = std::function<void(const RenderUpdate &)>;
+
+/* RenderScheduler
+ * Renders pages of one document in the background. Requests wait in a queue
+ * ordered by rank, then age; each worker that frees up takes the most urgent
+ * one, so a visible page queued after a batch of prefetches still goes
+ * first. A page request first delivers a preview at a quarter of the
+ * resolution, then fans out into tile jobs on the worker's own deque of the
+ * WorkStealingPool, where idle workers steal them. Cancelling a page drops
+ * its queued work and stops its running tiles before they are delivered.
+ * Updates are delivered on worker threads. Thread safe.
+ */
+class RenderScheduler {
+public:
+  class Stats {
+  public:
+    uint64_t requestTotal = 0, cancelTotal = 0, previewTotal = 0,
+             tileTotal = 0;
+  };
+
+  RenderScheduler(std::shared_ptr<DocxImpl> docx, render_update_cb_t callback,
+                  WorkStealingPool &pool = defaultWorkStealingPool());
+  /* Cancels everything and waits for running jobs. On a pool worker, the
+   * update callback included, it only waits for updates being delivered on
+   * other threads; the jobs left see the cancel and end on their own.
+   */
+  ~RenderScheduler();
+  /* Queues every tile of a page. A page already queued or rendering at the
+   * same dpi is only moved up when rank is more urgent.
+   */
+  void requestPage(uint32_t pageIndex, uint32_t dpi, uint32_t rank);
+  void requestTile(uint32_t pageIndex, uint32_t dpi, uint32_t tileX,
+                   uint32_t tileY, uint32_t rank);
+  /* Pages [firstPage, lastPage] are queued renderVisible and the
+   * prefetchTotal pages on either side renderPrefetch, nearest first. Work
+   * for any other page is cancelled.
+   */
+  void setViewport(uint32_t firstPage, uint32_t lastPage, uint32_t dpi);
+  void cancelPage(uint32_t pageIndex);
+  void cancelAll();
+  /* Blocks until nothing is queued or running */
+  void wait();
+  void setPrefetchTotal(uint32_t prefetchTotal_) {
+    prefetchTotal = prefetchTotal_;
+  }
+  Stats getStats() const;
+
+private:
+  class Ticket {
+  public:
+    uint32_t pageIndex, dpi, rank;
+    // a requestPage ticket rather than a requestTile one
+    bool wholePage = false;
+    std::atomic<bool> cancelled{false};
+    // tiles not yet finished
+    std::atomic<uint32_t> remaining{0};
+  };
+  class Job {
+  public:
+    std::shared_ptr<Ticket> ticket;
+    // documentNone for the whole page
+    uint32_t tileX, tileY;
+  };
+  /* Everything the pool tasks use. Each task holds a reference, so jobs
+   * left running when the scheduler goes away on a worker still find it.
+   */
+  class State : public std::enable_shared_from_this<State> {
+  public:
+    State(std::shared_ptr<DocxImpl> docx, render_update_cb_t callback,
+          WorkStealingPool &pool);
+    // these three expect mutex held
+    void enqueue(Job job, uint32_t rank);
+    void dropCancelled();
+    void submit(std::function<void()> task);
+    void runNext();
+    void renderPage(const std::shared_ptr<Ticket> &ticket);
+    void renderTile(const std::shared_ptr<Ticket> &ticket, uint32_t tileX,
+                    uint32_t tileY);
+    void finishTicket(const std::shared_ptr<Ticket> &ticket);
+    /* Runs the callback unless the ticket is cancelled or the scheduler
+     * closed
+     */
+    void deliver(const std::shared_ptr<Ticket> &ticket,
+                 const RenderUpdate &update);
+
+    std::shared_ptr<DocxImpl> docx;
+    render_update_cb_t callback;
+    WorkStealingPool &pool;
+    std::mutex mutex;
+    std::condition_variable idle;
+    // (rank, sequence)
+    std::map<std::pair<uint32_t, uint64_t>, Job> queue;
+    // live tickets by page
+    std::multimap<uint32_t, std::shared_ptr<Ticket>> ticketMap;
+    uint64_t sequence = 0;
+    // pool tasks submitted and not yet finished, callbacks in progress
+    size_t runningTotal = 0, deliveringTotal = 0;
+    // the scheduler is gone, nothing more is delivered
+    bool closed = false;
+    Stats stats;
+  };
+
+  std::atomic<uint32_t> prefetchTotal{2};
+  std::shared_ptr<State> state;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_RENDER_SCHEDULER_H
@@ -0,0 +1,252 @@
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "textExtractor.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+const std::string_view wordNamespace =
+    "http://schemas.openxmlformats.org/wordprocessingml/2006/main";
+
+bool matchPrefixed(std::string_view name, std::string_view prefix,
+                   std::string_view local) {
+  return name.size() == prefix.size() + local.size() &&
+         name.compare(0, prefix.size(), prefix) == 0 &&
+         name.compare(prefix.size(), local.size(), local) == 0;
+}
+
+} // namespace
+
+TextExtractor::TextExtractor() {}
+
+int32_t TextExtractor::extract(ZipInflateStream &stream,
+                               const text_paragraph_cb_t &callback_) {
+  XmlReader xmlReader;
+  xmlReader.open(
+      [&stream](std::string_view &chunk) { return stream.read(chunk); });
+  return extract(xmlReader, callback_);
+}
+
+int32_t TextExtractor::extract(XmlReader &reader_,
+                               const text_paragraph_cb_t &callback_) {
+  reader = &reader_;
+  callback = &callback_;
+  scanKernel = &xmlScanKernel();
+  wordPrefix = "w:";
+  skipDepth = 0;
+  inParagraph = inParagraphProperties = inRun = inRunProperties = inText =
+      inDrawing = inSectionProperties = sectionPending = pageBreakPending =
+          false;
+  paragraphText.clear();
+  paragraphIndex = paragraphPage = pageIndex = 0;
+  stats = Stats();
+
+  int32_t err;
+  while ((err = reader->next()) == MZ_OK) {
+    if (skipDepth != 0) {
+      if (reader->getEvent() == XmlEvent::EndElement &&
+          reader->getDepth() < skipDepth)
+        skipDepth = 0;
+      continue;
+    }
+    switch (reader->getEvent()) {
+    case XmlEvent::StartElement:
+      startElement();
+      break;
+    case XmlEvent::EndElement:
+      endElement();
+      break;
+    case XmlEvent::Text:
+      if (inText)
+        appendText(reader->getText(), reader->isCData());
+      break;
+    default:
+      break;
+    }
+  }
+  stats.pageTotal = pageIndex + 1;
+  return err == MZ_END_OF_STREAM ? MZ_OK : err;
+}
+
+std::string_view TextExtractor::wordLocal(std::string_view name) const {
+  if (wordPrefix.empty())
+    return name.find(':') == std::string_view::npos ? name
+                                                    : std::string_view();
+  if (name.size() > wordPrefix.size() &&
+      name.compare(0, wordPrefix.size(), wordPrefix) == 0)
+    return name.substr(wordPrefix.size());
+  return std::string_view();
+}
+
+std::string_view TextExtractor::wordAttribute(std::string_view local) const {
+  for (const XmlAttribute &attribute : reader->getAttributes()) {
+    if (matchPrefixed(attribute.name, wordPrefix, local))
+      return attribute.value;
+  }
+  return std::string_view();
+}
+
+void TextExtractor::appendText(std::string_view raw, bool cdata) {
+  if (raw.empty())
+    return;
+  if (pageBreakPending) {
+    // a break before any text does not start a page
+    if (stats.textBytes != 0 || !paragraphText.empty())
+      pageIndex++;
+    pageBreakPending = false;
+  }
+  if (paragraphText.empty())
+    paragraphPage = pageIndex;
+  if (cdata)
+    paragraphText.append(raw);
+  else
+    xmlUnescape(raw, paragraphText);
+}
+
+void TextExtractor::flushRunText() {
+  // repaired run by run, the ranges DocumentParser repairs
+  if (paragraphText.size() != runTextStart &&
+      !scanKernel->validUtf8(paragraphText.data() + runTextStart,
+                             paragraphText.size() - runTextStart))
+    utf8Repair(paragraphText, runTextStart);
+  runTextStart = paragraphText.size();
+}
+
+void TextExtractor::rootElement() {
+  for (const XmlAttribute &attribute : reader->getAttributes()) {
+    if (attribute.value != wordNamespace)
+      continue;
+    if (attribute.name == "xmlns")
+      wordPrefix = "";
+    else if (attribute.name.compare(0, 6, "xmlns:") == 0)
+      wordPrefix = std::string(attribute.name.substr(6)) + ":";
+  }
+}
+
+void TextExtractor::startElement() {
+  std::string_view name = reader->getName();
+  if (reader->getDepth() == 1) {
+    rootElement();
+    return;
+  }
+
+  std::string_view local = wordLocal(name);
+  if (local.empty()) {
+    // the preceding mc:Choice holds the same content
+    if (name == "mc:Fallback")
+      skipDepth = reader->getDepth();
+    return;
+  }
+
+  if (local == "p") {
+    if (inParagraph)
+      return;
+    inParagraph = true;
+    paragraphText.clear();
+    runTextStart = 0;
+  } else if (local == "pPr") {
+    if (inParagraph && !inRun)
+      inParagraphProperties = true;
+  } else if (local == "r") {
+    if (!inParagraph || inRun)
+      return;
+    inRun = true;
+    runTextStart = paragraphText.size();
+  } else if (local == "rPr") {
+    if (inRun)
+      inRunProperties = true;
+    else
+      skipDepth = reader->getDepth();
+  } else if (local == "pPrChange" || local == "rPrChange" ||
+             local == "sectPrChange" || local == "txbxContent" ||
+             local == "del") {
+    skipDepth = reader->getDepth();
+  } else if (local == "t") {
+    inText = inRun;
+  } else if (local == "tab" && inRun && !inRunProperties) {
+    appendText("\t", true);
+  } else if (local == "br" && inRun) {
+    if (wordAttribute("type") == "page") {
+      appendText("\f", true);
+      pageBreakPending = true;
+    } else {
+      appendText("\n", true);
+    }
+  } else if (local == "cr" && inRun) {
+    appendText("\n", true);
+  } else if (local == "noBreakHyphen" && inRun) {
+    appendText("-", true);
+  } else if (local == "softHyphen" && inRun) {
+    appendText("\xC2\xAD", true);
+  } else if (local == "lastRenderedPageBreak" && inRun) {
+    pageBreakPending = true;
+  } else if (local == "drawing" || local == "pict") {
+    inDrawing = inRun;
+  } else if (local == "sectPr") {
+    inSectionProperties = true;
+    sectionBreaksPage = true;
+  } else if (inSectionProperties) {
+    if (local == "type")
+      sectionBreaksPage = wordAttribute("val") != "continuous";
+  } else if (inParagraphProperties) {
+    if (local == "pageBreakBefore") {
+      std::string_view value = wordAttribute("val");
+      if (!(value == "0" || value == "false" || value == "off"))
+        pageBreakPending = true;
+    }
+  }
+}
+
+void TextExtractor::endElement() {
+  std::string_view local = wordLocal(reader->getName());
+  if (local.empty())
+    return;
+  if (local == "p") {
+    if (!inParagraph)
+      return;
+    inParagraph = false;
+    if (!paragraphText.empty()) {
+      (*callback)({paragraphIndex, paragraphPage, paragraphText});
+      stats.paragraphTotal++;
+      stats.textBytes += paragraphText.size();
+    }
+    paragraphIndex++;
+    if (sectionPending) {
+      // the next section starts on a page of its own
+      pageBreakPending = pageBreakPending || sectionBreaksPage;
+      sectionPending = false;
+    }
+  } else if (local == "pPr") {
+    inParagraphProperties = false;
+  } else if (local == "r") {
+    if (!inRun)
+      return;
+    flushRunText();
+    inRun = inText = inRunProperties = false;
+  } else if (local == "rPr") {
+    inRunProperties = false;
+  } else if (local == "t") {
+    inText = false;
+  } else if (local == "drawing" || local == "pict") {
+    if (!inDrawing)
+      return;
+    inDrawing = false;
+    flushRunText();
+  } else if (local == "sectPr") {
+    if (!inSectionProperties)
+      return;
+    inSectionProperties = false;
+    sectionPending = inParagraphProperties;
+  }
+}
+
+} // namespace bookfiler
@@ -0,0 +1,99 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_TEXT_EXTRACTOR_H
+#define BOOKFILER_MODULE_DOCX_TEXT_EXTRACTOR_H
+
+// C++
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Local Project
+#include "xmlReader.hpp"
+#include "zipStream.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* One paragraph of body text as TextExtractor delivers it */
+class TextParagraph {
+public:
+  // index into the DocumentModel::paragraphList parsed from the same part
+  uint32_t paragraphIndex;
+  // page the paragraph's text starts on, from the page breaks in the file
+  uint32_t pageIndex;
+  // the paragraph's runs as DocumentModel::text holds them, so offsets
+  // into it are offsets from the paragraph's first run. Valid during the
+  // callback only.
+  std::string_view text;
+};
+
+using text_paragraph_cb_t = std::function<void(const TextParagraph &)>;
+
+/* TextExtractor
+ * Streams the body text of word/document.xml in document order, one
+ * paragraph at a time, without building a DocumentModel. Paragraphs are
+ * numbered and their text is taken exactly as DocumentParser would, so
+ * an offset found here is one in the model: revisions, text boxes and
+ * mc:Fallback are left out, tabs and breaks become '\t', '\n' and '\f',
+ * malformed UTF-8 becomes U+FFFD. Paragraphs without text are not
+ * delivered.
+ *
+ * No layout is done, pages are counted from what the file records:
+ * explicit page breaks, w:lastRenderedPageBreak left by the application
+ * that saved it, direct pageBreakBefore and section breaks that start a
+ * page. Breaks with no text between them count once.
+ */
+class TextExtractor {
+public:
+  class Stats {
+  public:
+    uint64_t paragraphTotal = 0, textBytes = 0;
+    uint32_t pageTotal = 1;
+  };
+
+  TextExtractor();
+  /* @return MZ_OK or the reader's error */
+  int32_t extract(XmlReader &reader, const text_paragraph_cb_t &callback);
+  int32_t extract(ZipInflateStream &stream,
+                  const text_paragraph_cb_t &callback);
+  /* Of the last extract */
+  const Stats &getStats() const { return stats; }
+
+private:
+  void rootElement();
+  void startElement();
+  void endElement();
+  void flushRunText();
+  void appendText(std::string_view raw, bool cdata);
+  std::string_view wordLocal(std::string_view name) const;
+  std::string_view wordAttribute(std::string_view local) const;
+
+  XmlReader *reader = nullptr;
+  const text_paragraph_cb_t *callback = nullptr;
+  const XmlScanKernel *scanKernel = nullptr;
+  std::string wordPrefix;
+  size_t skipDepth = 0;
+  bool inParagraph = false, inParagraphProperties = false, inRun = false,
+       inRunProperties = false, inText = false, inDrawing = false,
+       inSectionProperties = false, sectionBreaksPage = false,
+       sectionPending = false, pageBreakPending = false;
+  // text of the current paragraph, reused for the next one
+  std::string paragraphText;
+  size_t runTextStart = 0;
+  uint32_t paragraphIndex = 0, paragraphPage = 0, pageIndex = 0;
+  Stats stats;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_TEXT_EXTRACTOR_H
@@ -0,0 +1,308 @@
+// C++
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+
+// Local Project
+#include "textIndex.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+using Occurrence = TextIndexDocument::Occurrence;
+
+const size_t termLengthMax = 64;
+
+/* Bytes of the separator at p, 0 when a term character starts there */
+size_t separatorLength(const unsigned char *p, const unsigned char *end) {
+  unsigned char c = *p;
+  if (c < 0x80)
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')
+               ? 0
+               : 1;
+  // U+0080 to U+00BF: controls, no-break space, soft hyphen, punctuation
+  if (c == 0xC2 && end - p >= 2)
+    return 2;
+  // U+2000 to U+207F: spaces, dashes, quotes, bullets
+  if (c == 0xE2 && end - p >= 3 && (p[1] == 0x80 || p[1] == 0x81))
+    return 3;
+  // U+3000 ideographic space
+  if (c == 0xE3 && end - p >= 3 && p[1] == 0x80 && p[2] == 0x80)
+    return 3;
+  return 0;
+}
+
+size_t characterLength(unsigned char c) {
+  return c < 0xC0 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+}
+
+/* callback(term, offset) for every term of text, term is reused */
+template <class F>
+void tokenize(std::string_view text, std::string &term, F &&callback) {
+  auto *begin = (const unsigned char *)text.data();
+  const unsigned char *p = begin, *end = begin + text.size();
+  const unsigned char *start = nullptr;
+  auto emit = [&]() {
+    term.assign((const char *)start, p - start);
+    for (char &c : term)
+      if (c >= 'A' && c <= 'Z')
+        c |= 0x20;
+    callback(term, (uint32_t)(start - begin));
+    start = nullptr;
+  };
+  while (p < end) {
+    size_t separator = separatorLength(p, end);
+    if (separator) {
+      if (start)
+        emit();
+      p += separator;
+      continue;
+    }
+    if (!start)
+      start = p;
+    p += std::min<size_t>(characterLength(*p), end - p);
+  }
+  if (start)
+    emit();
+}
+
+void putVarint(std::vector<uint8_t> &bytes, uint32_t value) {
+  while (value >= 0x80) {
+    bytes.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back((uint8_t)value);
+}
+
+uint32_t getVarint(const uint8_t *&p) {
+  uint32_t value = 0;
+  int shift = 0;
+  while (*p & 0x80) {
+    value |= (uint32_t)(*p++ & 0x7F) << shift;
+    shift += 7;
+  }
+  return value | (uint32_t)*p++ << shift;
+}
+
+/* Reads a posting list one document block at a time */
+class PostingCursor {
+public:
+  explicit PostingCursor(const std::vector<uint8_t> &bytes)
+      : p(bytes.data()), end(bytes.data() + bytes.size()) {}
+  /* @return false past the last document */
+  bool next() {
+    if (p == end)
+      return false;
+    documentId += getVarint(p);
+    occurrenceList.resize(getVarint(p));
+    Occurrence previous{0, 0, 0};
+    for (Occurrence &occurrence : occurrenceList) {
+      occurrence.position = previous.position + getVarint(p);
+      uint32_t paragraphDelta = getVarint(p);
+      occurrence.paragraphIndex = previous.paragraphIndex + paragraphDelta;
+      occurrence.offset =
+          getVarint(p) + (paragraphDelta ? 0 : previous.offset);
+      previous = occurrence;
+    }
+    return true;
+  }
+
+  uint32_t documentId = 0;
+  std::vector<Occurrence> occurrenceList;
+
+private:
+  const uint8_t *p, *end;
+};
+
+} // namespace
+
+void TextIndexDocument::addParagraph(const TextParagraph &paragraph) {
+  uint32_t lastPage = pageList.empty() ? 0 : pageList.back().second;
+  if (paragraph.pageIndex != lastPage)
+    pageList.push_back({paragraph.paragraphIndex, paragraph.pageIndex});
+  tokenize(paragraph.text, term,
+           [this, &paragraph](const std::string &token, uint32_t offset) {
+             if (token.size() <= termLengthMax) {
+               auto termIt = termMap.find(token);
+               if (termIt == termMap.end())
+                 termIt = termMap.emplace(token, std::vector<Occurrence>())
+                              .first;
+               termIt->second.push_back(
+                   {position, paragraph.paragraphIndex, offset});
+             }
+             position++;
+           });
+}
+
+uint32_t TextIndex::add(TextIndexDocument &&document) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  uint32_t documentId = (uint32_t)documentList.size();
+  documentList.emplace_back();
+  documentList.back().pageList = std::move(document.pageList);
+  while (!document.termMap.empty()) {
+    auto node = document.termMap.extract(document.termMap.begin());
+    append(termMap[std::move(node.key())], documentId, node.mapped());
+  }
+  return documentId;
+}
+
+void TextIndex::append(
+    PostingList &postingList, uint32_t documentId,
+    const std::vector<TextIndexDocument::Occurrence> &occurrenceList) {
+  std::vector<uint8_t> &bytes = postingList.bytes;
+  putVarint(bytes, documentId - postingList.lastDocument);
+  putVarint(bytes, (uint32_t)occurrenceList.size());
+  Occurrence previous{0, 0, 0};
+  for (const Occurrence &occurrence : occurrenceList) {
+    uint32_t paragraphDelta =
+        occurrence.paragraphIndex - previous.paragraphIndex;
+    putVarint(bytes, occurrence.position - previous.position);
+    putVarint(bytes, paragraphDelta);
+    // offsets grow within a paragraph and start over in the next
+    putVarint(bytes, paragraphDelta ? occurrence.offset
+                                    : occurrence.offset - previous.offset);
+    previous = occurrence;
+  }
+  postingList.lastDocument = documentId;
+  occurrenceTotal += occurrenceList.size();
+  blockTotal++;
+}
+
+void TextIndex::remove(uint32_t documentId) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  if (documentId >= documentList.size() || documentList[documentId].removed)
+    return;
+  DocumentEntry &entry = documentList[documentId];
+  entry.removed = true;
+  entry.pageList = std::vector<std::pair<uint32_t, uint32_t>>();
+  removedTotal++;
+  uncompactedTotal++;
+  if (uncompactedTotal > documentList.size() - removedTotal)
+    compact();
+}
+
+void TextIndex::compact() {
+  occurrenceTotal = blockTotal = 0;
+  for (auto termIt = termMap.begin(); termIt != termMap.end();) {
+    PostingList compacted;
+    PostingCursor cursor(termIt->second.bytes);
+    while (cursor.next()) {
+      if (!documentList[cursor.documentId].removed)
+        append(compacted, cursor.documentId, cursor.occurrenceList);
+    }
+    if (compacted.bytes.empty()) {
+      termIt = termMap.erase(termIt);
+    } else {
+      compacted.bytes.shrink_to_fit();
+      termIt->second = std::move(compacted);
+      ++termIt;
+    }
+  }
+  uncompactedTotal = 0;
+}
+
+void TextIndex::clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  termMap.clear();
+  documentList.clear();
+  removedTotal = uncompactedTotal = 0;
+  occurrenceTotal = blockTotal = 0;
+}
+
+uint32_t TextIndex::pageOf(uint32_t documentId,
+                           uint32_t paragraphIndex) const {
+  const auto &pageList = documentList[documentId].pageList;
+  auto pageIt = std::upper_bound(
+      pageList.begin(), pageList.end(), paragraphIndex,
+      [](uint32_t paragraph, const std::pair<uint32_t, uint32_t> &change) {
+        return paragraph < change.first;
+      });
+  return pageIt == pageList.begin() ? 0 : std::prev(pageIt)->second;
+}
+
+std::vector<TextIndex::Hit> TextIndex::search(std::string_view query,
+                                              size_t hitMax) const {
+  std::vector<Hit> hitList;
+  std::vector<std::string> queryTermList;
+  std::string term;
+  tokenize(query, term, [&queryTermList](const std::string &token, uint32_t) {
+    queryTermList.push_back(token);
+  });
+  if (queryTermList.empty() || hitMax == 0)
+    return hitList;
+
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  std::vector<PostingCursor> cursorList;
+  for (const std::string &queryTerm : queryTermList) {
+    auto termIt = termMap.find(queryTerm);
+    if (termIt == termMap.end())
+      return hitList;
+    cursorList.emplace_back(termIt->second.bytes);
+    if (!cursorList.back().next())
+      return hitList;
+  }
+  uint32_t lastLength = (uint32_t)queryTermList.back().size();
+  // in step through the documents holding every term
+  while (true) {
+    uint32_t documentId = 0;
+    for (const PostingCursor &cursor : cursorList)
+      documentId = std::max(documentId, cursor.documentId);
+    bool aligned = true;
+    for (PostingCursor &cursor : cursorList) {
+      while (cursor.documentId < documentId)
+        if (!cursor.next())
+          return hitList;
+      aligned = aligned && cursor.documentId == documentId;
+    }
+    if (!aligned)
+      continue;
+    if (!documentList[documentId].removed) {
+      for (const Occurrence &first : cursorList[0].occurrenceList) {
+        const Occurrence *last = &first;
+        for (size_t i = 1; i < cursorList.size() && last; i++) {
+          const std::vector<Occurrence> &list = cursorList[i].occurrenceList;
+          auto occurrenceIt = std::lower_bound(
+              list.begin(), list.end(), first.position + (uint32_t)i,
+              [](const Occurrence &occurrence, uint32_t position) {
+                return occurrence.position < position;
+              });
+          last = occurrenceIt != list.end() &&
+                         occurrenceIt->position == first.position + i &&
+                         occurrenceIt->paragraphIndex == first.paragraphIndex
+                     ? &*occurrenceIt
+                     : nullptr;
+        }
+        if (!last)
+          continue;
+        hitList.push_back({documentId, first.paragraphIndex,
+                           pageOf(documentId, first.paragraphIndex),
+                           first.offset,
+                           last->offset + lastLength - first.offset});
+        if (hitList.size() >= hitMax)
+          return hitList;
+      }
+    }
+    if (!cursorList[0].next())
+      return hitList;
+  }
+}
+
+TextIndex::Stats TextIndex::getStats() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  Stats stats;
+  stats.documentTotal = documentList.size() - removedTotal;
+  stats.removedTotal = removedTotal;
+  stats.termTotal = termMap.size();
+  stats.occurrenceTotal = occurrenceTotal;
+  for (const auto &termPair : termMap)
+    stats.postingBytes += termPair.second.bytes.size();
+  // document id and count, then position, paragraph and offset
+  stats.rawBytes = (size_t)(blockTotal * 8 + occurrenceTotal * 12);
+  return stats;
+}
+
+} // namespace bookfiler
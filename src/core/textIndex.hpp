@@ -0,0 +1,121 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_TEXT_INDEX_H
+#define BOOKFILER_MODULE_DOCX_TEXT_INDEX_H
+
+// C++
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Local Project
+#include "textExtractor.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* TextIndexDocument
+ * The terms of one document with the position, paragraph and byte offset
+ * of every occurrence, built on any thread and then handed to
+ * TextIndex::add. Terms are runs of ASCII letters and digits and of non
+ * ASCII characters other than U+0080 to U+00BF, general punctuation and
+ * the ideographic space. Only ASCII is folded to lower case, so a term is
+ * as long as the text it was found in. Terms over 64 bytes are not kept.
+ */
+class TextIndexDocument {
+public:
+  class Occurrence {
+  public:
+    // token number in the document, for phrases
+    uint32_t position, paragraphIndex, offset;
+  };
+
+  void addParagraph(const TextParagraph &paragraph);
+  /* Tokens seen, the ones too long to index included */
+  uint32_t getTokenTotal() const { return position; }
+
+private:
+  friend class TextIndex;
+
+  std::unordered_map<std::string, std::vector<Occurrence>> termMap;
+  // (paragraph, page) where the page changes
+  std::vector<std::pair<uint32_t, uint32_t>> pageList;
+  uint32_t position = 0;
+  std::string term;
+};
+
+/* TextIndex
+ * In memory inverted index over the body text of many documents. Every
+ * term has one posting list of varints in document order: per document
+ * the id delta and the occurrence count, per occurrence the token
+ * position, paragraph and byte offset, each a delta from the occurrence
+ * before. A query is a word or a phrase; phrase terms must be adjacent in
+ * one paragraph. Removed documents are skipped by search and dropped from
+ * the lists once they outnumber the rest. Thread safe, searches run
+ * alongside each other.
+ */
+class TextIndex {
+public:
+  class Hit {
+  public:
+    uint32_t documentId, paragraphIndex, pageIndex;
+    // bytes into the paragraph's text, as TextParagraph has it
+    uint32_t offset, length;
+  };
+  class Stats {
+  public:
+    size_t documentTotal = 0, removedTotal = 0, termTotal = 0;
+    uint64_t occurrenceTotal = 0;
+    // posting list bytes, and what 32 bit fields would have taken
+    size_t postingBytes = 0, rawBytes = 0;
+  };
+
+  /* @return the id of the document, ids count up from 0 */
+  uint32_t add(TextIndexDocument &&document);
+  void remove(uint32_t documentId);
+  void clear();
+  /* Hits in document order, then position, at most hitMax */
+  std::vector<Hit> search(std::string_view query, size_t hitMax = 100) const;
+  Stats getStats() const;
+
+private:
+  class PostingList {
+  public:
+    std::vector<uint8_t> bytes;
+    uint32_t lastDocument = 0;
+  };
+  class DocumentEntry {
+  public:
+    std::vector<std::pair<uint32_t, uint32_t>> pageList;
+    bool removed = false;
+  };
+
+  void append(PostingList &postingList, uint32_t documentId,
+              const std::vector<TextIndexDocument::Occurrence> &occurrenceList);
+  uint32_t pageOf(uint32_t documentId, uint32_t paragraphIndex) const;
+  void compact();
+
+  mutable std::shared_mutex mutex;
+  std::unordered_map<std::string, PostingList> termMap;
+  std::vector<DocumentEntry> documentList;
+  // removed ids, and those still in the posting lists
+  size_t removedTotal = 0, uncompactedTotal = 0;
+  uint64_t occurrenceTotal = 0, blockTotal = 0;
+};
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_TEXT_INDEX_H
@@ -0,0 +1,70 @@
+// Local Project
+#include "threadPool.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+ThreadPool::ThreadPool(size_t threadTotal, size_t queueCapacity_)
+    : queueCapacity(queueCapacity_) {
+  if (threadTotal == 0)
+    threadTotal = std::thread::hardware_concurrency();
+  if (threadTotal == 0)
+    threadTotal = 1;
+  for (size_t i = 0; i < threadTotal; i++)
+    workerList.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stopping = true;
+  }
+  taskReady.notify_all();
+  slotReady.notify_all();
+  for (std::thread &worker : workerList)
+    worker.join();
+}
+
+void ThreadPool::push(std::function<void()> task) {
+  {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    if (queueCapacity > 0)
+      slotReady.wait(lock, [this]() {
+        return stopping || taskQueue.size() < queueCapacity;
+      });
+    taskQueue.push_back(std::move(task));
+  }
+  taskReady.notify_one();
+}
+
+size_t ThreadPool::getQueueDepth() const {
+  std::lock_guard<std::mutex> lock(queueMutex);
+  return taskQueue.size();
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      taskReady.wait(lock,
+                     [this]() { return stopping || !taskQueue.empty(); });
+      // drain the queue before stopping so no future is left unsatisfied
+      if (taskQueue.empty())
+        return;
+      task = std::move(taskQueue.front());
+      taskQueue.pop_front();
+    }
+    slotReady.notify_one();
+    task();
+  }
+}
+
+ThreadPool &defaultThreadPool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+} // namespace bookfiler
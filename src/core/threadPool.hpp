@@ -0,0 +1,71 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_THREAD_POOL_H
+#define BOOKFILER_MODULE_DOCX_THREAD_POOL_H
+
+// C++
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* ThreadPool
+ * Fixed set of workers over one FIFO queue. When queueCapacity is non zero
+ * submit() blocks while the queue is full, which bounds the memory held by
+ * tasks that produce large results.
+ */
+class ThreadPool {
+public:
+  /* @param threadTotal 0 uses std::thread::hardware_concurrency() */
+  ThreadPool(size_t threadTotal = 0, size_t queueCapacity = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  template <class F>
+  std::future<typename std::invoke_result<F>::type> submit(F &&task) {
+    using result_t = typename std::invoke_result<F>::type;
+    auto packagedPtr = std::make_shared<std::packaged_task<result_t()>>(
+        std::forward<F>(task));
+    std::future<result_t> future = packagedPtr->get_future();
+    push([packagedPtr]() { (*packagedPtr)(); });
+    return future;
+  }
+  size_t size() const { return workerList.size(); }
+  /* Tasks waiting for a worker */
+  size_t getQueueDepth() const;
+
+private:
+  void push(std::function<void()> task);
+  void workerLoop();
+
+  std::vector<std::thread> workerList;
+  std::deque<std::function<void()>> taskQueue;
+  size_t queueCapacity;
+  bool stopping = false;
+  mutable std::mutex queueMutex;
+  std::condition_variable taskReady, slotReady;
+};
+
+/* Module wide pool sized to the machine, created on first use */
+ThreadPool &defaultThreadPool();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_THREAD_POOL_H
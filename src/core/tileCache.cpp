@@ -0,0 +1,130 @@
+// C++
+#include <algorithm>
+#include <iterator>
+
+// Local Project
+#include "tileCache.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+uint64_t TileKey::hash() const {
+  uint64_t value = documentHash;
+  for (uint32_t field : {pageIndex, dpi, tileX, tileY})
+    value = (value ^ field) * 0x100000001B3ull;
+  return value ^ (value >> 29);
+}
+
+TileCache::TileCache(size_t byteBudget) { stats.byteBudget = byteBudget; }
+
+std::shared_ptr<const RasterImage> TileCache::find(const TileKey &key) {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  auto entryIt = entryMap.find(key);
+  if (entryIt == entryMap.end()) {
+    missTotal.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  hitTotal.fetch_add(1, std::memory_order_relaxed);
+  const Entry &entry = *entryIt->second;
+  // a hot tile's line is only read once it is flagged
+  if (!entry.used.load(std::memory_order_relaxed))
+    entry.used.store(true, std::memory_order_relaxed);
+  return entry.tile;
+}
+
+void TileCache::insert(const TileKey &key,
+                       std::shared_ptr<const RasterImage> tile) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  size_t tileBytes = tile->byteSize();
+  auto entryIt = entryMap.find(key);
+  if (entryIt != entryMap.end()) {
+    stats.byteTotal -= entryIt->second->tile->byteSize();
+    removeBytes(key.documentHash, entryIt->second->tile->byteSize());
+    entryList.erase(entryIt->second);
+    entryMap.erase(entryIt);
+  }
+  if (tileBytes > stats.byteBudget)
+    return;
+  evictTo(stats.byteBudget - tileBytes);
+  entryList.emplace_front(key, std::move(tile));
+  entryMap[key] = entryList.begin();
+  stats.byteTotal += tileBytes;
+  documentBytesMap[key.documentHash] += tileBytes;
+}
+
+bool TileCache::contains(const TileKey &key) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return entryMap.find(key) != entryMap.end();
+}
+
+void TileCache::setByteBudget(size_t byteBudget) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  stats.byteBudget = byteBudget;
+  evictTo(byteBudget);
+}
+
+void TileCache::trim(size_t byteMax) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  evictTo(byteMax);
+}
+
+size_t TileCache::getDocumentBytes(uint64_t documentHash) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  auto bytesIt = documentBytesMap.find(documentHash);
+  return bytesIt == documentBytesMap.end() ? 0 : bytesIt->second;
+}
+
+void TileCache::clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  entryList.clear();
+  entryMap.clear();
+  documentBytesMap.clear();
+  stats.byteTotal = 0;
+}
+
+TileCache::Stats TileCache::getStats() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  Stats result = stats;
+  result.hitTotal = hitTotal.load(std::memory_order_relaxed);
+  result.missTotal = missTotal.load(std::memory_order_relaxed);
+  result.tileTotal = entryList.size();
+  return result;
+}
+
+void TileCache::evictTo(size_t byteMax) {
+  // every flag is cleared by the time a pass has gone round once
+  size_t secondChanceMax = entryList.size();
+  while (stats.byteTotal > byteMax && !entryList.empty()) {
+    Entry &entry = entryList.back();
+    if (secondChanceMax > 0 && entry.used.load(std::memory_order_relaxed)) {
+      entry.used.store(false, std::memory_order_relaxed);
+      entryList.splice(entryList.begin(), entryList,
+                       std::prev(entryList.end()));
+      secondChanceMax--;
+      continue;
+    }
+    stats.byteTotal -= entry.tile->byteSize();
+    removeBytes(entry.key.documentHash, entry.tile->byteSize());
+    entryMap.erase(entry.key);
+    entryList.pop_back();
+    stats.evictionTotal++;
+  }
+}
+
+void TileCache::removeBytes(uint64_t documentHash, size_t bytes) {
+  auto bytesIt = documentBytesMap.find(documentHash);
+  if (bytesIt == documentBytesMap.end())
+    return;
+  bytesIt->second -= std::min(bytes, bytesIt->second);
+  if (bytesIt->second == 0)
+    documentBytesMap.erase(bytesIt);
+}
+
+TileCache &tileCache() {
+  static TileCache cache;
+  return cache;
+}
+
+} // namespace bookfiler
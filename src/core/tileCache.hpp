@@ -0,0 +1,130 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_TILE_CACHE_H
+#define BOOKFILER_MODULE_DOCX_TILE_CACHE_H
+
+// C++
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* Pixel edge of a square tile */
+const int32_t tileSize = 256;
+
+/* documentHash is ZipIndex::getContentHash so reopening a file finds the
+ * tiles rendered before
+ */
+class TileKey {
+public:
+  uint64_t documentHash;
+  uint32_t pageIndex, dpi;
+  uint32_t tileX, tileY;
+
+  bool operator==(const TileKey &other) const {
+    return documentHash == other.documentHash &&
+           pageIndex == other.pageIndex && dpi == other.dpi &&
+           tileX == other.tileX && tileY == other.tileY;
+  }
+  uint64_t hash() const;
+};
+
+/* RGBA pixels, 4 bytes a pixel, rows packed. Edge tiles are cut to the
+ * page. The buffer comes from pixmapBufferPool() and goes back when the last
+ * holder drops it.
+ */
+class RasterImage {
+public:
+  std::shared_ptr<unsigned char> pixels;
+  int32_t width, height;
+  size_t stride;
+
+  size_t byteSize() const { return stride * (size_t)height; }
+};
+
+/* Embedded images with more pixels are not decoded, 256 MiB of RGBA */
+const uint64_t imagePixelMax = (uint64_t)1 << 26;
+
+/* TileCache
+ * Rendered tiles in least recently used order, bounded by the bytes of
+ * pixels held. A tile evicted while a Pixmap still uses it stays alive until
+ * that Pixmap is released, it just no longer counts against the budget.
+ * Thread safe. Lookups share the lock, so many threads reading tiles of one
+ * popular page do not queue: a hit only flags the tile, and eviction moves
+ * flagged tiles to the front instead of dropping them (second chance).
+ */
+class TileCache {
+public:
+  class Stats {
+  public:
+    uint64_t hitTotal = 0, missTotal = 0, evictionTotal = 0;
+    size_t byteTotal = 0, byteBudget = 0, tileTotal = 0;
+  };
+
+  explicit TileCache(size_t byteBudget = (size_t)128 << 20);
+  /* Counts a hit and flags the tile used, or counts a miss and returns
+   * nullptr
+   */
+  std::shared_ptr<const RasterImage> find(const TileKey &key);
+  /* Replaces any tile under key, then evicts down to the budget. A tile
+   * larger than the whole budget is not kept.
+   */
+  void insert(const TileKey &key, std::shared_ptr<const RasterImage> tile);
+  /* Neither counts nor reorders */
+  bool contains(const TileKey &key) const;
+  void setByteBudget(size_t byteBudget);
+  /* Evicts least recently used tiles down to byteMax, the budget stays */
+  void trim(size_t byteMax);
+  /* Bytes of the tiles held under documentHash */
+  size_t getDocumentBytes(uint64_t documentHash) const;
+  void clear();
+  Stats getStats() const;
+
+private:
+  class KeyHash {
+  public:
+    size_t operator()(const TileKey &key) const { return (size_t)key.hash(); }
+  };
+  class Entry {
+  public:
+    Entry(const TileKey &key_, std::shared_ptr<const RasterImage> tile_)
+        : key(key_), tile(std::move(tile_)) {}
+    TileKey key;
+    std::shared_ptr<const RasterImage> tile;
+    // found since eviction last looked at it, set under the shared lock
+    mutable std::atomic<bool> used{false};
+  };
+
+  void evictTo(size_t byteMax);
+  void removeBytes(uint64_t documentHash, size_t bytes);
+
+  mutable std::shared_mutex mutex;
+  // front is the most recently inserted or given a second chance
+  std::list<Entry> entryList;
+  std::unordered_map<TileKey, std::list<Entry>::iterator, KeyHash> entryMap;
+  // bytes held by documentHash, for the memory accountant
+  std::unordered_map<uint64_t, size_t> documentBytesMap;
+  Stats stats;
+  std::atomic<uint64_t> hitTotal{0}, missTotal{0};
+};
+
+/* Module wide cache, the budget is the "pixmapCacheBytes" setting */
+TileCache &tileCache();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_TILE_CACHE_H
@@ -0,0 +1,197 @@
+// C++
+#include <fstream>
+
+/* rapidjson v1.1 (2016-8-25)
+ * Developed by Tencent
+ * License: MITs
+ */
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "trace.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+std::atomic<uint64_t> documentIdTotal{0};
+std::atomic<uint32_t> threadIdTotal{0};
+
+/* Small numbers for the threads that record, Chrome shows one row each */
+uint32_t traceThreadId() {
+  thread_local uint32_t threadId = threadIdTotal.fetch_add(1) + 1;
+  return threadId;
+}
+
+} // namespace
+
+const char *traceSpanName(TraceSpanKind kind) {
+  static const char *nameList[traceSpanKindTotal] = {
+      "archiveOpen", "entryLocate", "inflate", "parse",
+      "layout",      "render",      "decode"};
+  return (uint32_t)kind < traceSpanKindTotal ? nameList[(uint32_t)kind] : "";
+}
+
+DocumentMetrics::DocumentMetrics()
+    : documentId(documentIdTotal.fetch_add(1) + 1) {}
+
+void DocumentMetrics::raise(std::atomic<uint64_t> &counter, uint64_t value) {
+  uint64_t current = counter.load(std::memory_order_relaxed);
+  while (current < value &&
+         !counter.compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+DocumentMetrics::Snapshot DocumentMetrics::getSnapshot() const {
+  Snapshot snapshot;
+  snapshot.documentId = documentId;
+  snapshot.bytesInflated = bytesInflated.load(std::memory_order_relaxed);
+  snapshot.partsTouched = partsTouched.load(std::memory_order_relaxed);
+  snapshot.allocationTotal = allocationTotal.load(std::memory_order_relaxed);
+  snapshot.allocationBytes = allocationBytes.load(std::memory_order_relaxed);
+  snapshot.arenaPeakBytes = arenaPeakBytes.load(std::memory_order_relaxed);
+  snapshot.cacheHits = cacheHits.load(std::memory_order_relaxed);
+  snapshot.cacheMisses = cacheMisses.load(std::memory_order_relaxed);
+  snapshot.errorTotal = errorTotal.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+Tracer::Tracer()
+    : mode((int)TraceMode::Off), epoch(std::chrono::steady_clock::now()) {}
+
+void Tracer::setMode(TraceMode mode_) {
+  mode.store((int)mode_, std::memory_order_relaxed);
+}
+
+void Tracer::setEventCapacity(size_t eventCapacity_) {
+  std::lock_guard<std::mutex> lock(eventMutex);
+  eventCapacity = eventCapacity_;
+}
+
+uint64_t Tracer::now() const {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void Tracer::record(TraceSpanKind kind, uint64_t documentId, uint64_t begin,
+                    uint64_t end) {
+  uint64_t duration = end - begin;
+  AtomicStats &kindStats = stats[(uint32_t)kind];
+  kindStats.count.fetch_add(1, std::memory_order_relaxed);
+  kindStats.totalNanoseconds.fetch_add(duration, std::memory_order_relaxed);
+  DocumentMetrics::raise(kindStats.maxNanoseconds, duration);
+  if (getMode() != TraceMode::Events)
+    return;
+  TraceEvent event{kind, traceThreadId(), documentId, begin, duration};
+  std::lock_guard<std::mutex> lock(eventMutex);
+  if (eventList.size() < eventCapacity)
+    eventList.push_back(event);
+  else
+    droppedTotal++;
+}
+
+std::array<Tracer::SpanStats, traceSpanKindTotal>
+Tracer::getSpanStats() const {
+  std::array<SpanStats, traceSpanKindTotal> spanStats;
+  for (uint32_t kind = 0; kind < traceSpanKindTotal; kind++) {
+    const AtomicStats &kindStats = stats[kind];
+    spanStats[kind].count = kindStats.count.load(std::memory_order_relaxed);
+    spanStats[kind].totalNanoseconds =
+        kindStats.totalNanoseconds.load(std::memory_order_relaxed);
+    spanStats[kind].maxNanoseconds =
+        kindStats.maxNanoseconds.load(std::memory_order_relaxed);
+  }
+  return spanStats;
+}
+
+uint64_t Tracer::getDroppedTotal() const {
+  std::lock_guard<std::mutex> lock(eventMutex);
+  return droppedTotal;
+}
+
+std::string Tracer::getChromeTrace() const {
+  std::vector<TraceEvent> eventCopy;
+  uint64_t dropped;
+  {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    eventCopy = eventList;
+    dropped = droppedTotal;
+  }
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("traceEvents");
+  writer.StartArray();
+  for (const TraceEvent &event : eventCopy) {
+    // complete events, microseconds
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(traceSpanName(event.kind));
+    writer.Key("cat");
+    writer.String("docx");
+    writer.Key("ph");
+    writer.String("X");
+    writer.Key("ts");
+    writer.Double(event.begin / 1000.0);
+    writer.Key("dur");
+    writer.Double(event.duration / 1000.0);
+    writer.Key("pid");
+    writer.Uint(1);
+    writer.Key("tid");
+    writer.Uint(event.threadId);
+    writer.Key("args");
+    writer.StartObject();
+    writer.Key("document");
+    writer.Uint64(event.documentId);
+    writer.EndObject();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.Key("displayTimeUnit");
+  writer.String("ms");
+  writer.Key("otherData");
+  writer.StartObject();
+  writer.Key("droppedEvents");
+  writer.Uint64(dropped);
+  writer.EndObject();
+  writer.EndObject();
+  return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+int32_t Tracer::writeChromeTrace(std::string fileName) const {
+  std::ofstream outFile(fileName, std::ios::binary);
+  if (!outFile)
+    return MZ_OPEN_ERROR;
+  outFile << getChromeTrace();
+  return outFile ? MZ_OK : MZ_WRITE_ERROR;
+}
+
+void Tracer::clear() {
+  for (AtomicStats &kindStats : stats) {
+    kindStats.count = 0;
+    kindStats.totalNanoseconds = 0;
+    kindStats.maxNanoseconds = 0;
+  }
+  std::lock_guard<std::mutex> lock(eventMutex);
+  eventList.clear();
+  droppedTotal = 0;
+}
+
+Tracer &tracer() {
+  static Tracer moduleTracer;
+  return moduleTracer;
+}
+
+} // namespace bookfiler
@@ -0,0 +1,203 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_TRACE_H
+#define BOOKFILER_MODULE_DOCX_TRACE_H
+
+// config
+#include "config.hpp"
+
+// C++
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* What a trace span measures */
+enum class TraceSpanKind : uint32_t {
+  ArchiveOpen,
+  EntryLocate,
+  Inflate,
+  Parse,
+  Layout,
+  Render,
+  Decode
+};
+const uint32_t traceSpanKindTotal = 7;
+/* "archiveOpen", "entryLocate", ... as they appear in snapshots */
+const char *traceSpanName(TraceSpanKind kind);
+
+/* Off: spans cost one relaxed load, the default.
+ * Stats: spans add to per kind counts and times, two clock reads each.
+ * Events: as Stats, and every span is kept for writeChromeTrace.
+ * The per document counters count in every mode.
+ */
+enum class TraceMode { Off, Stats, Events };
+
+/* DocumentMetrics
+ * Counters of one opened document. Every field is a relaxed atomic, so the
+ * hot paths that bump them never wait on each other.
+ */
+class DocumentMetrics {
+public:
+  class Snapshot {
+  public:
+    uint64_t documentId = 0;
+    uint64_t bytesInflated = 0, partsTouched = 0;
+    uint64_t allocationTotal = 0, allocationBytes = 0;
+    uint64_t arenaPeakBytes = 0;
+    uint64_t cacheHits = 0, cacheMisses = 0;
+    uint64_t errorTotal = 0;
+  };
+
+  DocumentMetrics();
+  // unique for the process, tags the spans of the document
+  const uint64_t documentId;
+  // uncompressed bytes of parts inflated or streamed
+  std::atomic<uint64_t> bytesInflated{0};
+  // parts read from the archive, cached ones included
+  std::atomic<uint64_t> partsTouched{0};
+  // buffers allocated for parts and pixels, and their bytes
+  std::atomic<uint64_t> allocationTotal{0}, allocationBytes{0};
+  // largest parsed model plus layout storage, line arena included
+  std::atomic<uint64_t> arenaPeakBytes{0};
+  // part, page count and tile cache lookups
+  std::atomic<uint64_t> cacheHits{0}, cacheMisses{0};
+  // archive errors, which zip.cpp otherwise only prints
+  std::atomic<uint64_t> errorTotal{0};
+
+  static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+  static void raise(std::atomic<uint64_t> &counter, uint64_t value);
+  Snapshot getSnapshot() const;
+};
+
+/* One finished span, times in nanoseconds since the tracer started */
+class TraceEvent {
+public:
+  TraceSpanKind kind;
+  uint32_t threadId;
+  uint64_t documentId;
+  uint64_t begin, duration;
+};
+
+/* Tracer
+ * Collects spans module wide. The mode is the "traceMode" setting; events
+ * are kept up to a capacity, later ones are counted as dropped. Thread
+ * safe.
+ */
+class Tracer {
+public:
+  class SpanStats {
+  public:
+    uint64_t count = 0, totalNanoseconds = 0, maxNanoseconds = 0;
+  };
+
+  Tracer();
+  void setMode(TraceMode mode);
+  TraceMode getMode() const {
+    return (TraceMode)mode.load(std::memory_order_relaxed);
+  }
+  void setEventCapacity(size_t eventCapacity);
+  /* Nanoseconds since the tracer started */
+  uint64_t now() const;
+  void record(TraceSpanKind kind, uint64_t documentId, uint64_t begin,
+              uint64_t end);
+  std::array<SpanStats, traceSpanKindTotal> getSpanStats() const;
+  uint64_t getDroppedTotal() const;
+  /* Kept events as Chrome trace JSON, for chrome://tracing or Perfetto */
+  std::string getChromeTrace() const;
+  /* @return MZ_OK, MZ_OPEN_ERROR or MZ_WRITE_ERROR */
+  int32_t writeChromeTrace(std::string fileName) const;
+  /* Forgets the counts, times and events */
+  void clear();
+
+private:
+  class AtomicStats {
+  public:
+    std::atomic<uint64_t> count{0}, totalNanoseconds{0}, maxNanoseconds{0};
+  };
+
+  std::atomic<int> mode;
+  std::chrono::steady_clock::time_point epoch;
+  std::array<AtomicStats, traceSpanKindTotal> stats;
+  mutable std::mutex eventMutex;
+  std::vector<TraceEvent> eventList;
+  size_t eventCapacity = (size_t)1 << 18;
+  uint64_t droppedTotal = 0;
+};
+
+/* Module wide tracer */
+Tracer &tracer();
+
+/* TraceSpan
+ * Times the scope it lives in. Use BOOKFILER_TRACE_SPAN, which compiles to
+ * nothing when BOOKFILER_MODULE_DOCX_TRACE is 0.
+ */
+class TraceSpan {
+public:
+  TraceSpan(TraceSpanKind kind_, uint64_t documentId_ = 0)
+      : kind(kind_), documentId(documentId_),
+        begin(tracer().getMode() == TraceMode::Off ? 0 : tracer().now() + 1) {
+  }
+  ~TraceSpan() {
+    if (begin)
+      tracer().record(kind, documentId, begin - 1, tracer().now());
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+  TraceSpanKind kind;
+  uint64_t documentId;
+  // 1 + the start, 0 when the span is not recorded
+  uint64_t begin;
+};
+
+} // namespace bookfiler
+
+#define BOOKFILER_TRACE_JOIN2(a, b) a##b
+#define BOOKFILER_TRACE_JOIN(a, b) BOOKFILER_TRACE_JOIN2(a, b)
+
+#if BOOKFILER_MODULE_DOCX_TRACE
+/* A span over the rest of the scope. metrics is a DocumentMetrics pointer
+ * or nullptr.
+ */
+#define BOOKFILER_TRACE_SPAN(kind, metrics)                                   \
+  bookfiler::TraceSpan BOOKFILER_TRACE_JOIN(traceSpan, __LINE__)(            \
+      bookfiler::TraceSpanKind::kind, (metrics) ? (metrics)->documentId : 0)
+/* Adds value to a DocumentMetrics counter, metrics may be nullptr */
+#define BOOKFILER_TRACE_ADD(metrics, counter, value)                          \
+  do {                                                                         \
+    if (metrics)                                                               \
+      bookfiler::DocumentMetrics::add((metrics)->counter, (uint64_t)(value));  \
+  } while (0)
+/* Raises a DocumentMetrics high water mark to value */
+#define BOOKFILER_TRACE_RAISE(metrics, counter, value)                        \
+  do {                                                                         \
+    if (metrics)                                                               \
+      bookfiler::DocumentMetrics::raise((metrics)->counter,                    \
+                                        (uint64_t)(value));                    \
+  } while (0)
+#else
+// metrics still counts as used, callers keep a local just for the macros
+#define BOOKFILER_TRACE_SPAN(kind, metrics) ((void)(metrics))
+#define BOOKFILER_TRACE_ADD(metrics, counter, value) ((void)(metrics))
+#define BOOKFILER_TRACE_RAISE(metrics, counter, value) ((void)(metrics))
+#endif
+
+#endif // BOOKFILER_MODULE_DOCX_TRACE_H
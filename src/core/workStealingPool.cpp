@@ -0,0 +1,105 @@
+// Local Project
+#include "workStealingPool.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+// the pool and worker the calling thread belongs to, if any
+thread_local const WorkStealingPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threadTotal) {
+  if (threadTotal == 0)
+    threadTotal = std::thread::hardware_concurrency();
+  if (threadTotal == 0)
+    threadTotal = 1;
+  for (size_t i = 0; i < threadTotal; i++)
+    workerList.push_back(std::make_unique<Worker>());
+  for (size_t i = 0; i < threadTotal; i++)
+    threadList.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  taskReady.notify_all();
+  for (std::thread &thread : threadList)
+    thread.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+  bool local = currentPool == this;
+  size_t workerIndex =
+      local ? currentWorker : nextWorker++ % workerList.size();
+  {
+    Worker &worker = *workerList[workerIndex];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.taskQueue.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    pendingTotal++;
+  }
+  taskReady.notify_one();
+}
+
+bool WorkStealingPool::isWorkerThread() const { return currentPool == this; }
+
+bool WorkStealingPool::take(size_t workerIndex,
+                            std::function<void()> &task) {
+  {
+    Worker &worker = *workerList[workerIndex];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.taskQueue.empty()) {
+      task = std::move(worker.taskQueue.back());
+      worker.taskQueue.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < workerList.size(); i++) {
+    Worker &victim = *workerList[(workerIndex + i) % workerList.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.taskQueue.empty()) {
+      task = std::move(victim.taskQueue.front());
+      victim.taskQueue.pop_front();
+      stealTotal++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::workerLoop(size_t workerIndex) {
+  currentPool = this;
+  currentWorker = workerIndex;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      taskReady.wait(lock, [this]() { return stopping || pendingTotal > 0; });
+      // drain the deques before stopping
+      if (pendingTotal == 0)
+        return;
+      pendingTotal--;
+    }
+    // a task is reserved for this worker, it is in some deque
+    std::function<void()> task;
+    while (!take(workerIndex, task))
+      std::this_thread::yield();
+    task();
+  }
+}
+
+WorkStealingPool &defaultWorkStealingPool() {
+  static WorkStealingPool pool;
+  return pool;
+}
+
+} // namespace bookfiler
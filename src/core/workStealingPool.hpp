@@ -0,0 +1,78 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_WORK_STEALING_POOL_H
+#define BOOKFILER_MODULE_DOCX_WORK_STEALING_POOL_H
+
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* WorkStealingPool
+ * One deque per worker. A task submitted from outside the pool is dealt to
+ * the workers round robin. A task submitted by a task already running on a
+ * worker goes to the back of that worker's own deque and runs next there,
+ * while its data is still in cache. A worker with nothing left steals from
+ * the front of the other deques, the oldest work. Use it for jobs that fan
+ * out into smaller jobs, like a page into tiles; ThreadPool is the plain
+ * FIFO for independent jobs.
+ */
+class WorkStealingPool {
+public:
+  /* @param threadTotal 0 uses std::thread::hardware_concurrency() */
+  WorkStealingPool(size_t threadTotal = 0);
+  /* Runs what is queued, then joins */
+  ~WorkStealingPool();
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  void submit(std::function<void()> task);
+  /* True on one of this pool's worker threads */
+  bool isWorkerThread() const;
+  size_t size() const { return threadList.size(); }
+  /* Tasks a worker took from another worker's deque */
+  uint64_t getStealTotal() const { return stealTotal; }
+
+private:
+  class Worker {
+  public:
+    std::mutex mutex;
+    std::deque<std::function<void()>> taskQueue;
+  };
+
+  bool take(size_t workerIndex, std::function<void()> &task);
+  void workerLoop(size_t workerIndex);
+
+  std::vector<std::unique_ptr<Worker>> workerList;
+  std::vector<std::thread> threadList;
+  std::atomic<size_t> nextWorker{0};
+  std::atomic<uint64_t> stealTotal{0};
+  // queued and not yet taken, guarded by sleepMutex for the wait
+  size_t pendingTotal = 0;
+  bool stopping = false;
+  std::mutex sleepMutex;
+  std::condition_variable taskReady;
+};
+
+/* Module wide pool sized to the machine, created on first use */
+WorkStealingPool &defaultWorkStealingPool();
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_WORK_STEALING_POOL_H
@@ -0,0 +1,374 @@
+// C++
+#include <cstddef>
+#include <cstring>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes
+ */
+#include "mz.h"
+
+// Local Project
+#include "xmlReader.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+/* Text longer than this without a '<' is handed out in pieces instead of
+ * being buffered whole
+ */
+const size_t textChunkMax = 64 * 1024;
+
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+const char *findSequence(const XmlScanKernel &kernel, const char *p,
+                         const char *end, const char *sequence,
+                         size_t sequenceLength) {
+  while (end - p >= (std::ptrdiff_t)sequenceLength) {
+    p = kernel.findChar(p, end, sequence[0]);
+    if (end - p < (std::ptrdiff_t)sequenceLength)
+      return nullptr;
+    if (std::memcmp(p, sequence, sequenceLength) == 0)
+      return p;
+    p++;
+  }
+  return nullptr;
+}
+
+void appendUtf8(uint32_t code, std::string &out) {
+  if (code < 0x80) {
+    out.push_back((char)code);
+  } else if (code < 0x800) {
+    out.push_back((char)(0xC0 | (code >> 6)));
+    out.push_back((char)(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    out.push_back((char)(0xE0 | (code >> 12)));
+    out.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+    out.push_back((char)(0x80 | (code & 0x3F)));
+  } else {
+    out.push_back((char)(0xF0 | (code >> 18)));
+    out.push_back((char)(0x80 | ((code >> 12) & 0x3F)));
+    out.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+    out.push_back((char)(0x80 | (code & 0x3F)));
+  }
+}
+
+} // namespace
+
+XmlReader::XmlReader() : kernel(&xmlScanKernel()) {}
+
+void XmlReader::open(xml_source_cb_t sourceCallback) {
+  kernel = &xmlScanKernel();
+  source = sourceCallback;
+  buffer.clear();
+  pos = end = buffer.data();
+  sourceDone = false;
+  pendingEnd = cdata = false;
+  event = XmlEvent::None;
+  depth = 0;
+  bytesRead = 0;
+}
+
+void XmlReader::open(std::string_view document) {
+  kernel = &xmlScanKernel();
+  source = nullptr;
+  buffer.clear();
+  pos = document.data();
+  end = pos + document.size();
+  sourceDone = true;
+  pendingEnd = cdata = false;
+  event = XmlEvent::None;
+  depth = 0;
+  bytesRead = document.size();
+}
+
+int32_t XmlReader::fill() {
+  if (sourceDone)
+    return MZ_END_OF_STREAM;
+  std::string_view chunk;
+  int32_t err = source(chunk);
+  if (err == MZ_END_OF_STREAM) {
+    sourceDone = true;
+    return err;
+  }
+  if (err != MZ_OK)
+    return err;
+  // keep the unconsumed tail, everything before pos was handed out already
+  buffer.erase(0, pos - buffer.data());
+  buffer.append(chunk.data(), chunk.size());
+  pos = buffer.data();
+  end = pos + buffer.size();
+  bytesRead += chunk.size();
+  return MZ_OK;
+}
+
+std::string_view
+XmlReader::getAttribute(std::string_view attributeName) const {
+  for (const XmlAttribute &attribute : attributeList) {
+    if (attribute.name == attributeName)
+      return attribute.value;
+  }
+  return std::string_view();
+}
+
+int32_t XmlReader::next() {
+  if (pendingEnd) {
+    // second half of a self closing element, name is unchanged
+    pendingEnd = false;
+    event = XmlEvent::EndElement;
+    attributeList.clear();
+    depth--;
+    return MZ_OK;
+  }
+  cdata = false;
+  while (true) {
+    event = XmlEvent::None;
+    if (pos == end) {
+      int32_t err = fill();
+      if (err == MZ_END_OF_STREAM)
+        return depth == 0 ? MZ_END_OF_STREAM : MZ_FORMAT_ERROR;
+      if (err != MZ_OK)
+        return err;
+      continue;
+    }
+
+    if (*pos != '<') {
+      const char *lt = kernel->findChar(pos, end, '<');
+      if (lt == end) {
+        if (!sourceDone && (size_t)(end - pos) < textChunkMax) {
+          int32_t err = fill();
+          if (err == MZ_OK)
+            continue;
+          if (err != MZ_END_OF_STREAM)
+            return err;
+        }
+        lt = end;
+        // don't split a character reference between two Text events
+        for (const char *q = end - 1; !sourceDone && q >= pos && q > end - 10;
+             q--) {
+          if (*q == ';')
+            break;
+          if (*q == '&' && q > pos) {
+            lt = q;
+            break;
+          }
+        }
+      }
+      text = std::string_view(pos, lt - pos);
+      pos = lt;
+      event = XmlEvent::Text;
+      return MZ_OK;
+    }
+
+    const char *p = pos;
+    Scan scan = scanMarkup(p);
+    if (scan == Scan::Error)
+      return MZ_FORMAT_ERROR;
+    if (scan == Scan::NeedMore) {
+      int32_t err = fill();
+      if (err == MZ_END_OF_STREAM)
+        return MZ_FORMAT_ERROR; // truncated markup
+      if (err != MZ_OK)
+        return err;
+      continue;
+    }
+    pos = p;
+    if (event != XmlEvent::None)
+      return MZ_OK;
+  }
+}
+
+XmlReader::Scan XmlReader::scanMarkup(const char *&p) {
+  if (end - p < 2)
+    return Scan::NeedMore;
+  char c = p[1];
+  if (c == '?') {
+    const char *close = findSequence(*kernel, p + 2, end, "?>", 2);
+    if (!close)
+      return Scan::NeedMore;
+    p = close + 2;
+    return Scan::Done;
+  }
+  if (c == '!') {
+    if (end - p < 4)
+      return Scan::NeedMore;
+    if (std::memcmp(p, "<!--", 4) == 0) {
+      const char *close = findSequence(*kernel, p + 4, end, "-->", 3);
+      if (!close)
+        return Scan::NeedMore;
+      p = close + 3;
+      return Scan::Done;
+    }
+    if (end - p < 9)
+      return Scan::NeedMore;
+    if (std::memcmp(p, "<![CDATA[", 9) == 0) {
+      const char *close = findSequence(*kernel, p + 9, end, "]]>", 3);
+      if (!close)
+        return Scan::NeedMore;
+      text = std::string_view(p + 9, close - p - 9);
+      cdata = true;
+      event = XmlEvent::Text;
+      p = close + 3;
+      return Scan::Done;
+    }
+    // doctype, skipping any internal subset
+    int bracketDepth = 0;
+    for (const char *q = p + 2; q < end; q++) {
+      if (*q == '[')
+        bracketDepth++;
+      else if (*q == ']')
+        bracketDepth--;
+      else if (*q == '>' && bracketDepth <= 0) {
+        p = q + 1;
+        return Scan::Done;
+      }
+    }
+    return Scan::NeedMore;
+  }
+  if (c == '/') {
+    const char *q = kernel->findNameEnd(p + 2, end);
+    const char *gt = kernel->findChar(q, end, '>');
+    if (gt == end)
+      return Scan::NeedMore;
+    if (depth == 0 || q == p + 2)
+      return Scan::Error;
+    name = std::string_view(p + 2, q - p - 2);
+    attributeList.clear();
+    event = XmlEvent::EndElement;
+    depth--;
+    p = gt + 1;
+    return Scan::Done;
+  }
+  return scanTag(p);
+}
+
+XmlReader::Scan XmlReader::scanTag(const char *&p) {
+  attributeList.clear();
+  const char *q = kernel->findNameEnd(p + 1, end);
+  if (q == end)
+    return Scan::NeedMore;
+  if (q == p + 1)
+    return Scan::Error;
+  std::string_view tagName(p + 1, q - p - 1);
+  bool selfClosing = false;
+  while (true) {
+    // usually a single space, not worth a kernel call
+    if (q < end && isSpace(*q) && ++q < end && isSpace(*q))
+      q = kernel->skipSpace(q, end);
+    if (q == end)
+      return Scan::NeedMore;
+    if (*q == '>') {
+      q++;
+      break;
+    }
+    if (*q == '/') {
+      if (q + 1 == end)
+        return Scan::NeedMore;
+      if (q[1] != '>')
+        return Scan::Error;
+      q += 2;
+      selfClosing = true;
+      break;
+    }
+    const char *attributeStart = q;
+    q = kernel->findNameEnd(q, end);
+    if (q == end)
+      return Scan::NeedMore;
+    std::string_view attributeName(attributeStart, q - attributeStart);
+    while (q < end && isSpace(*q))
+      q++;
+    if (q == end)
+      return Scan::NeedMore;
+    if (*q != '=' || attributeName.empty())
+      return Scan::Error;
+    q++;
+    while (q < end && isSpace(*q))
+      q++;
+    if (q == end)
+      return Scan::NeedMore;
+    char quote = *q;
+    if (quote != '"' && quote != '\'')
+      return Scan::Error;
+    q++;
+    const char *valueEnd = kernel->findChar(q, end, quote);
+    if (valueEnd == end)
+      return Scan::NeedMore;
+    attributeList.push_back(
+        {attributeName, std::string_view(q, valueEnd - q)});
+    q = valueEnd + 1;
+  }
+  name = tagName;
+  event = XmlEvent::StartElement;
+  depth++;
+  pendingEnd = selfClosing;
+  p = q;
+  return Scan::Done;
+}
+
+void xmlUnescape(std::string_view raw, std::string &out) {
+  const XmlScanKernel &kernel = xmlScanKernel();
+  const char *rawEnd = raw.data() + raw.size();
+  size_t i = 0;
+  while (i < raw.size()) {
+    size_t amp = kernel.findChar(raw.data() + i, rawEnd, '&') - raw.data();
+    if (amp == raw.size()) {
+      out.append(raw.data() + i, raw.size() - i);
+      return;
+    }
+    out.append(raw.data() + i, amp - i);
+    // references are short, don't search the rest of the text for ';'
+    size_t semi = raw.find(';', amp + 1);
+    if (semi == std::string_view::npos || semi - amp > 10) {
+      out.push_back('&');
+      i = amp + 1;
+      continue;
+    }
+    std::string_view ref = raw.substr(amp + 1, semi - amp - 1);
+    i = semi + 1;
+    if (ref == "lt")
+      out.push_back('<');
+    else if (ref == "gt")
+      out.push_back('>');
+    else if (ref == "amp")
+      out.push_back('&');
+    else if (ref == "quot")
+      out.push_back('"');
+    else if (ref == "apos")
+      out.push_back('\'');
+    else if (ref.size() > 1 && ref[0] == '#') {
+      bool hex = ref[1] == 'x' || ref[1] == 'X';
+      uint32_t code = 0;
+      bool valid = ref.size() > (hex ? 2u : 1u);
+      for (size_t j = hex ? 2 : 1; j < ref.size() && valid; j++) {
+        char c = ref[j];
+        uint32_t digit;
+        if (c >= '0' && c <= '9')
+          digit = c - '0';
+        else if (hex && c >= 'a' && c <= 'f')
+          digit = c - 'a' + 10;
+        else if (hex && c >= 'A' && c <= 'F')
+          digit = c - 'A' + 10;
+        else {
+          valid = false;
+          break;
+        }
+        code = code * (hex ? 16 : 10) + digit;
+      }
+      if (valid && code > 0 && code <= 0x10FFFF &&
+          (code < 0xD800 || code > 0xDFFF))
+        appendUtf8(code, out);
+      else
+        out.append(raw.data() + amp, semi + 1 - amp);
+    } else {
+      out.append(raw.data() + amp, semi + 1 - amp);
+    }
+  }
+}
+
+} // namespace bookfiler
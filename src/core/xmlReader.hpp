@@ -0,0 +1,101 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_XML_READER_H
+#define BOOKFILER_MODULE_DOCX_XML_READER_H
+
+// C++
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Local Project
+#include "xmlScan.hpp"
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+enum class XmlEvent { None, StartElement, EndElement, Text };
+
+/* Raw attribute, the value still has its entities escaped */
+class XmlAttribute {
+public:
+  std::string_view name, value;
+};
+
+/* Same contract as ZipInflateStream::read, MZ_OK with a chunk then
+ * MZ_END_OF_STREAM
+ */
+using xml_source_cb_t = std::function<int32_t(std::string_view &chunk)>;
+
+/* XmlReader
+ * Pull tokenizer for the XML written by office applications. It reads the
+ * source one chunk at a time and keeps only the unconsumed tail, so memory
+ * use is bounded by the largest tag rather than the document.
+ *   while ((err = reader.next()) == MZ_OK) { switch (reader.getEvent()) ... }
+ * Every view handed out is valid until the next call to next(). Comments,
+ * processing instructions and the doctype are skipped, text is reported raw
+ * (see xmlUnescape) and may be split across several Text events.
+ * Namespaces are not resolved, names are reported with their prefix.
+ * Byte searches go through the XmlScanKernel current at open().
+ */
+class XmlReader {
+public:
+  XmlReader();
+  void open(xml_source_cb_t sourceCallback);
+  /* Reads straight from memory without copying */
+  void open(std::string_view document);
+  /* @return MZ_OK with an event, MZ_END_OF_STREAM after the root element,
+   * MZ_FORMAT_ERROR on malformed input or the source's error
+   */
+  int32_t next();
+
+  XmlEvent getEvent() const { return event; }
+  std::string_view getName() const { return name; }
+  std::string_view getText() const { return text; }
+  bool isCData() const { return cdata; }
+  const std::vector<XmlAttribute> &getAttributes() const {
+    return attributeList;
+  }
+  /* @return the raw value or an empty view */
+  std::string_view getAttribute(std::string_view attributeName) const;
+  /* Elements open around the current event, the root element is depth 1 */
+  size_t getDepth() const { return depth; }
+  uint64_t getBytesRead() const { return bytesRead; }
+
+private:
+  enum class Scan { Done, NeedMore, Error };
+  Scan scanMarkup(const char *&p);
+  Scan scanTag(const char *&p);
+  int32_t fill();
+
+  const XmlScanKernel *kernel;
+  xml_source_cb_t source;
+  std::string buffer;
+  const char *pos = nullptr, *end = nullptr;
+  bool sourceDone = true, pendingEnd = false, cdata = false;
+  XmlEvent event = XmlEvent::None;
+  std::string_view name, text;
+  std::vector<XmlAttribute> attributeList;
+  size_t depth = 0;
+  uint64_t bytesRead = 0;
+};
+
+/* Appends raw with the predefined and numeric character references
+ * replaced. Unknown references are copied through unchanged. Runs without
+ * a '&' are appended in one piece.
+ */
+void xmlUnescape(std::string_view raw, std::string &out);
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_XML_READER_H
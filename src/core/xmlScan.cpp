@@ -0,0 +1,470 @@
+// C++
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Local Project
+#include "config.hpp"
+#include "xmlScan.hpp"
+
+#if BOOKFILER_MODULE_DOCX_SIMD && (defined(__x86_64__) || defined(_M_X64))
+#define BOOKFILER_XML_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define BOOKFILER_XML_SCAN_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BOOKFILER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BOOKFILER_TARGET_AVX2
+#endif
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+namespace {
+
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+inline bool isNameEnd(char c) {
+  return isSpace(c) || c == '>' || c == '/' || c == '=';
+}
+
+/* @return the length of the well formed sequence at p or 0 */
+size_t utf8SequenceLength(const unsigned char *p, size_t remaining) {
+  unsigned char c = p[0];
+  if (c < 0x80)
+    return 1;
+  if (c < 0xC2)
+    return 0;
+  if (c < 0xE0)
+    return remaining >= 2 && (p[1] & 0xC0) == 0x80 ? 2 : 0;
+  if (c < 0xF0) {
+    if (remaining < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80)
+      return 0;
+    // overlong and surrogates
+    if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] >= 0xA0))
+      return 0;
+    return 3;
+  }
+  if (c < 0xF5) {
+    if (remaining < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 ||
+        (p[3] & 0xC0) != 0x80)
+      return 0;
+    // overlong and above U+10FFFF
+    if ((c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] >= 0x90))
+      return 0;
+    return 4;
+  }
+  return 0;
+}
+
+inline int countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (int)index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+/* scalar */
+
+const char *scalarFindChar(const char *p, const char *end, char c) {
+  const char *found = (const char *)std::memchr(p, c, end - p);
+  return found ? found : end;
+}
+
+const char *scalarFindNameEnd(const char *p, const char *end) {
+  while (p < end && !isNameEnd(*p))
+    p++;
+  return p;
+}
+
+const char *scalarSkipSpace(const char *p, const char *end) {
+  while (p < end && isSpace(*p))
+    p++;
+  return p;
+}
+
+bool scalarValidUtf8(const char *p, size_t size) {
+  const unsigned char *q = (const unsigned char *)p;
+  size_t i = 0;
+  while (i < size) {
+    // eight ASCII bytes at a time
+    if (size - i >= 8) {
+      uint64_t word;
+      std::memcpy(&word, q + i, 8);
+      if ((word & 0x8080808080808080ULL) == 0) {
+        i += 8;
+        continue;
+      }
+    }
+    size_t length = utf8SequenceLength(q + i, size - i);
+    if (length == 0)
+      return false;
+    i += length;
+  }
+  return true;
+}
+
+const XmlScanKernel scalarKernel = {"scalar", scalarFindChar, scalarFindNameEnd,
+                                    scalarSkipSpace, scalarValidUtf8};
+
+#if BOOKFILER_XML_SCAN_X86
+
+/* SSE2, always present on x86-64 */
+
+inline __m128i sse2NameEndMask(__m128i block) {
+  __m128i mask = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+  mask = _mm_or_si128(mask, _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+  mask = _mm_or_si128(mask, _mm_cmpeq_epi8(block, _mm_set1_epi8('\r')));
+  mask = _mm_or_si128(mask, _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')));
+  return mask;
+}
+
+const char *sse2FindChar(const char *p, const char *end, char c) {
+  const __m128i needle = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask)
+      return p + countTrailingZeros(mask);
+  }
+  return scalarFindChar(p, end, c);
+}
+
+const char *sse2FindNameEnd(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    __m128i match = sse2NameEndMask(block);
+    match = _mm_or_si128(match, _mm_cmpeq_epi8(block, _mm_set1_epi8('>')));
+    match = _mm_or_si128(match, _mm_cmpeq_epi8(block, _mm_set1_epi8('/')));
+    match = _mm_or_si128(match, _mm_cmpeq_epi8(block, _mm_set1_epi8('=')));
+    uint32_t mask = _mm_movemask_epi8(match);
+    if (mask)
+      return p + countTrailingZeros(mask);
+  }
+  return scalarFindNameEnd(p, end);
+}
+
+const char *sse2SkipSpace(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    uint32_t mask = _mm_movemask_epi8(sse2NameEndMask(block)) ^ 0xFFFF;
+    if (mask)
+      return p + countTrailingZeros(mask);
+  }
+  return scalarSkipSpace(p, end);
+}
+
+/* A movemask per sixteen bytes, then a branchy walk of each multibyte
+ * sequence, ran at half the speed of the scalar loop on multilingual text, so
+ * this kernel validates with that loop
+ */
+const XmlScanKernel sse2Kernel = {"sse2", sse2FindChar, sse2FindNameEnd,
+                                  sse2SkipSpace, scalarValidUtf8};
+
+/* AVX2 */
+
+BOOKFILER_TARGET_AVX2 inline __m256i avx2SpaceMask(__m256i block) {
+  __m256i mask = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+  mask = _mm256_or_si256(mask,
+                         _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+  mask = _mm256_or_si256(mask,
+                         _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r')));
+  mask = _mm256_or_si256(mask,
+                         _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t')));
+  return mask;
+}
+
+BOOKFILER_TARGET_AVX2 const char *avx2FindChar(const char *p, const char *end,
+                                               char c) {
+  // most searches in markup end within a few bytes
+  if (end - p >= 16) {
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128((const __m128i *)p), _mm_set1_epi8(c)));
+    if (mask)
+      return p + countTrailingZeros(mask);
+    p += 16;
+  }
+  const __m256i needle = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)p);
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+    if (mask)
+      return p + countTrailingZeros(mask);
+  }
+  return sse2FindChar(p, end, c);
+}
+
+BOOKFILER_TARGET_AVX2 const char *avx2FindNameEnd(const char *p,
+                                                  const char *end) {
+  if (end - p >= 16) {
+    const char *found = sse2FindNameEnd(p, p + 16);
+    if (found != p + 16)
+      return found;
+    p += 16;
+  }
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)p);
+    __m256i match = avx2SpaceMask(block);
+    match = _mm256_or_si256(
+        match, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('>')));
+    match = _mm256_or_si256(
+        match, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('/')));
+    match = _mm256_or_si256(
+        match, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('=')));
+    uint32_t mask = _mm256_movemask_epi8(match);
+    if (mask)
+      return p + countTrailingZeros(mask);
+  }
+  return sse2FindNameEnd(p, end);
+}
+
+BOOKFILER_TARGET_AVX2 const char *avx2SkipSpace(const char *p,
+                                                const char *end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)p);
+    uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(avx2SpaceMask(block));
+    if (mask)
+      return p + countTrailingZeros(mask);
+  }
+  return sse2SkipSpace(p, end);
+}
+
+/* UTF-8 validation with nibble lookup tables, after Keiser and Lemire,
+ * "Validating UTF-8 In Less Than One Instruction Per Byte". Each bit of the
+ * tables below marks one kind of error for a (previous byte, byte) pair.
+ */
+const uint8_t utf8TooShort = 1 << 0;
+const uint8_t utf8TooLong = 1 << 1;
+const uint8_t utf8Overlong3 = 1 << 2;
+const uint8_t utf8TooLarge = 1 << 3;
+const uint8_t utf8Surrogate = 1 << 4;
+const uint8_t utf8Overlong2 = 1 << 5;
+const uint8_t utf8TooLarge1000 = 1 << 6;
+const uint8_t utf8Overlong4 = 1 << 6;
+const uint8_t utf8TwoContinuations = 1 << 7;
+const uint8_t utf8Carry = utf8TooShort | utf8TooLong | utf8TwoContinuations;
+
+// indexed by the high nibble of the previous byte
+const uint8_t utf8Byte1High[16] = {
+    utf8TooLong, utf8TooLong, utf8TooLong, utf8TooLong,
+    utf8TooLong, utf8TooLong, utf8TooLong, utf8TooLong,
+    utf8TwoContinuations, utf8TwoContinuations, utf8TwoContinuations,
+    utf8TwoContinuations, utf8TooShort | utf8Overlong2, utf8TooShort,
+    utf8TooShort | utf8Overlong3 | utf8Surrogate,
+    utf8TooShort | utf8TooLarge | utf8TooLarge1000 | utf8Overlong4};
+// indexed by the low nibble of the previous byte
+const uint8_t utf8Byte1Low[16] = {
+    utf8Carry | utf8Overlong3 | utf8Overlong2 | utf8Overlong4,
+    utf8Carry | utf8Overlong2,
+    utf8Carry,
+    utf8Carry,
+    utf8Carry | utf8TooLarge,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000 | utf8Surrogate,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000,
+    utf8Carry | utf8TooLarge | utf8TooLarge1000};
+// indexed by the high nibble of the byte
+const uint8_t utf8Byte2High[16] = {
+    utf8TooShort, utf8TooShort, utf8TooShort, utf8TooShort,
+    utf8TooShort, utf8TooShort, utf8TooShort, utf8TooShort,
+    utf8TooLong | utf8Overlong2 | utf8TwoContinuations | utf8Overlong3 |
+        utf8TooLarge1000 | utf8Overlong4,
+    utf8TooLong | utf8Overlong2 | utf8TwoContinuations | utf8Overlong3 |
+        utf8TooLarge,
+    utf8TooLong | utf8Overlong2 | utf8TwoContinuations | utf8Surrogate |
+        utf8TooLarge,
+    utf8TooLong | utf8Overlong2 | utf8TwoContinuations | utf8Surrogate |
+        utf8TooLarge,
+    utf8TooShort, utf8TooShort, utf8TooShort, utf8TooShort};
+// a lead byte this close to the end of a block needs the next block
+const uint8_t utf8IncompleteMax[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF};
+
+class Avx2Utf8State {
+public:
+  __m256i error, previous, incomplete;
+};
+
+template <int N>
+BOOKFILER_TARGET_AVX2 inline __m256i avx2Previous(__m256i block,
+                                                  __m256i previousBlock) {
+  return _mm256_alignr_epi8(
+      block, _mm256_permute2x128_si256(previousBlock, block, 0x21), 16 - N);
+}
+
+BOOKFILER_TARGET_AVX2 inline __m256i avx2Table(const uint8_t *table) {
+  return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+}
+
+BOOKFILER_TARGET_AVX2 void avx2Utf8Block(Avx2Utf8State &state,
+                                         __m256i block) {
+  if (_mm256_movemask_epi8(block) == 0) {
+    state.error = _mm256_or_si256(state.error, state.incomplete);
+    state.incomplete = _mm256_setzero_si256();
+    state.previous = block;
+    return;
+  }
+  const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+  __m256i previous1 = avx2Previous<1>(block, state.previous);
+  __m256i byte1High = _mm256_shuffle_epi8(
+      avx2Table(utf8Byte1High),
+      _mm256_and_si256(_mm256_srli_epi16(previous1, 4), lowNibble));
+  __m256i byte1Low = _mm256_shuffle_epi8(
+      avx2Table(utf8Byte1Low), _mm256_and_si256(previous1, lowNibble));
+  __m256i byte2High = _mm256_shuffle_epi8(
+      avx2Table(utf8Byte2High),
+      _mm256_and_si256(_mm256_srli_epi16(block, 4), lowNibble));
+  __m256i special =
+      _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+
+  // third and fourth bytes must be continuations
+  __m256i third = _mm256_subs_epu8(avx2Previous<2>(block, state.previous),
+                                   _mm256_set1_epi8((char)0xDF));
+  __m256i fourth = _mm256_subs_epu8(avx2Previous<3>(block, state.previous),
+                                    _mm256_set1_epi8((char)0xEF));
+  __m256i mustContinue = _mm256_cmpgt_epi8(_mm256_or_si256(third, fourth),
+                                           _mm256_setzero_si256());
+  mustContinue =
+      _mm256_and_si256(mustContinue, _mm256_set1_epi8((char)0x80));
+  state.error =
+      _mm256_or_si256(state.error, _mm256_xor_si256(mustContinue, special));
+
+  state.incomplete = _mm256_subs_epu8(
+      block, _mm256_loadu_si256((const __m256i *)utf8IncompleteMax));
+  state.previous = block;
+}
+
+BOOKFILER_TARGET_AVX2 bool avx2ValidUtf8(const char *p, size_t size) {
+  Avx2Utf8State state;
+  state.error = state.previous = state.incomplete = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; size - i >= 32; i += 32) {
+    // skip ASCII 64 bytes at a time
+    while (size - i >= 64) {
+      __m256i block = _mm256_loadu_si256((const __m256i *)(p + i + 32));
+      if (_mm256_movemask_epi8(_mm256_or_si256(
+              _mm256_loadu_si256((const __m256i *)(p + i)), block)) != 0)
+        break;
+      state.error = _mm256_or_si256(state.error, state.incomplete);
+      state.incomplete = _mm256_setzero_si256();
+      state.previous = block;
+      i += 64;
+    }
+    if (size - i < 32)
+      break;
+    avx2Utf8Block(state, _mm256_loadu_si256((const __m256i *)(p + i)));
+    // give up early on long invalid input
+    if ((i & 1023) == 0 && !_mm256_testz_si256(state.error, state.error))
+      return false;
+  }
+  // the tail padded with NUL, which also ends any open sequence
+  char tail[32] = {0};
+  std::memcpy(tail, p + i, size - i);
+  avx2Utf8Block(state, _mm256_loadu_si256((const __m256i *)tail));
+  state.error = _mm256_or_si256(state.error, state.incomplete);
+  return _mm256_testz_si256(state.error, state.error);
+}
+
+const XmlScanKernel avx2Kernel = {"avx2", avx2FindChar, avx2FindNameEnd,
+                                  avx2SkipSpace, avx2ValidUtf8};
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  // the OS must save the ymm registers
+  if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) ||
+      (_xgetbv(0) & 6) != 6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // BOOKFILER_XML_SCAN_X86
+
+std::vector<const XmlScanKernel *> supportedKernels() {
+  std::vector<const XmlScanKernel *> kernelList = {&scalarKernel};
+#if BOOKFILER_XML_SCAN_X86
+  kernelList.push_back(&sse2Kernel);
+  if (cpuHasAvx2())
+    kernelList.push_back(&avx2Kernel);
+#endif
+  return kernelList;
+}
+
+std::atomic<const XmlScanKernel *> selectedKernel{nullptr};
+
+} // namespace
+
+const std::vector<const XmlScanKernel *> &xmlScanKernelList() {
+  static const std::vector<const XmlScanKernel *> kernelList =
+      supportedKernels();
+  return kernelList;
+}
+
+const XmlScanKernel &xmlScanKernel() {
+  const XmlScanKernel *kernel =
+      selectedKernel.load(std::memory_order_acquire);
+  if (!kernel) {
+    kernel = xmlScanKernelList().back();
+    selectedKernel.store(kernel, std::memory_order_release);
+  }
+  return *kernel;
+}
+
+bool xmlSelectScanKernel(std::string_view kernelName) {
+  for (const XmlScanKernel *kernel : xmlScanKernelList()) {
+    if (kernelName == kernel->name) {
+      selectedKernel.store(kernel, std::memory_order_release);
+      return true;
+    }
+  }
+  return false;
+}
+
+void utf8Repair(std::string &text, size_t offset) {
+  std::string repaired;
+  const unsigned char *q = (const unsigned char *)text.data();
+  size_t i = offset;
+  while (i < text.size()) {
+    size_t length = utf8SequenceLength(q + i, text.size() - i);
+    if (length == 0) {
+      repaired.append("\xEF\xBF\xBD");
+      i++;
+    } else {
+      repaired.append(text, i, length);
+      i += length;
+    }
+  }
+  text.replace(offset, std::string::npos, repaired);
+}
+
+} // namespace bookfiler
@@ -0,0 +1,59 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_XML_SCAN_H
+#define BOOKFILER_MODULE_DOCX_XML_SCAN_H
+
+// C++
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * bookfiler = BookFiler™
+ */
+namespace bookfiler {
+
+/* XmlScanKernel
+ * The byte searches XmlReader and xmlUnescape spend their time in. One
+ * kernel per instruction set, the best one the CPU supports is picked the
+ * first time xmlScanKernel() is called. No function reads outside
+ * [p, end), so they are safe on views into a mapped file.
+ */
+class XmlScanKernel {
+public:
+  const char *name;
+  /* @return the first c in [p, end) or end */
+  const char *(*findChar)(const char *p, const char *end, char c);
+  /* @return the first whitespace, '>', '/' or '=' in [p, end) or end */
+  const char *(*findNameEnd)(const char *p, const char *end);
+  /* @return the first byte that is not XML whitespace or end */
+  const char *(*skipSpace)(const char *p, const char *end);
+  /* @return true if [p, p + size) is well formed UTF-8 */
+  bool (*validUtf8)(const char *p, size_t size);
+};
+
+/* Kernel used by new XmlReader instances and xmlUnescape */
+const XmlScanKernel &xmlScanKernel();
+/* Every kernel this CPU can run, scalar first */
+const std::vector<const XmlScanKernel *> &xmlScanKernelList();
+/* Overrides the automatic choice, meant for benchmarks and debugging.
+ * Not synchronized with readers running on other threads.
+ * @return false if no supported kernel has that name
+ */
+bool xmlSelectScanKernel(std::string_view kernelName);
+
+/* Replaces every malformed UTF-8 sequence in text from offset on with
+ * U+FFFD, the bytes before offset are left alone
+ */
+void utf8Repair(std::string &text, size_t offset);
+
+} // namespace bookfiler
+
+#endif // BOOKFILER_MODULE_DOCX_XML_SCAN_H
@@ -1,6 +1,42 @@
+// C++
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+
 // Local Project
+#include "bufferPool.hpp"
 #include "zip.hpp"
 
+namespace {
+
+// deflate can't expand data more than 1032 to 1
+const uint64_t inflateRatioMax = 1032;
+
+/* False when the central directory claims more than the entry's data
+ * could inflate to, the buffer is sized from the claim
+ */
+bool sizeClaimValid(const ZipIndexEntry &entry, uint64_t archiveSize) {
+  if (entry.compressedSize > archiveSize)
+    return false;
+  return entry.uncompressedSize / inflateRatioMax <= entry.compressedSize;
+}
+
+/* The MS-DOS date and time of a central directory record, local time */
+std::time_t dosDateToTime(uint32_t dosDateTime) {
+  std::tm date = {};
+  date.tm_year = (int)((dosDateTime >> 25) & 0x7F) + 80;
+  date.tm_mon = (int)((dosDateTime >> 21) & 0xF) - 1;
+  date.tm_mday = (int)((dosDateTime >> 16) & 0x1F);
+  date.tm_hour = (int)((dosDateTime >> 11) & 0x1F);
+  date.tm_min = (int)((dosDateTime >> 5) & 0x3F);
+  date.tm_sec = (int)(dosDateTime & 0x1F) * 2;
+  date.tm_isdst = -1;
+  return std::mktime(&date);
+}
+
+} // namespace
+
 ZipFileEntry::ZipFileEntry(mz_zip_file *zipFilePtr) {
   filePath = std::string(zipFilePtr->filename, zipFilePtr->filename_size);
   /* The pointer is invalidated when going to next
@@ -29,24 +65,49 @@ ZipFileEntry::ZipFileEntry(mz_zip_file *zipFilePtr) {
   accessed_date = zipFilePtr->accessed_date;
   creation_date = zipFilePtr->creation_date;
   modified_date = zipFilePtr->modified_date;
+  describe();
+}
+
+ZipFileEntry::ZipFileEntry(const ZipIndexEntry &entry) : mz_zip_file() {
+  filePath = std::string(entry.filePath);
+  filename = filePath.c_str();
+  filename_size = (uint16_t)filePath.size();
+  crc = entry.crc;
+  flag = entry.flag;
+  zip64 = entry.compressedSize >= 0xFFFFFFFF ||
+          entry.uncompressedSize >= 0xFFFFFFFF ||
+          entry.headerOffset >= 0xFFFFFFFF;
+  disk_offset = (int64_t)entry.headerOffset;
+  external_fa = entry.externalAttributes;
+  version_madeby = entry.versionMadeBy;
+  version_needed = entry.versionNeeded;
+  compressed_size = (int64_t)entry.compressedSize;
+  uncompressed_size = (int64_t)entry.uncompressedSize;
+  compression_method = entry.compressionMethod;
 
+  accessed_date = creation_date = 0;
+  modified_date = dosDateToTime(entry.dosDateTime);
+  mz_zip_file::modified_date = (time_t)modified_date;
+  describe();
+}
+
+void ZipFileEntry::describe() {
   ratio = 0;
-  if (zipFilePtr->uncompressed_size > 0)
-    ratio = (uint32_t)((zipFilePtr->compressed_size * 100) /
-                       zipFilePtr->uncompressed_size);
+  if (uncompressed_size > 0)
+    ratio = (uint32_t)((compressed_size * 100) / uncompressed_size);
 
   /* Display a '*' if the file is encrypted */
-  if (zipFilePtr->flag & MZ_ZIP_FLAG_ENCRYPTED)
+  if (flag & MZ_ZIP_FLAG_ENCRYPTED)
     crypt = '*';
   else
     crypt = ' ';
 
-  switch (zipFilePtr->compression_method) {
+  switch (compression_method) {
   case MZ_COMPRESS_METHOD_STORE:
     compressionName = "Stored";
     break;
   case MZ_COMPRESS_METHOD_DEFLATE:
-    level = (int16_t)((zipFilePtr->flag & 0x6) / 2);
+    level = (int16_t)((flag & 0x6) / 2);
     if (level == 0)
       compressionName = "Defl:N";
     else if (level == 1)
@@ -72,8 +133,8 @@ ZipFileMap::ZipFileMap(){};
 
 ZipFileMap::~ZipFileMap(){};
 
-std::unordered_map<std::string, std::shared_ptr<ZipFileEntry>>
-ZipFileMap::getMap() {
+const std::unordered_map<std::string, std::shared_ptr<ZipFileEntry>> &
+ZipFileMap::getMap() const {
   return m;
 };
 
@@ -82,23 +143,45 @@ bool ZipFileMap::insert(mz_zip_file *zipFilePtr) {
   return true;
 }
 
+bool ZipFileMap::insert(const ZipIndexEntry &entry) {
+  m.insert(
+      {std::string(entry.filePath), std::make_shared<ZipFileEntry>(entry)});
+  return true;
+}
+
 ZipReader::ZipReader() { mz_zip_reader_create(&reader); }
 
 ZipReader::~ZipReader() { mz_zip_reader_delete(&reader); }
 
 int32_t ZipReader::open(std::string fileName) {
+  BOOKFILER_TRACE_SPAN(ArchiveOpen, metrics);
   int32_t err = mz_zip_reader_open_file(reader, fileName.c_str());
+  if (err != MZ_OK) {
+    BOOKFILER_TRACE_ADD(metrics, errorTotal, 1);
+    return err;
+  }
+  /* Archives the index can't read (split archives) keep working through
+   * minizip alone
+   */
+  int32_t indexErr = index.open(fileName);
+  if (indexErr != MZ_OK) {
+    BOOKFILER_TRACE_ADD(metrics, errorTotal, 1);
+  }
   return err;
 }
 
 int32_t
 ZipReader::extractEntryAll(std::shared_ptr<ZipFileMap> ZipFileEntryMap) {
+  if (index.isOpen()) {
+    for (const ZipIndexEntry &entry : index.getEntries())
+      ZipFileEntryMap->insert(entry);
+    return MZ_OK;
+  }
+  std::lock_guard<std::mutex> lock(readerMutex);
   int32_t err = mz_zip_reader_goto_first_entry(reader);
 
   if (err != MZ_OK && err != MZ_END_OF_LIST) {
-    std::cout << "Error " << err << ": going to first entry in archive"
-              << std::endl;
-    mz_zip_reader_delete(&reader);
+    BOOKFILER_TRACE_ADD(metrics, errorTotal, 1);
     return err;
   }
 
@@ -106,15 +189,13 @@ ZipReader::extractEntryAll(std::shared_ptr<ZipFileMap> ZipFileEntryMap) {
   while (err == MZ_OK) {
     err = mz_zip_reader_entry_get_info(reader, &fileInfo);
     if (err != MZ_OK) {
-      std::cout << "Error " << err << ": getting entry info in archive"
-                << std::endl;
+      BOOKFILER_TRACE_ADD(metrics, errorTotal, 1);
       break;
     }
     ZipFileEntryMap->insert(fileInfo);
     err = mz_zip_reader_goto_next_entry(reader);
     if (err != MZ_OK && err != MZ_END_OF_LIST) {
-      std::cout << "Error " << err << ": going to next entry in archive"
-                << std::endl;
+      BOOKFILER_TRACE_ADD(metrics, errorTotal, 1);
       break;
     }
   }
@@ -126,6 +207,34 @@ ZipReader::extractEntryAll(std::shared_ptr<ZipFileMap> ZipFileEntryMap) {
 
 int32_t ZipReader::saveToFile(std::string resourcePath, std::string outName) {
   int32_t err = MZ_OK;
+  const ZipIndexEntry *entryPtr = locate(resourcePath);
+  if (entryPtr) {
+    ZipInflateStream stream;
+    err = stream.open(index, *entryPtr);
+    if (err == MZ_OK) {
+      BOOKFILER_TRACE_SPAN(Inflate, metrics);
+      BOOKFILER_TRACE_ADD(metrics, partsTouched, 1);
+      BOOKFILER_TRACE_ADD(metrics, bytesInflated, entryPtr->uncompressedSize);
+      std::filesystem::path outPath = std::filesystem::u8path(outName);
+      std::error_code ec;
+      if (outPath.has_parent_path())
+        std::filesystem::create_directories(outPath.parent_path(), ec);
+      std::ofstream outFile(outPath, std::ios::binary);
+      if (!outFile)
+        return MZ_OPEN_ERROR;
+      std::string_view chunk;
+      while ((err = stream.read(chunk)) == MZ_OK) {
+        if (!outFile.write(chunk.data(), (std::streamsize)chunk.size()))
+          return MZ_WRITE_ERROR;
+      }
+      return err == MZ_END_OF_STREAM ? MZ_OK : err;
+    }
+    if (err != MZ_SUPPORT_ERROR)
+      return err;
+  } else if (index.isOpen()) {
+    return MZ_END_OF_LIST;
+  }
+  std::lock_guard<std::mutex> lock(readerMutex);
   err = mz_zip_reader_locate_entry(reader, resourcePath.c_str(), 0);
   if (err != MZ_OK) {
     return err;
@@ -140,6 +249,14 @@ int32_t ZipReader::getResourceSize(std::string resourcePath,
                                    long long &resourceSize) {
   int32_t err = MZ_OK;
   // find resource by path
+  const ZipIndexEntry *entryPtr = locate(resourcePath);
+  if (entryPtr) {
+    resourceSize = (long long)entryPtr->uncompressedSize;
+    return err;
+  } else if (index.isOpen()) {
+    return MZ_END_OF_LIST;
+  }
+  std::lock_guard<std::mutex> lock(readerMutex);
   err = mz_zip_reader_locate_entry(reader, resourcePath.c_str(), 0);
   if (err != MZ_OK) {
     return err;
@@ -152,6 +269,18 @@ int32_t ZipReader::saveToMemory(std::string resourcePath, char *&buffer,
                                 long long resourceSize) {
   int32_t err = MZ_OK;
   // find resource by path
+  const ZipIndexEntry *entryPtr = locate(resourcePath);
+  if (entryPtr) {
+    BOOKFILER_TRACE_SPAN(Inflate, metrics);
+    BOOKFILER_TRACE_ADD(metrics, partsTouched, 1);
+    BOOKFILER_TRACE_ADD(metrics, bytesInflated, entryPtr->uncompressedSize);
+    err = index.extract(*entryPtr, buffer, resourceSize);
+    if (err != MZ_SUPPORT_ERROR)
+      return err;
+  } else if (index.isOpen()) {
+    return MZ_END_OF_LIST;
+  }
+  std::lock_guard<std::mutex> lock(readerMutex);
   err = mz_zip_reader_locate_entry(reader, resourcePath.c_str(), 0);
   if (err != MZ_OK) {
     return err;
@@ -164,15 +293,156 @@ int32_t ZipReader::saveToMemory(std::string resourcePath, char *&buffer,
   return err;
 }
 
+int32_t ZipReader::getView(std::string resourcePath, std::string_view &view) {
+  const ZipIndexEntry *entryPtr = locate(resourcePath);
+  if (!entryPtr)
+    return index.isOpen() ? MZ_END_OF_LIST : MZ_SUPPORT_ERROR;
+  BOOKFILER_TRACE_ADD(metrics, partsTouched, 1);
+  return index.getStoredView(*entryPtr, view);
+}
+
+int32_t ZipReader::openStream(std::string resourcePath,
+                              ZipInflateStream &stream) {
+  const ZipIndexEntry *entryPtr = locate(resourcePath);
+  if (entryPtr) {
+    BOOKFILER_TRACE_ADD(metrics, partsTouched, 1);
+    // counted up front, the reader inflates it chunk by chunk
+    if (entryPtr->compressionMethod != 0)
+      BOOKFILER_TRACE_ADD(metrics, bytesInflated, entryPtr->uncompressedSize);
+    int32_t err = stream.open(index, *entryPtr);
+    if (err != MZ_SUPPORT_ERROR)
+      return err;
+  } else if (index.isOpen()) {
+    return MZ_END_OF_LIST;
+  } else {
+    BOOKFILER_TRACE_ADD(metrics, partsTouched, 1);
+  }
+  // minizip has no chunked reads, the stream walks a whole copy
+  std::shared_ptr<ZipPart> partPtr = extractFallback(resourcePath);
+  if (partPtr->err != MZ_OK)
+    return partPtr->err;
+  return stream.open(partPtr->buffer, partPtr->data.size());
+}
+
+std::shared_ptr<ZipPart>
+ZipReader::extractPart(const ZipIndexEntry *entryPtr,
+                       std::string resourcePath) const {
+  std::shared_ptr<ZipPart> partPtr = std::make_shared<ZipPart>();
+  partPtr->filePath = resourcePath;
+  if (!entryPtr) {
+    if (!index.isOpen()) {
+      BOOKFILER_TRACE_ADD(metrics, partsTouched, 1);
+      return extractFallback(resourcePath);
+    }
+    partPtr->err = MZ_END_OF_LIST;
+    return partPtr;
+  }
+  BOOKFILER_TRACE_ADD(metrics, partsTouched, 1);
+  if (index.getStoredView(*entryPtr, partPtr->data) == MZ_OK) {
+    partPtr->mappedFile = index.getMappedFile();
+  } else if ((entryPtr->flag & MZ_ZIP_FLAG_ENCRYPTED) ||
+             (entryPtr->compressionMethod != MZ_COMPRESS_METHOD_STORE &&
+              entryPtr->compressionMethod != MZ_COMPRESS_METHOD_DEFLATE)) {
+    // the index can't read it, minizip sizes its own buffer
+    return extractFallback(resourcePath);
+  } else if (!sizeClaimValid(*entryPtr, index.getMappedFile()->size())) {
+    BOOKFILER_TRACE_ADD(metrics, errorTotal, 1);
+    partPtr->err = MZ_FORMAT_ERROR;
+  } else {
+    BOOKFILER_TRACE_SPAN(Inflate, metrics);
+    BOOKFILER_TRACE_ADD(metrics, bytesInflated, entryPtr->uncompressedSize);
+    BOOKFILER_TRACE_ADD(metrics, allocationTotal, 1);
+    BOOKFILER_TRACE_ADD(metrics, allocationBytes, entryPtr->uncompressedSize);
+    size_t size = (size_t)entryPtr->uncompressedSize;
+    partPtr->buffer = bookfiler::partBufferPool().acquire(size);
+    partPtr->bufferSize = bookfiler::BufferPool::classSize(size);
+    partPtr->err = index.extract(*entryPtr, (char *)partPtr->buffer.get(),
+                                 (long long)size);
+    partPtr->data = std::string_view((char *)partPtr->buffer.get(), size);
+    if (partPtr->err == MZ_SUPPORT_ERROR)
+      return extractFallback(resourcePath);
+  }
+  return partPtr;
+}
+
+std::shared_ptr<ZipPart>
+ZipReader::extractFallback(std::string resourcePath) const {
+  std::shared_ptr<ZipPart> partPtr = std::make_shared<ZipPart>();
+  partPtr->filePath = resourcePath;
+  BOOKFILER_TRACE_SPAN(Inflate, metrics);
+  std::lock_guard<std::mutex> lock(readerMutex);
+  partPtr->err = mz_zip_reader_locate_entry(reader, resourcePath.c_str(), 0);
+  if (partPtr->err != MZ_OK)
+    return partPtr;
+  int32_t length = mz_zip_reader_entry_save_buffer_length(reader);
+  if (length < 0) {
+    partPtr->err = length;
+    return partPtr;
+  }
+  size_t size = (size_t)length;
+  BOOKFILER_TRACE_ADD(metrics, bytesInflated, size);
+  BOOKFILER_TRACE_ADD(metrics, allocationTotal, 1);
+  BOOKFILER_TRACE_ADD(metrics, allocationBytes, size);
+  partPtr->buffer = bookfiler::partBufferPool().acquire(size);
+  partPtr->bufferSize = bookfiler::BufferPool::classSize(size);
+  partPtr->err = mz_zip_reader_entry_save_buffer(
+      reader, (void *)partPtr->buffer.get(), length);
+  partPtr->data = std::string_view((char *)partPtr->buffer.get(), size);
+  return partPtr;
+}
+
+const ZipIndexEntry *ZipReader::locate(std::string_view resourcePath) const {
+  BOOKFILER_TRACE_SPAN(EntryLocate, metrics);
+  return index.find(resourcePath);
+}
+
+std::shared_ptr<ZipPart>
+ZipReader::extractPart(std::string resourcePath) const {
+  return extractPart(locate(resourcePath), resourcePath);
+}
+
+std::vector<std::future<std::shared_ptr<ZipPart>>>
+ZipReader::extractBatch(const std::vector<std::string> &resourcePathList,
+                        zip_part_cb_t partCallback,
+                        bookfiler::ThreadPool &pool) {
+  size_t partTotal = resourcePathList.size();
+  std::vector<const ZipIndexEntry *> entryList(partTotal);
+  std::vector<size_t> order(partTotal);
+  for (size_t i = 0; i < partTotal; i++) {
+    entryList[i] = locate(resourcePathList[i]);
+    order[i] = i;
+  }
+  // largest first so one big part does not finish the batch alone
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    uint64_t sizeA = entryList[a] ? entryList[a]->uncompressedSize : 0;
+    uint64_t sizeB = entryList[b] ? entryList[b]->uncompressedSize : 0;
+    return sizeA > sizeB;
+  });
+
+  std::vector<std::future<std::shared_ptr<ZipPart>>> futureList(partTotal);
+  for (size_t i : order) {
+    const ZipIndexEntry *entryPtr = entryList[i];
+    std::string resourcePath = resourcePathList[i];
+    futureList[i] = pool.submit([this, entryPtr, resourcePath,
+                                 partCallback]() {
+      std::shared_ptr<ZipPart> partPtr = extractPart(entryPtr, resourcePath);
+      if (partCallback)
+        partCallback(partPtr);
+      return partPtr;
+    });
+  }
+  return futureList;
+}
+
 void zipFileEntryMapPrintAll(std::shared_ptr<ZipFileMap> zipFileMap) {
   std::cout << std::left << std::setw(10) << "Packed" << std::setw(10)
             << "Unpacked" << std::setw(10) << "Ratio" << std::setw(10)
             << "Method" << std::setw(2) << "C" << std::setw(10) << "Perms"
             << std::setw(20) << "Date Time" << std::setw(10) << "CRC-32"
             << std::setw(20) << "Name" << std::endl;
-  for (auto zipFileIt : zipFileMap->getMap()) {
+  for (const auto &zipFileIt : zipFileMap->getMap()) {
     auto zipFilePtr = zipFileIt.second;
-    // std::time_t t = zipFilePtr->modified_date;
+    std::time_t t = (std::time_t)zipFilePtr->modified_date;
     std::cout << std::left << std::dec << std::setw(10)
               << zipFilePtr->compressed_size << std::setw(10)
               << zipFilePtr->uncompressed_size << std::setw(10)
@@ -180,7 +450,7 @@ void zipFileEntryMapPrintAll(std::shared_ptr<ZipFileMap> zipFileMap) {
               << zipFilePtr->compressionName << std::setw(2)
               << zipFilePtr->crypt << std::setw(10) << zipFilePtr->external_fa
               << std::setw(20)
-              << std::put_time(std::localtime(&zipFilePtr->modified_date),
+              << std::put_time(std::localtime(&t),
                                "%Y-%m-%d %H:%M:%S ")
               << std::setw(10) << std::hex << zipFilePtr->crc << std::setw(20)
               << zipFilePtr->filePath << std::endl;
@@ -10,10 +10,15 @@
 #define BOOKFILER_MODULE_DOCX_ZIP_H
 
 // C++
+#include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 /* Minizip 2.7.0
  * License: zlib
@@ -26,45 +31,130 @@
 #include "mz_zip.h"
 #include "mz_zip_rw.h"
 
+// Local Project
+#include "threadPool.hpp"
+#include "trace.hpp"
+#include "zipIndex.hpp"
+#include "zipStream.hpp"
+
 /* ZipFileEntry
  * Extracts additional information from mz_zip_file
  */
 class ZipFileEntry : public mz_zip_file {
 public:
   ZipFileEntry(mz_zip_file *zipFilePtr);
+  /* From the central directory index, filename points at filePath and
+   * there is no comment or extra field
+   */
+  ZipFileEntry(const ZipIndexEntry &entry);
   ~ZipFileEntry();
   long long accessed_date, creation_date, modified_date;
   std::string compressionName, crypt, filePath;
   int16_t level;
   uint32_t ratio;
+
+private:
+  /* ratio, crypt and compressionName from the mz_zip_file fields */
+  void describe();
 };
 
 class ZipFileMap {
 public:
   ZipFileMap();
   ~ZipFileMap();
-  std::unordered_map<std::string, std::shared_ptr<ZipFileEntry>> getMap();
+  const std::unordered_map<std::string, std::shared_ptr<ZipFileEntry>> &
+  getMap() const;
   bool insert(mz_zip_file *zipFilePtr);
+  bool insert(const ZipIndexEntry &entry);
 
   std::unordered_map<std::string, std::shared_ptr<ZipFileEntry>> m;
 };
 
+/* ZipPart
+ * One resource from a batch extraction. Stored resources point into the
+ * mapping, which mappedFile keeps alive, deflated ones point into buffer.
+ */
+class ZipPart {
+public:
+  std::string filePath;
+  int32_t err = MZ_OK;
+  std::string_view data;
+  // inflated contents from partBufferPool(), bufferSize bytes of it held
+  std::shared_ptr<unsigned char> buffer;
+  size_t bufferSize = 0;
+  std::shared_ptr<const MappedFile> mappedFile;
+};
+
+using zip_part_cb_t = std::function<void(std::shared_ptr<ZipPart>)>;
+
+/* ZipReader
+ * Lookups go through the central directory index and reads start at the
+ * entry's offset in the mapping with their own inflate state, there is no
+ * current entry, so any number of threads read one archive at once. Only
+ * entries the index can't read (split archives, encryption, methods other
+ * than store and deflate) go through the minizip handle and its cursor,
+ * one thread at a time. open must return before anything else is called.
+ */
 class ZipReader {
 public:
   ZipReader();
   ~ZipReader();
   int32_t open(std::string fileName);
   int32_t extractEntryAll(std::shared_ptr<ZipFileMap> ZipFileEntryMap);
-  /* If a path without a directory is used the the error is received:
-   * MZ_OPEN_ERROR	-111	Stream open error
+  /* Writes the resource to outName, creating missing parent directories.
+   * MZ_OPEN_ERROR	-111	outName can't be created
    */
   int32_t saveToFile(std::string resourcePath, std::string);
   int32_t getResourceSize(std::string resourcePath, long long &resourceSize);
   int32_t saveToMemory(std::string resourcePath, char *&buffer, long long resourceSize);
+  /* Read-only view of a stored (uncompressed) resource in the mapping. The
+   * view is valid while the reader is open.
+   * MZ_SUPPORT_ERROR	-109	the resource is compressed, use openStream
+   */
+  int32_t getView(std::string resourcePath, std::string_view &view);
+  /* Positions stream at the start of a resource for chunked reading.
+   * Entries only minizip can read are extracted whole first.
+   */
+  int32_t openStream(std::string resourcePath, ZipInflateStream &stream);
+  /* One resource on the calling thread, same rules as extractBatch.
+   * Thread safe.
+   */
+  std::shared_ptr<ZipPart> extractPart(std::string resourcePath) const;
+  /* Inflates resources concurrently on pool. Each worker thread keeps its
+   * own inflate state and reads the shared mapping, only entries the index
+   * can't read wait their turn on the minizip handle. Futures are in the
+   * order of resourcePathList, partCallback (optional) runs on the worker
+   * as each resource completes. The reader must stay open until every
+   * future is ready.
+   */
+  std::vector<std::future<std::shared_ptr<ZipPart>>>
+  extractBatch(const std::vector<std::string> &resourcePathList,
+               zip_part_cb_t partCallback = nullptr,
+               bookfiler::ThreadPool &pool = bookfiler::defaultThreadPool());
+  /* Central directory of the memory mapped archive. Lookups by part name go
+   * through the index instead of mz_zip_reader_locate_entry.
+   */
+  const ZipIndex &getIndex() const { return index; }
+  /* Counters of the document the archive belongs to, set before open */
+  void setMetrics(std::shared_ptr<bookfiler::DocumentMetrics> metrics_) {
+    metrics = std::move(metrics_);
+  }
+  bookfiler::DocumentMetrics *getMetrics() const { return metrics.get(); }
 
 private:
+  std::shared_ptr<ZipPart> extractPart(const ZipIndexEntry *entryPtr,
+                                       std::string resourcePath) const;
+  /* The whole resource through the minizip handle, under readerMutex */
+  std::shared_ptr<ZipPart> extractFallback(std::string resourcePath) const;
+  /* index.find, traced */
+  const ZipIndexEntry *locate(std::string_view resourcePath) const;
+
   int32_t err = MZ_OK;
   void *reader = nullptr;
+  // the minizip handle's current entry is shared, fallbacks take turns
+  mutable std::mutex readerMutex;
+  ZipIndex index;
+  std::shared_ptr<bookfiler::DocumentMetrics> metrics;
 };
 
 void zipFileEntryMapPrintAll(std::shared_ptr<ZipFileMap> zipFileMap);
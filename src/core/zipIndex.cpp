@@ -0,0 +1,352 @@
+// C++
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+/* zlib
+ * License: zlib
+ */
+#include <zlib.h>
+
+/* Minizip 2.7.0
+ * License: zlib
+ */
+#include "mz.h"
+
+// Local Project
+#include "zipIndex.hpp"
+
+namespace {
+
+const uint32_t localHeaderMagic = 0x04034b50;
+const uint32_t centralHeaderMagic = 0x02014b50;
+const uint32_t endHeaderMagic = 0x06054b50;
+const uint32_t zip64EndHeaderMagic = 0x06064b50;
+const uint32_t zip64EndLocatorMagic = 0x07064b50;
+const uint16_t zip64ExtraId = 0x0001;
+const uint64_t endHeaderSize = 22;
+const uint64_t centralHeaderSize = 46;
+const uint64_t localHeaderSize = 30;
+
+inline uint16_t readLE16(const unsigned char *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+inline uint32_t readLE32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+inline uint64_t readLE64(const unsigned char *p) {
+  return (uint64_t)readLE32(p) | ((uint64_t)readLE32(p + 4) << 32);
+}
+
+class RawInflater {
+public:
+  RawInflater() { std::memset(&zs, 0, sizeof(zs)); }
+  ~RawInflater() {
+    if (ready)
+      inflateEnd(&zs);
+  }
+  bool reset() {
+    if (ready)
+      return inflateReset(&zs) == Z_OK;
+    ready = inflateInit2(&zs, -MAX_WBITS) == Z_OK;
+    return ready;
+  }
+  z_stream zs;
+
+private:
+  bool ready = false;
+};
+
+} // namespace
+
+uint32_t zipIndexHash(std::string_view filePath) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (unsigned char c : filePath) {
+    hash ^= c;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+ZipIndex::ZipIndex() {}
+
+ZipIndex::~ZipIndex() {}
+
+int32_t ZipIndex::open(std::string fileName) {
+  std::shared_ptr<MappedFile> mappedFilePtr = std::make_shared<MappedFile>();
+  int32_t err = mappedFilePtr->open(fileName);
+  if (err != MZ_OK)
+    return err;
+  return open(mappedFilePtr);
+}
+
+int32_t ZipIndex::open(std::shared_ptr<const MappedFile> mappedFilePtr) {
+  close();
+  mappedFile = mappedFilePtr;
+  int32_t err = readCentralDirectory();
+  if (err != MZ_OK)
+    close();
+  return err;
+}
+
+void ZipIndex::close() {
+  mappedFile.reset();
+  entries.clear();
+  slots.clear();
+  slotMask = 0;
+  contentHash = 0;
+}
+
+int32_t ZipIndex::readCentralDirectory() {
+  const unsigned char *data = mappedFile->data();
+  uint64_t size = mappedFile->size();
+  if (size < endHeaderSize)
+    return MZ_FORMAT_ERROR;
+
+  /* The end of central directory record is followed by a comment of at most
+   * 64 KiB, so scan backwards for its signature
+   */
+  uint64_t endPos = size - endHeaderSize;
+  uint64_t scanStop = endPos > 0xFFFF ? endPos - 0xFFFF : 0;
+  while (readLE32(data + endPos) != endHeaderMagic) {
+    if (endPos == scanStop)
+      return MZ_FORMAT_ERROR;
+    endPos--;
+  }
+  const unsigned char *end = data + endPos;
+  if (readLE16(end + 4) != 0 || readLE16(end + 6) != 0)
+    return MZ_SUPPORT_ERROR; // split archive
+  uint64_t entryTotal = readLE16(end + 10);
+  uint64_t cdSize = readLE32(end + 12);
+  uint64_t cdOffset = readLE32(end + 16);
+
+  if (entryTotal == 0xFFFF || cdSize == 0xFFFFFFFF ||
+      cdOffset == 0xFFFFFFFF) {
+    if (endPos < 20 || readLE32(end - 20) != zip64EndLocatorMagic)
+      return MZ_FORMAT_ERROR;
+    uint64_t zip64EndPos = readLE64(end - 20 + 8);
+    if (zip64EndPos > size || size - zip64EndPos < 56 ||
+        readLE32(data + zip64EndPos) != zip64EndHeaderMagic)
+      return MZ_FORMAT_ERROR;
+    const unsigned char *zip64End = data + zip64EndPos;
+    entryTotal = readLE64(zip64End + 32);
+    cdSize = readLE64(zip64End + 40);
+    cdOffset = readLE64(zip64End + 48);
+  }
+  if (cdOffset > size || cdSize > size - cdOffset)
+    return MZ_FORMAT_ERROR;
+  // every record is at least centralHeaderSize bytes
+  if (entryTotal > cdSize / centralHeaderSize)
+    return MZ_FORMAT_ERROR;
+
+  entries.reserve((size_t)entryTotal);
+  uint64_t pos = cdOffset, cdEnd = cdOffset + cdSize;
+  for (uint64_t i = 0; i < entryTotal; i++) {
+    if (pos + centralHeaderSize > cdEnd ||
+        readLE32(data + pos) != centralHeaderMagic)
+      return MZ_FORMAT_ERROR;
+    const unsigned char *header = data + pos;
+    uint16_t nameSize = readLE16(header + 28);
+    uint16_t extraSize = readLE16(header + 30);
+    uint16_t commentSize = readLE16(header + 32);
+    if (pos + centralHeaderSize + nameSize + extraSize + commentSize > cdEnd)
+      return MZ_FORMAT_ERROR;
+
+    ZipIndexEntry entry;
+    entry.versionMadeBy = readLE16(header + 4);
+    entry.versionNeeded = readLE16(header + 6);
+    entry.flag = readLE16(header + 8);
+    entry.compressionMethod = readLE16(header + 10);
+    entry.dosDateTime = readLE32(header + 12);
+    entry.crc = readLE32(header + 16);
+    entry.compressedSize = readLE32(header + 20);
+    entry.uncompressedSize = readLE32(header + 24);
+    entry.externalAttributes = readLE32(header + 38);
+    entry.headerOffset = readLE32(header + 42);
+    entry.filePath = std::string_view(
+        (const char *)header + centralHeaderSize, nameSize);
+    entry.nameHash = zipIndexHash(entry.filePath);
+
+    /* zip64 extended information only holds the fields that overflowed,
+     * in a fixed order
+     */
+    const unsigned char *extra = header + centralHeaderSize + nameSize;
+    const unsigned char *extraEnd = extra + extraSize;
+    while (extra + 4 <= extraEnd) {
+      uint16_t extraId = readLE16(extra);
+      uint16_t fieldSize = readLE16(extra + 2);
+      const unsigned char *field = extra + 4;
+      const unsigned char *fieldEnd = field + fieldSize;
+      if (fieldEnd > extraEnd)
+        break;
+      if (extraId == zip64ExtraId) {
+        if (entry.uncompressedSize == 0xFFFFFFFF && field + 8 <= fieldEnd) {
+          entry.uncompressedSize = readLE64(field);
+          field += 8;
+        }
+        if (entry.compressedSize == 0xFFFFFFFF && field + 8 <= fieldEnd) {
+          entry.compressedSize = readLE64(field);
+          field += 8;
+        }
+        if (entry.headerOffset == 0xFFFFFFFF && field + 8 <= fieldEnd) {
+          entry.headerOffset = readLE64(field);
+          field += 8;
+        }
+      }
+      extra = fieldEnd;
+    }
+    entries.push_back(entry);
+    pos += centralHeaderSize + nameSize + extraSize + commentSize;
+  }
+
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const ZipIndexEntry &a, const ZipIndexEntry &b) {
+                     return a.filePath < b.filePath;
+                   });
+
+  size_t slotTotal = 16;
+  while (slotTotal < entries.size() * 2)
+    slotTotal <<= 1;
+  slots.assign(slotTotal, 0);
+  slotMask = (uint32_t)(slotTotal - 1);
+  for (size_t i = 0; i < entries.size(); i++) {
+    uint32_t slot = entries[i].nameHash & slotMask;
+    while (slots[slot] != 0)
+      slot = (slot + 1) & slotMask;
+    slots[slot] = (uint32_t)(i + 1);
+  }
+
+  // FNV-1a over what identifies the content, in path order
+  contentHash = 14695981039346656037ull;
+  auto hashBytes = [this](const void *bytes, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      contentHash ^= ((const unsigned char *)bytes)[i];
+      contentHash *= 1099511628211ull;
+    }
+  };
+  for (const ZipIndexEntry &entry : entries) {
+    hashBytes(entry.filePath.data(), entry.filePath.size());
+    hashBytes(&entry.crc, sizeof(entry.crc));
+    hashBytes(&entry.uncompressedSize, sizeof(entry.uncompressedSize));
+  }
+  return MZ_OK;
+}
+
+const ZipIndexEntry *ZipIndex::find(std::string_view filePath) const {
+  if (slots.empty())
+    return nullptr;
+  uint32_t hash = zipIndexHash(filePath);
+  uint32_t slot = hash & slotMask;
+  while (slots[slot] != 0) {
+    const ZipIndexEntry &entry = entries[slots[slot] - 1];
+    if (entry.nameHash == hash && entry.filePath == filePath)
+      return &entry;
+    slot = (slot + 1) & slotMask;
+  }
+  return nullptr;
+}
+
+int32_t ZipIndex::getDataOffset(const ZipIndexEntry &entry,
+                                uint64_t &offset) const {
+  const unsigned char *data = mappedFile->data();
+  uint64_t size = mappedFile->size();
+  if (entry.headerOffset > size || size - entry.headerOffset < localHeaderSize)
+    return MZ_FORMAT_ERROR;
+  const unsigned char *header = data + entry.headerOffset;
+  if (readLE32(header) != localHeaderMagic)
+    return MZ_FORMAT_ERROR;
+  offset = entry.headerOffset + localHeaderSize + readLE16(header + 26) +
+           readLE16(header + 28);
+  if (offset > size || size - offset < entry.compressedSize)
+    return MZ_FORMAT_ERROR;
+  return MZ_OK;
+}
+
+int32_t ZipIndex::extract(const ZipIndexEntry &entry, char *buffer,
+                          long long bufferSize) const {
+  if (entry.flag & MZ_ZIP_FLAG_ENCRYPTED)
+    return MZ_SUPPORT_ERROR;
+  if (entry.compressionMethod != MZ_COMPRESS_METHOD_STORE &&
+      entry.compressionMethod != MZ_COMPRESS_METHOD_DEFLATE)
+    return MZ_SUPPORT_ERROR;
+  if (bufferSize < 0 || (uint64_t)bufferSize < entry.uncompressedSize)
+    return MZ_BUF_ERROR;
+  uint64_t offset = 0;
+  int32_t err = getDataOffset(entry, offset);
+  if (err != MZ_OK)
+    return err;
+  const unsigned char *src = mappedFile->data() + offset;
+
+  if (entry.compressionMethod == MZ_COMPRESS_METHOD_STORE) {
+    if (entry.compressedSize != entry.uncompressedSize)
+      return MZ_FORMAT_ERROR;
+    std::memcpy(buffer, src, (size_t)entry.uncompressedSize);
+  } else {
+    /* inflate state (~40 KiB with its window) is kept per thread and reset
+     * between entries, so parallel extraction never shares or reallocates it
+     */
+    thread_local RawInflater inflater;
+    if (!inflater.reset())
+      return MZ_MEM_ERROR;
+    z_stream &zs = inflater.zs;
+    uint64_t inLeft = entry.compressedSize;
+    uint64_t outLeft = entry.uncompressedSize;
+    zs.next_in = (Bytef *)src;
+    zs.next_out = (Bytef *)buffer;
+    zs.avail_in = zs.avail_out = 0;
+    int zerr = Z_OK;
+    // zlib counts in uInt, feed large entries in pieces
+    while (zerr == Z_OK) {
+      if (zs.avail_in == 0) {
+        zs.avail_in = (uInt)std::min<uint64_t>(inLeft, UINT_MAX);
+        inLeft -= zs.avail_in;
+      }
+      if (zs.avail_out == 0) {
+        zs.avail_out = (uInt)std::min<uint64_t>(outLeft, UINT_MAX);
+        outLeft -= zs.avail_out;
+      }
+      zerr = inflate(&zs, Z_NO_FLUSH);
+      if (zerr == Z_BUF_ERROR && ((zs.avail_in == 0 && inLeft > 0) ||
+                                  (zs.avail_out == 0 && outLeft > 0)))
+        zerr = Z_OK;
+    }
+    if (zerr != Z_STREAM_END || outLeft != 0 || zs.avail_out != 0)
+      return MZ_DATA_ERROR;
+  }
+
+  uint32_t crc = (uint32_t)crc32(0L, Z_NULL, 0);
+  const unsigned char *crcPtr = (const unsigned char *)buffer;
+  uint64_t crcLeft = entry.uncompressedSize;
+  while (crcLeft > 0) {
+    uInt crcChunk = (uInt)std::min<uint64_t>(crcLeft, UINT_MAX);
+    crc = (uint32_t)crc32(crc, crcPtr, crcChunk);
+    crcPtr += crcChunk;
+    crcLeft -= crcChunk;
+  }
+  if (crc != entry.crc)
+    return MZ_CRC_ERROR;
+  return MZ_OK;
+}
+
+int32_t ZipIndex::getCompressedView(const ZipIndexEntry &entry,
+                                    std::string_view &view) const {
+  uint64_t offset = 0;
+  int32_t err = getDataOffset(entry, offset);
+  if (err != MZ_OK)
+    return err;
+  view = std::string_view((const char *)mappedFile->data() + offset,
+                          (size_t)entry.compressedSize);
+  return MZ_OK;
+}
+
+int32_t ZipIndex::getStoredView(const ZipIndexEntry &entry,
+                                std::string_view &view) const {
+  if ((entry.flag & MZ_ZIP_FLAG_ENCRYPTED) ||
+      entry.compressionMethod != MZ_COMPRESS_METHOD_STORE)
+    return MZ_SUPPORT_ERROR;
+  if (entry.compressedSize != entry.uncompressedSize)
+    return MZ_FORMAT_ERROR;
+  return getCompressedView(entry, view);
+}
@@ -0,0 +1,105 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_ZIP_INDEX_H
+#define BOOKFILER_MODULE_DOCX_ZIP_INDEX_H
+
+// C++
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes and constants
+ */
+#include "mz.h"
+
+// Local Project
+#include "mappedFile.hpp"
+
+/* ZipIndexEntry
+ * One central directory record. filePath points into the mapped archive, so
+ * an entry is only valid while the ZipIndex that produced it is alive.
+ */
+class ZipIndexEntry {
+public:
+  std::string_view filePath;
+  uint64_t compressedSize, uncompressedSize;
+  // offset of the local file header from the start of the archive
+  uint64_t headerOffset;
+  uint32_t crc, dosDateTime, nameHash;
+  uint16_t flag, compressionMethod;
+  // only listings use these, minizip reports the same fields
+  uint16_t versionMadeBy, versionNeeded;
+  uint32_t externalAttributes;
+};
+
+/* ZipIndex
+ * Flat, sorted table of the central directory of a memory mapped archive.
+ * The central directory is parsed once on open; lookups by part name are a
+ * hash probe and never touch the archive again.
+ */
+class ZipIndex {
+public:
+  ZipIndex();
+  ~ZipIndex();
+  /* Maps the file and parses the central directory
+   * @return MZ_OK, MZ_OPEN_ERROR, MZ_FORMAT_ERROR or MZ_SUPPORT_ERROR for
+   * split archives
+   */
+  int32_t open(std::string fileName);
+  int32_t open(std::shared_ptr<const MappedFile> mappedFilePtr);
+  void close();
+
+  bool isOpen() const { return mappedFile != nullptr; }
+  /* @return nullptr when no entry has exactly this path */
+  const ZipIndexEntry *find(std::string_view filePath) const;
+  /* Entries sorted by filePath */
+  const std::vector<ZipIndexEntry> &getEntries() const { return entries; }
+  std::shared_ptr<const MappedFile> getMappedFile() const {
+    return mappedFile;
+  }
+  /* Hash of every entry's path, CRC and size. Equal archives hash equal
+   * however they were compressed or ordered, 0 when closed.
+   */
+  uint64_t getContentHash() const { return contentHash; }
+  /* Resolves the local file header to the first byte of the entry data */
+  int32_t getDataOffset(const ZipIndexEntry &entry, uint64_t &offset) const;
+  /* Decompresses an entry straight from the mapping.
+   * @return MZ_SUPPORT_ERROR for encrypted entries and methods other than
+   * store and deflate, so the caller can fall back to minizip
+   */
+  int32_t extract(const ZipIndexEntry &entry, char *buffer,
+                  long long bufferSize) const;
+  /* View of the entry data as stored in the archive, no copy is made */
+  int32_t getCompressedView(const ZipIndexEntry &entry,
+                            std::string_view &view) const;
+  /* View of a stored entry's contents, no copy is made. The CRC is not
+   * checked.
+   * @return MZ_SUPPORT_ERROR if the entry is compressed or encrypted
+   */
+  int32_t getStoredView(const ZipIndexEntry &entry,
+                        std::string_view &view) const;
+
+private:
+  int32_t readCentralDirectory();
+
+  std::shared_ptr<const MappedFile> mappedFile;
+  std::vector<ZipIndexEntry> entries;
+  /* open addressing table of entry index + 1, 0 is an empty slot */
+  std::vector<uint32_t> slots;
+  uint32_t slotMask = 0;
+  uint64_t contentHash = 0;
+};
+
+uint32_t zipIndexHash(std::string_view filePath);
+
+#endif // BOOKFILER_MODULE_DOCX_ZIP_INDEX_H
@@ -0,0 +1,158 @@
+// C++
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+/* zlib
+ * License: zlib
+ */
+#include <zlib.h>
+
+/* Minizip 2.7.0
+ * License: zlib
+ */
+#include "mz.h"
+
+// Local Project
+#include "zipStream.hpp"
+
+ZipInflateStream::ZipInflateStream(size_t chunkSize_)
+    : chunkSize(chunkSize_ > 0 ? chunkSize_ : 64 * 1024) {}
+
+ZipInflateStream::~ZipInflateStream() {
+  if (zstream) {
+    inflateEnd((z_stream *)zstream);
+    delete (z_stream *)zstream;
+  }
+}
+
+int32_t ZipInflateStream::open(const ZipIndex &index,
+                               const ZipIndexEntry &entry) {
+  close();
+  if (entry.flag & MZ_ZIP_FLAG_ENCRYPTED)
+    return MZ_SUPPORT_ERROR;
+  if (entry.compressionMethod != MZ_COMPRESS_METHOD_STORE &&
+      entry.compressionMethod != MZ_COMPRESS_METHOD_DEFLATE)
+    return MZ_SUPPORT_ERROR;
+  std::string_view compressedView;
+  int32_t err = index.getCompressedView(entry, compressedView);
+  if (err != MZ_OK)
+    return err;
+  if (entry.compressionMethod == MZ_COMPRESS_METHOD_STORE &&
+      entry.compressedSize != entry.uncompressedSize)
+    return MZ_FORMAT_ERROR;
+
+  mappedFile = index.getMappedFile();
+  src = (const unsigned char *)compressedView.data();
+  srcLeft = compressedView.size();
+  uncompressedSize = entry.uncompressedSize;
+  expectedCrc = entry.crc;
+  compressionMethod = entry.compressionMethod;
+
+  if (compressionMethod == MZ_COMPRESS_METHOD_DEFLATE) {
+    z_stream *zs = (z_stream *)zstream;
+    if (!zs) {
+      zs = new z_stream;
+      std::memset(zs, 0, sizeof(z_stream));
+      if (inflateInit2(zs, -MAX_WBITS) != Z_OK) {
+        delete zs;
+        return MZ_MEM_ERROR;
+      }
+      zstream = zs;
+    } else {
+      inflateReset(zs);
+    }
+    chunkBuffer.resize(chunkSize);
+  }
+  return MZ_OK;
+}
+
+int32_t ZipInflateStream::open(std::shared_ptr<unsigned char> buffer_,
+                               size_t size) {
+  close();
+  if (!buffer_)
+    return MZ_PARAM_ERROR;
+  buffer = std::move(buffer_);
+  src = buffer.get();
+  srcLeft = uncompressedSize = size;
+  // checked by whoever extracted it, read() then checks it matches
+  expectedCrc = (uint32_t)crc32(crc, src, (uInt)size);
+  compressionMethod = MZ_COMPRESS_METHOD_STORE;
+  return MZ_OK;
+}
+
+void ZipInflateStream::close() {
+  mappedFile.reset();
+  buffer.reset();
+  src = nullptr;
+  srcLeft = totalOut = uncompressedSize = 0;
+  expectedCrc = 0;
+  crc = (uint32_t)crc32(0L, Z_NULL, 0);
+  streamEnd = false;
+  /* A partly read entry leaves input pointing into the mapping just
+   * released, the next entry must not inflate it
+   */
+  if (zstream) {
+    z_stream *zs = (z_stream *)zstream;
+    zs->next_in = zs->next_out = Z_NULL;
+    zs->avail_in = zs->avail_out = 0;
+  }
+}
+
+int32_t ZipInflateStream::finish() {
+  if (totalOut != uncompressedSize)
+    return MZ_DATA_ERROR;
+  if (crc != expectedCrc)
+    return MZ_CRC_ERROR;
+  return MZ_END_OF_STREAM;
+}
+
+int32_t ZipInflateStream::read(std::string_view &chunk) {
+  chunk = std::string_view();
+  if (!mappedFile && !buffer)
+    return MZ_PARAM_ERROR;
+
+  if (compressionMethod == MZ_COMPRESS_METHOD_STORE) {
+    if (srcLeft == 0)
+      return finish();
+    size_t chunkLength = (size_t)std::min<uint64_t>(srcLeft, chunkSize);
+    chunk = std::string_view((const char *)src, chunkLength);
+    crc = (uint32_t)crc32(crc, src, (uInt)chunkLength);
+    src += chunkLength;
+    srcLeft -= chunkLength;
+    totalOut += chunkLength;
+    return MZ_OK;
+  }
+
+  if (streamEnd)
+    return finish();
+  z_stream *zs = (z_stream *)zstream;
+  zs->next_out = (Bytef *)chunkBuffer.data();
+  zs->avail_out = (uInt)chunkBuffer.size();
+  while (zs->avail_out > 0) {
+    if (zs->avail_in == 0 && srcLeft > 0) {
+      zs->next_in = (Bytef *)src;
+      zs->avail_in = (uInt)std::min<uint64_t>(srcLeft, UINT_MAX);
+      src += zs->avail_in;
+      srcLeft -= zs->avail_in;
+    }
+    int zerr = inflate(zs, Z_NO_FLUSH);
+    if (zerr == Z_STREAM_END) {
+      streamEnd = true;
+      break;
+    }
+    if (zerr == Z_BUF_ERROR && zs->avail_in == 0 && srcLeft == 0)
+      return MZ_DATA_ERROR; // truncated
+    if (zerr != Z_OK && zerr != Z_BUF_ERROR)
+      return MZ_DATA_ERROR;
+  }
+  size_t chunkLength = chunkBuffer.size() - zs->avail_out;
+  if (chunkLength == 0)
+    return finish();
+  chunk = std::string_view(chunkBuffer.data(), chunkLength);
+  crc = (uint32_t)crc32(crc, (const Bytef *)chunk.data(), (uInt)chunkLength);
+  totalOut += chunkLength;
+  if (totalOut > uncompressedSize)
+    return MZ_DATA_ERROR;
+  return MZ_OK;
+}
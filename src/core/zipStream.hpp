@@ -0,0 +1,70 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_ZIP_STREAM_H
+#define BOOKFILER_MODULE_DOCX_ZIP_STREAM_H
+
+// C++
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Local Project
+#include "zipIndex.hpp"
+
+/* ZipInflateStream
+ * Pull based reader over one archive entry. Stored entries are handed out as
+ * views into the mapping, deflated entries are inflated into a fixed size
+ * chunk buffer, so memory use does not depend on the entry size.
+ *   while ((err = stream.read(chunk)) == MZ_OK) { ... }
+ * The zlib state is reused when the stream is opened on another entry.
+ */
+class ZipInflateStream {
+public:
+  ZipInflateStream(size_t chunkSize = 64 * 1024);
+  ~ZipInflateStream();
+  ZipInflateStream(const ZipInflateStream &) = delete;
+  ZipInflateStream &operator=(const ZipInflateStream &) = delete;
+
+  /* The stream holds a reference to the mapping, the index may be closed
+   * @return MZ_SUPPORT_ERROR for encrypted entries and methods other than
+   * store and deflate
+   */
+  int32_t open(const ZipIndex &index, const ZipIndexEntry &entry);
+  /* Over an entry already extracted into buffer, e.g. by minizip for one
+   * the index can't read. The stream holds a reference to the buffer.
+   */
+  int32_t open(std::shared_ptr<unsigned char> buffer, size_t size);
+  void close();
+  /* chunk stays valid until the next call to read() or open()
+   * @return MZ_OK with a non empty chunk, MZ_END_OF_STREAM once the entry is
+   * exhausted and its CRC matched, otherwise MZ_DATA_ERROR or MZ_CRC_ERROR
+   */
+  int32_t read(std::string_view &chunk);
+  uint64_t getTotalOut() const { return totalOut; }
+  uint64_t getUncompressedSize() const { return uncompressedSize; }
+
+private:
+  int32_t finish();
+
+  size_t chunkSize;
+  std::shared_ptr<const MappedFile> mappedFile;
+  // what src points into when opened on a buffer instead of the mapping
+  std::shared_ptr<unsigned char> buffer;
+  const unsigned char *src = nullptr;
+  uint64_t srcLeft = 0, totalOut = 0, uncompressedSize = 0;
+  uint32_t expectedCrc = 0, crc = 0;
+  uint16_t compressionMethod = 0;
+  bool streamEnd = false;
+  // z_stream, kept opaque so zlib.h stays out of the header
+  void *zstream = nullptr;
+  std::vector<char> chunkBuffer;
+};
+
+#endif // BOOKFILER_MODULE_DOCX_ZIP_STREAM_H
@@ -0,0 +1,579 @@
+// C
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// C++
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/* zlib
+ * License: zlib
+ */
+#include <zlib.h>
+
+// Local Project
+#include "zipWriter.hpp"
+
+namespace {
+
+const uint32_t localHeaderMagic = 0x04034b50;
+const uint32_t centralHeaderMagic = 0x02014b50;
+const uint32_t endHeaderMagic = 0x06054b50;
+const uint32_t zip64EndHeaderMagic = 0x06064b50;
+const uint32_t zip64EndLocatorMagic = 0x07064b50;
+const uint16_t zip64ExtraId = 0x0001;
+const uint16_t versionDefault = 20;
+const uint16_t versionZip64 = 45;
+// sizes and CRC follow the data, never the case for what is written here
+const uint16_t flagDataDescriptor = 0x0008;
+const uint16_t flagUtf8 = 0x0800;
+const uint64_t zip32Max = 0xFFFFFFFF;
+// deflate's window, what each block is primed with
+const size_t dictionarySize = 32 * 1024;
+// header bytes are gathered up to this, larger writes go straight through
+const size_t pendingMax = 64 * 1024;
+
+void putLE16(std::vector<char> &out, uint16_t value) {
+  out.push_back((char)(value & 0xFF));
+  out.push_back((char)(value >> 8));
+}
+void putLE32(std::vector<char> &out, uint32_t value) {
+  putLE16(out, (uint16_t)(value & 0xFFFF));
+  putLE16(out, (uint16_t)(value >> 16));
+}
+void putLE64(std::vector<char> &out, uint64_t value) {
+  putLE32(out, (uint32_t)(value & 0xFFFFFFFF));
+  putLE32(out, (uint32_t)(value >> 32));
+}
+
+uint32_t dosDateTimeNow() {
+  std::time_t now = std::time(nullptr);
+  std::tm local;
+#ifdef _WIN32
+  localtime_s(&local, &now);
+#else
+  localtime_r(&now, &local);
+#endif
+  if (local.tm_year < 80)
+    return (1 << 21) | (1 << 16); // 1980-01-01
+  return (uint32_t)(local.tm_year - 80) << 25 |
+         (uint32_t)(local.tm_mon + 1) << 21 | (uint32_t)local.tm_mday << 16 |
+         (uint32_t)local.tm_hour << 11 | (uint32_t)local.tm_min << 5 |
+         (uint32_t)(local.tm_sec / 2);
+}
+
+bool isAscii(std::string_view text) {
+  for (unsigned char c : text) {
+    if (c >= 0x80)
+      return false;
+  }
+  return true;
+}
+
+class RawDeflater {
+public:
+  RawDeflater() { std::memset(&zs, 0, sizeof(zs)); }
+  ~RawDeflater() {
+    if (ready)
+      deflateEnd(&zs);
+  }
+  bool reset(int level_) {
+    if (ready && level == level_)
+      return deflateReset(&zs) == Z_OK;
+    if (ready)
+      deflateEnd(&zs);
+    level = level_;
+    ready = deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK;
+    return ready;
+  }
+  z_stream zs;
+
+private:
+  bool ready = false;
+  int level = 0;
+};
+
+class DeflateBlock {
+public:
+  std::string_view input, dictionary;
+  bool last = false;
+  std::vector<char> output;
+  uint32_t crc = 0;
+  int32_t err = MZ_OK;
+  // under DeflateJob::mutex
+  bool done = false;
+};
+
+/* One raw deflate stream per block, ended on a byte boundary with a sync
+ * flush unless it is the last of its part
+ */
+int32_t deflateBlock(DeflateBlock &block, int level) {
+  // reset between blocks, so workers never reallocate the deflate state
+  thread_local RawDeflater deflater;
+  if (!deflater.reset(level))
+    return MZ_MEM_ERROR;
+  z_stream &zs = deflater.zs;
+  if (!block.dictionary.empty() &&
+      deflateSetDictionary(&zs, (const Bytef *)block.dictionary.data(),
+                           (uInt)block.dictionary.size()) != Z_OK)
+    return MZ_MEM_ERROR;
+  // room for the sync flush's empty stored block on top of the bound
+  block.output.resize(deflateBound(&zs, (uLong)block.input.size()) + 16);
+  zs.next_in = (Bytef *)block.input.data();
+  zs.avail_in = (uInt)block.input.size();
+  zs.next_out = (Bytef *)block.output.data();
+  zs.avail_out = (uInt)block.output.size();
+  int zerr = deflate(&zs, block.last ? Z_FINISH : Z_SYNC_FLUSH);
+  if (zerr != (block.last ? Z_STREAM_END : Z_OK) || zs.avail_in != 0)
+    return MZ_STREAM_ERROR;
+  block.output.resize(block.output.size() - zs.avail_out);
+  block.crc = (uint32_t)crc32(crc32(0L, Z_NULL, 0),
+                              (const Bytef *)block.input.data(),
+                              (uInt)block.input.size());
+  return MZ_OK;
+}
+
+/* DeflateJob
+ * Blocks of one or more parts, claimed in order by pool workers and by the
+ * thread waiting for them. Helpers that start after every block was claimed
+ * return without touching the data the blocks point into.
+ */
+class DeflateJob {
+public:
+  explicit DeflateJob(int level_) : level(level_) {}
+
+  /* Splits data into blocks, [begin, end) in blockList */
+  void addPart(std::string_view data, size_t blockSize, size_t &begin,
+               size_t &end) {
+    begin = blockList.size();
+    size_t position = 0;
+    do {
+      DeflateBlock block;
+      block.input = data.substr(position, blockSize);
+      size_t primed = std::min(position, dictionarySize);
+      block.dictionary = data.substr(position - primed, primed);
+      position += block.input.size();
+      block.last = position == data.size();
+      blockList.push_back(std::move(block));
+    } while (position < data.size());
+    end = blockList.size();
+  }
+  static void start(const std::shared_ptr<DeflateJob> &job,
+                    bookfiler::ThreadPool &pool, size_t helperTotal) {
+    for (size_t i = 0; i < helperTotal; i++)
+      pool.submit([job]() { job->work(SIZE_MAX); });
+  }
+  /* Deflates claimed blocks until one at or past end is done */
+  void work(size_t end) {
+    size_t blockIndex;
+    while ((blockIndex = next.fetch_add(1)) < blockList.size()) {
+      DeflateBlock &block = blockList[blockIndex];
+      int32_t blockErr = deflateBlock(block, level);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        block.err = blockErr;
+        block.done = true;
+      }
+      blockDone.notify_all();
+      if (blockIndex + 1 >= end)
+        break;
+    }
+  }
+  /* Helps until [begin, end) is claimed, then waits for it */
+  void wait(size_t begin, size_t end) {
+    work(end);
+    std::unique_lock<std::mutex> lock(mutex);
+    blockDone.wait(lock, [&]() {
+      for (size_t i = begin; i < end; i++) {
+        if (!blockList[i].done)
+          return false;
+      }
+      return true;
+    });
+  }
+  /* Moves the output of finished blocks [begin, end) into part */
+  int32_t collect(size_t begin, size_t end, ZipDeflatedPart &part) {
+    part = ZipDeflatedPart();
+    part.crc = (uint32_t)crc32(0L, Z_NULL, 0);
+    for (size_t i = begin; i < end; i++) {
+      DeflateBlock &block = blockList[i];
+      if (block.err != MZ_OK)
+        return block.err;
+      part.crc = (uint32_t)crc32_combine(part.crc, block.crc,
+                                         (z_off_t)block.input.size());
+      part.compressedSize += block.output.size();
+      part.uncompressedSize += block.input.size();
+      part.blockList.push_back(std::move(block.output));
+    }
+    return MZ_OK;
+  }
+
+  std::vector<DeflateBlock> blockList;
+
+private:
+  int level;
+  std::atomic<size_t> next{0};
+  std::mutex mutex;
+  std::condition_variable blockDone;
+};
+
+} // namespace
+
+ZipFdSink::~ZipFdSink() { close(); }
+
+#ifdef _WIN32
+int32_t ZipFdSink::open(std::string fileName) {
+  close();
+  int wideSize =
+      MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, nullptr, 0);
+  std::wstring wideName(wideSize, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, &wideName[0],
+                      wideSize);
+  fd = _wopen(wideName.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+              _S_IREAD | _S_IWRITE);
+  if (fd < 0)
+    return MZ_OPEN_ERROR;
+  owned = true;
+  return MZ_OK;
+}
+
+int32_t ZipFdSink::close() {
+  int32_t err = MZ_OK;
+  if (owned && fd >= 0 && _close(fd) != 0)
+    err = MZ_CLOSE_ERROR;
+  if (owned)
+    fd = -1;
+  owned = false;
+  return err;
+}
+
+int32_t ZipFdSink::write(const char *data, size_t size) {
+  while (size > 0) {
+    int written =
+        _write(fd, data, (unsigned int)std::min<size_t>(size, INT_MAX));
+    if (written <= 0)
+      return MZ_WRITE_ERROR;
+    data += written;
+    size -= (size_t)written;
+  }
+  return MZ_OK;
+}
+#else
+int32_t ZipFdSink::open(std::string fileName) {
+  close();
+  fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+              0666);
+  if (fd < 0)
+    return MZ_OPEN_ERROR;
+  owned = true;
+  return MZ_OK;
+}
+
+int32_t ZipFdSink::close() {
+  int32_t err = MZ_OK;
+  if (owned && fd >= 0 && ::close(fd) != 0)
+    err = MZ_CLOSE_ERROR;
+  if (owned)
+    fd = -1;
+  owned = false;
+  return err;
+}
+
+int32_t ZipFdSink::write(const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return MZ_WRITE_ERROR;
+    data += written;
+    size -= (size_t)written;
+  }
+  return MZ_OK;
+}
+#endif
+
+int32_t ZipMemorySink::write(const char *data, size_t size) {
+  buffer.insert(buffer.end(), data, data + size);
+  return MZ_OK;
+}
+
+int32_t zipDeflate(std::string_view data, int level, ZipDeflatedPart &part,
+                   bookfiler::ThreadPool &pool, size_t blockSize) {
+  if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION)
+    return MZ_PARAM_ERROR;
+  // zlib counts a block's bytes in uInt
+  blockSize = std::min<size_t>(blockSize ? blockSize : zipDeflateBlockSize,
+                               (size_t)1 << 30);
+  auto job = std::make_shared<DeflateJob>(level);
+  size_t begin, end;
+  job->addPart(data, blockSize, begin, end);
+  DeflateJob::start(job, pool, std::min(pool.size(), end) - 1);
+  job->wait(begin, end);
+  return job->collect(begin, end, part);
+}
+
+ZipWriter::ZipWriter(ZipSink &sink_) : sink(sink_) {}
+
+int32_t ZipWriter::copyEntry(const ZipIndex &index,
+                             const ZipIndexEntry &entry) {
+  if (entry.flag & MZ_ZIP_FLAG_ENCRYPTED)
+    return MZ_SUPPORT_ERROR;
+  std::string_view compressedView;
+  int32_t copyErr = index.getCompressedView(entry, compressedView);
+  if (copyErr != MZ_OK)
+    return copyErr;
+  copyErr = writeHeader({std::string(entry.filePath), entry.compressedSize,
+                         entry.uncompressedSize, 0, entry.crc,
+                         entry.dosDateTime,
+                         (uint16_t)(entry.flag & ~flagDataDescriptor),
+                         entry.compressionMethod});
+  if (copyErr != MZ_OK)
+    return copyErr;
+  return put(compressedView.data(), compressedView.size());
+}
+
+int32_t ZipWriter::addPart(std::string_view filePath,
+                           const ZipDeflatedPart &part,
+                           uint32_t dosDateTime) {
+  int32_t partErr = writeHeader(
+      {std::string(filePath), part.compressedSize, part.uncompressedSize, 0,
+       part.crc, dosDateTime ? dosDateTime : dosDateTimeNow(),
+       isAscii(filePath) ? (uint16_t)0 : flagUtf8,
+       MZ_COMPRESS_METHOD_DEFLATE});
+  for (const std::vector<char> &block : part.blockList) {
+    if (partErr != MZ_OK)
+      break;
+    partErr = put(block.data(), block.size());
+  }
+  return partErr;
+}
+
+int32_t ZipWriter::writeHeader(Record record) {
+  if (finished)
+    return MZ_PARAM_ERROR;
+  if (record.filePath.size() > 0xFFFF)
+    return MZ_PARAM_ERROR;
+  record.headerOffset = getBytesWritten();
+  bool zip64 = record.compressedSize >= zip32Max ||
+               record.uncompressedSize >= zip32Max;
+  std::vector<char> header;
+  header.reserve(30 + record.filePath.size() + 20);
+  putLE32(header, localHeaderMagic);
+  putLE16(header, zip64 ? versionZip64 : versionDefault);
+  putLE16(header, record.flag);
+  putLE16(header, record.compressionMethod);
+  putLE32(header, record.dosDateTime);
+  putLE32(header, record.crc);
+  putLE32(header, zip64 ? (uint32_t)zip32Max : (uint32_t)record.compressedSize);
+  putLE32(header,
+          zip64 ? (uint32_t)zip32Max : (uint32_t)record.uncompressedSize);
+  putLE16(header, (uint16_t)record.filePath.size());
+  putLE16(header, zip64 ? 20 : 0);
+  header.insert(header.end(), record.filePath.begin(), record.filePath.end());
+  if (zip64) {
+    putLE16(header, zip64ExtraId);
+    putLE16(header, 16);
+    putLE64(header, record.uncompressedSize);
+    putLE64(header, record.compressedSize);
+  }
+  recordList.push_back(std::move(record));
+  return put(header.data(), header.size());
+}
+
+int32_t ZipWriter::finish() {
+  if (finished)
+    return MZ_PARAM_ERROR;
+  uint64_t directoryOffset = getBytesWritten();
+  std::vector<char> header;
+  for (const Record &record : recordList) {
+    header.clear();
+    // zip64 extended information holds only the fields that overflow
+    std::vector<char> extra;
+    if (record.uncompressedSize >= zip32Max)
+      putLE64(extra, record.uncompressedSize);
+    if (record.compressedSize >= zip32Max)
+      putLE64(extra, record.compressedSize);
+    if (record.headerOffset >= zip32Max)
+      putLE64(extra, record.headerOffset);
+    uint16_t version = extra.empty() ? versionDefault : versionZip64;
+    putLE32(header, centralHeaderMagic);
+    putLE16(header, version);
+    putLE16(header, version);
+    putLE16(header, record.flag);
+    putLE16(header, record.compressionMethod);
+    putLE32(header, record.dosDateTime);
+    putLE32(header, record.crc);
+    putLE32(header, (uint32_t)std::min(record.compressedSize, zip32Max));
+    putLE32(header, (uint32_t)std::min(record.uncompressedSize, zip32Max));
+    putLE16(header, (uint16_t)record.filePath.size());
+    putLE16(header, extra.empty() ? 0 : (uint16_t)(extra.size() + 4));
+    putLE16(header, 0); // comment
+    putLE16(header, 0); // disk
+    putLE16(header, 0); // internal attributes
+    putLE32(header, 0); // external attributes
+    putLE32(header, (uint32_t)std::min(record.headerOffset, zip32Max));
+    header.insert(header.end(), record.filePath.begin(),
+                  record.filePath.end());
+    if (!extra.empty()) {
+      putLE16(header, zip64ExtraId);
+      putLE16(header, (uint16_t)extra.size());
+      header.insert(header.end(), extra.begin(), extra.end());
+    }
+    int32_t finishErr = put(header.data(), header.size());
+    if (finishErr != MZ_OK)
+      return finishErr;
+  }
+  uint64_t directorySize = getBytesWritten() - directoryOffset;
+  uint64_t entryTotal = recordList.size();
+
+  header.clear();
+  if (entryTotal >= 0xFFFF || directorySize >= zip32Max ||
+      directoryOffset >= zip32Max) {
+    uint64_t zip64EndOffset = getBytesWritten();
+    putLE32(header, zip64EndHeaderMagic);
+    putLE64(header, 44); // size of the rest of the record
+    putLE16(header, versionZip64);
+    putLE16(header, versionZip64);
+    putLE32(header, 0); // disk
+    putLE32(header, 0); // disk with the central directory
+    putLE64(header, entryTotal);
+    putLE64(header, entryTotal);
+    putLE64(header, directorySize);
+    putLE64(header, directoryOffset);
+    putLE32(header, zip64EndLocatorMagic);
+    putLE32(header, 0);
+    putLE64(header, zip64EndOffset);
+    putLE32(header, 1); // disks
+  }
+  putLE32(header, endHeaderMagic);
+  putLE16(header, 0);
+  putLE16(header, 0);
+  putLE16(header, (uint16_t)std::min<uint64_t>(entryTotal, 0xFFFF));
+  putLE16(header, (uint16_t)std::min<uint64_t>(entryTotal, 0xFFFF));
+  putLE32(header, (uint32_t)std::min(directorySize, zip32Max));
+  putLE32(header, (uint32_t)std::min(directoryOffset, zip32Max));
+  putLE16(header, 0); // comment
+  int32_t finishErr = put(header.data(), header.size());
+  if (finishErr == MZ_OK)
+    finishErr = flush();
+  finished = true;
+  return finishErr;
+}
+
+int32_t ZipWriter::put(const char *data, size_t size) {
+  if (err != MZ_OK)
+    return err;
+  if (size < pendingMax) {
+    pending.insert(pending.end(), data, data + size);
+    return pending.size() >= pendingMax ? flush() : MZ_OK;
+  }
+  if (flush() != MZ_OK)
+    return err;
+  err = sink.write(data, size);
+  offset += size;
+  return err;
+}
+
+int32_t ZipWriter::flush() {
+  if (err != MZ_OK || pending.empty())
+    return err;
+  err = sink.write(pending.data(), pending.size());
+  offset += pending.size();
+  pending.clear();
+  return err;
+}
+
+int32_t zipRewrite(const ZipIndex &source,
+                   const std::vector<ZipReplacement> &replacementList,
+                   ZipSink &sink, int level, bookfiler::ThreadPool &pool) {
+  if (!source.isOpen() || level < Z_DEFAULT_COMPRESSION ||
+      level > Z_BEST_COMPRESSION)
+    return MZ_PARAM_ERROR;
+  // the last replacement of a path wins
+  std::unordered_map<std::string_view, const ZipReplacement *> replacementMap;
+  for (const ZipReplacement &replacement : replacementList)
+    replacementMap[replacement.filePath] = &replacement;
+
+  class Item {
+  public:
+    const ZipIndexEntry *entry;
+    const ZipReplacement *replacement;
+    size_t blockBegin, blockEnd;
+  };
+  std::vector<const ZipIndexEntry *> entryList;
+  for (const ZipIndexEntry &entry : source.getEntries())
+    entryList.push_back(&entry);
+  std::sort(entryList.begin(), entryList.end(),
+            [](const ZipIndexEntry *a, const ZipIndexEntry *b) {
+              return a->headerOffset < b->headerOffset;
+            });
+  auto job = std::make_shared<DeflateJob>(level);
+  std::vector<Item> itemList;
+  for (const ZipIndexEntry *entry : entryList) {
+    auto replacementIt = replacementMap.find(entry->filePath);
+    if (replacementIt == replacementMap.end()) {
+      itemList.push_back({entry, nullptr, 0, 0});
+      continue;
+    }
+    const ZipReplacement *replacement = replacementIt->second;
+    replacementMap.erase(replacementIt);
+    if (replacement->remove)
+      continue;
+    Item item{entry, replacement, 0, 0};
+    job->addPart(replacement->data, zipDeflateBlockSize, item.blockBegin,
+                 item.blockEnd);
+    itemList.push_back(item);
+  }
+  // what is left is new, in the order it was given
+  for (const ZipReplacement &replacement : replacementList) {
+    auto replacementIt = replacementMap.find(replacement.filePath);
+    if (replacementIt == replacementMap.end() ||
+        replacementIt->second != &replacement || replacement.remove)
+      continue;
+    Item item{nullptr, &replacement, 0, 0};
+    job->addPart(replacement.data, zipDeflateBlockSize, item.blockBegin,
+                 item.blockEnd);
+    itemList.push_back(item);
+  }
+
+  // replaced parts deflate while the rest is copied
+  DeflateJob::start(job, pool, std::min(pool.size(), job->blockList.size()));
+  ZipWriter writer(sink);
+  int32_t rewriteErr = MZ_OK;
+  for (const Item &item : itemList) {
+    if (!item.replacement) {
+      rewriteErr = writer.copyEntry(source, *item.entry);
+    } else {
+      job->wait(item.blockBegin, item.blockEnd);
+      ZipDeflatedPart part;
+      rewriteErr = job->collect(item.blockBegin, item.blockEnd, part);
+      if (rewriteErr == MZ_OK)
+        rewriteErr = writer.addPart(item.replacement->filePath, part,
+                                    item.entry ? item.entry->dosDateTime : 0);
+    }
+    if (rewriteErr != MZ_OK)
+      break;
+  }
+  // blocks still deflating point into replacementList
+  job->wait(0, job->blockList.size());
+  if (rewriteErr == MZ_OK)
+    rewriteErr = writer.finish();
+  return rewriteErr;
+}
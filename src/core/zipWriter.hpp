@@ -0,0 +1,171 @@
+/*
+ * @name Bookfiler™ Docx Module
+ * @author Branden Lee
+ * @version 1.00
+ * @license MIT
+ * @brief docx manipulation.
+ */
+
+#ifndef BOOKFILER_MODULE_DOCX_ZIP_WRITER_H
+#define BOOKFILER_MODULE_DOCX_ZIP_WRITER_H
+
+// C++
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Minizip 2.7.0
+ * License: zlib
+ * Only for the MZ_ error codes and constants
+ */
+#include "mz.h"
+
+// Local Project
+#include "threadPool.hpp"
+#include "zipIndex.hpp"
+
+/* ZipSink
+ * Where a ZipWriter's bytes go. write takes every byte or fails.
+ */
+class ZipSink {
+public:
+  virtual ~ZipSink() {}
+  /* @return MZ_OK or MZ_WRITE_ERROR */
+  virtual int32_t write(const char *data, size_t size) = 0;
+};
+
+/* ZipFdSink
+ * Writes to a file descriptor the caller owns, or to a file it opens
+ * itself and closes when destroyed.
+ */
+class ZipFdSink : public ZipSink {
+public:
+  ZipFdSink() {}
+  explicit ZipFdSink(int fd_) : fd(fd_) {}
+  ~ZipFdSink();
+  ZipFdSink(const ZipFdSink &) = delete;
+  ZipFdSink &operator=(const ZipFdSink &) = delete;
+
+  /* Creates or truncates a UTF8 encoded path
+   * @return MZ_OK or MZ_OPEN_ERROR
+   */
+  int32_t open(std::string fileName);
+  /* Closes a file open() opened, a borrowed descriptor is left open
+   * @return MZ_OK or MZ_CLOSE_ERROR
+   */
+  int32_t close();
+  int32_t write(const char *data, size_t size) override;
+
+private:
+  int fd = -1;
+  bool owned = false;
+};
+
+/* ZipMemorySink
+ * Appends everything to buffer
+ */
+class ZipMemorySink : public ZipSink {
+public:
+  int32_t write(const char *data, size_t size) override;
+
+  std::vector<char> buffer;
+};
+
+/* ZipDeflatedPart
+ * A part compressed for an archive. The raw deflate stream is split in
+ * blocks as they were compressed, written one after another.
+ */
+class ZipDeflatedPart {
+public:
+  std::vector<std::vector<char>> blockList;
+  uint64_t compressedSize = 0, uncompressedSize = 0;
+  uint32_t crc = 0;
+};
+
+/* ZipReplacement
+ * New contents of a part when rewriting an archive, or its removal
+ */
+class ZipReplacement {
+public:
+  std::string filePath, data;
+  bool remove = false;
+};
+
+/* Parts of at least two blocks are split and the blocks deflated in
+ * parallel
+ */
+const size_t zipDeflateBlockSize = 256 * 1024;
+
+/* Deflates data on pool in blocks of blockSize, the calling thread taking
+ * blocks too. Each block is primed with the 32 KiB of data before it and
+ * ends on a byte boundary, so the blocks together are one raw deflate
+ * stream that compresses about as well as a serial one; block CRCs are
+ * combined. Safe to call from a worker of pool.
+ * @return MZ_OK, MZ_PARAM_ERROR for a bad level or MZ_MEM_ERROR
+ */
+int32_t zipDeflate(std::string_view data, int level, ZipDeflatedPart &part,
+                   bookfiler::ThreadPool &pool = bookfiler::defaultThreadPool(),
+                   size_t blockSize = zipDeflateBlockSize);
+
+/* ZipWriter
+ * Writes a zip archive front to back into a sink, so it never seeks. Sizes
+ * and CRC are known before an entry is written and go in its local header;
+ * zip64 records are used only where a size or offset needs them.
+ */
+class ZipWriter {
+public:
+  explicit ZipWriter(ZipSink &sink);
+  ZipWriter(const ZipWriter &) = delete;
+  ZipWriter &operator=(const ZipWriter &) = delete;
+
+  /* Copies an entry of index's archive byte for byte: the compressed data
+   * straight from the mapping, with the CRC and sizes of its central
+   * directory record. Nothing is inflated or checked.
+   * @return MZ_SUPPORT_ERROR for encrypted entries
+   */
+  int32_t copyEntry(const ZipIndex &index, const ZipIndexEntry &entry);
+  /* A part compressed by zipDeflate. dosDateTime 0 uses the current time.
+   */
+  int32_t addPart(std::string_view filePath, const ZipDeflatedPart &part,
+                  uint32_t dosDateTime = 0);
+  /* Writes the central directory. Nothing can be added afterwards. */
+  int32_t finish();
+  uint64_t getBytesWritten() const { return offset + pending.size(); }
+
+private:
+  class Record {
+  public:
+    std::string filePath;
+    uint64_t compressedSize, uncompressedSize, headerOffset;
+    uint32_t crc, dosDateTime;
+    uint16_t flag, compressionMethod;
+  };
+
+  int32_t writeHeader(Record record);
+  int32_t put(const char *data, size_t size);
+  int32_t flush();
+
+  ZipSink &sink;
+  int32_t err = MZ_OK;
+  bool finished = false;
+  // header bytes gathered so small writes reach the sink together
+  std::vector<char> pending;
+  // bytes handed to the sink so far
+  uint64_t offset = 0;
+  std::vector<Record> recordList;
+};
+
+/* Writes source with replacementList applied. Parts keep their order in
+ * source; the ones not replaced are copied with ZipWriter::copyEntry while
+ * pool deflates the replaced ones, and parts source does not have follow at
+ * the end. [Content_Types].xml is not touched, a new kind of part needs it
+ * replaced too.
+ */
+int32_t
+zipRewrite(const ZipIndex &source,
+           const std::vector<ZipReplacement> &replacementList, ZipSink &sink,
+           int level = 6,
+           bookfiler::ThreadPool &pool = bookfiler::defaultThreadPool());
+
+#endif // BOOKFILER_MODULE_DOCX_ZIP_WRITER_H
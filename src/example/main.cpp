@@ -36,20 +36,34 @@ int main(int argc, char *argv[]) {
     std::cout << "Error " << err << ": could not save to file." << std::endl;
   }
 
-  long long resourceSize = 0;
-  err = zipReader->getResourceSize(imagePath, resourceSize);
+  // media is usually stored, read it in place without a copy
+  std::string_view imageView;
+  err = zipReader->getView(imagePath, imageView);
   if (err != MZ_OK) {
-    std::cout << "Error " << err << ": could not get resource size."
+    std::cout << "Error " << err << ": could not get resource view."
               << std::endl;
   }
 
-  char *buffer = new char[resourceSize];
-  err = zipReader->saveToMemory(imagePath, buffer, resourceSize);
+  std::cout << imageView.substr(0, 50) << std::endl;
+
+  // xml parts are deflated, inflate them a chunk at a time
+  ZipInflateStream documentStream;
+  err = zipReader->openStream(documentPath, documentStream);
   if (err != MZ_OK) {
-    std::cout << "Error " << err << ": could not save to memory." << std::endl;
+    std::cout << "Error " << err << ": could not open resource stream."
+              << std::endl;
   }
 
-  std::cout << std::string(buffer, resourceSize).substr(0, 50) << std::endl;
+  std::string_view chunk;
+  long long chunkTotal = 0;
+  while ((err = documentStream.read(chunk)) == MZ_OK)
+    chunkTotal++;
+  if (err != MZ_END_OF_STREAM) {
+    std::cout << "Error " << err << ": could not inflate resource."
+              << std::endl;
+  }
+  std::cout << documentPath << ": " << documentStream.getTotalOut()
+            << " bytes in " << chunkTotal << " chunks" << std::endl;
 
   system("pause");
   return 0;